@@ -21,10 +21,16 @@
 #include <direct.h>
 #endif
 #include <sys/stat.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
 #include <string>
+#include <algorithm>
+#include <vector>
 #include "OnDiskWrapper.h"
 #include "moses/Util.h"
 #include "util/exception.hh"
+#include "util/file.hh"
 #include "util/string_stream.hh"
 
 using namespace std;
@@ -35,6 +41,8 @@ namespace OnDiskPt
 int OnDiskWrapper::VERSION_NUM = 7;
 
 OnDiskWrapper::OnDiskWrapper()
+  :m_mapped(false)
+  ,m_rootSourceNode(NULL)
 {
 }
 
@@ -43,9 +51,9 @@ OnDiskWrapper::~OnDiskWrapper()
   delete m_rootSourceNode;
 }
 
-void OnDiskWrapper::BeginLoad(const std::string &filePath)
+void OnDiskWrapper::BeginLoad(const std::string &filePath, bool useMmap)
 {
-  if (!OpenForLoad(filePath)) {
+  if (!OpenForLoad(filePath, useMmap)) {
     UTIL_THROW(util::FileOpenException, "Couldn't open for loading: " << filePath);
   }
 
@@ -56,22 +64,29 @@ void OnDiskWrapper::BeginLoad(const std::string &filePath)
   m_rootSourceNode = new PhraseNode(rootFilePos, *this);
 }
 
-bool OnDiskWrapper::OpenForLoad(const std::string &filePath)
+bool OnDiskWrapper::OpenForLoad(const std::string &filePath, bool useMmap)
 {
-  m_fileSource.open((filePath + "/Source.dat").c_str(), ios::in | ios::binary);
-  UTIL_THROW_IF(!m_fileSource.is_open(),
-                util::FileOpenException,
-                "Couldn't open file " << filePath << "/Source.dat");
-
-  m_fileTargetInd.open((filePath + "/TargetInd.dat").c_str(), ios::in | ios::binary);
-  UTIL_THROW_IF(!m_fileTargetInd.is_open(),
-                util::FileOpenException,
-                "Couldn't open file " << filePath << "/TargetInd.dat");
-
-  m_fileTargetColl.open((filePath + "/TargetColl.dat").c_str(), ios::in | ios::binary);
-  UTIL_THROW_IF(!m_fileTargetColl.is_open(),
-                util::FileOpenException,
-                "Couldn't open file " << filePath << "/TargetColl.dat");
+  m_mapped = useMmap;
+  if (m_mapped) {
+    MapFile(filePath + "/Source.dat", m_memSource);
+    MapFile(filePath + "/TargetInd.dat", m_memTargetInd);
+    MapFile(filePath + "/TargetColl.dat", m_memTargetColl);
+  } else {
+    m_fileSource.open((filePath + "/Source.dat").c_str(), ios::in | ios::binary);
+    UTIL_THROW_IF(!m_fileSource.is_open(),
+                  util::FileOpenException,
+                  "Couldn't open file " << filePath << "/Source.dat");
+
+    m_fileTargetInd.open((filePath + "/TargetInd.dat").c_str(), ios::in | ios::binary);
+    UTIL_THROW_IF(!m_fileTargetInd.is_open(),
+                  util::FileOpenException,
+                  "Couldn't open file " << filePath << "/TargetInd.dat");
+
+    m_fileTargetColl.open((filePath + "/TargetColl.dat").c_str(), ios::in | ios::binary);
+    UTIL_THROW_IF(!m_fileTargetColl.is_open(),
+                  util::FileOpenException,
+                  "Couldn't open file " << filePath << "/TargetColl.dat");
+  }
 
   m_fileVocab.open((filePath + "/Vocab.dat").c_str(), ios::in);
   UTIL_THROW_IF(!m_fileVocab.is_open(),
@@ -92,6 +107,72 @@ bool OnDiskWrapper::OpenForLoad(const std::string &filePath)
   return true;
 }
 
+void OnDiskWrapper::MapFile(const std::string &path, util::scoped_memory &mem)
+{
+  util::scoped_fd file(util::OpenReadOrThrow(path.c_str()));
+  uint64_t size = util::SizeOrThrow(file.get());
+  // the mapping stays valid after the descriptor is closed
+  util::MapRead(util::LAZY, file.get(), 0, size, mem);
+}
+
+void OnDiskWrapper::PrefetchSourceTrie(size_t numLevels) const
+{
+#ifndef WIN32
+  if (!m_mapped || m_rootSourceNode == NULL) {
+    return;
+  }
+
+  const char *base = m_memSource.begin();
+  const uint64_t pageSize = util::SizePage();
+  const size_t childSize = GetSourceWordSize() + sizeof(uint64_t);
+  const size_t headerSize = sizeof(uint64_t) * 2 + sizeof(float) * GetNumCounts();
+
+  std::vector<uint64_t> level(1, m_rootSourceNode->GetFilePos()), nextLevel;
+  for (size_t depth = 0; depth < numLevels && !level.empty(); ++depth) {
+    // nodes are written children first, so siblings are mostly adjacent.
+    // Merge their page ranges to keep the number of madvise calls down
+    std::sort(level.begin(), level.end());
+    uint64_t adviseBegin = 0, adviseEnd = 0;
+    for (size_t i = 0; i < level.size(); ++i) {
+      uint64_t filePos = level[i];
+      uint64_t numChildren = *(const uint64_t*) (base + filePos);
+      uint64_t begin = filePos - filePos % pageSize;
+      uint64_t end = filePos + PhraseNode::GetNodeSize(numChildren, GetSourceWordSize(), GetNumCounts());
+
+      if (adviseEnd && begin <= adviseEnd) {
+        adviseEnd = std::max(adviseEnd, end);
+      } else {
+        if (adviseEnd) {
+          madvise(const_cast<char*>(base) + adviseBegin, adviseEnd - adviseBegin, MADV_WILLNEED);
+        }
+        adviseBegin = begin;
+        adviseEnd = end;
+      }
+    }
+    if (adviseEnd) {
+      madvise(const_cast<char*>(base) + adviseBegin, adviseEnd - adviseBegin, MADV_WILLNEED);
+    }
+
+    if (depth + 1 == numLevels) {
+      break;
+    }
+
+    // collect the children for the next level
+    nextLevel.clear();
+    for (size_t i = 0; i < level.size(); ++i) {
+      const char *node = base + level[i];
+      uint64_t numChildren = *(const uint64_t*) node;
+      const char *children = node + headerSize;
+      for (uint64_t child = 0; child < numChildren; ++child) {
+        const char *childPtr = children + childSize * child + GetSourceWordSize();
+        nextLevel.push_back(*(const uint64_t*) childPtr);
+      }
+    }
+    level.swap(nextLevel);
+  }
+#endif
+}
+
 bool OnDiskWrapper::LoadMisc()
 {
   char line[100000];
@@ -22,6 +22,7 @@
 #include <fstream>
 #include "Vocab.h"
 #include "PhraseNode.h"
+#include "util/mmap.hh"
 
 namespace OnDiskPt
 {
@@ -39,14 +40,19 @@ protected:
   int m_numSourceFactors, m_numTargetFactors, m_numScores;
   std::fstream m_fileMisc, m_fileVocab, m_fileSource, m_fileTarget, m_fileTargetInd, m_fileTargetColl;
 
+  // read-only mappings of the binary files, used instead of the fstreams if mapped
+  bool m_mapped;
+  util::scoped_memory m_memSource, m_memTargetInd, m_memTargetColl;
+
   size_t m_defaultNodeSize;
   PhraseNode *m_rootSourceNode;
 
   std::map<std::string, uint64_t> m_miscInfo;
 
   void SaveMisc();
-  bool OpenForLoad(const std::string &filePath);
+  bool OpenForLoad(const std::string &filePath, bool useMmap);
   bool LoadMisc();
+  void MapFile(const std::string &path, util::scoped_memory &mem);
 
 public:
   static int VERSION_NUM;
@@ -54,7 +60,14 @@ public:
   OnDiskWrapper();
   ~OnDiskWrapper();
 
-  void BeginLoad(const std::string &filePath);
+  /** Open a rule table for reading.
+   * If useMmap is set, the binary files are memory-mapped instead of read through fstreams.
+   * The wrapper is then read-only and can be shared by all threads.
+   */
+  void BeginLoad(const std::string &filePath, bool useMmap = false);
+
+  //! ask the kernel to read ahead the first numLevels levels of the source trie. Mapped tables only
+  void PrefetchSourceTrie(size_t numLevels) const;
 
   void BeginSave(const std::string &filePath
                  , int numSourceFactors, int	numTargetFactors, int numScores);
@@ -83,6 +96,19 @@ public:
     return m_fileVocab;
   }
 
+  bool IsMapped() const {
+    return m_mapped;
+  }
+  const char *GetMemSource() const {
+    return m_memSource.begin();
+  }
+  const char *GetMemTargetInd() const {
+    return m_memTargetInd.begin();
+  }
+  const char *GetMemTargetColl() const {
+    return m_memTargetColl.begin();
+  }
+
   size_t GetNumSourceFactors() const {
     return m_numSourceFactors;
   }
@@ -42,6 +42,7 @@ PhraseNode::PhraseNode()
   ,m_currChild(NULL)
   ,m_saved(false)
   ,m_memLoad(NULL)
+  ,m_memMapped(false)
 {
 }
 
@@ -53,22 +54,31 @@ PhraseNode::PhraseNode(uint64_t filePos, OnDiskWrapper &onDiskWrapper)
 
   size_t countSize = onDiskWrapper.GetNumCounts();
 
-  std::fstream &file = onDiskWrapper.GetFileSource();
-  file.seekg(filePos);
-  assert(filePos == (uint64_t)file.tellg());
+  if (onDiskWrapper.IsMapped()) {
+    // zero-copy. Children are read straight from the mapping
+    m_memMapped = true;
+    m_memLoad = const_cast<char*>(onDiskWrapper.GetMemSource()) + filePos;
+    m_numChildrenLoad = ((uint64_t*)m_memLoad)[0];
+  } else {
+    m_memMapped = false;
 
-  file.read((char*) &m_numChildrenLoad, sizeof(uint64_t));
+    std::fstream &file = onDiskWrapper.GetFileSource();
+    file.seekg(filePos);
+    assert(filePos == (uint64_t)file.tellg());
 
-  size_t memAlloc = GetNodeSize(m_numChildrenLoad, onDiskWrapper.GetSourceWordSize(), countSize);
-  m_memLoad = (char*) malloc(memAlloc);
+    file.read((char*) &m_numChildrenLoad, sizeof(uint64_t));
 
-  // go to start of node again
-  file.seekg(filePos);
-  assert(filePos == (uint64_t)file.tellg());
+    size_t memAlloc = GetNodeSize(m_numChildrenLoad, onDiskWrapper.GetSourceWordSize(), countSize);
+    m_memLoad = (char*) malloc(memAlloc);
 
-  // read everything into memory
-  file.read(m_memLoad, memAlloc);
-  assert(filePos + memAlloc == (uint64_t)file.tellg());
+    // go to start of node again
+    file.seekg(filePos);
+    assert(filePos == (uint64_t)file.tellg());
+
+    // read everything into memory
+    file.read(m_memLoad, memAlloc);
+    assert(filePos + memAlloc == (uint64_t)file.tellg());
+  }
 
   // get value
   m_value = ((uint64_t*)m_memLoad)[1];
@@ -79,12 +89,14 @@ PhraseNode::PhraseNode(uint64_t filePos, OnDiskWrapper &onDiskWrapper)
   assert(countSize == 1);
   m_counts[0] = memFloat[0];
 
-  m_memLoadLast = m_memLoad + memAlloc;
+  m_memLoadLast = m_memLoad + GetNodeSize(m_numChildrenLoad, onDiskWrapper.GetSourceWordSize(), countSize);
 }
 
 PhraseNode::~PhraseNode()
 {
-  free(m_memLoad);
+  if (!m_memMapped) {
+    free(m_memLoad);
+  }
 }
 
 float PhraseNode::GetCount(size_t ind) const
@@ -49,6 +49,7 @@ protected:
 
   char *m_memLoad, *m_memLoadLast;
   uint64_t m_numChildrenLoad;
+  bool m_memMapped; // m_memLoad points into the mapped source file, not owned
 
   void AddTargetPhrase(size_t pos, const SourcePhrase &sourcePhrase
                        , TargetPhrase *targetPhrase, OnDiskWrapper &onDiskWrapper
@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <cstring>
 #include "moses/Util.h"
 #include "TargetPhraseCollection.h"
 #include "Vocab.h"
@@ -114,6 +115,11 @@ void TargetPhraseCollection::Save(OnDiskWrapper &onDiskWrapper)
 
 void TargetPhraseCollection::ReadFromFile(size_t tableLimit, uint64_t filePos, OnDiskWrapper &onDiskWrapper)
 {
+  if (onDiskWrapper.IsMapped()) {
+    ReadFromMemory(tableLimit, filePos, onDiskWrapper);
+    return;
+  }
+
   fstream &fileTPColl = onDiskWrapper.GetFileTargetColl();
   fstream &fileTP = onDiskWrapper.GetFileTargetInd();
 
@@ -145,6 +151,33 @@ void TargetPhraseCollection::ReadFromFile(size_t tableLimit, uint64_t filePos, O
   }
 }
 
+void TargetPhraseCollection::ReadFromMemory(size_t tableLimit, uint64_t filePos, const OnDiskWrapper &onDiskWrapper)
+{
+  const char *memTPColl = onDiskWrapper.GetMemTargetColl() + filePos;
+  const char *memTP = onDiskWrapper.GetMemTargetInd();
+
+  size_t numScores = onDiskWrapper.GetNumScores();
+
+  uint64_t numPhrases;
+  memcpy(&numPhrases, memTPColl, sizeof(uint64_t));
+  memTPColl += sizeof(uint64_t);
+
+  // table limit
+  if (tableLimit) {
+    numPhrases = std::min(numPhrases, (uint64_t) tableLimit);
+  }
+
+  m_coll.reserve(numPhrases);
+  for (size_t ind = 0; ind < numPhrases; ++ind) {
+    TargetPhrase *tp = new TargetPhrase(numScores);
+
+    memTPColl += tp->ReadOtherInfoFromMemory(memTPColl);
+    tp->ReadFromMemory(memTP);
+
+    m_coll.push_back(tp);
+  }
+}
+
 uint64_t TargetPhraseCollection::GetFilePos() const
 {
   return m_filePos;
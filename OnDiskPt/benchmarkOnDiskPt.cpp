@@ -0,0 +1,186 @@
+// Compare lookup speed of the fstream and the memory-mapped read path of an
+// on-disk rule table, with a cold and a warm page cache.
+//
+// Every sub-phrase of every input line is looked up the way the decoder does:
+// extend the source trie word by word from each start position and read the
+// target phrase collection of each node that is found.
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "moses/Util.h"
+#include "util/file.hh"
+#include "util/usage.hh"
+#include "OnDiskWrapper.h"
+#include "PhraseNode.h"
+#include "Word.h"
+
+using namespace std;
+using namespace OnDiskPt;
+
+namespace
+{
+
+struct RunStats {
+  double loadTime, queryTime;
+  size_t lookups, found, rules;
+};
+
+void usage()
+{
+  std::cerr << "Usage: benchmarkOnDiskPt -t <ttable> -i <source text> [-tlimit <n>] [-prefetch <levels>] [-no-cold]\n"
+            "-t <ttable>          on-disk rule table\n"
+            "-i <source text>     sentences to look up, one per line\n"
+            "-tlimit <n>          max number of rules per source phrase (default: 20)\n"
+            "-prefetch <levels>   trie levels to madvise when mapped (default: 2)\n"
+            "-no-cold             skip the runs with an evicted page cache\n";
+  exit(1);
+}
+
+// Drop the table files from the page cache. Only clean, unmapped pages go,
+// so no table may be open when this is called.
+void EvictFromPageCache(const std::string &ttable)
+{
+  const char *files[] = { "/Source.dat", "/TargetInd.dat", "/TargetColl.dat" };
+  for (size_t i = 0; i < 3; ++i) {
+    util::scoped_fd file(util::OpenReadOrThrow((ttable + files[i]).c_str()));
+#ifdef POSIX_FADV_DONTNEED
+    fdatasync(file.get());
+    posix_fadvise(file.get(), 0, 0, POSIX_FADV_DONTNEED);
+#endif
+  }
+}
+
+RunStats Run(const std::string &ttable, const std::vector<std::vector<std::string> > &sentences
+             , size_t tableLimit, bool useMmap, size_t prefetchLevels)
+{
+  RunStats stats;
+  stats.lookups = stats.found = stats.rules = 0;
+
+  double start = util::WallTime();
+  OnDiskWrapper wrapper;
+  wrapper.BeginLoad(ttable, useMmap);
+  wrapper.PrefetchSourceTrie(prefetchLevels);
+  stats.loadTime = util::WallTime() - start;
+
+  start = util::WallTime();
+  for (size_t sent = 0; sent < sentences.size(); ++sent) {
+    const std::vector<std::string> &tokens = sentences[sent];
+
+    // vocab ids of the sentence. Unknown words can't start or extend a phrase
+    std::vector<uint64_t> vocabIds(tokens.size());
+    std::vector<bool> known(tokens.size());
+    for (size_t pos = 0; pos < tokens.size(); ++pos) {
+      bool found;
+      vocabIds[pos] = wrapper.GetVocab().GetVocabId(tokens[pos], found);
+      known[pos] = found;
+    }
+
+    for (size_t startPos = 0; startPos < tokens.size(); ++startPos) {
+      const PhraseNode *prevNode = &wrapper.GetRootSourceNode();
+      for (size_t endPos = startPos; endPos < tokens.size() && known[endPos]; ++endPos) {
+        Word word(false);
+        word.SetVocabId(vocabIds[endPos]);
+
+        ++stats.lookups;
+        const PhraseNode *node = prevNode->GetChild(word, wrapper);
+        if (prevNode != &wrapper.GetRootSourceNode()) {
+          delete prevNode;
+        }
+        if (node == NULL) {
+          prevNode = NULL;
+          break;
+        }
+
+        ++stats.found;
+        TargetPhraseCollection::shared_ptr coll = node->GetTargetPhraseCollection(tableLimit, wrapper);
+        stats.rules += coll->GetSize();
+
+        prevNode = node;
+      }
+
+      if (prevNode && prevNode != &wrapper.GetRootSourceNode()) {
+        delete prevNode;
+      }
+    }
+  }
+  stats.queryTime = util::WallTime() - start;
+
+  return stats;
+}
+
+void Report(const std::string &mode, const std::string &cache, const RunStats &stats)
+{
+  std::cout << "mode=" << mode
+            << "\tcache=" << cache
+            << "\tload_s=" << stats.loadTime
+            << "\tquery_s=" << stats.queryTime
+            << "\tlookups=" << stats.lookups
+            << "\tlookups_per_s=" << (stats.queryTime > 0 ? stats.lookups / stats.queryTime : 0)
+            << "\tfound=" << stats.found
+            << "\trules=" << stats.rules
+            << std::endl;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+  size_t tableLimit = 20, prefetchLevels = 2;
+  std::string ttable, inputPath;
+  bool cold = true;
+
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "-tlimit")) {
+      if(i + 1 == argc)
+        usage();
+      tableLimit = atoi(argv[++i]);
+    } else if(!strcmp(argv[i], "-prefetch")) {
+      if(i + 1 == argc)
+        usage();
+      prefetchLevels = atoi(argv[++i]);
+    } else if(!strcmp(argv[i], "-t")) {
+      if(i + 1 == argc)
+        usage();
+      ttable = argv[++i];
+    } else if(!strcmp(argv[i], "-i")) {
+      if(i + 1 == argc)
+        usage();
+      inputPath = argv[++i];
+    } else if(!strcmp(argv[i], "-no-cold")) {
+      cold = false;
+    } else
+      usage();
+  }
+
+  if(ttable == "" || inputPath == "")
+    usage();
+
+  std::vector<std::vector<std::string> > sentences;
+  std::ifstream input(inputPath.c_str());
+  UTIL_THROW_IF(!input.is_open(), util::FileOpenException, "Couldn't open file " << inputPath);
+  std::string line;
+  while(getline(input, line)) {
+    sentences.push_back(Moses::Tokenize(line, " "));
+  }
+
+  for (size_t i = 0; i < 2; ++i) {
+    bool useMmap = (i == 1);
+    std::string mode = useMmap ? "mmap" : "fstream";
+
+    if (cold) {
+      EvictFromPageCache(ttable);
+      Report(mode, "cold", Run(ttable, sentences, tableLimit, useMmap, prefetchLevels));
+    }
+
+    // second run of the same mode sees the pages the first one brought in
+    Report(mode, "warm", Run(ttable, sentences, tableLimit, useMmap, prefetchLevels));
+  }
+}
@@ -16,6 +16,9 @@
 #include "PhrasePenalty.h"
 #include "WordPenalty.h"
 #include "OSM/OpSequenceModel.h"
+#include "PhrasePairFeature.h"
+#include "TargetNgramFeature.h"
+#include "WordTranslationFeature.h"
 
 #include "SkeletonStatefulFF.h"
 #include "SkeletonStatelessFF.h"
@@ -70,6 +73,9 @@ FeatureRegistry::FeatureRegistry()
   MOSES_FNAME(PhrasePenalty);
   MOSES_FNAME(WordPenalty);
   MOSES_FNAME(OpSequenceModel);
+  MOSES_FNAME(PhrasePairFeature);
+  MOSES_FNAME(TargetNgramFeature);
+  MOSES_FNAME(WordTranslationFeature);
 
   MOSES_FNAME(SkeletonStatefulFF);
   MOSES_FNAME(SkeletonStatelessFF);
@@ -0,0 +1,113 @@
+#include <boost/foreach.hpp>
+#include "PhrasePairFeature.h"
+#include "../System.h"
+#include "../Scores.h"
+#include "../TargetPhrase.h"
+#include "../SCFG/Word.h"
+#include "../PhraseBased/TargetPhraseImpl.h"
+#include "../legacy/Util2.h"
+
+using namespace std;
+
+namespace Moses2
+{
+
+PhrasePairFeature::PhrasePairFeature(size_t startInd, const std::string &line) :
+    StatelessFeatureFunction(startInd, line)
+    , m_sourceFactorId(0)
+    , m_targetFactorId(0)
+{
+  ReadParameters();
+}
+
+PhrasePairFeature::~PhrasePairFeature()
+{
+}
+
+void PhrasePairFeature::SetParameter(const std::string& key,
+    const std::string& value)
+{
+  if (key == "input-factor") {
+    m_sourceFactorId = Scan<FactorType>(value);
+  }
+  else if (key == "output-factor") {
+    m_targetFactorId = Scan<FactorType>(value);
+  }
+  else if (key == "simple") {
+    UTIL_THROW_IF2(!Scan<bool>(value), GetName() << ": only simple phrase pair features are supported");
+  }
+  else if (key == "source-context" || key == "domain-trigger") {
+    UTIL_THROW_IF2(Scan<bool>(value), GetName() << ": " << key << " is not supported");
+  }
+  else if (key == "unrestricted" || key == "ignore-punctuation" || key == "path") {
+    // only used by the source context and domain trigger features
+  }
+  else {
+    StatelessFeatureFunction::SetParameter(key, value);
+  }
+}
+
+void PhrasePairFeature::Load(System &system)
+{
+  typedef pair<string, SCORE> SparseWeight;
+  BOOST_FOREACH(const SparseWeight &weight, system.weights.GetSparseWeights(*this)) {
+    size_t sep = weight.first.find("~~");
+    UTIL_THROW_IF2(sep == string::npos, GetName() << ": not a phrase pair feature: " << weight.first);
+
+    SparseFeatureWeights::Key key;
+    SparseFeatureWeights::ToFactors(key, system, weight.first.substr(0, sep), "~", "<TILDE>");
+    key.push_back(NULL);
+    SparseFeatureWeights::ToFactors(key, system, weight.first.substr(sep + 2), "~", "<TILDE>");
+    m_weights.Add(key, weight.second);
+  }
+}
+
+template<typename WORD>
+void PhrasePairFeature::Evaluate(const System &system,
+    const Phrase<WORD> &source, const TargetPhrase<WORD> &targetPhrase,
+    Scores &scores) const
+{
+  if (m_weights.GetSize() == 0) {
+    return;
+  }
+
+  // source words, NULL, target words. The pool may be the system pool when
+  // the phrase table is loaded, so don't take the key from it
+  size_t size = source.GetSize() + 1 + targetPhrase.GetSize();
+  const Factor *shortKey[32];
+  std::vector<const Factor*> longKey;
+  if (size > 32) {
+    longKey.resize(size);
+  }
+  const Factor **key = size > 32 ? &longKey[0] : shortKey;
+  const Factor **out = key;
+  for (size_t i = 0; i < source.GetSize(); ++i) {
+    *out++ = source[i][m_sourceFactorId];
+  }
+  *out++ = NULL;
+  for (size_t i = 0; i < targetPhrase.GetSize(); ++i) {
+    *out++ = targetPhrase[i][m_targetFactorId];
+  }
+
+  SCORE score = m_weights.Find(key, size);
+  if (score) {
+    scores.PlusEquals(system, *this, score);
+  }
+}
+
+void PhrasePairFeature::EvaluateInIsolation(MemPool &pool, const System &system,
+    const Phrase<Moses2::Word> &source, const TargetPhraseImpl &targetPhrase,
+    Scores &scores, SCORE &estimatedScore) const
+{
+  Evaluate(system, source, targetPhrase, scores);
+}
+
+void PhrasePairFeature::EvaluateInIsolation(MemPool &pool, const System &system,
+    const Phrase<SCFG::Word> &source, const TargetPhrase<SCFG::Word> &targetPhrase,
+    Scores &scores, SCORE &estimatedScore) const
+{
+  Evaluate(system, source, targetPhrase, scores);
+}
+
+}
+
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "StatelessFeatureFunction.h"
+#include "SparseFeatureWeights.h"
+
+namespace Moses2
+{
+
+/** Sparse feature for each phrase pair, named
+ *  <name>_src1~src2~~tgt1~tgt2 as in moses. Only the simple phrase pair
+ *  features are supported. The single dense score is the weighted sum of the
+ *  features that fire; features without a weight in the [weight] section or
+ *  weight-file are ignored.
+ */
+class PhrasePairFeature: public StatelessFeatureFunction
+{
+public:
+  PhrasePairFeature(size_t startInd, const std::string &line);
+  virtual ~PhrasePairFeature();
+
+  virtual void Load(System &system);
+
+  virtual void
+  EvaluateInIsolation(MemPool &pool, const System &system, const Phrase<Moses2::Word> &source,
+      const TargetPhraseImpl &targetPhrase, Scores &scores,
+      SCORE &estimatedScore) const;
+
+  virtual void
+  EvaluateInIsolation(MemPool &pool, const System &system, const Phrase<SCFG::Word> &source,
+      const TargetPhrase<SCFG::Word> &targetPhrase, Scores &scores,
+      SCORE &estimatedScore) const;
+
+  virtual void SetParameter(const std::string& key, const std::string& value);
+
+protected:
+  FactorType m_sourceFactorId, m_targetFactorId;
+  SparseFeatureWeights m_weights;
+
+  template<typename WORD>
+  void Evaluate(const System &system, const Phrase<WORD> &source,
+      const TargetPhrase<WORD> &targetPhrase, Scores &scores) const;
+};
+
+}
+
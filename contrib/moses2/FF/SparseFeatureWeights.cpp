@@ -0,0 +1,50 @@
+#include "SparseFeatureWeights.h"
+#include "../System.h"
+#include "../legacy/FactorCollection.h"
+
+using namespace std;
+
+namespace Moses2
+{
+
+void SparseFeatureWeights::Add(const Key &key, SCORE weight)
+{
+  m_weights[key] = weight;
+}
+
+SCORE SparseFeatureWeights::Find(const Factor * const *begin, size_t size) const
+{
+  Range range;
+  range.begin = begin;
+  range.size = size;
+
+  Coll::const_iterator iter = m_weights.find(range, Hasher(), Equals());
+  return iter == m_weights.end() ? 0 : iter->second;
+}
+
+void SparseFeatureWeights::ToFactors(Key &key, const System &system,
+    const std::string &name, const std::string &sep, const std::string &unescape)
+{
+  FactorCollection &vocab = system.GetVocab();
+
+  size_t begin = 0;
+  while (true) {
+    size_t end = name.find(sep, begin);
+    string word = name.substr(begin, end == string::npos ? string::npos : end - begin);
+
+    if (!unescape.empty()) {
+      size_t pos = word.find(unescape);
+      while (pos != string::npos) {
+        word.replace(pos, unescape.size(), sep);
+        pos = word.find(unescape, pos + sep.size());
+      }
+    }
+    key.push_back(vocab.AddFactor(word, system, false));
+
+    if (end == string::npos) break;
+    begin = end + sep.size();
+  }
+}
+
+}
+
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+#include "../TypeDef.h"
+
+namespace Moses2
+{
+class Factor;
+class System;
+
+/** Weights of sparse features that are named by a sequence of words, eg. the
+ *  phrase pairs of PhrasePairFeature or the n-grams of TargetNgramFeature.
+ *  The names are turned into factors once, when the feature function is
+ *  loaded, so the decoder looks features up by factor pointer and never
+ *  builds a name. Features without a weight don't change the score, so they
+ *  aren't stored. NULL can be used to separate parts of a name.
+ */
+class SparseFeatureWeights
+{
+public:
+  typedef std::vector<const Factor*> Key;
+
+  void Add(const Key &key, SCORE weight);
+
+  // 0 if the feature has no weight
+  SCORE Find(const Factor * const *begin, size_t size) const;
+
+  SCORE Find(const Key &key) const
+  {
+    return key.empty() ? 0 : Find(&key[0], key.size());
+  }
+
+  size_t GetSize() const
+  {
+    return m_weights.size();
+  }
+
+  // split name at each occurrence of sep and add each part to the vocab.
+  // unescape, if given, is replaced by sep in each part
+  static void ToFactors(Key &key, const System &system, const std::string &name,
+      const std::string &sep, const std::string &unescape = "");
+
+protected:
+  struct Range
+  {
+    const Factor * const *begin;
+    size_t size;
+  };
+
+  struct Hasher
+  {
+    size_t operator()(const Key &key) const
+    {
+      return boost::hash_range(key.begin(), key.end());
+    }
+    size_t operator()(const Range &range) const
+    {
+      return boost::hash_range(range.begin, range.begin + range.size);
+    }
+  };
+
+  struct Equals
+  {
+    bool operator()(const Key &a, const Key &b) const
+    {
+      return a == b;
+    }
+    bool operator()(const Range &a, const Key &b) const
+    {
+      return a.size == b.size() && std::equal(a.begin, a.begin + a.size, b.begin());
+    }
+  };
+
+  typedef boost::unordered_map<Key, SCORE, Hasher, Equals> Coll;
+  Coll m_weights;
+};
+
+}
+
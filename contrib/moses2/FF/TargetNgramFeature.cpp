@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include <boost/foreach.hpp>
+#include <boost/functional/hash.hpp>
+#include "TargetNgramFeature.h"
+#include "../System.h"
+#include "../Scores.h"
+#include "../MemPool.h"
+#include "../PhraseBased/Manager.h"
+#include "../PhraseBased/Hypothesis.h"
+#include "../legacy/Bitmap.h"
+#include "../legacy/Factor.h"
+#include "../legacy/FactorCollection.h"
+#include "../legacy/InputFileStream.h"
+#include "../legacy/Util2.h"
+
+using namespace std;
+
+namespace Moses2
+{
+
+// the last n-1 words of the hypothesis, starting with <s>. Empty once the
+// hypothesis is complete
+class TargetNgramState: public FFState
+{
+public:
+  const Factor **words;
+  size_t size;
+
+  TargetNgramState(MemPool &pool, size_t maxSize)
+  :words(pool.Allocate<const Factor*>(maxSize))
+  ,size(0)
+  {
+  }
+
+  virtual size_t hash() const
+  {
+    return boost::hash_range(words, words + size);
+  }
+
+  virtual bool operator==(const FFState& o) const
+  {
+    const TargetNgramState& other = static_cast<const TargetNgramState&>(o);
+    return size == other.size && std::equal(words, words + size, other.words);
+  }
+
+  virtual std::string ToString() const
+  {
+    stringstream sb;
+    for (size_t i = 0; i < size; ++i) {
+      sb << *words[i] << " ";
+    }
+    return sb.str();
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////
+TargetNgramFeature::TargetNgramFeature(size_t startInd, const std::string &line) :
+    StatefulFeatureFunction(startInd, line)
+    , m_factorType(0)
+    , m_n(0)
+    , m_lowerNgrams(false)
+    , m_bos(NULL)
+    , m_eos(NULL)
+{
+  ReadParameters();
+  UTIL_THROW_IF2(m_n == 0, GetName() << ": n must be set");
+}
+
+TargetNgramFeature::~TargetNgramFeature()
+{
+}
+
+void TargetNgramFeature::SetParameter(const std::string& key,
+    const std::string& value)
+{
+  if (key == "factor") {
+    m_factorType = Scan<FactorType>(value);
+  }
+  else if (key == "n") {
+    m_n = Scan<size_t>(value);
+  }
+  else if (key == "lower-ngrams") {
+    m_lowerNgrams = Scan<bool>(value);
+  }
+  else if (key == "file") {
+    m_file = value;
+  }
+  else {
+    StatefulFeatureFunction::SetParameter(key, value);
+  }
+}
+
+void TargetNgramFeature::Load(System &system)
+{
+  FactorCollection &vocab = system.GetVocab();
+  m_bos = vocab.AddFactor(BOS_, system, false);
+  m_eos = vocab.AddFactor(EOS_, system, false);
+
+  if (!m_file.empty() && m_file != "*") {
+    m_vocab.insert(m_bos);
+    m_vocab.insert(m_eos);
+
+    InputFileStream file(m_file);
+    string line;
+    while (getline(file, line)) {
+      m_vocab.insert(vocab.AddFactor(line, system, false));
+    }
+  }
+
+  typedef pair<string, SCORE> SparseWeight;
+  BOOST_FOREACH(const SparseWeight &weight, system.weights.GetSparseWeights(*this)) {
+    SparseFeatureWeights::Key key;
+    SparseFeatureWeights::ToFactors(key, system, weight.first, ":");
+    m_weights.Add(key, weight.second);
+  }
+}
+
+FFState* TargetNgramFeature::BlankState(MemPool &pool, const System &sys) const
+{
+  return new (pool.Allocate<TargetNgramState>()) TargetNgramState(pool, std::max<size_t>(m_n - 1, 1));
+}
+
+void TargetNgramFeature::EmptyHypothesisState(FFState &state,
+    const ManagerBase &mgr, const InputType &input,
+    const Hypothesis &hypo) const
+{
+  TargetNgramState &stateCast = static_cast<TargetNgramState&>(state);
+  stateCast.words[0] = m_bos;
+  stateCast.size = 1;
+}
+
+void TargetNgramFeature::EvaluateInIsolation(MemPool &pool,
+    const System &system, const Phrase<Moses2::Word> &source,
+    const TargetPhraseImpl &targetPhrase, Scores &scores,
+    SCORE &estimatedScore) const
+{
+}
+
+void TargetNgramFeature::EvaluateInIsolation(MemPool &pool, const System &system, const Phrase<SCFG::Word> &source,
+    const TargetPhrase<SCFG::Word> &targetPhrase, Scores &scores,
+    SCORE &estimatedScore) const
+{
+}
+
+void TargetNgramFeature::EvaluateWhenApplied(const ManagerBase &mgr,
+    const Hypothesis &hypo, const FFState &prevState, Scores &scores,
+    FFState &state) const
+{
+  const TargetNgramState &prevStateCast = static_cast<const TargetNgramState&>(prevState);
+  TargetNgramState &stateCast = static_cast<TargetNgramState&>(state);
+  const TargetPhrase<Moses2::Word> &tp = hypo.GetTargetPhrase();
+  bool isComplete = hypo.GetBitmap().IsComplete();
+
+  // context from the previous state, the new words, then </s> if the
+  // hypothesis is complete
+  size_t prevSize = prevStateCast.size;
+  const Factor *shortWords[32];
+  std::vector<const Factor*> longWords;
+  if (prevSize + tp.GetSize() + 1 > 32) {
+    longWords.resize(prevSize + tp.GetSize() + 1);
+  }
+  const Factor **words = longWords.empty() ? shortWords : &longWords[0];
+  std::copy(prevStateCast.words, prevStateCast.words + prevSize, words);
+  size_t size = prevSize;
+  for (size_t i = 0; i < tp.GetSize(); ++i) {
+    words[size++] = tp[i][m_factorType];
+  }
+  size_t end = size;
+  if (isComplete) {
+    words[end++] = m_eos;
+  }
+
+  // every n-gram ending in a new word
+  SCORE score = 0;
+  size_t smallest = m_lowerNgrams ? 1 : m_n;
+  for (size_t pos = prevSize; pos < end && m_weights.GetSize(); ++pos) {
+    for (size_t n = 1; n <= m_n && n <= pos + 1; ++n) {
+      const Factor *first = words[pos + 1 - n];
+      if (m_vocab.size() && m_vocab.find(first) == m_vocab.end()) {
+        // so do all longer n-grams
+        break;
+      }
+      if (n < smallest || (n == 1 && first == m_eos)) {
+        continue;
+      }
+      score += m_weights.Find(words + pos + 1 - n, n);
+    }
+  }
+
+  if (score) {
+    scores.PlusEquals(mgr.system, *this, score);
+  }
+
+  if (isComplete) {
+    stateCast.size = 0;
+  }
+  else {
+    stateCast.size = std::min(size, m_n - 1);
+    std::copy(words + size - stateCast.size, words + size, stateCast.words);
+  }
+}
+
+void TargetNgramFeature::EvaluateWhenApplied(const SCFG::Manager &mgr,
+    const SCFG::Hypothesis &hypo, int featureID, Scores &scores,
+    FFState &state) const
+{
+  UTIL_THROW2("Not implemented");
+}
+
+}
+
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <boost/unordered_set.hpp>
+#include "StatefulFeatureFunction.h"
+#include "SparseFeatureWeights.h"
+
+namespace Moses2
+{
+
+/** Sparse feature for each target n-gram, named <name>_w1:w2:w3 as in moses.
+ *  With lower-ngrams, the shorter n-grams ending at each word fire too. With
+ *  file, only n-grams made of the words listed in it fire. The single dense
+ *  score is the weighted sum of the features that fire. Phrase-based only.
+ */
+class TargetNgramFeature: public StatefulFeatureFunction
+{
+public:
+  TargetNgramFeature(size_t startInd, const std::string &line);
+  virtual ~TargetNgramFeature();
+
+  virtual void Load(System &system);
+
+  virtual FFState* BlankState(MemPool &pool, const System &sys) const;
+  virtual void EmptyHypothesisState(FFState &state, const ManagerBase &mgr,
+      const InputType &input, const Hypothesis &hypo) const;
+
+  virtual void
+  EvaluateInIsolation(MemPool &pool, const System &system, const Phrase<Moses2::Word> &source,
+      const TargetPhraseImpl &targetPhrase, Scores &scores,
+      SCORE &estimatedScore) const;
+
+  virtual void
+  EvaluateInIsolation(MemPool &pool, const System &system, const Phrase<SCFG::Word> &source,
+      const TargetPhrase<SCFG::Word> &targetPhrase, Scores &scores,
+      SCORE &estimatedScore) const;
+
+  virtual void EvaluateWhenApplied(const ManagerBase &mgr,
+      const Hypothesis &hypo, const FFState &prevState, Scores &scores,
+      FFState &state) const;
+
+  virtual void EvaluateWhenApplied(const SCFG::Manager &mgr,
+      const SCFG::Hypothesis &hypo, int featureID, Scores &scores,
+      FFState &state) const;
+
+  virtual void SetParameter(const std::string& key, const std::string& value);
+
+protected:
+  FactorType m_factorType;
+  size_t m_n;
+  bool m_lowerNgrams;
+  std::string m_file;
+
+  const Factor *m_bos, *m_eos;
+
+  // empty if all words are allowed
+  boost::unordered_set<const Factor*> m_vocab;
+
+  SparseFeatureWeights m_weights;
+};
+
+}
+
@@ -0,0 +1,168 @@
+#include <cstring>
+#include <boost/foreach.hpp>
+#include "WordTranslationFeature.h"
+#include "../System.h"
+#include "../Scores.h"
+#include "../TargetPhrase.h"
+#include "../AlignmentInfo.h"
+#include "../SCFG/Word.h"
+#include "../PhraseBased/TargetPhraseImpl.h"
+#include "../legacy/Factor.h"
+#include "../legacy/FactorCollection.h"
+#include "../legacy/InputFileStream.h"
+#include "../legacy/Util2.h"
+
+using namespace std;
+
+namespace Moses2
+{
+
+namespace
+{
+// same characters as moses. Only the first byte of a word is checked, so
+// the multi-byte characters stand for their leading bytes
+const char kPunctuation[] = "\"'!?¿·()#_,.:;•&@‑/\\0123456789~=";
+
+inline bool IsNonTerminal(const Moses2::Word &word)
+{
+  return false;
+}
+
+inline bool IsNonTerminal(const SCFG::Word &word)
+{
+  return word.isNonTerminal;
+}
+}
+
+WordTranslationFeature::WordTranslationFeature(size_t startInd, const std::string &line) :
+    StatelessFeatureFunction(startInd, line)
+    , m_factorTypeSource(0)
+    , m_factorTypeTarget(0)
+    , m_ignorePunctuation(false)
+    , m_other(NULL)
+{
+  ReadParameters();
+}
+
+WordTranslationFeature::~WordTranslationFeature()
+{
+}
+
+void WordTranslationFeature::SetParameter(const std::string& key,
+    const std::string& value)
+{
+  if (key == "input-factor") {
+    m_factorTypeSource = Scan<FactorType>(value);
+  }
+  else if (key == "output-factor") {
+    m_factorTypeTarget = Scan<FactorType>(value);
+  }
+  else if (key == "simple") {
+    UTIL_THROW_IF2(!Scan<bool>(value), GetName() << ": only simple word translation features are supported");
+  }
+  else if (key == "source-context" || key == "target-context" || key == "domain-trigger") {
+    UTIL_THROW_IF2(Scan<bool>(value), GetName() << ": " << key << " is not supported");
+  }
+  else if (key == "ignore-punctuation") {
+    m_ignorePunctuation = Scan<bool>(value);
+  }
+  else if (key == "texttype") {
+    // not used, as in moses
+  }
+  else if (key == "source-path") {
+    m_filePathSource = value;
+  }
+  else if (key == "target-path") {
+    m_filePathTarget = value;
+  }
+  else {
+    StatelessFeatureFunction::SetParameter(key, value);
+  }
+}
+
+void WordTranslationFeature::Load(System &system)
+{
+  if (!m_filePathSource.empty()) {
+    LoadVocab(system, m_filePathSource, m_vocabSource);
+    LoadVocab(system, m_filePathTarget, m_vocabTarget);
+    m_other = system.GetVocab().AddFactor("OTHER", system, false);
+  }
+
+  typedef pair<string, SCORE> SparseWeight;
+  BOOST_FOREACH(const SparseWeight &weight, system.weights.GetSparseWeights(*this)) {
+    SparseFeatureWeights::Key key;
+    SparseFeatureWeights::ToFactors(key, system, weight.first, "~");
+    UTIL_THROW_IF2(key.size() != 2, GetName() << ": not a word translation feature: " << weight.first);
+    m_weights.Add(key, weight.second);
+  }
+}
+
+void WordTranslationFeature::LoadVocab(System &system, const std::string &path,
+    Vocab &vocab)
+{
+  InputFileStream file(path);
+  string line;
+  while (getline(file, line)) {
+    vocab.insert(system.GetVocab().AddFactor(line, system, false));
+  }
+}
+
+bool WordTranslationFeature::IsPunctuation(const Factor *factor) const
+{
+  StringPiece str = factor->GetString();
+  return str.size() && strchr(kPunctuation, str[0]) != NULL;
+}
+
+template<typename WORD>
+void WordTranslationFeature::Evaluate(const System &system,
+    const Phrase<WORD> &source, const TargetPhrase<WORD> &targetPhrase,
+    Scores &scores) const
+{
+  if (m_weights.GetSize() == 0) {
+    return;
+  }
+
+  SCORE score = 0;
+  const AlignmentInfo &alignment = targetPhrase.GetAlignTerm();
+  for (AlignmentInfo::const_iterator iter = alignment.begin();
+      iter != alignment.end(); ++iter) {
+    const WORD &sourceWord = source[iter->first];
+    const WORD &targetWord = targetPhrase[iter->second];
+    if (IsNonTerminal(sourceWord) || IsNonTerminal(targetWord)) {
+      continue;
+    }
+
+    const Factor *key[2] = { sourceWord[m_factorTypeSource], targetWord[m_factorTypeTarget] };
+    if (m_ignorePunctuation && (IsPunctuation(key[0]) || IsPunctuation(key[1]))) {
+      continue;
+    }
+
+    if (m_other) {
+      if (m_vocabSource.find(key[0]) == m_vocabSource.end()) key[0] = m_other;
+      if (m_vocabTarget.find(key[1]) == m_vocabTarget.end()) key[1] = m_other;
+    }
+
+    score += m_weights.Find(key, 2);
+  }
+
+  if (score) {
+    scores.PlusEquals(system, *this, score);
+  }
+}
+
+void WordTranslationFeature::EvaluateInIsolation(MemPool &pool, const System &system,
+    const Phrase<Moses2::Word> &source, const TargetPhraseImpl &targetPhrase,
+    Scores &scores, SCORE &estimatedScore) const
+{
+  Evaluate(system, source, targetPhrase, scores);
+}
+
+void WordTranslationFeature::EvaluateInIsolation(MemPool &pool, const System &system,
+    const Phrase<SCFG::Word> &source, const TargetPhrase<SCFG::Word> &targetPhrase,
+    Scores &scores, SCORE &estimatedScore) const
+{
+  Evaluate(system, source, targetPhrase, scores);
+}
+
+}
+
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <boost/unordered_set.hpp>
+#include "StatelessFeatureFunction.h"
+#include "SparseFeatureWeights.h"
+
+namespace Moses2
+{
+
+/** Sparse feature for each aligned word pair of a phrase pair, named
+ *  <name>_src~tgt as in moses. With source-path and target-path, words that
+ *  aren't in those lists are called OTHER. Only the simple word translation
+ *  features are supported. The single dense score is the weighted sum of the
+ *  features that fire.
+ */
+class WordTranslationFeature: public StatelessFeatureFunction
+{
+public:
+  WordTranslationFeature(size_t startInd, const std::string &line);
+  virtual ~WordTranslationFeature();
+
+  virtual void Load(System &system);
+
+  virtual void
+  EvaluateInIsolation(MemPool &pool, const System &system, const Phrase<Moses2::Word> &source,
+      const TargetPhraseImpl &targetPhrase, Scores &scores,
+      SCORE &estimatedScore) const;
+
+  virtual void
+  EvaluateInIsolation(MemPool &pool, const System &system, const Phrase<SCFG::Word> &source,
+      const TargetPhrase<SCFG::Word> &targetPhrase, Scores &scores,
+      SCORE &estimatedScore) const;
+
+  virtual void SetParameter(const std::string& key, const std::string& value);
+
+protected:
+  typedef boost::unordered_set<const Factor*> Vocab;
+
+  FactorType m_factorTypeSource, m_factorTypeTarget;
+  bool m_ignorePunctuation;
+  std::string m_filePathSource, m_filePathTarget;
+
+  // empty if unrestricted
+  Vocab m_vocabSource, m_vocabTarget;
+  const Factor *m_other;
+
+  SparseFeatureWeights m_weights;
+
+  void LoadVocab(System &system, const std::string &path, Vocab &vocab);
+  bool IsPunctuation(const Factor *factor) const;
+
+  template<typename WORD>
+  void Evaluate(const System &system, const Phrase<WORD> &source,
+      const TargetPhrase<WORD> &targetPhrase, Scores &scores) const;
+};
+
+}
+
@@ -82,10 +82,24 @@ void batch_run(Moses2::Parameter &params, Moses2::System &system, Moses2::Thread
 {
   istream &inStream = GetInputStream(params);
 
+  size_t batchSize = system.options.search.batch_sentences;
+
   long translationId = 0;
   string line;
+  vector<string> lines;
   while (getline(inStream, line)) {
     //cerr << "line=" << line << endl;
+    if (batchSize > 1) {
+      lines.push_back(line);
+      if (lines.size() == batchSize) {
+        boost::shared_ptr<Moses2::TranslationTask> task(new Moses2::BatchTranslationTask(system, lines, translationId + 1 - lines.size()));
+        pool.Submit(task);
+        lines.clear();
+      }
+      ++translationId;
+      continue;
+    }
+
       boost::shared_ptr<Moses2::TranslationTask> task(new Moses2::TranslationTask(system, line, translationId));
 
     //cerr << "START pool.Submit()" << endl;
@@ -94,13 +108,18 @@ void batch_run(Moses2::Parameter &params, Moses2::System &system, Moses2::Thread
     ++translationId;
   }
 
+  if (lines.size()) {
+    boost::shared_ptr<Moses2::TranslationTask> task(new Moses2::BatchTranslationTask(system, lines, translationId - lines.size()));
+    pool.Submit(task);
+  }
+
   pool.Stop(true);
 
   if (&inStream != &cin) {
     delete &inStream;
   }
 
-  //util::PrintUsage(std::cerr);
+  util::PrintUsage(std::cerr);
 
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////
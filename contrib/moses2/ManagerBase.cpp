@@ -29,6 +29,7 @@ ManagerBase::ManagerBase(System &sys, const TranslationTask &task,
 ,m_pool(NULL)
 ,m_systemPool(NULL)
 ,m_hypoRecycle(NULL)
+,m_sharedPools(false)
 {
 }
 
@@ -36,6 +37,9 @@ ManagerBase::~ManagerBase()
 {
   system.featureFunctions.CleanUpAfterSentenceProcessing();
 
+  if (m_sharedPools) {
+	  return;
+  }
   if (m_pool) {
 	  GetPool().Reset();
   }
@@ -60,6 +60,11 @@ public:
   long GetTranslationId() const
   {  return m_translationId; }
 
+  // Managers decoded together share the thread's pools. Their task resets the
+  // pools once the last of them is deleted, instead of each destructor.
+  void SetSharedPools()
+  {  m_sharedPools = true; }
+
 protected:
   std::string m_inputStr;
   long m_translationId;
@@ -67,6 +72,7 @@ protected:
 
   mutable MemPool *m_pool, *m_systemPool;
   mutable Recycler<HypothesisBase*> *m_hypoRecycle;
+  bool m_sharedPools;
 
   void InitPools();
 
@@ -0,0 +1,97 @@
+/*
+ * Scheduler.cpp
+ *
+ */
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include "Scheduler.h"
+#include "Search.h"
+#include "../Manager.h"
+#include "../../System.h"
+#include "../../TranslationModel/PhraseTable.h"
+
+using namespace std;
+
+namespace Moses2
+{
+namespace NSBatch
+{
+
+Scheduler::Scheduler(const std::vector<Manager*> &mgrs)
+:m_mgrs(mgrs)
+{
+}
+
+Scheduler::~Scheduler()
+{
+}
+
+void Scheduler::Decode()
+{
+	if (m_mgrs.empty()) {
+		return;
+	}
+	const System &system = m_mgrs[0]->system;
+
+	BOOST_FOREACH(Manager *mgr, m_mgrs) {
+		mgr->InitInput();
+	}
+
+	// lookup with every pt, one table at a time
+	const std::vector<const PhraseTable*> &pts = system.mappings;
+	for (size_t i = 0; i < pts.size(); ++i) {
+		BOOST_FOREACH(Manager *mgr, m_mgrs) {
+			mgr->Lookup(*pts[i]);
+		}
+	}
+
+	BOOST_FOREACH(Manager *mgr, m_mgrs) {
+		mgr->InitSearch();
+	}
+
+	if (system.options.search.algo != NormalBatch) {
+		// nothing to share during search
+		BOOST_FOREACH(Manager *mgr, m_mgrs) {
+			mgr->GetSearch().Decode();
+		}
+		return;
+	}
+
+	std::vector<Search*> searches;
+	size_t numStacks = 0;
+	BOOST_FOREACH(Manager *mgr, m_mgrs) {
+		Search &search = static_cast<Search&>(mgr->GetSearch());
+		search.Init();
+		numStacks = std::max(numStacks, search.GetNumStacks());
+		searches.push_back(&search);
+	}
+
+	// every search fills the same thread-specific batch
+	Batch &batch = system.GetBatch(m_mgrs[0]->GetSystemPool());
+	std::vector<size_t> ends(searches.size());
+
+	for (size_t stackInd = 0; stackInd < numStacks; ++stackInd) {
+		for (size_t i = 0; i < searches.size(); ++i) {
+			searches[i]->Extend(stackInd);
+			ends[i] = batch.size();
+		}
+
+		if (batch.size()) {
+			system.featureFunctions.EvaluateWhenAppliedBatch(batch);
+
+			size_t begin = 0;
+			for (size_t i = 0; i < searches.size(); ++i) {
+				searches[i]->Add(begin, ends[i]);
+				begin = ends[i];
+			}
+			batch.clear();
+		}
+
+		BOOST_FOREACH(Search *search, searches) {
+			search->Delete(stackInd);
+		}
+	}
+}
+
+}
+}
@@ -0,0 +1,37 @@
+/*
+ * Scheduler.h
+ *
+ */
+#pragma once
+
+#include <vector>
+
+namespace Moses2
+{
+class Manager;
+
+namespace NSBatch
+{
+
+/** Decodes several sentences on one thread in lockstep. The phrase tables
+ *  are queried table by table for all sentences, and the stacks of every
+ *  sentence are expanded before the hypotheses are scored, so stateful
+ *  feature functions see one batch per stack index for the whole group
+ *  rather than one per sentence. All sentences allocate from the thread's
+ *  pools, which are reset only when the group's managers are deleted.
+ */
+class Scheduler
+{
+public:
+  Scheduler(const std::vector<Manager*> &mgrs);
+  virtual ~Scheduler();
+
+  void Decode();
+
+protected:
+  const std::vector<Manager*> &m_mgrs;
+
+};
+
+}
+}
@@ -40,6 +40,20 @@ Search::~Search()
 }
 
 void Search::Decode()
+{
+	Init();
+
+	for (size_t stackInd = 0; stackInd < m_stacks.GetSize(); ++stackInd) {
+		Decode(stackInd);
+		//cerr << m_stacks << endl;
+
+		// delete stack to save mem
+		Delete(stackInd);
+		//cerr << m_stacks << endl;
+	}
+}
+
+void Search::Init()
 {
 	// init stacks
 	const Sentence &sentence = static_cast<const Sentence&>(mgr.GetInput());
@@ -52,26 +66,29 @@ void Search::Decode()
 	initHypo->EmptyHypothesisState(mgr.GetInput());
 
 	m_stacks.Add(initHypo, mgr.GetHypoRecycle(), mgr.arcLists);
+}
 
-	for (size_t stackInd = 0; stackInd < m_stacks.GetSize(); ++stackInd) {
-		Decode(stackInd);
-		//cerr << m_stacks << endl;
-
-		// delete stack to save mem
-		if (stackInd < m_stacks.GetSize() - 1) {
-			m_stacks.Delete(stackInd);
-		}
-		//cerr << m_stacks << endl;
+void Search::Decode(size_t stackInd)
+{
+	Extend(stackInd);
+	if (m_batch.size() == 0) {
+		return;
 	}
+
+	// process batch
+	mgr.system.featureFunctions.EvaluateWhenAppliedBatch(m_batch);
+
+	Add(0, m_batch.size());
+	m_batch.clear();
 }
 
-void Search::Decode(size_t stackInd)
+void Search::Extend(size_t stackInd)
 {
-	Stack &stack = m_stacks[stackInd];
-	if (&stack == &m_stacks.Back()) {
+	if (stackInd + 1 >= m_stacks.GetSize()) {
 		// last stack. don't do anythin
 		return;
 	}
+	Stack &stack = m_stacks[stackInd];
 
 	const Hypotheses &hypos = stack.GetSortedAndPruneHypos(mgr, mgr.arcLists);
 
@@ -82,15 +99,22 @@ void Search::Decode(size_t stackInd)
 			Extend(*static_cast<const Hypothesis*>(hypo), *static_cast<const InputPath*>(path));
 		}
 	}
+}
 
-	// process batch
-	mgr.system.featureFunctions.EvaluateWhenAppliedBatch(m_batch);
-
-	for (size_t i = 0; i < m_batch.size(); ++i) {
+void Search::Add(size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; ++i) {
 		Hypothesis *hypo = m_batch[i];
 		m_stacks.Add(hypo, mgr.GetHypoRecycle(), mgr.arcLists);
 	}
-	m_batch.clear();
+}
+
+void Search::Delete(size_t stackInd)
+{
+	// keep the last stack, it has the best hypo
+	if (stackInd + 1 < m_stacks.GetSize()) {
+		m_stacks.Delete(stackInd);
+	}
 }
 
 void Search::Extend(const Hypothesis &hypo, const InputPath &path)
@@ -35,6 +35,18 @@ public:
 
   void AddInitialTrellisPaths(TrellisPaths<TrellisPath> &paths) const;
 
+  // the steps of Decode(), so that a Scheduler can advance the stacks of
+  // several sentences together and score their hypotheses in one batch
+  void Init();
+  size_t GetNumStacks() const
+  {  return m_stacks.GetSize(); }
+
+  // put the extensions of the hypotheses in a stack into the thread's batch
+  void Extend(size_t stackInd);
+  // add hypotheses [begin, end) of the batch, once they've been scored
+  void Add(size_t begin, size_t end);
+  void Delete(size_t stackInd);
+
 protected:
   Stacks m_stacks;
 
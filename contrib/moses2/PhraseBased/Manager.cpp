@@ -55,6 +55,21 @@ Manager::~Manager()
 }
 
 void Manager::Init()
+{
+	InitInput();
+
+	// lookup with every pt
+	const std::vector<const PhraseTable*> &pts = system.mappings;
+	for (size_t i = 0; i < pts.size(); ++i) {
+		const PhraseTable &pt = *pts[i];
+		//cerr << "Looking up from " << pt.GetName() << endl;
+		Lookup(pt);
+	}
+
+	InitSearch();
+}
+
+void Manager::InitInput()
 {
 	// init pools etc
 	InitPools();
@@ -77,14 +92,17 @@ void Manager::Init()
 	const UnknownWordPenalty *unkWP = system.featureFunctions.GetUnknownWordPenalty();
 	UTIL_THROW_IF2(unkWP == NULL, "There must be a UnknownWordPenalty FF");
 	unkWP->ProcessXML(*this, GetPool(), sentence, m_inputPaths);
+}
+
+void Manager::Lookup(const PhraseTable &pt)
+{
+	pt.Lookup(*this, m_inputPaths);
+}
+
+void Manager::InitSearch()
+{
+	const Sentence &sentence = static_cast<const Sentence&>(GetInput());
 
-	// lookup with every pt
-	const std::vector<const PhraseTable*> &pts = system.mappings;
-	for (size_t i = 0; i < pts.size(); ++i) {
-		const PhraseTable &pt = *pts[i];
-		//cerr << "Looking up from " << pt.GetName() << endl;
-		pt.Lookup(*this, m_inputPaths);
-	}
 	//m_inputPaths.DeleteUnusedPaths();
 	CalcFutureScore();
 
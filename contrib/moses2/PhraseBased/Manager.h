@@ -32,6 +32,7 @@ class Search;
 class Hypothesis;
 class Sentence;
 class OutputCollector;
+class PhraseTable;
 
 class Manager: public ManagerBase
 {
@@ -58,6 +59,15 @@ public:
   std::string OutputNBest();
   std::string OutputTransOpt();
 
+  // the steps of Init(), for decoding several sentences together.
+  // must be run in same thread as Decode()
+  void InitInput();
+  void Lookup(const PhraseTable &pt);
+  void InitSearch();
+
+  Search &GetSearch()
+  {  return *m_search; }
+
 protected:
 
   InputPaths m_inputPaths;
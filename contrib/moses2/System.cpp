@@ -12,6 +12,7 @@
 #include "System.h"
 #include "FF/FeatureFunction.h"
 #include "TranslationModel/UnknownWordPenalty.h"
+#include "legacy/InputFileStream.h"
 #include "legacy/Util2.h"
 #include "util/exception.hh"
 
@@ -101,8 +102,46 @@ void System::LoadWeights()
 	  }
 	  cerr << endl;
 	  */
-	  weights.SetWeights(featureFunctions, ffName, ffWeights);
+	  if (ffWeights.size() == 1 && IsSparseFeature(ffName)) {
+	    weights.SetSparseWeight(ffName, ffWeights[0]);
+	  }
+	  else {
+	    weights.SetWeights(featureFunctions, ffName, ffWeights);
+	  }
+  }
+
+  // sparse weights, 1 per line 'name value'
+  const PARAM_VEC *weightFile = params.GetParam("weight-file");
+  if (weightFile && weightFile->size()) {
+    UTIL_THROW_IF2(weightFile->size() != 1, "weight-file should be a single file");
+    InputFileStream file((*weightFile)[0]);
+    string line;
+    while (getline(file, line)) {
+      vector<string> toks = Tokenize(line);
+      if (toks.empty()) continue;
+      UTIL_THROW_IF2(toks.size() != 2, "Error in format of weight-file: " << line);
+      UTIL_THROW_IF2(!IsSparseFeature(toks[0]), "weight-file contains a weight for an unknown feature: " << toks[0]);
+      weights.SetSparseWeight(toks[0], Scan<SCORE>(toks[1]));
+    }
+  }
+}
+
+// sparse feature names are the name of a feature function, '_', then the
+// name of the feature itself
+bool System::IsSparseFeature(const std::string &name) const
+{
+  if (featureFunctions.FindFeatureFunction(name)) {
+    return false;
+  }
+
+  size_t pos = name.find('_');
+  while (pos != string::npos) {
+    if (featureFunctions.FindFeatureFunction(name.substr(0, pos))) {
+      return true;
+    }
+    pos = name.find('_', pos + 1);
   }
+  return false;
 }
 
 void System::LoadMappings()
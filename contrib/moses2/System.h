@@ -73,6 +73,7 @@ protected:
   mutable boost::thread_specific_ptr<Batch> m_batch;
 
   void LoadWeights();
+  bool IsSparseFeature(const std::string &name) const;
   void LoadMappings();
   void LoadDecodeGraphBackoff();
 
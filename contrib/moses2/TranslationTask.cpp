@@ -1,7 +1,9 @@
+#include <boost/foreach.hpp>
 #include "TranslationTask.h"
 #include "System.h"
 #include "InputType.h"
 #include "PhraseBased/Manager.h"
+#include "PhraseBased/Batch/Scheduler.h"
 #include "SCFG/Manager.h"
 
 using namespace std;
@@ -21,6 +23,11 @@ TranslationTask::TranslationTask(System &system,
   }
 }
 
+TranslationTask::TranslationTask()
+:m_mgr(NULL)
+{
+}
+
 TranslationTask::~TranslationTask()
 {
 }
@@ -30,23 +37,69 @@ void TranslationTask::Run()
 
   m_mgr->Decode();
 
+  Output(*m_mgr);
+
+  delete m_mgr;
+}
+
+void TranslationTask::Output(ManagerBase &mgr) const
+{
   string out;
 
-  out = m_mgr->OutputBest() + "\n";
-  m_mgr->system.bestCollector->Write(m_mgr->GetTranslationId(), out);
+  out = mgr.OutputBest() + "\n";
+  mgr.system.bestCollector->Write(mgr.GetTranslationId(), out);
 
-  if (m_mgr->system.options.nbest.nbest_size) {
-    out = m_mgr->OutputNBest();
-    m_mgr->system.nbestCollector->Write(m_mgr->GetTranslationId(), out);
+  if (mgr.system.options.nbest.nbest_size) {
+    out = mgr.OutputNBest();
+    mgr.system.nbestCollector->Write(mgr.GetTranslationId(), out);
   }
 
-  if (!m_mgr->system.options.output.detailed_transrep_filepath.empty()) {
-    out = m_mgr->OutputTransOpt();
-    m_mgr->system.detailedTranslationCollector->Write(m_mgr->GetTranslationId(), out);
+  if (!mgr.system.options.output.detailed_transrep_filepath.empty()) {
+    out = mgr.OutputTransOpt();
+    mgr.system.detailedTranslationCollector->Write(mgr.GetTranslationId(), out);
   }
+}
 
-  delete m_mgr;
+//////////////////////////////////////////////////////////////////////////////
+BatchTranslationTask::BatchTranslationTask(System &system,
+		const std::vector<std::string> &lines,
+		long translationId)
+{
+  UTIL_THROW_IF2(!system.isPb, "Only phrase-based models can decode sentences in batches");
+  for (size_t i = 0; i < lines.size(); ++i) {
+	  Manager *mgr = new Manager(system, *this, lines[i], translationId + i);
+	  mgr->SetSharedPools();
+	  m_mgrs.push_back(mgr);
+  }
 }
 
+BatchTranslationTask::~BatchTranslationTask()
+{
+}
+
+void BatchTranslationTask::Run()
+{
+  NSBatch::Scheduler scheduler(m_mgrs);
+  scheduler.Decode();
+
+  BOOST_FOREACH(Manager *mgr, m_mgrs) {
+    Output(*mgr);
+  }
+
+  if (m_mgrs.empty()) {
+    return;
+  }
+  const System &system = m_mgrs[0]->system;
+
+  // the managers share the thread's pools, which are reset after the last
+  // of them is gone
+  BOOST_FOREACH(Manager *mgr, m_mgrs) {
+    delete mgr;
+  }
+  m_mgrs.clear();
+
+  system.GetManagerPool().Reset();
+  system.GetHypoRecycler().Clear();
 }
 
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <vector>
 #include "legacy/ThreadPool.h"
 
 namespace Moses2
@@ -19,6 +20,23 @@ public:
 
 protected:
   ManagerBase *m_mgr;
+
+  TranslationTask();
+  void Output(ManagerBase &mgr) const;
+};
+
+// Decodes several phrase-based sentences in lockstep on one thread, see
+// NSBatch::Scheduler
+class BatchTranslationTask: public TranslationTask
+{
+public:
+
+  BatchTranslationTask(System &system, const std::vector<std::string> &lines, long translationId);
+  virtual ~BatchTranslationTask();
+  virtual void Run();
+
+protected:
+  std::vector<Manager*> m_mgrs;
 };
 
 }
@@ -67,5 +67,25 @@ void Weights::SetWeights(const FeatureFunctions &ffs, const std::string &ffName,
   }
 }
 
+void Weights::SetSparseWeight(const std::string &name, SCORE weight)
+{
+  m_sparseWeights[name] = weight;
+}
+
+std::vector<std::pair<std::string, SCORE> > Weights::GetSparseWeights(const FeatureFunction &ff) const
+{
+  std::vector<std::pair<std::string, SCORE> > ret;
+  string prefix = ff.GetName() + "_";
+
+  std::map<std::string, SCORE>::const_iterator iter;
+  for (iter = m_sparseWeights.lower_bound(prefix); iter != m_sparseWeights.end(); ++iter) {
+    const string &name = iter->first;
+    if (name.compare(0, prefix.size(), prefix) != 0) {
+      break;
+    }
+    ret.push_back(std::make_pair(name.substr(prefix.size()), iter->second));
+  }
+  return ret;
 }
 
+}
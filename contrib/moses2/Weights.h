@@ -7,6 +7,9 @@
 #pragma once
 
 #include <iostream>
+#include <map>
+#include <string>
+#include <utility>
 #include <vector>
 #include "TypeDef.h"
 
@@ -33,8 +36,15 @@ public:
 
   void SetWeights(const FeatureFunctions &ffs, const std::string &ffName, const std::vector<float> &weights);
 
+  // sparse features are named <ff name>_<feature name>, as in moses
+  void SetSparseWeight(const std::string &name, SCORE weight);
+
+  // weights of the sparse features of ff, without the ff name prefix
+  std::vector<std::pair<std::string, SCORE> > GetSparseWeights(const FeatureFunction &ff) const;
+
 protected:
   std::vector<SCORE> m_weights;
+  std::map<std::string, SCORE> m_sparseWeights;
 };
 
 }
@@ -87,6 +87,8 @@ Parameter::Parameter()
       "maximum stack size for histogram pruning. 0 = unlimited stack size");
   AddParam(search_opts, "stack-diversity", "sd",
       "minimum number of hypothesis of each coverage in stack (default 0)");
+  AddParam(search_opts, "batch-sentences",
+      "number of sentences each thread decodes together, so that their feature function calls are batched (default 1). Phrase-based only");
 
   // feature weight-related options
   AddParam(search_opts, "weight-file", "wf",
@@ -16,6 +16,7 @@ namespace Moses2
     , max_partial_trans_opt(DEFAULT_MAX_PART_TRANS_OPT_SIZE)
     , beam_width(DEFAULT_BEAM_WIDTH)
     , timeout(0)
+    , batch_sentences(1)
     , consensus(false)
     , early_discarding_threshold(DEFAULT_EARLY_DISCARDING_THRESHOLD)
     , trans_opt_threshold(DEFAULT_TRANSLATION_OPTION_THRESHOLD)
@@ -39,6 +40,7 @@ namespace Moses2
     param.SetParameter(early_discarding_threshold, "early-discarding-threshold", 
                        DEFAULT_EARLY_DISCARDING_THRESHOLD);
     param.SetParameter(timeout, "time-out", 0);
+    param.SetParameter(batch_sentences, "batch-sentences", size_t(1));
     param.SetParameter(max_phrase_length, "max-phrase-length", 
                        DEFAULT_MAX_PHRASE_LENGTH);
     param.SetParameter(trans_opt_threshold, "translation-option-threshold", 
@@ -28,6 +28,9 @@ namespace Moses2
 
     int timeout;
 
+    // sentences decoded together by each thread. 1 = one at a time
+    size_t batch_sentences;
+
     bool consensus; //! Use Consensus decoding  (DeNero et al 2009)
     
     // reordering options
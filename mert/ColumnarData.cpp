@@ -0,0 +1,318 @@
+/*
+ *  ColumnarData.cpp
+ *  mert - Minimum Error Rate Training
+ */
+
+#include "ColumnarData.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+#include "util/exception.hh"
+#include "util/file.hh"
+
+#include "FeatureArray.h"
+#include "FeatureStats.h"
+#include "ScoreArray.h"
+#include "ScoreStats.h"
+
+using namespace std;
+
+namespace MosesTuning
+{
+
+namespace
+{
+
+const size_t kAlign = 8;
+
+size_t Padded(size_t bytes)
+{
+  return (bytes + kAlign - 1) / kAlign * kAlign;
+}
+
+template <class T> void WriteSection(ofstream& out, const T* data, size_t count)
+{
+  size_t bytes = count * sizeof(T);
+  if (bytes) out.write(reinterpret_cast<const char*>(data), bytes);
+  static const char zeros[kAlign] = {0};
+  out.write(zeros, Padded(bytes) - bytes);
+}
+
+template <class T> void WriteSection(ofstream& out, const vector<T>& data)
+{
+  WriteSection(out, data.empty() ? NULL : &data[0], data.size());
+}
+
+// Walks the sections of a mapped file in the order they were written.
+class SectionReader
+{
+public:
+  SectionReader(const util::scoped_memory& mem, const string& file)
+    : m_begin(static_cast<const char*>(mem.get())), m_size(mem.size()), m_offset(Padded(sizeof(ColumnarHeader))), m_file(file) {}
+
+  template <class T> const T* Next(size_t count) {
+    size_t bytes = count * sizeof(T);
+    UTIL_THROW_IF2(m_offset + bytes > m_size, "Columnar file " << m_file << " is truncated");
+    const T* ret = reinterpret_cast<const T*>(m_begin + m_offset);
+    m_offset += Padded(bytes);
+    return ret;
+  }
+
+private:
+  const char* m_begin;
+  size_t m_size;
+  size_t m_offset;
+  const string& m_file;
+};
+
+const ColumnarHeader* MapHeader(const string& file, const char* magic, util::scoped_memory& mem)
+{
+  UTIL_THROW_IF2(!IsColumnarFile(file, magic), "File " << file << " is not a columnar " << magic << " file");
+  util::scoped_fd fd(util::OpenReadOrThrow(file.c_str()));
+  util::MapRead(util::LAZY, fd.get(), 0, util::SizeOrThrow(fd.get()), mem);
+  UTIL_THROW_IF2(mem.size() < sizeof(ColumnarHeader), "Columnar file " << file << " is truncated");
+  return static_cast<const ColumnarHeader*>(mem.get());
+}
+
+// Sentence ids and hypothesis offsets, shared by both file types.
+template <class Array> void CollectSentences(const vector<Array>& arrays, vector<int64_t>& ids, vector<uint64_t>& offsets)
+{
+  offsets.push_back(0);
+  for (size_t i = 0; i < arrays.size(); ++i) {
+    ids.push_back(arrays[i].getIndex());
+    offsets.push_back(offsets.back() + arrays[i].size());
+  }
+}
+
+} // namespace
+
+bool IsColumnarFile(const string& file, const char* magic)
+{
+  ifstream in(file.c_str(), ios::in | ios::binary);
+  char buf[sizeof(ColumnarHeader().magic)];
+  if (!in.read(buf, sizeof(buf))) return false;
+  return memcmp(buf, magic, sizeof(buf)) == 0;
+}
+
+void ColumnarFeatureFile::Write(const featdata_t& arrays, const string& file)
+{
+  ColumnarHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, COLUMNAR_FEATURES_MAGIC, sizeof(header.magic));
+
+  vector<int64_t> ids;
+  vector<uint64_t> hyp_offsets;
+  CollectSentences(arrays, ids, hyp_offsets);
+
+  string features;
+  if (!arrays.empty()) {
+    header.num_columns = arrays[0].NumberOfFeatures();
+    features = arrays[0].Features();
+  }
+
+  vector<float> dense;
+  vector<uint64_t> sparse_offsets(1, 0);
+  vector<uint32_t> sparse_ids;
+  vector<float> sparse_values;
+  // SparseVector ids are process wide, so intern the names used in this file
+  map<size_t, uint32_t> interned;
+  vector<uint64_t> name_offsets(1, 0);
+  string names;
+
+  for (size_t i = 0; i < arrays.size(); ++i) {
+    UTIL_THROW_IF2(arrays[i].NumberOfFeatures() != header.num_columns,
+                   "Sentence " << arrays[i].getIndex() << " has " << arrays[i].NumberOfFeatures()
+                   << " dense features, expected " << header.num_columns);
+    for (size_t j = 0; j < arrays[i].size(); ++j) {
+      const FeatureStats& entry = arrays[i].get(j);
+      for (size_t k = 0; k < header.num_columns; ++k) {
+        dense.push_back(k < entry.size() ? entry.get(k) : 0);
+      }
+      const SparseVector& sparse = entry.getSparse();
+      vector<size_t> feats = sparse.feats();
+      for (size_t k = 0; k < feats.size(); ++k) {
+        map<size_t, uint32_t>::iterator it = interned.find(feats[k]);
+        if (it == interned.end()) {
+          it = interned.insert(make_pair(feats[k], static_cast<uint32_t>(interned.size()))).first;
+          names += SparseVector::decode(feats[k]);
+          name_offsets.push_back(names.size());
+        }
+        sparse_ids.push_back(it->second);
+        sparse_values.push_back(sparse.get(feats[k]));
+      }
+      sparse_offsets.push_back(sparse_ids.size());
+    }
+  }
+
+  header.num_sentences = ids.size();
+  header.num_hyps = hyp_offsets.back();
+  header.num_sparse = sparse_ids.size();
+  header.num_names = interned.size();
+  header.names_bytes = names.size();
+  header.label_bytes = features.size();
+
+  ofstream out(file.c_str(), ios::out | ios::binary | ios::trunc);
+  UTIL_THROW_IF2(!out, "Unable to open " << file);
+  WriteSection(out, &header, 1);
+  WriteSection(out, features.data(), features.size());
+  WriteSection(out, ids);
+  WriteSection(out, hyp_offsets);
+  WriteSection(out, dense);
+  WriteSection(out, sparse_offsets);
+  WriteSection(out, sparse_ids);
+  WriteSection(out, sparse_values);
+  WriteSection(out, name_offsets);
+  WriteSection(out, names.data(), names.size());
+  UTIL_THROW_IF2(!out, "Error writing " << file);
+}
+
+ColumnarFeatureFile::ColumnarFeatureFile(const string& file)
+  : m_file(file)
+{
+  m_header = MapHeader(file, COLUMNAR_FEATURES_MAGIC, m_mem);
+
+  SectionReader reader(m_mem, m_file);
+  const char* features = reader.Next<char>(m_header->label_bytes);
+  m_features.assign(features, m_header->label_bytes);
+  m_sentence_ids = reader.Next<int64_t>(m_header->num_sentences);
+  m_hyp_offsets = reader.Next<uint64_t>(m_header->num_sentences + 1);
+  m_dense = reader.Next<float>(m_header->num_hyps * m_header->num_columns);
+  m_sparse_offsets = reader.Next<uint64_t>(m_header->num_hyps + 1);
+  m_sparse_ids = reader.Next<uint32_t>(m_header->num_sparse);
+  m_sparse_values = reader.Next<float>(m_header->num_sparse);
+  const uint64_t* name_offsets = reader.Next<uint64_t>(m_header->num_names + 1);
+  const char* names = reader.Next<char>(m_header->names_bytes);
+
+  m_sparse_vector_ids.reserve(m_header->num_names);
+  for (size_t i = 0; i < m_header->num_names; ++i) {
+    string name(names + name_offsets[i], name_offsets[i + 1] - name_offsets[i]);
+    m_sparse_vector_ids.push_back(SparseVector::encode(name));
+  }
+}
+
+void ColumnarFeatureFile::Get(size_t hyp, FeatureStats& entry, const SparseVector& sparseWeights) const
+{
+  entry.reset();
+  const float* dense = Dense(hyp);
+  for (size_t k = 0; k < NumDense(); ++k) {
+    entry.add(dense[k]);
+  }
+  const uint32_t* ids = SparseIds(hyp);
+  const float* values = SparseValues(hyp);
+  for (size_t k = 0; k < NumSparse(hyp); ++k) {
+    entry.addSparse(m_sparse_vector_ids[ids[k]], values[k]);
+  }
+  entry.mergeSparse(sparseWeights);
+}
+
+void ColumnarFeatureFile::Get(size_t sentence, FeatureArray& array, const SparseVector& sparseWeights) const
+{
+  array.clear();
+  array.setIndex(SentenceId(sentence));
+  array.NumberOfFeatures(NumDense());
+  array.Features(m_features);
+
+  FeatureStats entry(NumDense());
+  for (size_t hyp = FirstHyp(sentence); hyp < FirstHyp(sentence) + NumHyps(sentence); ++hyp) {
+    Get(hyp, entry, sparseWeights);
+    array.add(entry);
+  }
+}
+
+void ColumnarScoreFile::Write(const scoredata_t& arrays, const string& scoreType, const string& file)
+{
+  ColumnarHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, COLUMNAR_SCORES_MAGIC, sizeof(header.magic));
+
+  vector<int64_t> ids;
+  vector<uint64_t> hyp_offsets;
+  CollectSentences(arrays, ids, hyp_offsets);
+
+  if (!arrays.empty()) {
+    header.num_columns = arrays[0].NumberOfScores();
+  }
+
+  // Most metrics use counts as statistics; store those as integers
+  vector<float> stats;
+  bool integral = true;
+  for (size_t i = 0; i < arrays.size(); ++i) {
+    UTIL_THROW_IF2(arrays[i].NumberOfScores() != header.num_columns,
+                   "Sentence " << arrays[i].getIndex() << " has " << arrays[i].NumberOfScores()
+                   << " scores, expected " << header.num_columns);
+    for (size_t j = 0; j < arrays[i].size(); ++j) {
+      const ScoreStats& entry = arrays[i].get(j);
+      for (size_t k = 0; k < header.num_columns; ++k) {
+        float value = k < entry.size() ? entry.get(k) : 0;
+        if (integral && (value != floor(value) || fabs(value) > 2147483647.0f)) integral = false;
+        stats.push_back(value);
+      }
+    }
+  }
+
+  header.num_sentences = ids.size();
+  header.num_hyps = hyp_offsets.back();
+  header.label_bytes = scoreType.size();
+  header.float_stats = integral ? 0 : 1;
+
+  ofstream out(file.c_str(), ios::out | ios::binary | ios::trunc);
+  UTIL_THROW_IF2(!out, "Unable to open " << file);
+  WriteSection(out, &header, 1);
+  WriteSection(out, scoreType.data(), scoreType.size());
+  WriteSection(out, ids);
+  WriteSection(out, hyp_offsets);
+  if (integral) {
+    vector<int32_t> int_stats(stats.begin(), stats.end());
+    WriteSection(out, int_stats);
+  } else {
+    WriteSection(out, stats);
+  }
+  UTIL_THROW_IF2(!out, "Error writing " << file);
+}
+
+ColumnarScoreFile::ColumnarScoreFile(const string& file)
+  : m_file(file), m_int_stats(NULL), m_float_stats(NULL)
+{
+  m_header = MapHeader(file, COLUMNAR_SCORES_MAGIC, m_mem);
+
+  SectionReader reader(m_mem, m_file);
+  const char* score_type = reader.Next<char>(m_header->label_bytes);
+  m_score_type.assign(score_type, m_header->label_bytes);
+  m_sentence_ids = reader.Next<int64_t>(m_header->num_sentences);
+  m_hyp_offsets = reader.Next<uint64_t>(m_header->num_sentences + 1);
+  if (m_header->float_stats) {
+    m_float_stats = reader.Next<float>(m_header->num_hyps * m_header->num_columns);
+  } else {
+    m_int_stats = reader.Next<int32_t>(m_header->num_hyps * m_header->num_columns);
+  }
+}
+
+void ColumnarScoreFile::Get(size_t hyp, vector<ScoreStatsType>& stats) const
+{
+  stats.resize(NumScores());
+  for (size_t k = 0; k < NumScores(); ++k) {
+    stats[k] = Get(hyp, k);
+  }
+}
+
+void ColumnarScoreFile::Get(size_t sentence, ScoreArray& array) const
+{
+  array.clear();
+  array.setIndex(SentenceId(sentence));
+  array.NumberOfScores(NumScores());
+  string score_type = m_score_type;
+  array.name(score_type);
+
+  ScoreStats entry(NumScores());
+  vector<ScoreStatsType> stats;
+  for (size_t hyp = FirstHyp(sentence); hyp < FirstHyp(sentence) + NumHyps(sentence); ++hyp) {
+    Get(hyp, stats);
+    entry.set(stats);
+    array.add(entry);
+  }
+}
+
+}
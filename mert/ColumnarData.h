@@ -0,0 +1,182 @@
+/*
+ *  ColumnarData.h
+ *  mert - Minimum Error Rate Training
+ *
+ *  Binary, column-oriented versions of the feature and score data files.
+ *  The files are memory-mapped when read, so loading them costs no parsing:
+ *
+ *   - dense features are one float array, hypothesis after hypothesis
+ *   - sparse features are id/value arrays, with the names interned once per file
+ *   - sufficient statistics are one int array (float if any statistic is fractional)
+ *
+ *  Sentences and their hypotheses are located through offset arrays.
+ */
+
+#ifndef MERT_COLUMNAR_DATA_H_
+#define MERT_COLUMNAR_DATA_H_
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "util/mmap.hh"
+#include "Types.h"
+
+namespace MosesTuning
+{
+
+class SparseVector;
+
+const char COLUMNAR_FEATURES_MAGIC[] = "MERTFCB1";
+const char COLUMNAR_SCORES_MAGIC[] = "MERTSCB1";
+
+/** Fixed-size file header, followed by the sections in the order listed */
+struct ColumnarHeader {
+  char magic[8];
+  uint64_t num_sentences;
+  uint64_t num_hyps;
+  uint64_t num_columns;  // dense features or scores per hypothesis
+  uint64_t num_sparse;   // sparse feature entries over all hypotheses
+  uint64_t num_names;    // distinct sparse feature names
+  uint64_t names_bytes;
+  uint64_t label_bytes;  // dense feature names or score type
+  uint64_t float_stats;  // scores only: statistics are stored as float
+};
+
+/** Check whether the file starts with the given magic */
+bool IsColumnarFile(const std::string& file, const char* magic);
+
+class ColumnarFeatureFile
+{
+public:
+  /** Write the feature arrays to file */
+  static void Write(const featdata_t& arrays, const std::string& file);
+
+  /** Map the file read-only */
+  explicit ColumnarFeatureFile(const std::string& file);
+
+  const std::string& FileName() const {
+    return m_file;
+  }
+
+  std::size_t NumSentences() const {
+    return m_header->num_sentences;
+  }
+  int SentenceId(std::size_t sentence) const {
+    return static_cast<int>(m_sentence_ids[sentence]);
+  }
+  std::size_t FirstHyp(std::size_t sentence) const {
+    return m_hyp_offsets[sentence];
+  }
+  std::size_t NumHyps(std::size_t sentence) const {
+    return m_hyp_offsets[sentence + 1] - m_hyp_offsets[sentence];
+  }
+
+  std::size_t NumDense() const {
+    return m_header->num_columns;
+  }
+  const std::string& Features() const {
+    return m_features;
+  }
+  const float* Dense(std::size_t hyp) const {
+    return m_dense + hyp * m_header->num_columns;
+  }
+
+  std::size_t NumSparse(std::size_t hyp) const {
+    return m_sparse_offsets[hyp + 1] - m_sparse_offsets[hyp];
+  }
+  const uint32_t* SparseIds(std::size_t hyp) const {
+    return m_sparse_ids + m_sparse_offsets[hyp];
+  }
+  const float* SparseValues(std::size_t hyp) const {
+    return m_sparse_values + m_sparse_offsets[hyp];
+  }
+
+  /** SparseVector ids of the file's interned names, in file id order */
+  const std::vector<std::size_t>& SparseVectorIds() const {
+    return m_sparse_vector_ids;
+  }
+
+  /** Dense and sparse features of one hypothesis */
+  void Get(std::size_t hyp, FeatureStats& entry, const SparseVector& sparseWeights) const;
+
+  /** All hypotheses of one sentence as a FeatureArray */
+  void Get(std::size_t sentence, FeatureArray& array, const SparseVector& sparseWeights) const;
+
+private:
+  std::string m_file;
+  util::scoped_memory m_mem;
+
+  const ColumnarHeader* m_header;
+  const int64_t* m_sentence_ids;
+  const uint64_t* m_hyp_offsets;
+  const float* m_dense;
+  const uint64_t* m_sparse_offsets;
+  const uint32_t* m_sparse_ids;
+  const float* m_sparse_values;
+
+  std::string m_features;
+  std::vector<std::size_t> m_sparse_vector_ids;
+};
+
+class ColumnarScoreFile
+{
+public:
+  /** Write the score arrays to file */
+  static void Write(const scoredata_t& arrays, const std::string& scoreType, const std::string& file);
+
+  /** Map the file read-only */
+  explicit ColumnarScoreFile(const std::string& file);
+
+  const std::string& FileName() const {
+    return m_file;
+  }
+
+  std::size_t NumSentences() const {
+    return m_header->num_sentences;
+  }
+  int SentenceId(std::size_t sentence) const {
+    return static_cast<int>(m_sentence_ids[sentence]);
+  }
+  std::size_t FirstHyp(std::size_t sentence) const {
+    return m_hyp_offsets[sentence];
+  }
+  std::size_t NumHyps(std::size_t sentence) const {
+    return m_hyp_offsets[sentence + 1] - m_hyp_offsets[sentence];
+  }
+
+  std::size_t NumScores() const {
+    return m_header->num_columns;
+  }
+  const std::string& ScoreType() const {
+    return m_score_type;
+  }
+
+  ScoreStatsType Get(std::size_t hyp, std::size_t i) const {
+    std::size_t index = hyp * m_header->num_columns + i;
+    return m_float_stats ? m_float_stats[index] : static_cast<ScoreStatsType>(m_int_stats[index]);
+  }
+
+  /** Statistics of one hypothesis */
+  void Get(std::size_t hyp, std::vector<ScoreStatsType>& stats) const;
+
+  /** All hypotheses of one sentence as a ScoreArray */
+  void Get(std::size_t sentence, ScoreArray& array) const;
+
+private:
+  std::string m_file;
+  util::scoped_memory m_mem;
+
+  const ColumnarHeader* m_header;
+  const int64_t* m_sentence_ids;
+  const uint64_t* m_hyp_offsets;
+  const int32_t* m_int_stats;
+  const float* m_float_stats;
+
+  std::string m_score_type;
+};
+
+}
+
+#endif  // MERT_COLUMNAR_DATA_H_
@@ -0,0 +1,125 @@
+#include "ColumnarData.h"
+#include "FeatureArray.h"
+#include "FeatureDataIterator.h"
+#include "ScoreArray.h"
+#include "ScoreDataIterator.h"
+
+#define BOOST_TEST_MODULE MertColumnarData
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+
+using namespace MosesTuning;
+
+namespace
+{
+
+std::string TempFile()
+{
+  return (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+}
+
+featdata_t MakeFeatures()
+{
+  featdata_t arrays(2);
+  for (std::size_t i = 0; i < arrays.size(); ++i) {
+    arrays[i].setIndex(i);
+    arrays[i].NumberOfFeatures(2);
+    arrays[i].Features("lm_0 tm_0 ");
+    for (std::size_t j = 0; j <= i; ++j) {
+      FeatureStats entry;
+      entry.add(0.5 + i);
+      entry.add(-1.25 * j);
+      entry.addSparse(j ? "pp_a" : "pp_b", 2 + j);
+      arrays[i].add(entry);
+    }
+  }
+  return arrays;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(columnar_features_round_trip)
+{
+  std::string file = TempFile();
+  ColumnarFeatureFile::Write(MakeFeatures(), file);
+  BOOST_CHECK(IsColumnarFile(file, COLUMNAR_FEATURES_MAGIC));
+  BOOST_CHECK(!IsColumnarFile(file, COLUMNAR_SCORES_MAGIC));
+
+  ColumnarFeatureFile columnar(file);
+  BOOST_REQUIRE_EQUAL(columnar.NumSentences(), 2);
+  BOOST_CHECK_EQUAL(columnar.Features(), "lm_0 tm_0 ");
+  BOOST_CHECK_EQUAL(columnar.NumHyps(1), 2);
+
+  FeatureArray array;
+  columnar.Get(1, array, SparseVector());
+  BOOST_CHECK_EQUAL(array.getIndex(), 1);
+  BOOST_REQUIRE_EQUAL(array.size(), 2);
+  BOOST_CHECK_EQUAL(array.get(1).get(0), 1.5);
+  BOOST_CHECK_EQUAL(array.get(1).get(1), -1.25);
+  BOOST_CHECK_EQUAL(array.get(1).getSparse().get("pp_a"), 3);
+  BOOST_CHECK_EQUAL(array.get(1).getSparse().get("pp_b"), 0);
+
+  // sparse features are folded into one dense value when weights are given
+  SparseVector weights;
+  weights.set("pp_a", 2);
+  columnar.Get(1, array, weights);
+  BOOST_REQUIRE_EQUAL(array.get(1).size(), 3);
+  BOOST_CHECK_EQUAL(array.get(1).get(2), 6);
+
+  std::size_t sentences = 0;
+  for (FeatureDataIterator it(file); it != FeatureDataIterator::end(); ++it, ++sentences) {
+    BOOST_CHECK_EQUAL(it->size(), sentences + 1);
+    BOOST_CHECK_EQUAL((*it)[0].dense[0], 0.5 + sentences);
+    BOOST_CHECK_EQUAL((*it)[0].sparse.get("pp_b"), 2);
+  }
+  BOOST_CHECK_EQUAL(sentences, 2);
+
+  boost::filesystem::remove(file);
+}
+
+BOOST_AUTO_TEST_CASE(columnar_scores_round_trip)
+{
+  scoredata_t arrays(1);
+  arrays[0].setIndex(7);
+  arrays[0].NumberOfScores(2);
+  std::vector<ScoreStatsType> stats(2);
+  stats[0] = 3;
+  stats[1] = 4;
+  ScoreStats entry;
+  entry.set(stats);
+  arrays[0].add(entry);
+
+  // integral statistics
+  std::string file = TempFile();
+  ColumnarScoreFile::Write(arrays, "BLEU", file);
+  {
+    ColumnarScoreFile columnar(file);
+    BOOST_CHECK_EQUAL(columnar.ScoreType(), "BLEU");
+    BOOST_CHECK_EQUAL(columnar.SentenceId(0), 7);
+    BOOST_CHECK_EQUAL(columnar.Get(0, 1), 4);
+  }
+
+  // fractional statistics are kept as float
+  stats[1] = 0.25;
+  entry.set(stats);
+  arrays[0].add(entry);
+  ColumnarScoreFile::Write(arrays, "TER", file);
+  {
+    ColumnarScoreFile columnar(file);
+    ScoreArray array;
+    columnar.Get(0, array);
+    BOOST_CHECK_EQUAL(array.name(), "TER");
+    BOOST_REQUIRE_EQUAL(array.size(), 2);
+    BOOST_CHECK_EQUAL(array.get(0).get(1), 4);
+    BOOST_CHECK_EQUAL(array.get(1).get(1), 0.25);
+  }
+
+  std::size_t sentences = 0;
+  for (ScoreDataIterator it(file); it != ScoreDataIterator::end(); ++it, ++sentences) {
+    BOOST_REQUIRE_EQUAL(it->size(), 2);
+    BOOST_CHECK_EQUAL((*it)[1][1], 0.25);
+  }
+  BOOST_CHECK_EQUAL(sentences, 1);
+
+  boost::filesystem::remove(file);
+}
@@ -206,6 +206,12 @@ void Data::save(const std::string &featfile, const std::string &scorefile, bool
   m_score_data->save(scorefile, bin);
 }
 
+void Data::saveColumnar(const std::string &featfile, const std::string &scorefile)
+{
+  m_feature_data->saveColumnar(featfile);
+  m_score_data->saveColumnar(scorefile);
+}
+
 void Data::InitFeatureMap(const string& str)
 {
   string buf = str;
@@ -72,6 +72,7 @@ public:
   void load(const std::string &featfile, const std::string &scorefile);
 
   void save(const std::string &featfile, const std::string &scorefile, bool bin=false);
+  void saveColumnar(const std::string &featfile, const std::string &scorefile);
 
   //ADDED BY TS
   void removeDuplicates();
@@ -9,6 +9,7 @@
 #include "FeatureData.h"
 
 #include <limits>
+#include "ColumnarData.h"
 #include "FileStream.h"
 #include "Util.h"
 
@@ -43,6 +44,13 @@ void FeatureData::save(bool bin)
   save(&cout, bin);
 }
 
+void FeatureData::saveColumnar(const string &file) const
+{
+  if (file.empty()) return;
+  TRACE_ERR("saving the columnar array into " << file << endl);
+  ColumnarFeatureFile::Write(m_array, file);
+}
+
 void FeatureData::load(istream* is, const SparseVector& sparseWeights)
 {
   FeatureArray entry;
@@ -70,6 +78,17 @@ void FeatureData::load(istream* is, const SparseVector& sparseWeights)
 void FeatureData::load(const string &file, const SparseVector& sparseWeights)
 {
   TRACE_ERR("loading feature data from " << file << endl);
+  if (IsColumnarFile(file, COLUMNAR_FEATURES_MAGIC)) {
+    ColumnarFeatureFile columnar(file);
+    FeatureArray entry;
+    for (size_t i = 0; i < columnar.NumSentences(); ++i) {
+      columnar.Get(i, entry, sparseWeights);
+      if (size() == 0)
+        setFeatureMap(entry.Features());
+      add(entry);
+    }
+    return;
+  }
   inputfilestream input_stream(file); // matches a stream with a file. Opens the file
   if (!input_stream) {
     throw runtime_error("Unable to open feature file: " + file);
@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "util/file_piece.hh"
 #include "util/tokenize_piece.hh"
 
+#include "ColumnarData.h"
 #include "FeatureArray.h"
 #include "FeatureDataIterator.h"
 
@@ -69,10 +70,15 @@ size_t hash_value(FeatureDataItem const& item)
 }
 
 
-FeatureDataIterator::FeatureDataIterator() {}
+FeatureDataIterator::FeatureDataIterator() : m_sentence(0) {}
 
-FeatureDataIterator::FeatureDataIterator(const string& filename)
+FeatureDataIterator::FeatureDataIterator(const string& filename) : m_sentence(0)
 {
+  if (IsColumnarFile(filename, COLUMNAR_FEATURES_MAGIC)) {
+    m_columnar.reset(new ColumnarFeatureFile(filename));
+    readNextColumnar();
+    return;
+  }
   m_in.reset(new FilePiece(filename.c_str()));
   readNext();
 }
@@ -124,13 +130,45 @@ void FeatureDataIterator::readNext()
   }
 }
 
+void FeatureDataIterator::readNextColumnar()
+{
+  m_next.clear();
+  if (m_sentence == m_columnar->NumSentences()) {
+    m_columnar.reset();
+    return;
+  }
+  size_t first = m_columnar->FirstHyp(m_sentence);
+  size_t count = m_columnar->NumHyps(m_sentence);
+  const vector<size_t>& sparseIds = m_columnar->SparseVectorIds();
+  m_next.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    const float* dense = m_columnar->Dense(first + i);
+    m_next[i].dense.assign(dense, dense + m_columnar->NumDense());
+    const uint32_t* ids = m_columnar->SparseIds(first + i);
+    const float* values = m_columnar->SparseValues(first + i);
+    for (size_t j = 0; j < m_columnar->NumSparse(first + i); ++j) {
+      m_next[i].sparse.set(sparseIds[ids[j]], values[j]);
+    }
+  }
+  ++m_sentence;
+}
+
 void FeatureDataIterator::increment()
 {
-  readNext();
+  if (m_columnar) {
+    readNextColumnar();
+  } else {
+    readNext();
+  }
 }
 
 bool FeatureDataIterator::equal(const FeatureDataIterator& rhs) const
 {
+  if (m_columnar || rhs.m_columnar) {
+    return m_columnar && rhs.m_columnar &&
+           m_columnar->FileName() == rhs.m_columnar->FileName() &&
+           m_sentence == rhs.m_sentence;
+  }
   if (!m_in && !rhs.m_in) {
     return true;
   } else if (!m_in) {
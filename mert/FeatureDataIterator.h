@@ -45,6 +45,7 @@ class FilePiece;
 namespace MosesTuning
 {
 
+class ColumnarFeatureFile;
 
 class FileFormatException : public util::Exception
 {
@@ -95,8 +96,12 @@ private:
   const std::vector<FeatureDataItem>& dereference() const;
 
   void readNext();
+  void readNextColumnar();
 
   boost::shared_ptr<util::FilePiece> m_in;
+  // set instead of m_in when reading a columnar file
+  boost::shared_ptr<ColumnarFeatureFile> m_columnar;
+  std::size_t m_sentence;
   std::vector<FeatureDataItem> m_next;
 };
 
@@ -249,6 +249,21 @@ void FeatureStats::addSparse(const string& name, FeatureStatsType v)
   m_map.set(name,v);
 }
 
+void FeatureStats::addSparse(size_t id, FeatureStatsType v)
+{
+  m_map.set(id,v);
+}
+
+void FeatureStats::mergeSparse(const SparseVector& sparseWeights)
+{
+  if (sparseWeights.size()) {
+    //Merge the sparse features
+    FeatureStatsType merged = inner_product(sparseWeights, m_map);
+    add(merged);
+    m_map.clear();
+  }
+}
+
 void FeatureStats::set(string &theString, const SparseVector& sparseWeights )
 {
   string substring, stringBuf;
@@ -267,19 +282,7 @@ void FeatureStats::set(string &theString, const SparseVector& sparseWeights )
     }
   }
 
-  if (sparseWeights.size()) {
-    //Merge the sparse features
-    FeatureStatsType merged = inner_product(sparseWeights, m_map);
-    add(merged);
-    /*
-    cerr << "Merged ";
-    sparseWeights.write(cerr,"=");
-    cerr << " and ";
-    map_.write(cerr,"=");
-    cerr << " to give " <<  merged << endl;
-    */
-    m_map.clear();
-  }
+  mergeSparse(sparseWeights);
   /*
   cerr << "FS: ";
   for (size_t i = 0; i < entries_; ++i) {
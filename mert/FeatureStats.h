@@ -92,6 +92,10 @@ public:
   void expand();
   void add(FeatureStatsType v);
   void addSparse(const std::string& name, FeatureStatsType v);
+  void addSparse(std::size_t id, FeatureStatsType v);
+
+  /** Fold the sparse features into one dense feature if weights are given */
+  void mergeSparse(const SparseVector& sparseWeights);
 
   void clear() {
     memset((void*)m_array, 0, GetArraySizeWithBytes());
@@ -145,57 +145,66 @@ ValType HopeFearDecoder::Evaluate(const AvgWeightVector& wv)
   return scorer_->calculateScore(stats);
 }
 
-NbestHopeFearDecoder::NbestHopeFearDecoder(
-  const vector<string>& featureFiles,
-  const vector<string>&  scoreFiles,
-  bool streaming,
-  bool  no_shuffle,
-  bool safe_hope,
-  Scorer* scorer
-) : safe_hope_(safe_hope)
-{
-  scorer_ = scorer;
-  if (streaming) {
-    train_.reset(new StreamingHypPackEnumerator(featureFiles, scoreFiles));
-  } else {
-    train_.reset(new RandomAccessHypPackEnumerator(featureFiles, scoreFiles, no_shuffle));
-  }
-}
-
-
-void NbestHopeFearDecoder::next()
+namespace
 {
-  train_->next();
-}
 
-bool NbestHopeFearDecoder::finished()
+// The n-best list the iterator currently points at
+class CurrentNbest
 {
-  return train_->finished();
-}
+public:
+  CurrentNbest(HypPackEnumerator& train) : train_(train) {}
+  size_t size() const {
+    return train_.cur_size();
+  }
+  const MiraFeatureVector& featuresAt(size_t i) const {
+    return train_.featuresAt(i);
+  }
+  const ScoreDataItem& scoresAt(size_t i) const {
+    return train_.scoresAt(i);
+  }
+private:
+  HypPackEnumerator& train_;
+};
 
-void NbestHopeFearDecoder::reset()
+// A fixed n-best list of the in-memory collection
+class StoredNbest
 {
-  train_->reset();
-}
+public:
+  StoredNbest(const RandomAccessHypPackEnumerator& train, size_t id) : train_(train), id_(id) {}
+  size_t size() const {
+    return train_.list_size(id_);
+  }
+  const MiraFeatureVector& featuresAt(size_t i) const {
+    return train_.featuresAt(id_, i);
+  }
+  const ScoreDataItem& scoresAt(size_t i) const {
+    return train_.scoresAt(id_, i);
+  }
+private:
+  const RandomAccessHypPackEnumerator& train_;
+  size_t id_;
+};
 
-void NbestHopeFearDecoder::HopeFear(
+template <class Nbest>
+void NbestHopeFear(
+  const Nbest& nbest,
+  bool safe_hope,
+  Scorer* scorer,
   const std::vector<ValType>& backgroundBleu,
   const MiraWeightVector& wv,
   HopeFearData* hopeFear
 )
 {
-
-
   // Hope / fear decode
   ValType hope_scale = 1.0;
   size_t hope_index=0, fear_index=0, model_index=0;
   ValType hope_score=0, fear_score=0, model_score=0;
   for(size_t safe_loop=0; safe_loop<2; safe_loop++) {
     ValType hope_bleu=0, hope_model=0;
-    for(size_t i=0; i< train_->cur_size(); i++) {
-      const MiraFeatureVector& vec=train_->featuresAt(i);
+    for(size_t i=0; i< nbest.size(); i++) {
+      const MiraFeatureVector& vec=nbest.featuresAt(i);
       ValType score = wv.score(vec);
-      ValType bleu = scorer_->calculateSentenceLevelBackgroundScore(train_->scoresAt(i),backgroundBleu);
+      ValType bleu = scorer->calculateSentenceLevelBackgroundScore(nbest.scoresAt(i),backgroundBleu);
       // Hope
       if(i==0 || (hope_scale*score + bleu) > hope_score) {
         hope_score = hope_scale*score + bleu;
@@ -217,37 +226,110 @@ void NbestHopeFearDecoder::HopeFear(
     // Outer loop rescales the contribution of model score to 'hope' in antagonistic cases
     // where model score is having far more influence than BLEU
     hope_bleu *= BLEU_RATIO; // We only care about cases where model has MUCH more influence than BLEU
-    if(safe_hope_ && safe_loop==0 && abs(hope_model)>1e-8 && abs(hope_bleu)/abs(hope_model)<hope_scale)
+    if(safe_hope && safe_loop==0 && abs(hope_model)>1e-8 && abs(hope_bleu)/abs(hope_model)<hope_scale)
       hope_scale = abs(hope_bleu) / abs(hope_model);
     else break;
   }
-  hopeFear->modelFeatures = train_->featuresAt(model_index);
-  hopeFear->hopeFeatures = train_->featuresAt(hope_index);
-  hopeFear->fearFeatures = train_->featuresAt(fear_index);
+  hopeFear->modelFeatures = nbest.featuresAt(model_index);
+  hopeFear->hopeFeatures = nbest.featuresAt(hope_index);
+  hopeFear->fearFeatures = nbest.featuresAt(fear_index);
 
-  hopeFear->hopeStats = train_->scoresAt(hope_index);
-  hopeFear->hopeBleu = scorer_->calculateSentenceLevelBackgroundScore(hopeFear->hopeStats, backgroundBleu);
-  const vector<float>& fear_stats = train_->scoresAt(fear_index);
-  hopeFear->fearBleu = scorer_->calculateSentenceLevelBackgroundScore(fear_stats, backgroundBleu);
+  hopeFear->hopeStats = nbest.scoresAt(hope_index);
+  hopeFear->hopeBleu = scorer->calculateSentenceLevelBackgroundScore(hopeFear->hopeStats, backgroundBleu);
+  const vector<float>& fear_stats = nbest.scoresAt(fear_index);
+  hopeFear->fearBleu = scorer->calculateSentenceLevelBackgroundScore(fear_stats, backgroundBleu);
 
-  hopeFear->modelStats = train_->scoresAt(model_index);
+  hopeFear->modelStats = nbest.scoresAt(model_index);
   hopeFear->hopeFearEqual = (hope_index == fear_index);
 }
 
-void NbestHopeFearDecoder::MaxModel(const AvgWeightVector& wv, std::vector<ValType>* stats)
+template <class Nbest>
+void NbestMaxModel(const Nbest& nbest, const AvgWeightVector& wv, std::vector<ValType>* stats)
 {
   // Find max model
   size_t max_index=0;
   ValType max_score=0;
-  for(size_t i=0; i<train_->cur_size(); i++) {
-    MiraFeatureVector vec(train_->featuresAt(i));
-    ValType score = wv.score(vec);
+  for(size_t i=0; i<nbest.size(); i++) {
+    ValType score = wv.score(nbest.featuresAt(i));
     if(i==0 || score > max_score) {
       max_index = i;
       max_score = score;
     }
   }
-  *stats = train_->scoresAt(max_index);
+  *stats = nbest.scoresAt(max_index);
+}
+
+}
+
+NbestHopeFearDecoder::NbestHopeFearDecoder(
+  const vector<string>& featureFiles,
+  const vector<string>&  scoreFiles,
+  bool streaming,
+  bool  no_shuffle,
+  bool safe_hope,
+  Scorer* scorer
+) : random_access_(NULL), safe_hope_(safe_hope)
+{
+  scorer_ = scorer;
+  if (streaming) {
+    train_.reset(new StreamingHypPackEnumerator(featureFiles, scoreFiles));
+  } else {
+    random_access_ = new RandomAccessHypPackEnumerator(featureFiles, scoreFiles, no_shuffle);
+    train_.reset(random_access_);
+  }
+}
+
+
+void NbestHopeFearDecoder::next()
+{
+  train_->next();
+}
+
+bool NbestHopeFearDecoder::finished()
+{
+  return train_->finished();
+}
+
+void NbestHopeFearDecoder::reset()
+{
+  train_->reset();
+}
+
+void NbestHopeFearDecoder::HopeFear(
+  const std::vector<ValType>& backgroundBleu,
+  const MiraWeightVector& wv,
+  HopeFearData* hopeFear
+)
+{
+  NbestHopeFear(CurrentNbest(*train_), safe_hope_, scorer_, backgroundBleu, wv, hopeFear);
+}
+
+void NbestHopeFearDecoder::MaxModel(const AvgWeightVector& wv, std::vector<ValType>* stats)
+{
+  NbestMaxModel(CurrentNbest(*train_), wv, stats);
+}
+
+size_t NbestHopeFearDecoder::NumSentences() const
+{
+  UTIL_THROW_IF(!random_access_, util::Exception, "Sentence access requires in-memory n-best lists");
+  return random_access_->num_lists();
+}
+
+void NbestHopeFearDecoder::HopeFear(
+  size_t sentenceId,
+  const std::vector<ValType>& backgroundBleu,
+  const MiraWeightVector& wv,
+  HopeFearData* hopeFear
+) const
+{
+  UTIL_THROW_IF(!random_access_, util::Exception, "Sentence access requires in-memory n-best lists");
+  NbestHopeFear(StoredNbest(*random_access_, sentenceId), safe_hope_, scorer_, backgroundBleu, wv, hopeFear);
+}
+
+void NbestHopeFearDecoder::MaxModel(size_t sentenceId, const AvgWeightVector& wv, std::vector<ValType>* stats) const
+{
+  UTIL_THROW_IF(!random_access_, util::Exception, "Sentence access requires in-memory n-best lists");
+  NbestMaxModel(StoredNbest(*random_access_, sentenceId), wv, stats);
 }
 
 
@@ -116,8 +116,31 @@ public:
 
   virtual void MaxModel(const AvgWeightVector& wv, std::vector<ValType>* stats);
 
+  /** True if the lists are held in memory, which the sentence id versions below require */
+  bool RandomAccess() const {
+    return random_access_ != NULL;
+  }
+  std::size_t NumSentences() const;
+  std::size_t CurrentId() {
+    return train_->cur_id();
+  }
+
+  /**
+    * Hope, fear and model for the given sentence. Unlike the iterator
+    * versions, these can be called from several threads at once.
+    **/
+  void HopeFear(
+    std::size_t sentenceId,
+    const std::vector<ValType>& backgroundBleu,
+    const MiraWeightVector& wv,
+    HopeFearData* hopeFear
+  ) const;
+
+  void MaxModel(std::size_t sentenceId, const AvgWeightVector& wv, std::vector<ValType>* stats) const;
+
 private:
   boost::scoped_ptr<HypPackEnumerator> train_;
+  RandomAccessHypPackEnumerator* random_access_; // train_, if in memory
   bool safe_hope_;
 
 };
@@ -95,6 +95,21 @@ public:
   virtual const MiraFeatureVector& featuresAt(std::size_t i);
   virtual const ScoreDataItem& scoresAt(std::size_t i);
 
+  // Stateless access by sentence id. The lists are read-only after
+  // construction, so these can be used from several threads at once.
+  std::size_t num_lists() const {
+    return m_features.size();
+  }
+  std::size_t list_size(std::size_t id) const {
+    return m_features[id].size();
+  }
+  const MiraFeatureVector& featuresAt(std::size_t id, std::size_t i) const {
+    return m_features[id][i];
+  }
+  const ScoreDataItem& scoresAt(std::size_t id, std::size_t i) const {
+    return m_scores[id][i];
+  }
+
 private:
   bool m_no_shuffle;
   std::size_t m_cur_index;
@@ -1,5 +1,6 @@
 #include "MiraWeightVector.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace std;
@@ -52,6 +53,41 @@ void MiraWeightVector::tick()
   m_numUpdates++;
 }
 
+/**
+ * Iterative parameter mixing
+ * \param shards Weight vectors trained in parallel
+ */
+void MiraWeightVector::mix(vector<MiraWeightVector>& shards)
+{
+  if (shards.empty()) return;
+
+  this->fixTotals();
+  size_t size = m_weights.size();
+  for(size_t k=0; k<shards.size(); k++) {
+    shards[k].fixTotals();
+    size = max(size, shards[k].m_weights.size());
+  }
+
+  vector<ValType> weights(size, 0.0);
+  vector<ValType> totals(m_totals);
+  totals.resize(size, 0.0);
+  size_t numUpdates = m_numUpdates;
+  for(size_t k=0; k<shards.size(); k++) {
+    const MiraWeightVector& shard = shards[k];
+    for(size_t i=0; i<shard.m_weights.size(); i++) {
+      weights[i] += shard.m_weights[i] / shards.size();
+      // shard totals include ours, count them once only
+      totals[i] += shard.m_totals[i] - (i < m_totals.size() ? m_totals[i] : 0.0);
+    }
+    numUpdates += shard.m_numUpdates - m_numUpdates;
+  }
+
+  m_weights.swap(weights);
+  m_totals.swap(totals);
+  m_numUpdates = numUpdates;
+  m_lastUpdated.assign(size, m_numUpdates);
+}
+
 /**
  * Score a feature vector according to the model
  * \param fv Feature vector to be scored
@@ -47,6 +47,15 @@ public:
    */
   void tick();
 
+  /**
+   * Iterative parameter mixing. Each of the shards started out as a copy of
+   * this vector and was then trained on its own part of the data. The weights
+   * become the mean of the shards' weights, and the averaging totals collect
+   * the updates made in all shards.
+   * \param shards Weight vectors trained in parallel
+   */
+  void mix(std::vector<MiraWeightVector>& shards);
+
   /**
    * Score a feature vector according to the model
    * \param fv Feature vector to be scored
@@ -0,0 +1,56 @@
+#include "MiraFeatureVector.h"
+#include "MiraWeightVector.h"
+
+#define BOOST_TEST_MODULE MiraWeightVector
+#include <boost/test/unit_test.hpp>
+
+using namespace MosesTuning;
+
+namespace
+{
+
+MiraFeatureVector MakeVector(ValType f0, ValType f1)
+{
+  std::vector<ValType> dense;
+  dense.push_back(f0);
+  dense.push_back(f1);
+  return MiraFeatureVector(dense, std::vector<std::size_t>(), std::vector<ValType>());
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(mix_averages_weights)
+{
+  std::vector<ValType> init(2, 1.0);
+  MiraWeightVector wv(init);
+
+  std::vector<MiraWeightVector> shards(2, wv);
+  shards[0].update(MakeVector(2.0, 0.0), 1.0);
+  shards[1].update(MakeVector(0.0, 4.0), 1.0);
+  shards[1].update(MakeVector(0.0, 2.0), 1.0);
+
+  wv.mix(shards);
+
+  // weights are the mean of the shards
+  BOOST_CHECK_CLOSE(wv.score(MakeVector(1.0, 0.0)), 2.0, 1e-5);
+  BOOST_CHECK_CLOSE(wv.score(MakeVector(0.0, 1.0)), 4.0, 1e-5);
+
+  // the totals start from the initial weights and collect all three
+  // updates made in the shards: f0 was 3, 1, 1 and f1 was 1, 5, 7
+  AvgWeightVector avg = wv.avg();
+  BOOST_CHECK_CLOSE(avg.weight(0), 6.0 / 3, 1e-5);
+  BOOST_CHECK_CLOSE(avg.weight(1), 14.0 / 3, 1e-5);
+}
+
+BOOST_AUTO_TEST_CASE(mix_grows_weights)
+{
+  MiraWeightVector wv;
+
+  std::vector<MiraWeightVector> shards(2, wv);
+  shards[1].update(MakeVector(0.0, 2.0), 1.0);
+
+  wv.mix(shards);
+
+  BOOST_CHECK_EQUAL(wv.avg().size(), 2);
+  BOOST_CHECK_CLOSE(wv.score(MakeVector(0.0, 1.0)), 1.0, 1e-5);
+}
@@ -7,8 +7,13 @@
 #include <map>
 #include <cfloat>
 #include <iostream>
+#include <queue>
+#include <functional>
 #include <stdint.h>
 
+#include <boost/shared_ptr.hpp>
+
+#include "moses/ThreadPool.h"
 #include "Point.h"
 #include "Util.h"
 
@@ -32,14 +37,96 @@ inline float intersect(float m1, float b1, float m2, float b2)
   return isect;
 }
 
+// Below this, splitting the sentences of a line search costs more than it saves.
+const size_t kMinSentencesPerShard = 16;
+
 } // namespace
 
 namespace MosesTuning
 {
 
+namespace
+{
+
+/**
+ * Thresholds of a contiguous range of sentences.
+ */
+class LineThresholdsTask : public Moses::Task
+{
+public:
+  LineThresholdsTask(const Optimizer& optimizer, unsigned begin, unsigned end,
+                     const Point& origin, const Point& direction,
+                     map<float,diff_t>& thresholds, vector<unsigned>& first1best)
+    : m_optimizer(optimizer), m_begin(begin), m_end(end), m_origin(origin), m_direction(direction),
+      m_thresholds(thresholds), m_first1best(first1best) {}
+
+  virtual void Run() {
+    m_optimizer.LineThresholds(m_begin, m_end, m_origin, m_direction, m_thresholds, m_first1best);
+  }
+
+private:
+  const Optimizer& m_optimizer;
+  unsigned m_begin, m_end;
+  const Point& m_origin;
+  const Point& m_direction;
+  map<float,diff_t>& m_thresholds;
+  vector<unsigned>& m_first1best;
+};
+
+/**
+ * Line search along one direction, for running the directions of a Powell round concurrently.
+ */
+class LineOptimizeTask : public Moses::Task
+{
+public:
+  LineOptimizeTask(const Optimizer& optimizer, const Point& origin, const Point& direction,
+                   size_t num_threads, Point& best, statscore_t& score)
+    : m_optimizer(optimizer), m_origin(origin), m_direction(direction), m_num_threads(num_threads),
+      m_best(best), m_score(score) {}
+
+  virtual void Run() {
+    m_score = m_optimizer.LineOptimize(m_origin, m_direction, m_best, m_num_threads);
+  }
+
+private:
+  const Optimizer& m_optimizer;
+  const Point& m_origin;
+  const Point& m_direction;
+  size_t m_num_threads;
+  Point& m_best;
+  statscore_t& m_score;
+};
+
+/**
+ * k-way merge of the per shard threshold maps. Diffs of a threshold shared by
+ * several shards are concatenated in shard, i.e. sentence, order.
+ */
+void MergeThresholds(const vector<map<float,diff_t> >& shards, vector<threshold>& merged)
+{
+  typedef pair<float, size_t> HeapEntry;
+  priority_queue<HeapEntry, vector<HeapEntry>, greater<HeapEntry> > heap;
+  vector<map<float,diff_t>::const_iterator> pos(shards.size());
+  for (size_t i = 0; i < shards.size(); ++i) {
+    pos[i] = shards[i].begin();
+    if (pos[i] != shards[i].end()) heap.push(HeapEntry(pos[i]->first, i));
+  }
+  while (!heap.empty()) {
+    size_t i = heap.top().second;
+    heap.pop();
+    if (merged.empty() || merged.back().first != pos[i]->first) {
+      merged.push_back(threshold(pos[i]->first, diff_t()));
+    }
+    diff_t& diffs = merged.back().second;
+    diffs.insert(diffs.end(), pos[i]->second.begin(), pos[i]->second.end());
+    if (++pos[i] != shards[i].end()) heap.push(HeapEntry(pos[i]->first, i));
+  }
+}
+
+} // namespace
+
 
 Optimizer::Optimizer(unsigned Pd, const vector<unsigned>& i2O, const vector<bool>& pos, const vector<parameter_t>& start, unsigned int nrandom)
-  : m_scorer(NULL), m_feature_data(), m_num_random_directions(nrandom), m_positive(pos)
+  : m_scorer(NULL), m_feature_data(), m_num_random_directions(nrandom), m_num_threads(1), m_positive(pos)
 {
   // Warning: the init vector is a full set of parameters, of dimension m_pdim!
   Point::m_pdim = Pd;
@@ -90,17 +177,11 @@ map<float,diff_t >::iterator AddThreshold(map<float,diff_t >& thresholdmap, floa
   return it;
 }
 
-statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction, Point& bestpoint) const
+void Optimizer::LineThresholds(unsigned begin, unsigned end, const Point& origin, const Point& direction,
+                               map<float,diff_t>& thresholdmap, vector<unsigned>& first1best) const
 {
-  // We are looking for the best Point on the line y=Origin+x*direction
   float min_int = 0.0001;
-  //typedef pair<unsigned,unsigned> diff;//first the sentence that changes, second is the new 1best for this sentence
-  //list<threshold> thresholdlist;
-
-  map<float,diff_t> thresholdmap;
-  thresholdmap[MIN_FLOAT] = diff_t();
-  vector<unsigned> first1best;       // the vector of nbests for x=-inf
-  for (unsigned int S = 0; S < size(); S++) {
+  for (unsigned int S = begin; S < end; S++) {
     map<float,diff_t >::iterator previnserted = thresholdmap.begin();
     // First, we determine the translation with the best feature score
     // for each sentence and each value of x.
@@ -224,14 +305,50 @@ statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction,
       gradientit = leftmost;
     } // while (gradientit!=gradient.end()){
   }   // loop on S
+}
+
+statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction, Point& bestpoint, size_t num_threads) const
+{
+  // We are looking for the best Point on the line y=Origin+x*direction
+  size_t num_shards = min<size_t>(num_threads, size() / kMinSentencesPerShard);
+  if (num_shards < 1) num_shards = 1;
+
+  // Each shard of sentences gets its own threshold map, starting at x=-inf.
+  vector<map<float,diff_t> > shardthresholds(num_shards);
+  vector<vector<unsigned> > shardfirst1best(num_shards);
+  for (size_t i = 0; i < num_shards; ++i) {
+    shardthresholds[i][MIN_FLOAT] = diff_t();
+  }
+#ifdef WITH_THREADS
+  if (num_shards > 1) {
+    Moses::ThreadPool pool(num_shards);
+    for (size_t i = 0; i < num_shards; ++i) {
+      boost::shared_ptr<Moses::Task> task(new LineThresholdsTask(
+                                            *this, i * size() / num_shards, (i + 1) * size() / num_shards,
+                                            origin, direction, shardthresholds[i], shardfirst1best[i]));
+      pool.Submit(task);
+    }
+    pool.Stop(true);
+  } else
+#endif
+  {
+    LineThresholds(0, size(), origin, direction, shardthresholds[0], shardfirst1best[0]);
+  }
+
+  vector<unsigned> first1best;       // the vector of nbests for x=-inf
+  for (size_t i = 0; i < num_shards; ++i) {
+    first1best.insert(first1best.end(), shardfirst1best[i].begin(), shardfirst1best[i].end());
+  }
+  vector<threshold> thresholds;
+  MergeThresholds(shardthresholds, thresholds);
 
   // Now the thresholdlist is up to date: it contains a list of all the parameter_ts where
   // the function changed its value, along with the nbest list for the interval after each threshold.
 
-  map<float,diff_t >::iterator thrit;
+  vector<threshold>::const_iterator thrit;
   if (verboselevel() > 6) {
-    cerr << "Thresholds:(" << thresholdmap.size() << ")" << endl;
-    for (thrit = thresholdmap.begin(); thrit != thresholdmap.end(); thrit++) {
+    cerr << "Thresholds:(" << thresholds.size() << ")" << endl;
+    for (thrit = thresholds.begin(); thrit != thresholds.end(); thrit++) {
       cerr << "x: " << thrit->first << " diffs";
       for (size_t j = 0; j < thrit->second.size(); ++j) {
         cerr << " " <<thrit->second[j].first << "," << thrit->second[j].second;
@@ -241,19 +358,19 @@ statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction,
   }
 
   // Last thing to do is compute the Stat score (i.e., BLEU) and find the minimum.
-  thrit = thresholdmap.begin();
+  thrit = thresholds.begin();
   ++thrit;       // first diff corrrespond to MIN_FLOAT and first1best
   diffs_t diffs;
-  for (; thrit != thresholdmap.end(); thrit++)
+  for (; thrit != thresholds.end(); thrit++)
     diffs.push_back(thrit->second);
   vector<statscore_t> scores = GetIncStatScore(first1best, diffs);
 
-  thrit = thresholdmap.begin();
+  thrit = thresholds.begin();
   statscore_t bestscore = MIN_FLOAT;
   float bestx = MIN_FLOAT;
 
   // We skipped the first el of thresholdlist but GetIncStatScore return 1 more for first1best.
-  UTIL_THROW_IF(scores.size() != thresholdmap.size(),
+  UTIL_THROW_IF(scores.size() != thresholds.size(),
                 util::Exception,
                 "Error");
   for (unsigned int sc = 0; sc != scores.size(); sc++) {
@@ -279,12 +396,12 @@ statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction,
       // interval, take x to be the first interval boundary - 1000.
       // These values are taken from cmert.
       float leftx = thrit->first;
-      if (thrit == thresholdmap.begin()) {
+      if (thrit == thresholds.begin()) {
         leftx = MIN_FLOAT;
       }
       ++thrit;
       float rightx = MAX_FLOAT;
-      if (thrit != thresholdmap.end()) {
+      if (thrit != thresholds.end()) {
         rightx = thrit->first;
       }
       --thrit;
@@ -403,14 +520,11 @@ statscore_t SimpleOptimizer::TrueRun(Point& P) const
       cerr << "last diff=" << bestscore-prevscore << " nrun " << nrun << endl;
     prevscore = bestscore;
 
-    Point  linebest;
-
-    for (unsigned int d = 0; d < Point::getdim() + m_num_random_directions; d++) {
-      if (verboselevel() > 4) {
-        //	cerr<<"minimizing along direction "<<d<<endl;
-        cerr << "starting point: " << P << " => " << prevscore << endl;
-      }
-      Point direction;
+    // All directions of a round start from P, so their line searches are independent.
+    const unsigned int ndirections = Point::getdim() + m_num_random_directions;
+    vector<Point> directions(ndirections);
+    for (unsigned int d = 0; d < ndirections; d++) {
+      Point& direction = directions[d];
       if (d < Point::getdim()) { // regular updates along one dimension
         for (unsigned int i = 0; i < Point::getdim(); i++)
           direction[i]=0.0;
@@ -418,7 +532,36 @@ statscore_t SimpleOptimizer::TrueRun(Point& P) const
       } else { // random direction update
         direction.Randomize();
       }
-      statscore_t curscore = LineOptimize(P, direction, linebest);//find the minimum on the line
+    }
+
+    vector<Point> linebests(ndirections);
+    vector<statscore_t> curscores(ndirections);
+#ifdef WITH_THREADS
+    if (m_num_threads > 1 && ndirections > 1) {
+      // Threads left over when there are fewer directions go to the line searches.
+      size_t outer = min<size_t>(m_num_threads, ndirections);
+      Moses::ThreadPool pool(outer);
+      for (unsigned int d = 0; d < ndirections; d++) {
+        boost::shared_ptr<Moses::Task> task(new LineOptimizeTask(
+                                              *this, P, directions[d], m_num_threads / outer, linebests[d], curscores[d]));
+        pool.Submit(task);
+      }
+      pool.Stop(true);
+    } else
+#endif
+    {
+      for (unsigned int d = 0; d < ndirections; d++) {
+        curscores[d] = LineOptimize(P, directions[d], linebests[d]);//find the minimum on the line
+      }
+    }
+
+    for (unsigned int d = 0; d < ndirections; d++) {
+      if (verboselevel() > 4) {
+        //	cerr<<"minimizing along direction "<<d<<endl;
+        cerr << "starting point: " << P << " => " << prevscore << endl;
+      }
+      statscore_t curscore = curscores[d];
+      const Point& linebest = linebests[d];
       if (verboselevel() > 5) {
         cerr << "direction: " << d << " => " << curscore << endl;
         cerr << "\tending point: "<< linebest << " => " << curscore << endl;
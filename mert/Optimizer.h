@@ -1,6 +1,7 @@
 #ifndef MERT_OPTIMIZER_H_
 #define MERT_OPTIMIZER_H_
 
+#include <map>
 #include <vector>
 #include <string>
 #include "Data.h"
@@ -25,6 +26,7 @@ protected:
   Scorer *m_scorer;      // no accessor for them only child can use them
   FeatureDataHandle m_feature_data;  // no accessor for them only child can use them
   unsigned int m_num_random_directions;
+  std::size_t m_num_threads;
 
   const std::vector<bool>& m_positive;
 
@@ -37,6 +39,13 @@ public:
   void SetFeatureData(FeatureDataHandle feature_data) {
     m_feature_data = feature_data;
   }
+  /**
+   * Number of threads used inside one optimization run
+   * (line searches and directions). Only has an effect with threads.
+   */
+  void SetThreadCount(std::size_t num_threads) {
+    m_num_threads = num_threads ? num_threads : 1;
+  }
   virtual ~Optimizer();
 
   unsigned size() const {
@@ -72,7 +81,22 @@ public:
   /**
    * Get the optimal Lambda and the best score in a particular direction from a given Point.
    */
-  statscore_t LineOptimize(const Point& start, const Point& direction, Point& best) const;
+  statscore_t LineOptimize(const Point& start, const Point& direction, Point& best) const {
+    return LineOptimize(start, direction, best, m_num_threads);
+  }
+
+  /**
+   * As above, with the sentences split into num_threads contiguous shards
+   * whose thresholds are computed concurrently and then merged.
+   */
+  statscore_t LineOptimize(const Point& start, const Point& direction, Point& best, std::size_t num_threads) const;
+
+  /**
+   * Add the points on the line where the 1best of the sentences [begin, end) changes
+   * to thresholds, and append the 1best at x=-inf of each sentence to first1best.
+   */
+  void LineThresholds(unsigned begin, unsigned end, const Point& origin, const Point& direction,
+                      std::map<float,diff_t>& thresholds, std::vector<unsigned>& first1best) const;
 };
 
 
@@ -10,6 +10,7 @@
 
 #include <iostream>
 #include <fstream>
+#include "ColumnarData.h"
 #include "Scorer.h"
 #include "Util.h"
 #include "FileStream.h"
@@ -55,6 +56,13 @@ void ScoreData::save(bool bin)
   save(&cout, bin);
 }
 
+void ScoreData::saveColumnar(const string &file) const
+{
+  if (file.empty()) return;
+  TRACE_ERR("saving the columnar array into " << file << endl);
+  ColumnarScoreFile::Write(m_array, m_score_type, file);
+}
+
 void ScoreData::load(istream* is)
 {
   ScoreArray entry;
@@ -75,6 +83,15 @@ void ScoreData::load(istream* is)
 void ScoreData::load(const string &file)
 {
   TRACE_ERR("loading score data from " << file << endl);
+  if (IsColumnarFile(file, COLUMNAR_SCORES_MAGIC)) {
+    ColumnarScoreFile columnar(file);
+    ScoreArray entry;
+    for (size_t i = 0; i < columnar.NumSentences(); ++i) {
+      columnar.Get(i, entry);
+      add(entry);
+    }
+    return;
+  }
   inputfilestream input_stream(file); // matches a stream with a file. Opens the file
   if (!input_stream) {
     throw runtime_error("Unable to open score file: " + file);
@@ -91,7 +91,11 @@ public:
   void save(std::ostream* os, bool bin=false);
   void save(bool bin=false);
 
+  /** Write the memory-mappable format of ColumnarData.h */
+  void saveColumnar(const std::string &file) const;
+
   void load(std::istream* is);
+  /** Loads the text and binary formats as well as the columnar format */
   void load(const std::string &file);
 
   bool check_consistency() const;
@@ -21,6 +21,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "util/file_piece.hh"
 #include "util/tokenize_piece.hh"
 
+#include "ColumnarData.h"
 #include "ScoreArray.h"
 #include "ScoreDataIterator.h"
 
@@ -31,10 +32,15 @@ namespace MosesTuning
 {
 
 
-ScoreDataIterator::ScoreDataIterator() {}
+ScoreDataIterator::ScoreDataIterator() : m_sentence(0) {}
 
-ScoreDataIterator::ScoreDataIterator(const string& filename)
+ScoreDataIterator::ScoreDataIterator(const string& filename) : m_sentence(0)
 {
+  if (IsColumnarFile(filename, COLUMNAR_SCORES_MAGIC)) {
+    m_columnar.reset(new ColumnarScoreFile(filename));
+    readNextColumnar();
+    return;
+  }
   m_in.reset(new FilePiece(filename.c_str()));
   readNext();
 }
@@ -74,14 +80,38 @@ void ScoreDataIterator::readNext()
   }
 }
 
+void ScoreDataIterator::readNextColumnar()
+{
+  m_next.clear();
+  if (m_sentence == m_columnar->NumSentences()) {
+    m_columnar.reset();
+    return;
+  }
+  size_t first = m_columnar->FirstHyp(m_sentence);
+  m_next.resize(m_columnar->NumHyps(m_sentence));
+  for (size_t i = 0; i < m_next.size(); ++i) {
+    m_columnar->Get(first + i, m_next[i]);
+  }
+  ++m_sentence;
+}
+
 void ScoreDataIterator::increment()
 {
-  readNext();
+  if (m_columnar) {
+    readNextColumnar();
+  } else {
+    readNext();
+  }
 }
 
 
 bool ScoreDataIterator::equal(const ScoreDataIterator& rhs) const
 {
+  if (m_columnar || rhs.m_columnar) {
+    return m_columnar && rhs.m_columnar &&
+           m_columnar->FileName() == rhs.m_columnar->FileName() &&
+           m_sentence == rhs.m_sentence;
+  }
   if (!m_in && !rhs.m_in) {
     return true;
   } else if (!m_in) {
@@ -41,6 +41,7 @@ class FilePiece;
 namespace MosesTuning
 {
 
+class ColumnarScoreFile;
 
 typedef std::vector<float> ScoreDataItem;
 
@@ -67,8 +68,12 @@ private:
   const std::vector<ScoreDataItem>& dereference() const;
 
   void readNext();
+  void readNextColumnar();
 
   boost::shared_ptr<util::FilePiece> m_in;
+  // set instead of m_in when reading a columnar file
+  boost::shared_ptr<ColumnarScoreFile> m_columnar;
+  std::size_t m_sentence;
   std::vector<ScoreDataItem> m_next;
 };
 
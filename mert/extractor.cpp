@@ -31,6 +31,8 @@ void usage()
   cerr << "\tThis is of the form NAME1:VAL1,NAME2:VAL2 etc " << endl;
   cerr << "[--reference|-r] comma separated list of reference files" << endl;
   cerr << "[--binary|-b] use binary output format (default to text )" << endl;
+  cerr << "[--columnar|-C] use the memory-mapped columnar output format" << endl;
+  cerr << "\tWith only --prev-ffile/--prev-scfile this converts existing data" << endl;
   cerr << "[--nbest|-n] the nbest file" << endl;
   cerr << "[--scfile|-S] the scorer data output file" << endl;
   cerr << "[--ffile|-F] the feature data output file" << endl;
@@ -51,6 +53,7 @@ static struct option long_options[] = {
   {"filter", required_argument,0, 'l'},
   {"reference", required_argument, 0, 'r'},
   {"binary", no_argument, 0, 'b'},
+  {"columnar", no_argument, 0, 'C'},
   {"nbest", required_argument, 0, 'n'},
   {"scfile", required_argument, 0, 'S'},
   {"ffile", required_argument, 0, 'F'},
@@ -75,6 +78,7 @@ struct ProgramOption {
   string prevScoreDataFile;
   string prevFeatureDataFile;
   bool binmode;
+  bool columnar;
   bool allowDuplicates;
   int verbosity;
 
@@ -90,6 +94,7 @@ struct ProgramOption {
       prevScoreDataFile(""),
       prevFeatureDataFile(""),
       binmode(false),
+      columnar(false),
       allowDuplicates(false),
       verbosity(0) { }
 };
@@ -99,7 +104,7 @@ void ParseCommandOptions(int argc, char** argv, ProgramOption* opt)
   int c;
   int option_index;
 
-  while ((c = getopt_long(argc, argv, "s:r:f:l:n:S:F:R:E:v:hbd", long_options, &option_index)) != -1) {
+  while ((c = getopt_long(argc, argv, "s:r:f:l:n:S:F:R:E:v:hbCd", long_options, &option_index)) != -1) {
     switch (c) {
     case 's':
       opt->scorerType = string(optarg);
@@ -119,6 +124,9 @@ void ParseCommandOptions(int argc, char** argv, ProgramOption* opt)
     case 'b':
       opt->binmode = true;
       break;
+    case 'C':
+      opt->columnar = true;
+      break;
     case 'n':
       opt->nbestFile = string(optarg);
       break;
@@ -195,7 +203,9 @@ int main(int argc, char** argv)
       throw runtime_error("Error: there is a different number of previous score and feature files");
     }
 
-    if (option.binmode) {
+    if (option.columnar) {
+      cerr << "Columnar write mode is selected" << endl;
+    } else if (option.binmode) {
       cerr << "Binary write mode is selected" << endl;
     } else {
       cerr << "Binary write mode is NOT selected" << endl;
@@ -238,7 +248,11 @@ int main(int argc, char** argv)
     }
     //END_ADDED
 
-    data.save(option.featureDataFile, option.scoreDataFile, option.binmode);
+    if (option.columnar) {
+      data.saveColumnar(option.featureDataFile, option.scoreDataFile);
+    } else {
+      data.save(option.featureDataFile, option.scoreDataFile, option.binmode);
+    }
     PrintUserTime("Stopping...");
 
     return EXIT_SUCCESS;
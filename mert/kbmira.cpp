@@ -50,11 +50,195 @@ de recherches du Canada
 #include "Scorer.h"
 #include "ScorerFactory.h"
 
+#include "moses/ThreadPool.h"
+
 using namespace std;
 using namespace MosesTuning;
 
 namespace po = boost::program_options;
 
+namespace
+{
+
+struct MiraParams {
+  float c;
+  float decay;
+  bool model_bg;
+  bool verbose;
+};
+
+/**
+ * One MIRA step on a hope/fear pair. Updates the weights and the background
+ * BLEU statistics, returns true if the weights changed.
+ */
+bool MiraUpdate(const HopeFearData& hfd, const MiraParams& params, size_t sentenceIndex,
+                MiraWeightVector& wv, vector<ValType>& bg, ValType& totalLoss)
+{
+  bool updated = false;
+  if (!hfd.hopeFearEqual && hfd.hopeBleu  > hfd.fearBleu) {
+    // Vector difference
+    MiraFeatureVector diff = hfd.hopeFeatures - hfd.fearFeatures;
+    // Bleu difference
+    //assert(hfd.hopeBleu + 1e-8 >= hfd.fearBleu);
+    ValType delta = hfd.hopeBleu - hfd.fearBleu;
+    // Loss and update
+    ValType diff_score = wv.score(diff);
+    ValType loss = delta - diff_score;
+    if(params.verbose) {
+      cerr << "Updating sent " << sentenceIndex << endl;
+      cerr << "Wght: " << wv << endl;
+      cerr << "Hope: " << hfd.hopeFeatures << " BLEU:" << hfd.hopeBleu << " Score:" << wv.score(hfd.hopeFeatures) << endl;
+      cerr << "Fear: " << hfd.fearFeatures << " BLEU:" << hfd.fearBleu << " Score:" << wv.score(hfd.fearFeatures) << endl;
+      cerr << "Diff: " << diff << " BLEU:" << delta << " Score:" << diff_score << endl;
+      cerr << "Loss: " << loss <<  " Scale: " << 1 << endl;
+      cerr << endl;
+    }
+    if(loss > 0) {
+      ValType eta = min(params.c, loss / diff.sqrNorm());
+      wv.update(diff,eta);
+      totalLoss+=loss;
+      updated = true;
+    }
+    // Update BLEU statistics
+    for(size_t k=0; k<bg.size(); k++) {
+      bg[k]*=params.decay;
+      if(params.model_bg)
+        bg[k]+=hfd.modelStats[k];
+      else
+        bg[k]+=hfd.hopeStats[k];
+    }
+  }
+  return updated;
+}
+
+/**
+ * Runs one epoch of MIRA over a shard of the sentences, starting from a
+ * private copy of the weights and the background corpus.
+ */
+class MiraShardTask : public Moses::Task
+{
+public:
+  MiraShardTask(const NbestHopeFearDecoder& decoder, const MiraParams& params,
+                const MiraWeightVector& wv, const vector<ValType>& bg)
+    : m_decoder(decoder), m_params(params), m_wv(wv), m_bg(bg),
+      m_numUpdates(0), m_totalLoss(0) {}
+
+  void AddSentence(size_t sentenceId) {
+    m_sentenceIds.push_back(sentenceId);
+  }
+
+  virtual void Run() {
+    for (size_t i = 0; i < m_sentenceIds.size(); ++i) {
+      HopeFearData hfd;
+      m_decoder.HopeFear(m_sentenceIds[i], m_bg, m_wv, &hfd);
+      if (MiraUpdate(hfd, m_params, m_sentenceIds[i], m_wv, m_bg, m_totalLoss))
+        m_numUpdates++;
+    }
+  }
+
+  MiraWeightVector& GetWeights() {
+    return m_wv;
+  }
+  const vector<ValType>& GetBackground() const {
+    return m_bg;
+  }
+  size_t GetNumExamples() const {
+    return m_sentenceIds.size();
+  }
+  size_t GetNumUpdates() const {
+    return m_numUpdates;
+  }
+  ValType GetTotalLoss() const {
+    return m_totalLoss;
+  }
+
+private:
+  const NbestHopeFearDecoder& m_decoder;
+  const MiraParams& m_params;
+  MiraWeightVector m_wv;
+  vector<ValType> m_bg;
+  vector<size_t> m_sentenceIds;
+  size_t m_numUpdates;
+  ValType m_totalLoss;
+};
+
+/**
+ * Sums the sufficient statistics of the max model hypotheses of a shard.
+ */
+class MaxModelShardTask : public Moses::Task
+{
+public:
+  MaxModelShardTask(const NbestHopeFearDecoder& decoder, const AvgWeightVector& wv,
+                    size_t begin, size_t end, size_t numScores)
+    : m_decoder(decoder), m_wv(wv), m_begin(begin), m_end(end), m_stats(numScores, 0) {}
+
+  virtual void Run() {
+    vector<ValType> sent;
+    for (size_t id = m_begin; id < m_end; ++id) {
+      m_decoder.MaxModel(id, m_wv, &sent);
+      for(size_t i=0; i<sent.size(); i++) {
+        m_stats[i]+=sent[i];
+      }
+    }
+  }
+
+  const vector<ValType>& GetStats() const {
+    return m_stats;
+  }
+
+private:
+  const NbestHopeFearDecoder& m_decoder;
+  const AvgWeightVector& m_wv;
+  size_t m_begin, m_end;
+  vector<ValType> m_stats;
+};
+
+/**
+ * Run the given tasks, on a pool of threads if available.
+ */
+template <class TaskT>
+void RunTasks(const vector<boost::shared_ptr<TaskT> >& tasks, size_t threads)
+{
+#ifdef WITH_THREADS
+  Moses::ThreadPool pool(threads);
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    pool.Submit(tasks[i]);
+  }
+  pool.Stop(true);
+#else
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    tasks[i]->Run();
+  }
+#endif
+}
+
+/**
+ * Training BLEU of the averaged weights, with the sentences split over threads
+ */
+ValType ParallelEvaluate(const NbestHopeFearDecoder& decoder, const AvgWeightVector& wv,
+                         Scorer& scorer, size_t threads)
+{
+  size_t numSentences = decoder.NumSentences();
+  vector<boost::shared_ptr<MaxModelShardTask> > tasks;
+  for (size_t t = 0; t < threads; ++t) {
+    size_t begin = numSentences * t / threads;
+    size_t end = numSentences * (t + 1) / threads;
+    tasks.push_back(boost::shared_ptr<MaxModelShardTask>(
+                      new MaxModelShardTask(decoder, wv, begin, end, scorer.NumberOfScores())));
+  }
+  RunTasks(tasks, threads);
+
+  vector<ValType> stats(scorer.NumberOfScores(), 0);
+  for (size_t t = 0; t < tasks.size(); ++t) {
+    for (size_t i = 0; i < stats.size(); ++i) {
+      stats[i] += tasks[t]->GetStats()[i];
+    }
+  }
+  return scorer.calculateScore(stats);
+}
+
+}
+
 int main(int argc, char** argv)
 {
   bool help;
@@ -79,6 +263,7 @@ int main(int argc, char** argv)
   bool verbose = false; // Verbose updates
   bool safe_hope = false; // Model score cannot have more than BLEU_RATIO times more influence than BLEU
   size_t hgPruning = 50; //prune hypergraphs to have this many edges per reference word
+  size_t threads = 1; // Parallel training with iterative parameter mixing if > 1
 
   // Command-line processing follows pro.cpp
   po::options_description desc("Allowed options");
@@ -105,6 +290,7 @@ int main(int argc, char** argv)
   ("verbose", po::value(&verbose)->zero_tokens()->default_value(false), "Verbose updates")
   ("safe-hope", po::value(&safe_hope)->zero_tokens()->default_value(false), "Mode score's influence on hope decoding is limited")
   ("hg-prune", po::value<size_t>(&hgPruning), "Prune hypergraphs to have this many edges per reference word")
+  ("threads,T", po::value<size_t>(&threads), "Train on this many sentence shards in parallel, mixing the weights after each epoch (default 1)")
   ;
 
   po::options_description cmdline_options;
@@ -119,7 +305,17 @@ int main(int argc, char** argv)
     exit(0);
   }
 
-  cerr << "kbmira with c=" << c << " decay=" << decay << " no_shuffle=" << no_shuffle << endl;
+  cerr << "kbmira with c=" << c << " decay=" << decay << " no_shuffle=" << no_shuffle << " threads=" << threads << endl;
+
+  if (threads < 1) threads = 1;
+  UTIL_THROW_IF(threads > 1 && (type != "nbest" || streaming), util::Exception,
+                "Parallel batch mira requires in-memory n-best lists (no --streaming, type nbest)");
+
+  MiraParams params;
+  params.c = c;
+  params.decay = decay;
+  params.model_bg = model_bg;
+  params.verbose = verbose;
 
   if (vm.count("random-seed")) {
     cerr << "Initialising random seed to " << seed << endl;
@@ -144,8 +340,10 @@ int main(int argc, char** argv)
   vector<ValType> bg(scorer->NumberOfScores(), 1);
 
   boost::scoped_ptr<HopeFearDecoder> decoder;
+  NbestHopeFearDecoder* nbestDecoder = NULL;
   if (type == "nbest") {
-    decoder.reset(new NbestHopeFearDecoder(featureFiles, scoreFiles, streaming, no_shuffle, safe_hope, scorer.get()));
+    nbestDecoder = new NbestHopeFearDecoder(featureFiles, scoreFiles, streaming, no_shuffle, safe_hope, scorer.get());
+    decoder.reset(nbestDecoder);
   } else if (type == "hypergraph") {
     decoder.reset(new HypergraphHopeFearDecoder(hgDir, referenceFiles, initDenseSize, streaming, no_shuffle, safe_hope, hgPruning, *wv, scorer.get()));
   } else {
@@ -153,8 +351,12 @@ int main(int argc, char** argv)
   }
 
   // Training loop
-  if (!streaming_out)
-    cerr << "Initial BLEU = " << decoder->Evaluate(wv->avg()) << endl;
+  if (!streaming_out) {
+    if (threads > 1)
+      cerr << "Initial BLEU = " << ParallelEvaluate(*nbestDecoder, wv->avg(), *scorer, threads) << endl;
+    else
+      cerr << "Initial BLEU = " << decoder->Evaluate(wv->avg()) << endl;
+  }
   ValType bestBleu = 0;
   for(int j=0; j<n_iters; j++) {
     // MIRA train for one epoch
@@ -162,48 +364,46 @@ int main(int argc, char** argv)
     int iNumUpdates = 0;
     ValType totalLoss = 0.0;
     size_t sentenceIndex = 0;
-    for(decoder->reset(); !decoder->finished(); decoder->next()) {
-      HopeFearData hfd;
-      decoder->HopeFear(bg,*wv,&hfd);
-
-      // Update weights
-      if (!hfd.hopeFearEqual && hfd.hopeBleu  > hfd.fearBleu) {
-        // Vector difference
-        MiraFeatureVector diff = hfd.hopeFeatures - hfd.fearFeatures;
-        // Bleu difference
-        //assert(hfd.hopeBleu + 1e-8 >= hfd.fearBleu);
-        ValType delta = hfd.hopeBleu - hfd.fearBleu;
-        // Loss and update
-        ValType diff_score = wv->score(diff);
-        ValType loss = delta - diff_score;
-        if(verbose) {
-          cerr << "Updating sent " << sentenceIndex << endl;
-          cerr << "Wght: " << *wv << endl;
-          cerr << "Hope: " << hfd.hopeFeatures << " BLEU:" << hfd.hopeBleu << " Score:" << wv->score(hfd.hopeFeatures) << endl;
-          cerr << "Fear: " << hfd.fearFeatures << " BLEU:" << hfd.fearBleu << " Score:" << wv->score(hfd.fearFeatures) << endl;
-          cerr << "Diff: " << diff << " BLEU:" << delta << " Score:" << diff_score << endl;
-          cerr << "Loss: " << loss <<  " Scale: " << 1 << endl;
-          cerr << endl;
-        }
-        if(loss > 0) {
-          ValType eta = min(c, loss / diff.sqrNorm());
-          wv->update(diff,eta);
-          totalLoss+=loss;
-          iNumUpdates++;
-        }
-        // Update BLEU statistics
+    if (threads > 1) {
+      // Deal the (shuffled) sentences out to the shards, train each shard
+      // from the current weights, then mix
+      vector<boost::shared_ptr<MiraShardTask> > tasks;
+      for (size_t t = 0; t < threads; ++t) {
+        tasks.push_back(boost::shared_ptr<MiraShardTask>(new MiraShardTask(*nbestDecoder, params, *wv, bg)));
+      }
+      for(decoder->reset(); !decoder->finished(); decoder->next()) {
+        tasks[sentenceIndex % threads]->AddSentence(nbestDecoder->CurrentId());
+        ++sentenceIndex;
+      }
+      RunTasks(tasks, threads);
+
+      vector<MiraWeightVector> shards;
+      fill(bg.begin(), bg.end(), 0);
+      for (size_t t = 0; t < tasks.size(); ++t) {
+        shards.push_back(tasks[t]->GetWeights());
         for(size_t k=0; k<bg.size(); k++) {
-          bg[k]*=decay;
-          if(model_bg)
-            bg[k]+=hfd.modelStats[k];
-          else
-            bg[k]+=hfd.hopeStats[k];
+          bg[k] += tasks[t]->GetBackground()[k] / tasks.size();
         }
+        iNumExamples += tasks[t]->GetNumExamples();
+        iNumUpdates += tasks[t]->GetNumUpdates();
+        totalLoss += tasks[t]->GetTotalLoss();
       }
-      iNumExamples++;
-      ++sentenceIndex;
+      wv->mix(shards);
       if (streaming_out)
         cout << *wv << endl;
+    } else {
+      for(decoder->reset(); !decoder->finished(); decoder->next()) {
+        HopeFearData hfd;
+        decoder->HopeFear(bg,*wv,&hfd);
+
+        // Update weights
+        if (MiraUpdate(hfd, params, sentenceIndex, *wv, bg, totalLoss))
+          iNumUpdates++;
+        iNumExamples++;
+        ++sentenceIndex;
+        if (streaming_out)
+          cout << *wv << endl;
+      }
     }
     // Training Epoch summary
     cerr << iNumUpdates << "/" << iNumExamples << " updates"
@@ -212,7 +412,8 @@ int main(int argc, char** argv)
 
     // Evaluate current average weights
     AvgWeightVector avg = wv->avg();
-    ValType bleu = decoder->Evaluate(avg);
+    ValType bleu = (threads > 1) ? ParallelEvaluate(*nbestDecoder, avg, *scorer, threads)
+                   : decoder->Evaluate(avg);
     cerr << ", BLEU = " << bleu << endl;
     if(bleu > bestBleu) {
       /*
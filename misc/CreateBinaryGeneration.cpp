@@ -0,0 +1,48 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "moses/GenerationTable.h"
+#include "moses/InputFileStream.h"
+#include "moses/Util.h"
+#include "util/exception.hh"
+
+// Compiles a generation table in Moses format for GenerationDictionary, which
+// recognises the binary file by its header and memory maps it.  The numbers
+// of factors and scores are those of the first line of the table.
+int main(int argc, char* argv[])
+{
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <generation-table> <output-file>" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try {
+    size_t numInputFactors = 0, numOutputFactors = 0, numScores = 0;
+    {
+      Moses::InputFileStream in(argv[1]);
+      UTIL_THROW_IF2(!in.good(), "Couldn't read " << argv[1]);
+      std::string line;
+      std::vector<std::string> token;
+      while (token.empty() && std::getline(in, line)) {
+        token = Moses::Tokenize(line);
+      }
+      UTIL_THROW_IF2(token.size() < 2, argv[1] << " is not a generation table");
+      numInputFactors = Moses::Tokenize(token[0], "|").size();
+      numOutputFactors = Moses::Tokenize(token[1], "|").size();
+      numScores = token.size() - 2;
+    }
+
+    Moses::InputFileStream in(argv[1]);
+    Moses::GenerationTable table;
+    table.Load(in, argv[1], numInputFactors, numOutputFactors, numScores);
+    table.WriteBinary(argv[2]);
+    std::cerr << argv[2] << ": " << table.GetNumSources() << " input words, "
+              << numInputFactors << " input factors, " << numOutputFactors
+              << " output factors, " << numScores << " scores" << std::endl;
+  } catch (const util::Exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
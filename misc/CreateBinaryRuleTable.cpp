@@ -0,0 +1,23 @@
+#include <cstdlib>
+#include <iostream>
+#include "moses/TranslationModel/RuleTable/BinaryRuleTable.h"
+#include "util/exception.hh"
+
+// Compiles a SCFG rule table in Moses format for PhraseDictionaryMemory, which
+// searches the trie stored in the file, or RuleTable (S2T / T2S), which load
+// its rules.  They recognise the binary file by its header.
+int main(int argc, char* argv[])
+{
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <rule-table> <output-file>" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try {
+    Moses::BinaryRuleTable::Create(argv[1], argv[2]);
+  } catch (const util::Exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "StaticData.h"
+#include "TargetPhrase.h"
+#include "TargetPhraseCollection.h"
+#include "TranslationModel/PhraseDictionaryMemory.h"
+#include "TranslationModel/PhraseDictionaryNodeMemory.h"
+#include "TranslationModel/RuleTable/BinaryRuleTable.h"
+#include "TranslationModel/RuleTable/LoaderStandard.h"
+#include "parameters/AllOptions.h"
+
+using namespace Moses;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(binary_rule_table)
+
+namespace
+{
+
+const char *const kTable =
+  "das [X] ||| the [X] ||| 0.5 0.25 ||| ||| 2 4 1\n"
+  "das [X] ||| this [X] ||| 0.25 0.5 ||| ||| 2 4 1\n"
+  "das Haus [X] ||| the house [X] ||| 0.75 0.5 ||| 0-0 1-1 ||| 1 1 1\n"
+  "das [X][X] [X] ||| the [X][NP] [NP] ||| 0.5 0.5 ||| 1-1 ||| 1 1 1\n"
+  "das [X][X] [X] ||| this [X][NN] [NP] ||| 0.125 0.5 ||| 1-1 ||| 1 1 1\n"
+  "[X][X] sagt [X][X] [X] ||| [X][NP] says [X][VP] [S] ||| 0.5 0.125 "
+  "||| 0-0 2-2 ||| 1 1 1 ||| says_a 1 ||| {{Counts 2 3 1}}\n"
+  "[X][X] sagt [X][X] [X] ||| [X][VP] , says [X][NP] [S] ||| 0.25 0.125 "
+  "||| 0-3 2-0 ||| 1 1 1\n"
+  "Haus [X] ||| house [X] ||| 0.5 0.5 ||| 0-0 ||| 1 1 1\n";
+
+string TempPath()
+{
+  return (boost::filesystem::temp_directory_path()
+          / boost::filesystem::unique_path()).string();
+}
+
+vector<string> ToStrings(const TargetPhraseCollection &coll)
+{
+  vector<string> ret;
+  for (TargetPhraseCollection::const_iterator p = coll.begin();
+       p != coll.end(); ++p) {
+    ostringstream out;
+    out << **p;
+    ret.push_back(out.str());
+  }
+  sort(ret.begin(), ret.end());
+  return ret;
+}
+
+// Checks that the subtree of the binary table at node holds the same rules
+// as the subtree of the text table at textNode.
+void CheckNode(const PhraseDictionaryMemory &pt, BinaryRuleTable &table,
+               const PhraseDictionaryNodeMemory &textNode,
+               const BinaryRuleTable::Node &node)
+{
+  BOOST_CHECK_EQUAL(textNode.GetTerminalMap().size(), node.terminalCount);
+  BOOST_CHECK_EQUAL(textNode.GetNonTerminalMap().size(), node.nonTerminalCount);
+
+  TargetPhraseCollection coll;
+  table.CreateTargetPhrases(node, pt, pt.GetInput(), pt.GetOutput(), false,
+                            coll);
+  vector<string> expected = ToStrings(*textNode.GetTargetPhraseCollection());
+  vector<string> actual = ToStrings(coll);
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(),
+                                actual.begin(), actual.end());
+
+  const PhraseDictionaryNodeMemory::TerminalMap &terminals =
+    textNode.GetTerminalMap();
+  for (PhraseDictionaryNodeMemory::TerminalMap::const_iterator p =
+         terminals.begin(); p != terminals.end(); ++p) {
+    const BinaryRuleTable::Node *child = table.GetTerminalChild(node, p->first);
+    BOOST_REQUIRE(child);
+    CheckNode(pt, table, p->second, *child);
+  }
+
+  // the non-terminals of each node in kTable have distinct target labels
+  const PhraseDictionaryNodeMemory::NonTerminalMap &nonTerminals =
+    textNode.GetNonTerminalMap();
+  for (PhraseDictionaryNodeMemory::NonTerminalMap::const_iterator p =
+         nonTerminals.begin(); p != nonTerminals.end(); ++p) {
+    const BinaryRuleTable::Edge *edge = table.BeginNonTerminals(node);
+    const BinaryRuleTable::Edge *end = table.EndNonTerminals(node);
+    while (edge != end && !(table.GetTargetNonTerm(*edge) == p->first.second)) {
+      ++edge;
+    }
+    BOOST_REQUIRE(edge != end);
+    CheckNode(pt, table, p->second, table.GetChild(*edge));
+  }
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(lookup)
+{
+  const string textPath = TempPath();
+  const string binaryPath = TempPath();
+  {
+    ofstream out(textPath.c_str());
+    out << kTable;
+  }
+  BinaryRuleTable::Create(textPath, binaryPath);
+  BOOST_CHECK(BinaryRuleTable::IsBinary(binaryPath));
+  BOOST_CHECK(!BinaryRuleTable::IsBinary(textPath));
+
+  // The text table is read by the loader rather than by Load(), which would
+  // take the features to apply from the global feature list.  No features
+  // are applied, but the scores need an index.
+  PhraseDictionaryMemory pt("PhraseDictionaryMemory name=BinaryRuleTableTest"
+                            " num-features=2 input-factor=0 output-factor=0"
+                            " table-limit=0 path=" + textPath);
+  ScoreComponentCollection::RegisterScoreProducer(&pt);
+  AllOptions opts(*StaticData::Instance().options());
+  RuleTableLoaderStandard().Load(opts, pt.GetInput(), pt.GetOutput(),
+                                 textPath, 0, pt);
+
+  {
+    BinaryRuleTable table(binaryPath);
+    BOOST_CHECK_EQUAL(table.GetNumScores(), 2);
+    table.InitializeLookup(pt.GetInput(), pt.GetOutput());
+    CheckNode(pt, table, pt.GetRootNode(), table.GetRoot());
+  }
+
+  boost::filesystem::remove(textPath);
+  boost::filesystem::remove(binaryPath);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
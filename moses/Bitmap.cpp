@@ -28,64 +28,74 @@ namespace Moses
 TO_STRING_BODY(Bitmap);
 
 Bitmap::Bitmap(size_t size, const std::vector<bool>& initializer)
-  :m_bitmap(initializer.begin(), initializer.end())
+  :m_bits((size + kBitsPerWord - 1) / kBitsPerWord, 0)
+  ,m_size(size)
+  ,m_numWordsCovered(0)
 {
 
-  // The initializer may not be of the same length.  Change to the desired
-  // length.  If we need to add any elements, initialize them to false.
-  m_bitmap.resize(size, false);
+  // The initializer may not be of the same length.  Positions it doesn't
+  // cover are false.
+  for (size_t pos = 0; pos < size && pos < initializer.size(); ++pos) {
+    if (initializer[pos]) {
+      m_bits[pos / kBitsPerWord] |= uint64_t(1) << (pos % kBitsPerWord);
+    }
+  }
 
-  m_numWordsCovered = std::count(m_bitmap.begin(), m_bitmap.end(), true);
+  for (size_t word = 0; word < m_bits.size(); ++word) {
+    m_numWordsCovered += PopCount(m_bits[word]);
+  }
 
   // Find the first gap, and cache it.
-  std::vector<char>::const_iterator first_gap = std::find(
-        m_bitmap.begin(), m_bitmap.end(), false);
-  m_firstGap = (
-                 (first_gap == m_bitmap.end()) ?
-                 NOT_FOUND : first_gap - m_bitmap.begin());
+  m_firstGap = FindNext(0, false);
+  UpdateHash();
 }
 
 //! Create Bitmap of length size and initialise.
 Bitmap::Bitmap(size_t size)
-  :m_bitmap(size, false)
+  :m_bits((size + kBitsPerWord - 1) / kBitsPerWord, 0)
+  ,m_size(size)
   ,m_firstGap(0)
   ,m_numWordsCovered(0)
 
 {
+  UpdateHash();
 }
 
 //! Deep copy.
 Bitmap::Bitmap(const Bitmap &copy)
-  :m_bitmap(copy.m_bitmap)
+  :m_bits(copy.m_bits)
+  ,m_size(copy.m_size)
   ,m_firstGap(copy.m_firstGap)
   ,m_numWordsCovered(copy.m_numWordsCovered)
+  ,m_hash(copy.m_hash)
 {
 }
 
 Bitmap::Bitmap(const Bitmap &copy, const Range &range)
-  :m_bitmap(copy.m_bitmap)
+  :m_bits(copy.m_bits)
+  ,m_size(copy.m_size)
   ,m_firstGap(copy.m_firstGap)
   ,m_numWordsCovered(copy.m_numWordsCovered)
 {
   SetValueNonOverlap(range);
+  UpdateHash();
 }
 
-// for unordered_set in stack
-size_t Bitmap::hash() const
+// The hypotheses in a stack are hashed with their bitmaps, and the order of
+// hypo extension depends on it, so the hash stays what it was.
+void Bitmap::UpdateHash()
 {
-  size_t ret = boost::hash_value(m_bitmap);
-  return ret;
-}
-
-bool Bitmap::operator==(const Bitmap& other) const
-{
-  return m_bitmap == other.m_bitmap;
+  std::vector<char> ticks(m_size);
+  for (size_t pos = 0; pos < m_size; ++pos) {
+    ticks[pos] = GetValue(pos);
+  }
+  m_hash = boost::hash_value(ticks);
 }
 
 // friend
 std::ostream& operator<<(std::ostream& out, const Bitmap& bitmap)
 {
-  for (size_t i = 0 ; i < bitmap.m_bitmap.size() ; i++) {
+  for (size_t i = 0 ; i < bitmap.m_size ; i++) {
     out << int(bitmap.GetValue(i));
   }
   return out;
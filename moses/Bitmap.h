@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_WordsBitmap_h
 #define moses_WordsBitmap_h
 
+#include <stdint.h>
 #include <algorithm>
 #include <limits>
 #include <vector>
@@ -38,38 +39,100 @@ typedef unsigned long WordsBitmapID;
 
 /** Vector of boolean to represent whether a word has been translated or not.
  *
- * Implemented using a vector of char, which is usually the same representation
- * for the elements that a C array of bool would use.  A vector of bool, or a
- * Boost dynamic_bitset, could be much more efficient in theory.  Unfortunately
- * algorithms like std::find() are not optimized for vector<bool> on gcc or
- * clang, and dynamic_bitset lacks all the optimized search operations we want.
- * Only benchmarking will tell what works best.  Perhaps dynamic_bitset could
- * still be a dramatic improvement, if we flip the meaning of the bits around
- * so we can use its find_first() and find_next() for the most common searches.
+ * The bits are packed into 64-bit words, so the searches for gaps and
+ * translated words look at 64 positions at a time with count-trailing-zeros
+ * and count-leading-zeros.  The bits after the end of the sentence are 0.
+ *
+ * A bitmap doesn't change once the Bitmaps factory has made it, so its hash
+ * is computed once, when it is created.
  */
 class Bitmap
 {
   friend std::ostream& operator<<(std::ostream& out, const Bitmap& bitmap);
 private:
-  std::vector<char> m_bitmap; //! Ticks of words in sentence that have been done.
+  static const size_t kBitsPerWord = 64;
+
+  std::vector<uint64_t> m_bits; //! Ticks of words in sentence that have been done.
+  size_t m_size; //! Number of words in sentence.
   size_t m_firstGap; //! Cached position of first gap, or NOT_FOUND.
   size_t m_numWordsCovered;
+  size_t m_hash; //! Cached hash of the ticks.
 
   Bitmap(); // not implemented
   Bitmap& operator= (const Bitmap& other);
 
+  static size_t CountTrailingZeros(uint64_t bits) {
+#ifdef __GNUC__
+    return __builtin_ctzll(bits);
+#else
+    size_t ret = 0;
+    for (; !(bits & 1); bits >>= 1) ++ret;
+    return ret;
+#endif
+  }
+
+  static size_t HighestBit(uint64_t bits) {
+#ifdef __GNUC__
+    return kBitsPerWord - 1 - __builtin_clzll(bits);
+#else
+    size_t ret = 0;
+    while (bits >>= 1) ++ret;
+    return ret;
+#endif
+  }
+
+  static size_t PopCount(uint64_t bits) {
+#ifdef __GNUC__
+    return __builtin_popcountll(bits);
+#else
+    size_t ret = 0;
+    for (; bits; bits &= bits - 1) ++ret;
+    return ret;
+#endif
+  }
+
+  //! the bits of a word from position 'from' in it onwards
+  static uint64_t MaskFrom(size_t from) {
+    return ~uint64_t(0) << from;
+  }
+
+  //! the bits of a word up to and including position 'to' in it
+  static uint64_t MaskTo(size_t to) {
+    return ~uint64_t(0) >> (kBitsPerWord - 1 - to);
+  }
+
+  //! first position from pos onwards whose bit is value, or NOT_FOUND
+  size_t FindNext(size_t pos, bool value) const {
+    if (pos >= m_size) return NOT_FOUND;
+    size_t word = pos / kBitsPerWord;
+    uint64_t bits = (value ? m_bits[word] : ~m_bits[word]) & MaskFrom(pos % kBitsPerWord);
+    while (!bits) {
+      if (++word == m_bits.size()) return NOT_FOUND;
+      bits = value ? m_bits[word] : ~m_bits[word];
+    }
+    size_t found = word * kBitsPerWord + CountTrailingZeros(bits);
+    return found < m_size ? found : NOT_FOUND;
+  }
+
+  //! last position before end whose bit is value, or NOT_FOUND
+  size_t FindPrev(size_t end, bool value) const {
+    if (end == 0) return NOT_FOUND;
+    size_t word = (end - 1) / kBitsPerWord;
+    uint64_t bits = (value ? m_bits[word] : ~m_bits[word]) & MaskTo((end - 1) % kBitsPerWord);
+    while (!bits) {
+      if (word == 0) return NOT_FOUND;
+      --word;
+      bits = value ? m_bits[word] : ~m_bits[word];
+    }
+    return word * kBitsPerWord + HighestBit(bits);
+  }
+
   /** Update the first gap, when bits are flipped */
   void UpdateFirstGap(size_t startPos, size_t endPos, bool value) {
     if (value) {
       //may remove gap
       if (startPos <= m_firstGap && m_firstGap <= endPos) {
-        m_firstGap = NOT_FOUND;
-        for (size_t i = endPos + 1 ; i < m_bitmap.size(); ++i) {
-          if (!m_bitmap[i]) {
-            m_firstGap = i;
-            break;
-          }
-        }
+        m_firstGap = FindNext(endPos + 1, false);
       }
 
     } else {
@@ -86,14 +149,22 @@ private:
     size_t startPos = range.GetStartPos();
     size_t endPos = range.GetEndPos();
 
-    for(size_t pos = startPos ; pos <= endPos ; pos++) {
-      m_bitmap[pos] = true;
+    size_t startWord = startPos / kBitsPerWord;
+    size_t endWord = endPos / kBitsPerWord;
+    for (size_t word = startWord; word <= endWord; ++word) {
+      uint64_t mask = ~uint64_t(0);
+      if (word == startWord) mask &= MaskFrom(startPos % kBitsPerWord);
+      if (word == endWord) mask &= MaskTo(endPos % kBitsPerWord);
+      m_bits[word] |= mask;
     }
 
     m_numWordsCovered += range.GetNumWordsCovered();
     UpdateFirstGap(startPos, endPos, true);
   }
 
+  //! hash of the ticks, the same as that of the vector of char they used to be kept in
+  void UpdateHash();
+
 public:
   //! Create Bitmap of length size, and initialise with vector.
   explicit Bitmap(size_t size, const std::vector<bool>& initializer);
@@ -119,44 +190,33 @@ public:
 
   //! position of last word not yet translated, or NOT_FOUND if everything already translated
   size_t GetLastGapPos() const {
-    for (int pos = int(m_bitmap.size()) - 1 ; pos >= 0 ; pos--) {
-      if (!m_bitmap[pos]) {
-        return pos;
-      }
-    }
-    // no starting pos
-    return NOT_FOUND;
+    return FindPrev(m_size, false);
   }
 
 
   //! position of last translated word
   size_t GetLastPos() const {
-    for (int pos = int(m_bitmap.size()) - 1 ; pos >= 0 ; pos--) {
-      if (m_bitmap[pos]) {
-        return pos;
-      }
-    }
-    // no starting pos
-    return NOT_FOUND;
+    return FindPrev(m_size, true);
   }
 
   //! whether a word has been translated at a particular position
   bool GetValue(size_t pos) const {
-    return bool(m_bitmap[pos]);
+    return (m_bits[pos / kBitsPerWord] >> (pos % kBitsPerWord)) & 1;
   }
   //! set value at a particular position
   void SetValue( size_t pos, bool value ) {
-    bool origValue = m_bitmap[pos];
+    bool origValue = GetValue(pos);
     if (origValue == value) {
       // do nothing
     } else {
-      m_bitmap[pos] = value;
+      m_bits[pos / kBitsPerWord] ^= uint64_t(1) << (pos % kBitsPerWord);
       UpdateFirstGap(pos, pos, value);
       if (value) {
         ++m_numWordsCovered;
       } else {
         --m_numWordsCovered;
       }
+      UpdateHash();
     }
   }
 
@@ -166,40 +226,43 @@ public:
   }
   //! whether the wordrange overlaps with any translated word in this bitmap
   bool Overlap(const Range &compare) const {
-    for (size_t pos = compare.GetStartPos() ; pos <= compare.GetEndPos() ; pos++) {
-      if (m_bitmap[pos])
+    size_t startPos = compare.GetStartPos();
+    size_t endPos = compare.GetEndPos();
+    size_t startWord = startPos / kBitsPerWord;
+    size_t endWord = endPos / kBitsPerWord;
+    for (size_t word = startWord; word <= endWord; ++word) {
+      uint64_t mask = ~uint64_t(0);
+      if (word == startWord) mask &= MaskFrom(startPos % kBitsPerWord);
+      if (word == endWord) mask &= MaskTo(endPos % kBitsPerWord);
+      if (m_bits[word] & mask)
         return true;
     }
     return false;
   }
   //! number of elements
   size_t GetSize() const {
-    return m_bitmap.size();
+    return m_size;
   }
 
   inline size_t GetEdgeToTheLeftOf(size_t l) const {
     if (l == 0) return l;
-    while (l && !m_bitmap[l-1]) {
-      --l;
-    }
-    return l;
+    size_t translated = FindPrev(l, true);
+    return translated == NOT_FOUND ? 0 : translated + 1;
   }
 
   inline size_t GetEdgeToTheRightOf(size_t r) const {
-    if (r+1 == m_bitmap.size()) return r;
-    return (
-             std::find(m_bitmap.begin() + r + 1, m_bitmap.end(), true) -
-             m_bitmap.begin()
-           ) - 1;
+    if (r+1 == m_size) return r;
+    size_t translated = FindNext(r + 1, true);
+    return (translated == NOT_FOUND ? m_size : translated) - 1;
   }
 
 
   //! converts bitmap into an integer ID: it consists of two parts: the first 16 bit are the pattern between the first gap and the last word-1, the second 16 bit are the number of filled positions. enforces a sentence length limit of 65535 and a max distortion of 16
   WordsBitmapID GetID() const {
-    assert(m_bitmap.size() < (1<<16));
+    assert(m_size < (1<<16));
 
     size_t start = GetFirstGapPos();
-    if (start == NOT_FOUND) start = m_bitmap.size(); // nothing left
+    if (start == NOT_FOUND) start = m_size; // nothing left
 
     size_t end = GetLastPos();
     if (end == NOT_FOUND) end = 0; // nothing translated yet
@@ -214,10 +277,10 @@ public:
 
   //! converts bitmap into an integer ID, with an additional span covered
   WordsBitmapID GetIDPlus( size_t startPos, size_t endPos ) const {
-    assert(m_bitmap.size() < (1<<16));
+    assert(m_size < (1<<16));
 
     size_t start = GetFirstGapPos();
-    if (start == NOT_FOUND) start = m_bitmap.size(); // nothing left
+    if (start == NOT_FOUND) start = m_size; // nothing left
 
     size_t end = GetLastPos();
     if (end == NOT_FOUND) end = 0; // nothing translated yet
@@ -236,8 +299,12 @@ public:
   }
 
   // for unordered_set in stack
-  size_t hash() const;
-  bool operator==(const Bitmap& other) const;
+  size_t hash() const {
+    return m_hash;
+  }
+  bool operator==(const Bitmap& other) const {
+    return m_hash == other.m_hash && m_size == other.m_size && m_bits == other.m_bits;
+  }
   bool operator!=(const Bitmap& other) const {
     return !(*this == other);
   }
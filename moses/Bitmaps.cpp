@@ -7,52 +7,75 @@ using namespace std;
 namespace Moses
 {
 Bitmaps::Bitmaps(size_t inputSize, const std::vector<bool> &initSourceCompleted)
+  : m_numTransitions(0)
 {
   m_initBitmap = new Bitmap(inputSize, initSourceCompleted);
-  m_coll[m_initBitmap];
+  m_coll.insert(m_initBitmap);
+
+  Transition empty = {NULL, 0, 0, NULL};
+  m_transitions.resize(256, empty);
 }
 
 Bitmaps::~Bitmaps()
 {
-  BOOST_FOREACH (const Coll::value_type& myPair, m_coll) {
-    const Bitmap *bm = myPair.first;
+  BOOST_FOREACH (const Bitmap *bm, m_coll) {
     delete bm;
   }
 }
 
+size_t Bitmaps::HashTransition(const Bitmap *bm, size_t startPos, size_t endPos)
+{
+  uint64_t key = reinterpret_cast<uintptr_t>(bm) ^ (uint64_t(startPos) << 32) ^ (uint64_t(endPos) << 48);
+  // finalizer of MurmurHash3, the low bits pick the slot
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return key;
+}
+
+void Bitmaps::AddTransition(const Bitmap &bm, const Range &range, const Bitmap *newBM)
+{
+  // keep the table at most half full
+  if (2 * (m_numTransitions + 1) > m_transitions.size()) {
+    std::vector<Transition> old;
+    old.swap(m_transitions);
+    Transition empty = {NULL, 0, 0, NULL};
+    m_transitions.resize(2 * old.size(), empty);
+    m_numTransitions = 0;
+    BOOST_FOREACH (const Transition &transition, old) {
+      if (transition.from) {
+        AddTransition(*transition.from, Range(transition.startPos, transition.endPos), transition.to);
+      }
+    }
+  }
+
+  size_t mask = m_transitions.size() - 1;
+  size_t slot = HashTransition(&bm, range.GetStartPos(), range.GetEndPos()) & mask;
+  while (m_transitions[slot].from != NULL) {
+    slot = (slot + 1) & mask;
+  }
+  Transition &transition = m_transitions[slot];
+  transition.from = &bm;
+  transition.startPos = range.GetStartPos();
+  transition.endPos = range.GetEndPos();
+  transition.to = newBM;
+  ++m_numTransitions;
+}
+
 const Bitmap &Bitmaps::GetNextBitmap(const Bitmap &bm, const Range &range)
 {
   Bitmap *newBM = new Bitmap(bm, range);
 
   Coll::const_iterator iter = m_coll.find(newBM);
   if (iter == m_coll.end()) {
-    m_coll[newBM] = NextBitmaps();
+    m_coll.insert(newBM);
     return *newBM;
   } else {
     delete newBM;
-    return *iter->first;
-  }
-}
-
-const Bitmap &Bitmaps::GetBitmap(const Bitmap &bm, const Range &range)
-{
-  Coll::iterator iter = m_coll.find(&bm);
-  assert(iter != m_coll.end());
-
-  const Bitmap *newBM;
-  NextBitmaps &next = iter->second;
-  NextBitmaps::const_iterator iterNext = next.find(range);
-  if (iterNext == next.end()) {
-    // not seen the link yet.
-    newBM = &GetNextBitmap(bm, range);
-    next[range] = newBM;
-  } else {
-    // link exist
-    //std::cerr << "link exists" << endl;
-    newBM = iterNext->second;
+    return **iter;
   }
-  return *newBM;
 }
 
 }
-
@@ -1,8 +1,8 @@
 #pragma once
 
 #include <boost/unordered_set.hpp>
-#include <boost/unordered_map.hpp>
 #include <set>
+#include <vector>
 #include "Bitmap.h"
 #include "Util.h"
 
@@ -11,12 +11,27 @@ namespace Moses
 
 class Bitmaps
 {
-  typedef boost::unordered_map<Range, const Bitmap*> NextBitmaps;
-  typedef boost::unordered_map<const Bitmap*, NextBitmaps, UnorderedComparer<Bitmap>, UnorderedComparer<Bitmap> > Coll;
+  typedef boost::unordered_set<const Bitmap*, UnorderedComparer<Bitmap>, UnorderedComparer<Bitmap> > Coll;
   //typedef std::set<const Bitmap*, OrderedComparer<Bitmap> > Coll;
   Coll m_coll;
   const Bitmap *m_initBitmap;
 
+  /** the bitmap made by covering a range of a bitmap, in an open-addressed
+   *  table with linear probing.  The bitmaps all come from m_coll, so they
+   *  are compared by address.
+   */
+  struct Transition {
+    const Bitmap *from; //< NULL if the slot is empty
+    size_t startPos;
+    size_t endPos;
+    const Bitmap *to;
+  };
+  std::vector<Transition> m_transitions; //< size is a power of 2
+  size_t m_numTransitions;
+
+  static size_t HashTransition(const Bitmap *bm, size_t startPos, size_t endPos);
+  void AddTransition(const Bitmap &bm, const Range &range, const Bitmap *newBM);
+
   const Bitmap &GetNextBitmap(const Bitmap &bm, const Range &range);
 public:
   Bitmaps(size_t inputSize, const std::vector<bool> &initSourceCompleted);
@@ -25,7 +40,25 @@ public:
   const Bitmap &GetInitialBitmap() const {
     return *m_initBitmap;
   }
-  const Bitmap &GetBitmap(const Bitmap &bm, const Range &range);
+  const Bitmap &GetBitmap(const Bitmap &bm, const Range &range) {
+    size_t mask = m_transitions.size() - 1;
+    for (size_t slot = HashTransition(&bm, range.GetStartPos(), range.GetEndPos()) & mask; ; slot = (slot + 1) & mask) {
+      const Transition &transition = m_transitions[slot];
+      if (transition.from == &bm && transition.startPos == range.GetStartPos()
+          && transition.endPos == range.GetEndPos()) {
+        // link exist
+        return *transition.to;
+      }
+      if (transition.from == NULL) {
+        break;
+      }
+    }
+
+    // not seen the link yet.
+    const Bitmap *newBM = &GetNextBitmap(bm, range);
+    AddTransition(bm, range, newBM);
+    return *newBM;
+  }
 
 };
 
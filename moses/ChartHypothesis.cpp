@@ -28,6 +28,7 @@
 #include "Phrase.h"
 #include "StaticData.h"
 #include "ChartTranslationOptions.h"
+#include "Profiler.h"
 #include "moses/FF/FFState.h"
 #include "moses/FF/StatefulFeatureFunction.h"
 #include "moses/FF/StatelessFeatureFunction.h"
@@ -48,6 +49,7 @@ ChartHypothesis::ChartHypothesis(const ChartTranslationOptions &transOpt,
   :m_transOpt(item.GetTranslationDimension().GetTranslationOption())
   ,m_currSourceWordsRange(transOpt.GetSourceWordsRange())
   ,m_ffStates(StatefulFeatureFunction::GetStatefulFeatureFunctions().size())
+  ,m_hash(0)
   ,m_arcList(NULL)
   ,m_winningHypo(NULL)
   ,m_manager(manager)
@@ -67,6 +69,7 @@ ChartHypothesis::ChartHypothesis(const ChartTranslationOptions &transOpt,
 ChartHypothesis::ChartHypothesis(const ChartHypothesis &pred,
                                  const ChartKBestExtractor & /*unused*/)
   :m_currSourceWordsRange(pred.m_currSourceWordsRange)
+  ,m_hash(0)
   ,m_totalScore(pred.m_totalScore)
   ,m_arcList(NULL)
   ,m_winningHypo(NULL)
@@ -184,10 +187,12 @@ void ChartHypothesis::EvaluateWhenApplied()
 
   // compute values of stateless feature functions that were not
   // cached in the translation option-- there is no principled distinction
+  Profiler::Data *profile = Profiler::GetData();
   const std::vector<const StatelessFeatureFunction*>& sfs =
     StatelessFeatureFunction::GetStatelessFeatureFunctions();
   for (unsigned i = 0; i < sfs.size(); ++i) {
     if (! staticData.IsFeatureFunctionIgnored( *sfs[i] )) {
+      ProfileTimer timer(profile, *sfs[i], Profiler::WhenApplied);
       sfs[i]->EvaluateWhenApplied(*this,&m_currScoreBreakdown);
     }
   }
@@ -196,12 +201,14 @@ void ChartHypothesis::EvaluateWhenApplied()
     StatefulFeatureFunction::GetStatefulFeatureFunctions();
   for (unsigned i = 0; i < ffs.size(); ++i) {
     if (! staticData.IsFeatureFunctionIgnored( *ffs[i] )) {
+      ProfileTimer timer(profile, *ffs[i], Profiler::WhenApplied);
       m_ffStates[i] = ffs[i]->EvaluateWhenApplied(*this,i,&m_currScoreBreakdown);
     }
   }
+  ComputeHash();
 
   // total score from current translation rule
-  m_totalScore = GetTranslationOption().GetScores().GetWeightedScore();
+  m_totalScore = GetTranslationOption().GetWeightedScore();
   m_totalScore += m_currScoreBreakdown.GetWeightedScore();
 
   // total scores from prev hypos
@@ -295,7 +302,7 @@ void ChartHypothesis::SetWinningHypo(const ChartHypothesis *hypo)
   m_winningHypo = hypo;
 }
 
-size_t ChartHypothesis::hash() const
+void ChartHypothesis::ComputeHash()
 {
   size_t seed = 0;
 
@@ -305,12 +312,17 @@ size_t ChartHypothesis::hash() const
     size_t hash = state->hash();
     boost::hash_combine(seed, hash);
   }
-  return seed;
-
+  m_hash = seed;
 }
 
 bool ChartHypothesis::operator==(const ChartHypothesis& other) const
 {
+  // equal states have equal hashes, so most hypotheses that can't be
+  // recombined are told apart without comparing their states
+  if (m_hash != other.m_hash) {
+    return false;
+  }
+
   // states
   for (size_t i = 0; i < m_ffStates.size(); ++i) {
     const FFState &thisState = *m_ffStates[i];
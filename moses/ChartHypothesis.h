@@ -54,6 +54,7 @@ protected:
 
   Range m_currSourceWordsRange;
   std::vector<const FFState*> m_ffStates; /*! stateful feature function states */
+  size_t m_hash; /*! recombination key of the states, computed once they are set */
   /*! sum of scores of this hypothesis, and previous hypotheses. Lazily initialised.  */
   mutable boost::scoped_ptr<ScoreComponentCollection> m_scoreBreakdown;
   mutable boost::scoped_ptr<ScoreComponentCollection> m_deltaScoreBreakdown;
@@ -71,6 +72,8 @@ protected:
 
   unsigned m_id; /* pkoehn wants to log the order in which hypotheses were generated */
 
+  void ComputeHash();
+
   //! not implemented
   ChartHypothesis();
 
@@ -193,7 +196,9 @@ public:
   }
 
   // for unordered_set in stack
-  size_t hash() const;
+  size_t hash() const {
+    return m_hash;
+  }
   bool operator==(const ChartHypothesis& other) const;
 
   TO_STRING();
@@ -25,6 +25,7 @@
 #include "ChartHypothesis.h"
 #include "ChartManager.h"
 #include "HypergraphOutput.h"
+#include "Profiler.h"
 #include "util/exception.hh"
 #include "parameters/AllOptions.h"
 
@@ -63,8 +64,12 @@ ChartHypothesisCollection::~ChartHypothesisCollection()
  */
 bool ChartHypothesisCollection::AddHypothesis(ChartHypothesis *hypo, ChartManager &manager)
 {
+  size_t stack = hypo->GetCurrSourceRange().GetNumWordsCovered();
+  Profiler::AddCreated(stack);
+
   if (hypo->GetFutureScore() == - std::numeric_limits<float>::infinity()) {
-    manager.GetSentenceStats().AddDiscarded();
+    manager.AddDiscarded();
+    Profiler::AddPruned(stack);
     VERBOSE(3,"discarded, -inf score" << std::endl);
     delete hypo;
     return false;
@@ -72,7 +77,8 @@ bool ChartHypothesisCollection::AddHypothesis(ChartHypothesis *hypo, ChartManage
 
   if (hypo->GetFutureScore() < m_bestScore + m_beamWidth) {
     // really bad score. don't bother adding hypo into collection
-    manager.GetSentenceStats().AddDiscarded();
+    manager.AddDiscarded();
+    Profiler::AddPruned(stack);
     VERBOSE(3,"discarded, too bad for stack" << std::endl);
     delete hypo;
     return false;
@@ -94,6 +100,7 @@ bool ChartHypothesisCollection::AddHypothesis(ChartHypothesis *hypo, ChartManage
                  "Adding a hypothesis should have returned a valid iterator");
 
   //StaticData::Instance().GetSentenceStats().AddRecombination(*hypo, **iterExisting);
+  Profiler::AddRecombined(stack);
 
   // found existing hypo with same target ending.
   // keep the best 1
@@ -212,8 +219,9 @@ void ChartHypothesisCollection::PruneToSize(ChartManager &manager)
       float score = hypo->GetFutureScore();
       if (score < scoreThreshold) {
         HCType::iterator iterRemove = iter++;
+        Profiler::AddPruned(hypo->GetCurrSourceRange().GetNumWordsCovered());
         Remove(iterRemove);
-        manager.GetSentenceStats().AddPruning();
+        manager.AddPruning();
       } else {
         ++iter;
       }
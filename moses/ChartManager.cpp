@@ -19,16 +19,22 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  ***********************************************************************/
 
+#include <algorithm>
 #include <cstdio>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 #include "ChartManager.h"
 #include "ChartCell.h"
 #include "ChartHypothesis.h"
 #include "ChartKBestExtractor.h"
 #include "ChartTranslationOptions.h"
 #include "HypergraphOutput.h"
+#include "ParallelSpans.h"
+#include "Profiler.h"
 #include "StaticData.h"
 #include "DecodeStep.h"
 #include "TreeInput.h"
+#include "moses/FF/FeatureFunction.h"
 #include "moses/FF/StatefulFeatureFunction.h"
 #include "moses/FF/WordPenaltyProducer.h"
 #include "moses/OutputCollector.h"
@@ -41,6 +47,33 @@ using namespace std;
 namespace Moses
 {
 
+namespace
+{
+
+// Whether every feature function can be evaluated by the workers of
+// chart-cell-threads.  Reports the ones that can't.
+bool CheckCellThreadFeatures()
+{
+  bool allowed = true;
+  BOOST_FOREACH(const FeatureFunction *ff, FeatureFunction::GetFeatureFunctions()) {
+    if (!ff->CanEvaluateInWorkerThreads()) {
+      TRACE_ERR("WARNING: chart-cell-threads: " << ff->GetScoreProducerDescription()
+                << " keeps per-thread state, decoding one cell at a time" << endl);
+      allowed = false;
+    }
+  }
+  return allowed;
+}
+
+// checked once, for the first sentence decoded with chart-cell-threads
+bool CellThreadsAllowed()
+{
+  static const bool allowed = CheckCellThreadFeatures();
+  return allowed;
+}
+
+}
+
 /* constructor. Initialize everything prior to decoding a particular sentence.
  * \param source the sentence to be decoded
  * \param system which particular set of models to use.
@@ -77,28 +110,41 @@ void ChartManager::Decode()
   AddXmlChartOptions();
 
   // MAIN LOOP
+  Profiler::Data *profile = Profiler::GetData();
   size_t size = m_source.GetSize();
-  for (int startPos = size-1; startPos >= 0; --startPos) {
-    for (size_t width = 1; width <= size-startPos; ++width) {
-      size_t endPos = startPos + width - 1;
-      Range range(startPos, endPos);
-
-      // create trans opt
-      m_translationOptionList.Clear();
-      m_parser.Create(range, m_translationOptionList);
-      m_translationOptionList.ApplyThreshold(options()->search.trans_opt_threshold);
-
-      const InputPath &inputPath = m_parser.GetInputPath(range);
-      m_translationOptionList.EvaluateWithSourceContext(m_source, inputPath);
+  const size_t numThreads = options()->syntax.chart_cell_threads;
+  if (numThreads > 1 && m_parser.UseWidthOrder() && CellThreadsAllowed()) {
+    // The rules of each width are looked up one span at a time, then the
+    // cells are decoded in parallel.
+    std::vector<boost::shared_ptr<ChartTranslationOptionList> > transOptLists;
+    for (size_t i = 0; i < size; ++i) {
+      transOptLists.push_back(boost::shared_ptr<ChartTranslationOptionList>(
+                                new ChartTranslationOptionList(options()->syntax.rule_limit, m_source)));
+    }
+    for (size_t width = 1; width <= size; ++width) {
+      const size_t numSpans = size-width+1;
+      for (size_t startPos = 0; startPos < numSpans; ++startPos) {
+        Range range(startPos, startPos + width - 1);
+        CreateTranslationOptions(range, *transOptLists[startPos]);
+      }
+      ParallelSpans::ForEachSpan(size, width, numThreads,
+                                 boost::bind(&ChartManager::DecodeSpan, this,
+                                             width, boost::ref(transOptLists), _1));
+    }
+  } else {
+    if (numThreads > 1 && !m_parser.UseWidthOrder()) {
+      VERBOSE(1, "chart-cell-threads: not supported by all rule tables, decoding one cell at a time" << endl);
+    }
+    for (int startPos = size-1; startPos >= 0; --startPos) {
+      for (size_t width = 1; width <= size-startPos; ++width) {
+        size_t endPos = startPos + width - 1;
+        Range range(startPos, endPos);
 
-      // decode
-      ChartCell &cell = m_hypoStackColl.Get(range);
-      cell.Decode(m_translationOptionList, m_hypoStackColl);
+        CreateTranslationOptions(range, m_translationOptionList);
 
-      m_translationOptionList.Clear();
-      cell.PruneToSize();
-      cell.CleanupArcList();
-      cell.SortHypotheses();
+        ProfileTimer timer(profile, Profiler::Search);
+        DecodeCell(range, m_translationOptionList);
+      }
     }
   }
 
@@ -123,6 +169,43 @@ void ChartManager::Decode()
   }
 }
 
+// create the translation options of a span
+void ChartManager::CreateTranslationOptions(const Range &range,
+    ChartTranslationOptionList &transOptList)
+{
+  ProfileTimer timer(Profiler::GetData(), Profiler::CollectOptions);
+  transOptList.Clear();
+  m_parser.Create(range, transOptList);
+  transOptList.ApplyThreshold(options()->search.trans_opt_threshold);
+
+  const InputPath &inputPath = m_parser.GetInputPath(range);
+  transOptList.EvaluateWithSourceContext(m_source, inputPath);
+}
+
+// fill the cell of a span from its translation options
+void ChartManager::DecodeCell(const Range &range,
+                              ChartTranslationOptionList &transOptList)
+{
+  ChartCell &cell = m_hypoStackColl.Get(range);
+  cell.Decode(transOptList, m_hypoStackColl);
+
+  transOptList.Clear();
+  cell.PruneToSize();
+  cell.CleanupArcList();
+  cell.SortHypotheses();
+}
+
+// fill the cell of the span of the given width starting at startPos, whose
+// translation options are in transOptLists[startPos]
+void ChartManager::DecodeSpan(size_t width,
+                              std::vector<boost::shared_ptr<ChartTranslationOptionList> > &transOptLists,
+                              size_t startPos)
+{
+  ProfileTimer timer(Profiler::GetData(), Profiler::Search);
+  Range range(startPos, startPos + width - 1);
+  DecodeCell(range, *transOptLists[startPos]);
+}
+
 /** add specific translation options and hypotheses according to the XML override translation scheme.
  *  Doesn't seem to do anything about walls and zones.
  *  @todo check walls & zones. Check that the implementation doesn't leak, xml options sometimes does if you're not careful
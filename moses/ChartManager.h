@@ -23,6 +23,10 @@
 
 #include <vector>
 #include <boost/unordered_map.hpp>
+#include <boost/shared_ptr.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
 #include "ChartCell.h"
 #include "ChartCellCollection.h"
 #include "Range.h"
@@ -48,11 +52,22 @@ private:
   std::auto_ptr<SentenceStats> m_sentenceStats;
   clock_t m_start; /**< starting time, used for logging */
   unsigned m_hypothesisId; /* For handing out hypothesis ids to ChartHypothesis */
+#ifdef WITH_THREADS
+  // held for the hypothesis ids and sentence stats, when the cells of a
+  // width are decoded in parallel
+  boost::mutex m_mutex;
+#endif
 
   ChartParser m_parser;
 
   ChartTranslationOptionList m_translationOptionList; /**< pre-computed list of translation options for the phrases in this sentence */
 
+  void CreateTranslationOptions(const Range &range, ChartTranslationOptionList &transOptList);
+  void DecodeCell(const Range &range, ChartTranslationOptionList &transOptList);
+  void DecodeSpan(size_t width,
+                  std::vector<boost::shared_ptr<ChartTranslationOptionList> > &transOptLists,
+                  size_t startPos);
+
   /* auxilliary functions for SearchGraphs */
   void FindReachableHypotheses(
     const ChartHypothesis *hypo, std::map<unsigned,bool> &reachable , size_t* winners, size_t* losers) const;
@@ -133,9 +148,28 @@ public:
 
   //! contigious hypo id for each input sentence. For debugging purposes
   unsigned GetNextHypoId() {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
     return m_hypothesisId++;
   }
 
+  //! count a hypothesis discarded before it was added to its cell
+  void AddDiscarded() {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    m_sentenceStats->AddDiscarded();
+  }
+
+  //! count a hypothesis pruned from its cell
+  void AddPruning() {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    m_sentenceStats->AddPruning();
+  }
+
   const ChartParser &GetParser() const {
     return m_parser;
   }
@@ -69,6 +69,13 @@ public:
 
   void Create(const Range &range, ChartParserCallback &to);
 
+  /** Switches the rule lookup to spans in order of increasing width, each
+   *  looked up once the cells of all narrower spans are complete, if every
+   *  rule lookup manager supports it.  Returns false otherwise, and spans
+   *  must then be looked up right to left, as in ChartManager::Decode().
+   */
+  bool UseWidthOrder();
+
   //! the sentence being decoded
   //const Sentence &GetSentence() const;
   long GetTranslationId() const;
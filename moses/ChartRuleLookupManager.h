@@ -69,6 +69,18 @@ public:
     size_t lastPos,  // last position to consider if using lookahead
     ChartParserCallback &outColl) = 0;
 
+  /** Spans are normally looked up right to left, each start position in
+   *  order of increasing width.  Returns true if they can instead be looked
+   *  up in order of increasing width, once the cells of all narrower spans
+   *  are complete.
+   */
+  virtual bool SupportsWidthOrder() const {
+    return false;
+  }
+
+  //! Called before the first lookup if spans will be looked up by width
+  virtual void UseWidthOrder() {}
+
 private:
   //! Non-copyable: copy constructor and assignment operator not implemented.
   ChartRuleLookupManager(const ChartRuleLookupManager &);
@@ -8,6 +8,7 @@ ChartTranslationOption::ChartTranslationOption(const TargetPhrase &targetPhrase)
   :m_targetPhrase(targetPhrase)
   ,m_scoreBreakdown(targetPhrase.GetScoreBreakdown())
 {
+  m_weightedScore = m_scoreBreakdown.GetWeightedScore();
 }
 
 void ChartTranslationOption::EvaluateWithSourceContext(const InputType &input,
@@ -20,6 +21,7 @@ void ChartTranslationOption::EvaluateWithSourceContext(const InputType &input,
     const FeatureFunction &ff = *ffs[i];
     ff.EvaluateWithSourceContext(input, inputPath, m_targetPhrase, &stackVec, m_scoreBreakdown);
   }
+  m_weightedScore = m_scoreBreakdown.GetWeightedScore();
 }
 
 
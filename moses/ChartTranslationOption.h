@@ -16,6 +16,7 @@ class ChartTranslationOption
 protected:
   const TargetPhrase &m_targetPhrase;
   ScoreComponentCollection m_scoreBreakdown;
+  float m_weightedScore; // of m_scoreBreakdown
   const InputPath *m_inputPath;
   const std::vector<const Word*> *m_ruleSourceFromInputPath; // used by placeholders
 
@@ -45,6 +46,11 @@ public:
     return m_scoreBreakdown;
   }
 
+  //! the weighted sum of GetScores()
+  float GetWeightedScore() const {
+    return m_weightedScore;
+  }
+
   void EvaluateWithSourceContext(const InputType &input,
                                  const InputPath &inputPath,
                                  const StackVec &stackVec);
@@ -58,9 +58,7 @@ class ChartTranslationOptionScoreOrderer
 public:
   bool operator()(const boost::shared_ptr<ChartTranslationOption> &transOptA
                   , const boost::shared_ptr<ChartTranslationOption> &transOptB) const {
-    const ScoreComponentCollection &scoresA = transOptA->GetScores();
-    const ScoreComponentCollection &scoresB = transOptB->GetScores();
-    return scoresA.GetWeightedScore() > scoresB.GetWeightedScore();
+    return transOptA->GetWeightedScore() > transOptB->GetWeightedScore();
   }
 };
 
@@ -84,7 +82,7 @@ void ChartTranslationOptions::EvaluateWithSourceContext(const InputType &input,
   for (size_t i = 0; i < m_collection.size(); ++i) {
     ChartTranslationOption *transOpt = m_collection[i].get();
 
-    if (transOpt->GetScores().GetWeightedScore() == - std::numeric_limits<float>::infinity()) {
+    if (transOpt->GetWeightedScore() == - std::numeric_limits<float>::infinity()) {
       ++numDiscard;
     } else if (numDiscard) {
       m_collection[i - numDiscard] = m_collection[i];
@@ -37,26 +37,19 @@ DecodeStepGeneration::DecodeStepGeneration(GenerationDictionary* dict,
 {
 }
 
-// helpers
-typedef pair<Word, ScoreComponentCollection> WordPair;
-typedef list< WordPair > WordList;
-// 1st = word
-// 2nd = score
-typedef list< WordPair >::const_iterator WordListIterator;
-
-/** used in generation: increases iterators when looping through the exponential number of generation expansions */
-inline void IncrementIterators(vector< WordListIterator > &wordListIterVector
-                               , const vector< WordList > &wordListVector)
+/** used in generation: increases the counters when looping through the exponential number of generation expansions */
+inline void IncrementCounters(vector< size_t > &counters
+                              , const vector< pair<size_t, size_t> > &ranges)
 {
-  for (size_t currPos = 0 ; currPos < wordListVector.size() ; currPos++) {
-    WordListIterator &iter = wordListIterVector[currPos];
-    iter++;
-    if (iter != wordListVector[currPos].end()) {
+  for (size_t currPos = 0 ; currPos < ranges.size() ; currPos++) {
+    size_t &counter = counters[currPos];
+    counter++;
+    if (counter != ranges[currPos].second) {
       // eg. 4 -> 5
       return;
     } else {
       //  eg 9 -> 10
-      iter = wordListVector[currPos].begin();
+      counter = ranges[currPos].first;
     }
   }
 }
@@ -83,56 +76,39 @@ void DecodeStepGeneration::Process(const TranslationOption &inputPartialTranslOp
   const InputPath &inputPath = inputPartialTranslOpt.GetInputPath();
   size_t targetLength         = targetPhrase.GetSize();
 
-  // generation list for each word in phrase
-  vector< WordList > wordListVector(targetLength);
+  // range of output words in the generation table for each word in phrase
+  vector< pair<size_t, size_t> > ranges(targetLength);
 
-  // create generation list
-  int wordListVectorPos = 0;
   for (size_t currPos = 0 ; currPos < targetLength ; currPos++) { // going thorugh all words
-    // generatable factors for this word to be put in wordList
-    WordList &wordList = wordListVector[wordListVectorPos];
     const Word &word = targetPhrase.GetWord(currPos);
 
     // consult dictionary for possible generations for this word
-    const OutputWordCollection *wordColl = generationDictionary->FindWord(word);
-
-    if (wordColl == NULL) {
+    if (!generationDictionary->FindWord(word, ranges[currPos].first, ranges[currPos].second)) {
       // word not found in generation dictionary
       //toc->ProcessUnknownWord(sourceWordsRange.GetStartPos(), factorCollection);
       return; // can't be part of a phrase, special handling
-    } else {
-      // sort(*wordColl, CompareWordCollScore);
-      OutputWordCollection::const_iterator iterWordColl;
-      for (iterWordColl = wordColl->begin() ; iterWordColl != wordColl->end(); ++iterWordColl) {
-        const Word &outputWord = (*iterWordColl).first;
-        const ScoreComponentCollection& score = (*iterWordColl).second;
-        // enter into word list generated factor(s) and its(their) score(s)
-        wordList.push_back(WordPair(outputWord, score));
-      }
-
-      wordListVectorPos++; // done, next word
     }
   }
 
-  // use generation list (wordList)
-  // set up iterators (total number of expansions)
+  // set up counters (total number of expansions)
   size_t numIteration = 1;
-  vector< WordListIterator >  wordListIterVector(targetLength);
+  vector< size_t >            counters(targetLength);
+  vector< Word >              outputWords(targetLength);
   vector< const Word* >       mergeWords(targetLength);
   for (size_t currPos = 0 ; currPos < targetLength ; currPos++) {
-    wordListIterVector[currPos] = wordListVector[currPos].begin();
-    numIteration *= wordListVector[currPos].size();
+    counters[currPos] = ranges[currPos].first;
+    numIteration *= ranges[currPos].second - ranges[currPos].first;
+    mergeWords[currPos] = &outputWords[currPos];
   }
 
   // go thru each possible factor for each word & create hypothesis
-  for (size_t currIter = 0 ; currIter < numIteration ; currIter++) {
+  for (size_t currIter = 0 ; currIter < numIteration ; currIter++, IncrementCounters(counters, ranges)) {
     ScoreComponentCollection generationScore; // total score for this string of words
 
     // create vector of words with new factors for last phrase
     for (size_t currPos = 0 ; currPos < targetLength ; currPos++) {
-      const WordPair &wordPair = *wordListIterVector[currPos];
-      mergeWords[currPos] = &(wordPair.first);
-      generationScore.PlusEquals(wordPair.second);
+      generationDictionary->GetOutputWord(counters[currPos], outputWords[currPos]);
+      generationScore.PlusEquals(generationDictionary, generationDictionary->GetScores(counters[currPos]));
     }
 
     // merge with existing trans opt
@@ -158,9 +134,6 @@ void DecodeStepGeneration::Process(const TranslationOption &inputPartialTranslOp
     newTransOpt->SetInputPath(inputPath);
 
     outputPartialTranslOptColl.Add(newTransOpt);
-
-    // increment iterators
-    IncrementIterators(wordListIterVector, wordListVector);
   }
 }
 
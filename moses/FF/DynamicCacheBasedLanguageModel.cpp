@@ -11,6 +11,7 @@ DynamicCacheBasedLanguageModel *DynamicCacheBasedLanguageModel::s_instance = NUL
 
 DynamicCacheBasedLanguageModel::DynamicCacheBasedLanguageModel(const std::string &line)
   : StatelessFeatureFunction(1, line)
+  , m_cache(new Cache())
 {
   VERBOSE(2,"Initializing DynamicCacheBasedLanguageModel feature..." << std::endl);
 
@@ -30,11 +31,53 @@ DynamicCacheBasedLanguageModel::DynamicCacheBasedLanguageModel(const std::string
 
 DynamicCacheBasedLanguageModel::~DynamicCacheBasedLanguageModel() {};
 
-void DynamicCacheBasedLanguageModel::SetPreComputedScores()
+boost::shared_ptr<const DynamicCacheBasedLanguageModel::Cache> DynamicCacheBasedLanguageModel::GetCache() const
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  return boost::atomic_load(&m_cache);
+#else
+  return m_cache;
 #endif
+}
+
+void DynamicCacheBasedLanguageModel::SetCache(const boost::shared_ptr<const Cache> &cache)
+{
+#ifdef WITH_THREADS
+  boost::atomic_store(&m_cache, cache);
+#else
+  m_cache = cache;
+#endif
+}
+
+boost::shared_ptr<DynamicCacheBasedLanguageModel::Cache> DynamicCacheBasedLanguageModel::CopyCache(bool decay) const
+{
+  boost::shared_ptr<const Cache> cache = GetCache();
+  if (!decay) {
+    return boost::shared_ptr<Cache>(new Cache(*cache));
+  }
+
+  // every entry a step older, leaving out those that have become too old
+  boost::shared_ptr<Cache> ret(new Cache());
+  ret->decays = cache->decays + 1;
+  ret->entries.rehash(cache->entries.size());
+  decaying_cache_t::const_iterator it;
+  for (it = cache->entries.begin(); it != cache->entries.end(); ++it) {
+    unsigned int age = it->second.age + (ret->decays - it->second.decays);
+    if (age <= m_maxAge) {
+      ret->entries.insert(*it);
+    }
+  }
+  return ret;
+}
+
+float DynamicCacheBasedLanguageModel::GetScore(const Cache &cache, const decaying_cache_value_t &entry) const
+{
+  unsigned int age = entry.age + (cache.decays - entry.decays);
+  return precomputedScores[std::min(age, m_maxAge)];
+}
+
+void DynamicCacheBasedLanguageModel::SetPreComputedScores()
+{
   precomputedScores.clear();
   for (unsigned int i=0; i<m_maxAge; i++) {
     precomputedScores.push_back(decaying_score(i));
@@ -52,19 +95,6 @@ void DynamicCacheBasedLanguageModel::SetPreComputedScores()
   VERBOSE(3, "SetPreComputedScores(): lower_age:|" << m_maxAge << "| lower_score:|" << m_lower_score << "|" << std::endl);
 }
 
-float DynamicCacheBasedLanguageModel::GetPreComputedScores(const unsigned int age)
-{
-  VERBOSE(2, "float DynamicCacheBasedLanguageModel::GetPreComputedScores" << std::endl);
-  VERBOSE(2, "age:|"<< age << "|" << std::endl);
-
-  if (age < m_maxAge) {
-    return precomputedScores.at(age);
-  } else {
-    VERBOSE(2, "is to big reduced to m)_maxAge:|"<< m_maxAge << "|" << std::endl);
-    return precomputedScores.at(m_maxAge);
-  }
-}
-
 void DynamicCacheBasedLanguageModel::SetParameter(const std::string& key, const std::string& value)
 {
   VERBOSE(2, "DynamicCacheBasedLanguageModel::SetParameter key:|" << key << "| value:|" << value << "|" << std::endl);
@@ -90,13 +120,14 @@ void DynamicCacheBasedLanguageModel::EvaluateInIsolation(const Phrase &sp
     , ScoreComponentCollection &scoreBreakdown
     , ScoreComponentCollection &estimatedScores) const
 {
+  boost::shared_ptr<const Cache> cache = GetCache();
   float score = m_lower_score;
   switch(m_query_type) {
   case CBLM_QUERY_TYPE_WHOLESTRING:
-    score = Evaluate_Whole_String(tp);
+    score = Evaluate_Whole_String(*cache, tp);
     break;
   case CBLM_QUERY_TYPE_ALLSUBSTRINGS:
-    score = Evaluate_All_Substrings(tp);
+    score = Evaluate_All_Substrings(*cache, tp);
     break;
   default:
     UTIL_THROW_IF2(false, "This score type (" << m_query_type << ") is unknown.");
@@ -105,7 +136,7 @@ void DynamicCacheBasedLanguageModel::EvaluateInIsolation(const Phrase &sp
   scoreBreakdown.Assign(this, score);
 }
 
-float DynamicCacheBasedLanguageModel::Evaluate_Whole_String(const TargetPhrase& tp) const
+float DynamicCacheBasedLanguageModel::Evaluate_Whole_String(const Cache &cache, const TargetPhrase& tp) const
 {
   //consider all words in the TargetPhrase as one n-gram
   // and compute the decaying_score for the whole n-gram
@@ -122,11 +153,11 @@ float DynamicCacheBasedLanguageModel::Evaluate_Whole_String(const TargetPhrase&
       w += " ";
     }
   }
-  it = m_cache.find(w);
+  it = cache.entries.find(w);
 
   VERBOSE(4,"cblm::Evaluate_Whole_String: searching w:|" << w << "|" << std::endl);
-  if (it != m_cache.end()) { //found!
-    score = ((*it).second).second;
+  if (it != cache.entries.end()) { //found!
+    score = GetScore(cache, it->second);
     VERBOSE(4,"cblm::Evaluate_Whole_String: found w:|" << w << "|" << std::endl);
   }
 
@@ -134,7 +165,7 @@ float DynamicCacheBasedLanguageModel::Evaluate_Whole_String(const TargetPhrase&
   return score;
 }
 
-float DynamicCacheBasedLanguageModel::Evaluate_All_Substrings(const TargetPhrase& tp) const
+float DynamicCacheBasedLanguageModel::Evaluate_All_Substrings(const Cache &cache, const TargetPhrase& tp) const
 {
   //loop over all n-grams in the TargetPhrase (no matter of n)
   //and compute the decaying_score for all words
@@ -147,11 +178,12 @@ float DynamicCacheBasedLanguageModel::Evaluate_All_Substrings(const TargetPhrase
     std::string w = "";
     for (size_t endpos = startpos; endpos < tp.GetSize() ; ++endpos) {
       w += tp.GetWord(endpos).GetFactor(0)->GetString().as_string();
-      it = m_cache.find(w);
+      it = cache.entries.find(w);
 
-      if (it != m_cache.end()) { //found!
-        score += ((*it).second).second;
-        VERBOSE(3,"cblm::Evaluate_All_Substrings: found w:|" << w << "| actual score:|" << ((*it).second).second << "| score:|" << score << "|" << std::endl);
+      if (it != cache.entries.end()) { //found!
+        float entryScore = GetScore(cache, it->second);
+        score += entryScore;
+        VERBOSE(3,"cblm::Evaluate_All_Substrings: found w:|" << w << "| actual score:|" << entryScore << "| score:|" << score << "|" << std::endl);
       } else {
         score += m_lower_score;
       }
@@ -168,55 +200,24 @@ float DynamicCacheBasedLanguageModel::Evaluate_All_Substrings(const TargetPhrase
 
 void DynamicCacheBasedLanguageModel::Print() const
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
+  boost::shared_ptr<const Cache> cache = GetCache();
   decaying_cache_t::const_iterator it;
   std::cout << "Content of the cache of Cache-Based Language Model" << std::endl;
-  std::cout << "Size of the cache of Cache-Based Language Model:|" << m_cache.size() << "|" << std::endl;
-  for ( it=m_cache.begin() ; it != m_cache.end(); it++ ) {
-    std::cout << "word:|" << (*it).first << "| age:|" << ((*it).second).first << "| score:|" << ((*it).second).second << "|" << std::endl;
+  std::cout << "Size of the cache of Cache-Based Language Model:|" << cache->entries.size() << "|" << std::endl;
+  for ( it=cache->entries.begin() ; it != cache->entries.end(); it++ ) {
+    unsigned int age = it->second.age + (cache->decays - it->second.decays);
+    std::cout << "word:|" << (*it).first << "| age:|" << age << "| score:|" << GetScore(*cache, it->second) << "|" << std::endl;
   }
 }
 
-void DynamicCacheBasedLanguageModel::Decay()
+void DynamicCacheBasedLanguageModel::Update(Cache &cache, std::vector<std::string> words, int age)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
-  decaying_cache_t::iterator it;
-
-  unsigned int age;
-  float score;
-  for ( it=m_cache.begin() ; it != m_cache.end(); it++ ) {
-    age=((*it).second).first + 1;
-    if (age > m_maxAge) {
-      m_cache.erase(it);
-      it--;
-    } else {
-      score = GetPreComputedScores(age);
-//      score = decaying_score(age);
-      decaying_cache_value_t p (age, score);
-      (*it).second = p;
-    }
-  }
-}
-
-void DynamicCacheBasedLanguageModel::Update(std::vector<std::string> words, int age)
-{
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
   VERBOSE(3,"words.size():|" << words.size() << "|" << std::endl);
   for (size_t j=0; j<words.size(); j++) {
     words[j] = Trim(words[j]);
-//    VERBOSE(3,"CacheBasedLanguageModel::Update   word[" << j << "]:"<< words[j] << " age:" << age << " decaying_score(age):" << decaying_score(age) << std::endl);
-//    decaying_cache_value_t p (age,decaying_score(age));
-    VERBOSE(3,"CacheBasedLanguageModel::Update   word[" << j << "]:"<< words[j] << " age:" << age << " GetPreComputedScores(age):" << GetPreComputedScores(age) << std::endl);
-    decaying_cache_value_t p (age,GetPreComputedScores(age));
-    std::pair<std::string, decaying_cache_value_t> e (words[j],p);
-    m_cache.erase(words[j]); //always erase the element (do nothing if the entry does not exist)
-    m_cache.insert(e); //insert the entry
+    VERBOSE(3,"CacheBasedLanguageModel::Update   word[" << j << "]:"<< words[j] << " age:" << age << std::endl);
+    decaying_cache_value_t p = { age, cache.decays };
+    cache.entries[words[j]] = p; //the entry replaces the old one, if any
   }
 }
 
@@ -233,14 +234,16 @@ void DynamicCacheBasedLanguageModel::ClearEntries(std::string &entries)
 void DynamicCacheBasedLanguageModel::ClearEntries(std::vector<std::string> words)
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::mutex::scoped_lock lock(m_updateLock);
 #endif
+  boost::shared_ptr<Cache> cache = CopyCache(false);
   VERBOSE(3,"words.size():|" << words.size() << "|" << std::endl);
   for (size_t j=0; j<words.size(); j++) {
     words[j] = Trim(words[j]);
     VERBOSE(3,"CacheBasedLanguageModel::ClearEntries   word[" << j << "]:"<< words[j] << std::endl);
-    m_cache.erase(words[j]); //always erase the element (do nothing if the entry does not exist)
+    cache->entries.erase(words[j]); //always erase the element (do nothing if the entry does not exist)
   }
+  SetCache(cache);
 }
 
 void DynamicCacheBasedLanguageModel::Insert(std::string &entries)
@@ -256,10 +259,14 @@ void DynamicCacheBasedLanguageModel::Insert(std::string &entries)
 void DynamicCacheBasedLanguageModel::Insert(std::vector<std::string> ngrams)
 {
   VERBOSE(3,"DynamicCacheBasedLanguageModel Insert ngrams.size():|" << ngrams.size() << "|" << std::endl);
-  if (m_constant == false) {
-    Decay();
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_updateLock);
+#endif
+    boost::shared_ptr<Cache> cache = CopyCache(m_constant == false);
+    Update(*cache, ngrams, 1);
+    SetCache(cache);
   }
-  Update(ngrams,1);
   IFVERBOSE(3) Print();
 }
 
@@ -318,9 +325,11 @@ void DynamicCacheBasedLanguageModel::Execute_Single_Command(std::string command)
 void DynamicCacheBasedLanguageModel::Clear()
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::mutex::scoped_lock lock(m_updateLock);
 #endif
-  m_cache.clear();
+  boost::shared_ptr<Cache> cache(new Cache());
+  cache->decays = GetCache()->decays;
+  SetCache(cache);
 }
 
 void DynamicCacheBasedLanguageModel::Load(AllOptions::ptr const& opts)
@@ -343,12 +352,20 @@ void DynamicCacheBasedLanguageModel::Load(const std::string filestr)
 void DynamicCacheBasedLanguageModel::Load_Multiple_Files(std::vector<std::string> files)
 {
   VERBOSE(2,"DynamicCacheBasedLanguageModel::Load_Multiple_Files(std::vector<std::string> files)" << std::endl);
-  for(size_t j = 0; j < files.size(); ++j) {
-    Load_Single_File(files[j]);
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_updateLock);
+#endif
+    boost::shared_ptr<Cache> cache = CopyCache(false);
+    for(size_t j = 0; j < files.size(); ++j) {
+      Load_Single_File(*cache, files[j]);
+    }
+    SetCache(cache);
   }
+  IFVERBOSE(2) Print();
 }
 
-void DynamicCacheBasedLanguageModel::Load_Single_File(const std::string file)
+void DynamicCacheBasedLanguageModel::Load_Single_File(Cache &cache, const std::string file)
 {
   VERBOSE(2,"DynamicCacheBasedLanguageModel::Load_Single_File(const std::string file)" << std::endl);
   //file format
@@ -374,20 +391,15 @@ void DynamicCacheBasedLanguageModel::Load_Single_File(const std::string file)
     if (vecStr.size() >= 2) {
       age = Scan<int>(vecStr[0]);
       vecStr.erase(vecStr.begin());
-      Update(vecStr,age);
+      Update(cache, vecStr, age);
     } else {
       UTIL_THROW_IF2(false, "The format of the loaded file is wrong: " << line);
     }
   }
-  IFVERBOSE(2) Print();
 }
 
 void DynamicCacheBasedLanguageModel::SetQueryType(size_t type)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
-
   m_query_type = type;
   if ( m_query_type != CBLM_QUERY_TYPE_WHOLESTRING
        && m_query_type != CBLM_QUERY_TYPE_ALLSUBSTRINGS ) {
@@ -400,9 +412,6 @@ void DynamicCacheBasedLanguageModel::SetQueryType(size_t type)
 
 void DynamicCacheBasedLanguageModel::SetScoreType(size_t type)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
   m_score_type = type;
   if ( m_score_type != CBLM_SCORE_TYPE_HYPERBOLA
        && m_score_type != CBLM_SCORE_TYPE_POWER
@@ -419,9 +428,6 @@ void DynamicCacheBasedLanguageModel::SetScoreType(size_t type)
 
 void DynamicCacheBasedLanguageModel::SetMaxAge(unsigned int age)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
   m_maxAge = age;
   VERBOSE(2, "CacheBasedLanguageModel MaxAge:  " << m_maxAge << std::endl);
 };
@@ -3,16 +3,25 @@
 #ifndef moses_DynamicCacheBasedLanguageModel_h
 #define moses_DynamicCacheBasedLanguageModel_h
 
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
 #include "moses/Util.h"
 #include "FeatureFunction.h"
 
 #ifdef WITH_THREADS
-#include <boost/thread/shared_mutex.hpp>
-#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
 #endif
 
-typedef std::pair<int, float> decaying_cache_value_t;
-typedef std::map<std::string, decaying_cache_value_t > decaying_cache_t;
+/** an n-gram in the cache: its age when it was set, and how many times the
+ *  cache had decayed by then.  Its age now follows from the decays since,
+ *  so decaying the cache doesn't touch the entries.
+ */
+struct decaying_cache_value_t {
+  int age;
+  unsigned int decays;
+};
+typedef boost::unordered_map<std::string, decaying_cache_value_t> decaying_cache_t;
 
 #define CBLM_QUERY_TYPE_UNDEFINED (-1)
 #define CBLM_QUERY_TYPE_ALLSUBSTRINGS 0
@@ -38,8 +47,18 @@ class Range;
 class DynamicCacheBasedLanguageModel : public StatelessFeatureFunction
 {
   // data structure for the cache;
-  // the key is the word and the value is the decaying score
-  decaying_cache_t m_cache;
+  // the key is the word and the value is its age
+  struct Cache {
+    decaying_cache_t entries;
+    unsigned int decays; //! times the cache has decayed
+
+    Cache() : decays(0) {}
+  };
+
+  // The cache is never changed once it's published: an update copies it,
+  // changes the copy and publishes that, so the decoding threads read it
+  // without locking.
+  boost::shared_ptr<const Cache> m_cache;
   size_t m_query_type; //way of querying the cache
   size_t m_score_type; //way of scoring entries of the cache
   std::string m_initfiles; // vector of files loaded in the initialization phase
@@ -50,19 +69,23 @@ class DynamicCacheBasedLanguageModel : public StatelessFeatureFunction
   unsigned int m_maxAge;
 
 #ifdef WITH_THREADS
-  //multiple readers - single writer lock
-  mutable boost::shared_mutex m_cacheLock;
+  //one update at a time
+  boost::mutex m_updateLock;
 #endif
 
   float decaying_score(unsigned int age);
   void SetPreComputedScores();
-  float GetPreComputedScores(const unsigned int age);
 
-  float Evaluate_Whole_String( const TargetPhrase&) const;
-  float Evaluate_All_Substrings( const TargetPhrase&) const;
+  boost::shared_ptr<const Cache> GetCache() const;
+  void SetCache(const boost::shared_ptr<const Cache> &cache);
+  boost::shared_ptr<Cache> CopyCache(bool decay) const;
+  //! score of an entry at its age now
+  float GetScore(const Cache &cache, const decaying_cache_value_t &entry) const;
+
+  float Evaluate_Whole_String(const Cache &cache, const TargetPhrase&) const;
+  float Evaluate_All_Substrings(const Cache &cache, const TargetPhrase&) const;
 
-  void Decay();
-  void Update(std::vector<std::string> words, int age);
+  void Update(Cache &cache, std::vector<std::string> words, int age);
 
   void ClearEntries(std::vector<std::string> entries);
 
@@ -70,7 +93,7 @@ class DynamicCacheBasedLanguageModel : public StatelessFeatureFunction
   void Execute_Single_Command(std::string command);
 
   void Load_Multiple_Files(std::vector<std::string> files);
-  void Load_Single_File(const std::string file);
+  void Load_Single_File(Cache &cache, const std::string file);
 
   void Insert(std::vector<std::string> ngrams);
 
@@ -12,6 +12,9 @@ class FFState
 {
 public:
   virtual ~FFState();
+  //! Called once for each hypothesis, when its states are set.  The
+  //! hypothesis keeps the hashes of its states combined as its recombination
+  //! key, and operator== is only called for hypotheses with equal keys.
   virtual size_t hash() const = 0;
   virtual bool operator==(const FFState& other) const = 0;
 
@@ -51,6 +51,7 @@ FeatureFunction(const std::string& line, bool registerNow)
   , m_verbosity(std::numeric_limits<std::size_t>::max())
   , m_numScoreComponents(1)
   , m_index(0)
+  , m_profileId(0)
 {
   m_numTuneableComponents = m_numScoreComponents;
   ParseLine(line);
@@ -64,6 +65,7 @@ FeatureFunction::FeatureFunction(size_t numScoreComponents, const std::string& l
   , m_verbosity(std::numeric_limits<std::size_t>::max())
   , m_numScoreComponents(numScoreComponents)
   , m_index(0)
+  , m_profileId(0)
 {
   m_numTuneableComponents = m_numScoreComponents;
   ParseLine(line);
@@ -76,6 +78,7 @@ FeatureFunction::
 Register(FeatureFunction* ff)
 {
   ScoreComponentCollection::RegisterScoreProducer(ff);
+  ff->m_profileId = s_staticColl.size();
   s_staticColl.push_back(ff);
 }
 
@@ -132,6 +135,8 @@ void FeatureFunction::SetParameter(const std::string& key, const std::string& va
     m_requireSortingAfterSourceContext = Scan<bool>(value);
   } else if (key == "verbosity") {
     m_verbosity = Scan<size_t>(value);
+  } else if (key == "load-after") {
+    m_loadAfter = Tokenize(value, ",");
   } else if (key == "filterable") { //ignore
   } else {
     UTIL_THROW2(GetScoreProducerDescription() << ": Unknown argument " << key << "=" << value);
@@ -45,8 +45,10 @@ protected:
   size_t m_verbosity;
   size_t m_numScoreComponents;
   size_t m_index; // index into vector covering ALL feature function values
+  size_t m_profileId; // position in s_staticColl
   std::vector<bool> m_tuneableComponents;
   size_t m_numTuneableComponents;
+  std::vector<std::string> m_loadAfter;
   AllOptions::ptr m_options;
   //In case there's multiple producers with the same description
   static std::multiset<std::string> description_counts;
@@ -75,6 +77,11 @@ public:
     m_options = opts;
   }
 
+  //! names of the feature functions that must be loaded before this one
+  virtual std::vector<std::string> GetLoadDependencies() const {
+    return m_loadAfter;
+  }
+
   AllOptions::ptr const&
   options() const {
     return m_options;
@@ -90,6 +97,11 @@ public:
     return m_numScoreComponents;
   }
 
+  //! which counters of the Profiler are this feature function's
+  size_t GetProfileId() const {
+    return m_profileId;
+  }
+
   //! returns a string description of this producer
   const std::string& GetScoreProducerDescription() const {
     return m_description;
@@ -121,6 +133,13 @@ public:
     return m_requireSortingAfterSourceContext;
   }
 
+  //! false if the feature keeps state for the current sentence in the thread
+  //! that decodes it, so it can't be evaluated by the workers of
+  //! chart-cell-threads
+  virtual bool CanEvaluateInWorkerThreads() const {
+    return true;
+  }
+
   virtual std::vector<float> DefaultWeights() const;
 
   size_t GetIndex() const;
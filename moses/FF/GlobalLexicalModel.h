@@ -70,6 +70,11 @@ public:
 
   void InitializeForInput(ttasksptr const& ttask);
 
+  // the input is in m_local, set for the thread of the sentence
+  bool CanEvaluateInWorkerThreads() const {
+    return false;
+  }
+
   bool IsUseable(const FactorMask &mask) const;
 
   void EvaluateInIsolation(const Phrase &source
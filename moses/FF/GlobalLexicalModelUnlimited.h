@@ -74,6 +74,11 @@ public:
 
   void InitializeForInput(ttasksptr const& ttask);
 
+  // the input is in m_local, set for the thread of the sentence
+  bool CanEvaluateInWorkerThreads() const {
+    return false;
+  }
+
   //TODO: This implements the old interface, but cannot be updated because
   //it appears to be stateful
   void EvaluateWhenApplied(const Hypothesis& cur_hypo,
@@ -1,12 +1,17 @@
 // -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
 #pragma once
 
+#include <utility>
 #include "FeatureFunction.h"
 
 
 namespace Moses
 {
 class FFState;
+class TranslationOption;
+
+//! a hypothesis and a translation option the phrase-based search applies to it
+typedef std::pair<const Hypothesis*, const TranslationOption*> HypothesisExpansion;
 
 namespace Syntax
 {
@@ -63,6 +68,21 @@ public:
     return 0; /* FIXME */
   }
 
+  /**
+   * Phrase-based search: called with the expansions of a stack before they
+   * are built, so that work they share can be done in one batch, eg. the
+   * n-gram queries of a neural LM.  EvaluateWhenApplied() is then called for
+   * each new hypothesis as usual.  Early discarding may drop some of the
+   * expansions, and the search only collects them if UsesWhenAppliedBatch().
+   */
+  virtual void EvaluateWhenAppliedBatch(
+    const std::vector<HypothesisExpansion> & /* expansions */) const {
+  }
+
+  virtual bool UsesWhenAppliedBatch() const {
+    return false;
+  }
+
   //! return the state associated with the empty hypothesis for a given sentence
   virtual const FFState* EmptyHypothesisState(const InputType &input) const = 0;
 
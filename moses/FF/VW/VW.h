@@ -75,6 +75,11 @@ public:
     return true;
   }
 
+  // the target sentence and classifiers are thread-local
+  bool CanEvaluateInWorkerThreads() const {
+    return false;
+  }
+
   void EvaluateInIsolation(const Phrase &source
                            , const TargetPhrase &targetPhrase
                            , ScoreComponentCollection &scoreBreakdown
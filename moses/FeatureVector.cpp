@@ -37,6 +37,27 @@ using namespace std;
 namespace Moses
 {
 
+namespace
+{
+// Kernels for the dense (core) features, over plain arrays so that the
+// compiler can vectorise them.
+
+void AddDense(FValue *lhs, const FValue *rhs, size_t size)
+{
+  for (size_t i = 0; i < size; ++i) {
+    lhs[i] += rhs[i];
+  }
+}
+
+void SubtractDense(FValue *lhs, const FValue *rhs, size_t size)
+{
+  for (size_t i = 0; i < size; ++i) {
+    lhs[i] -= rhs[i];
+  }
+}
+
+}
+
 const string FName::SEP = "_";
 FName::Name2Id FName::name2id;
 vector<string> FName::id2name;
@@ -262,23 +283,11 @@ ProxyFVector FVector::operator[](const FName& name)
   return ProxyFVector(this, name);
 }
 
-/** Equivalent for core features. */
-FValue& FVector::operator[](size_t index)
-{
-  return m_coreFeatures[index];
-}
-
-
 FValue FVector::operator[](const FName& name) const
 {
   return get(name);
 }
 
-FValue FVector::operator[](size_t index) const
-{
-  return m_coreFeatures[index];
-}
-
 ostream& FVector::print(ostream& out) const
 {
   out << "core=(";
@@ -372,8 +381,8 @@ FVector& FVector::operator+= (const FVector& rhs)
     resize(rhs.m_coreFeatures.size());
   for (const_iterator i = rhs.cbegin(); i != rhs.cend(); ++i)
     set(i->first, get(i->first) + i->second);
-  for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
-    m_coreFeatures[i] += rhs.m_coreFeatures[i];
+  if (rhs.m_coreFeatures.size())
+    AddDense(&m_coreFeatures[0], &rhs.m_coreFeatures[0], rhs.m_coreFeatures.size());
   return *this;
 }
 
@@ -389,8 +398,8 @@ void FVector::corePlusEquals(const FVector& rhs)
 {
   if (rhs.m_coreFeatures.size() > m_coreFeatures.size())
     resize(rhs.m_coreFeatures.size());
-  for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
-    m_coreFeatures[i] += rhs.m_coreFeatures[i];
+  if (rhs.m_coreFeatures.size())
+    AddDense(&m_coreFeatures[0], &rhs.m_coreFeatures[0], rhs.m_coreFeatures.size());
 }
 
 // assign only core features
@@ -550,11 +559,8 @@ FVector& FVector::operator-= (const FVector& rhs)
     resize(rhs.m_coreFeatures.size());
   for (const_iterator i = rhs.cbegin(); i != rhs.cend(); ++i)
     set(i->first, get(i->first) -(i->second));
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
-    if (i < rhs.m_coreFeatures.size()) {
-      m_coreFeatures[i] -= rhs.m_coreFeatures[i];
-    }
-  }
+  if (rhs.m_coreFeatures.size())
+    SubtractDense(&m_coreFeatures[0], &rhs.m_coreFeatures[0], rhs.m_coreFeatures.size());
   return *this;
 }
 
@@ -809,6 +815,8 @@ FValue FVector::inner_product(const FVector& rhs) const
   for (const_iterator i = cbegin(); i != cend(); ++i) {
     product += ((i->second)*(rhs.get(i->first)));
   }
+  // One sum, in feature order: partial sums would change weighted scores in
+  // the last bits, and with them the order of tied hypotheses.
   for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
     product += m_coreFeatures[i]*rhs.m_coreFeatures[i];
   }
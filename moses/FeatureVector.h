@@ -171,9 +171,13 @@ public:
 
   /** Element access */
   ProxyFVector operator[](const FName& name);
-  FValue& operator[](size_t index);
+  FValue& operator[](size_t index) {
+    return m_coreFeatures[index];
+  }
   FValue operator[](const FName& name) const;
-  FValue operator[](size_t index) const;
+  FValue operator[](size_t index) const {
+    return m_coreFeatures[index];
+  }
 
   /** Size */
   size_t size() const {
@@ -306,6 +306,35 @@ BOOST_AUTO_TEST_CASE(ip)
   BOOST_CHECK_CLOSE((FValue)p1, 1.1*0.5 + -0.1*0.25 + 2.2*2.4, TOL);
 }
 
+BOOST_AUTO_TEST_CASE(core_long)
+{
+  // longer than the kernels' unrolled loops, and not a multiple of them
+  const size_t size = 11;
+  FVector f1(size);
+  FVector f2(size);
+  FValue expected = 0;
+  for (size_t i = 0; i < size; ++i) {
+    f1[i] = 0.5 * i - 2;
+    f2[i] = 1.25 - 0.1 * i;
+    expected += f1[i] * f2[i];
+  }
+  // summed in a different order
+  BOOST_CHECK_CLOSE(inner_product(f1,f2), expected, 0.001);
+
+  FVector sum = f1 + f2;
+  FVector diff = f1 - f2;
+  for (size_t i = 0; i < size; ++i) {
+    BOOST_CHECK_CLOSE(sum[i], f1[i] + f2[i], TOL);
+    BOOST_CHECK_CLOSE(diff[i], f1[i] - f2[i], TOL);
+  }
+
+  FVector f3(3);
+  f3[2] = 1;
+  f1 -= f3;
+  BOOST_CHECK_CLOSE(f1[2], -2.0, TOL);
+  BOOST_CHECK_CLOSE(f1[10], 3.0, TOL);
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -28,13 +28,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "InputFileStream.h"
 #include "StaticData.h"
 #include "util/exception.hh"
-#include "util/string_stream.hh"
 
 using namespace std;
 
 namespace Moses
 {
 std::vector<GenerationDictionary*> GenerationDictionary::s_staticColl;
+const uint32_t GenerationDictionary::NO_ID;
 
 GenerationDictionary::GenerationDictionary(const std::string &line)
   : DecodeFeature(line, true)
@@ -51,83 +51,57 @@ void GenerationDictionary::Load(AllOptions::ptr const& opts)
 
   const size_t numFeatureValuesInConfig = this->GetNumScoreComponents();
 
-
-  // data from file
-  InputFileStream inFile(m_filePath);
-  UTIL_THROW_IF2(!inFile.good(), "Couldn't read " << m_filePath);
-
-  string line;
-  size_t lineNum = 0;
-  while(getline(inFile, line)) {
-    ++lineNum;
-    vector<string> token = Tokenize( line );
-
-    // add each line in generation file into class
-    Word *inputWord = new Word();  // deleted in destructor
-    Word outputWord;
-
-    // create word with certain factors filled out
-
-    // inputs
-    vector<string> factorString = Tokenize( token[0], "|" );
-    for (size_t i = 0 ; i < GetInput().size() ; i++) {
-      FactorType factorType = GetInput()[i];
-      const Factor *factor = factorCollection.AddFactor( Output, factorType, factorString[i]);
-      inputWord->SetFactor(factorType, factor);
-    }
-
-    factorString = Tokenize( token[1], "|" );
-    for (size_t i = 0 ; i < GetOutput().size() ; i++) {
-      FactorType factorType = GetOutput()[i];
-
-      const Factor *factor = factorCollection.AddFactor( Output, factorType, factorString[i]);
-      outputWord.SetFactor(factorType, factor);
-    }
-
-    size_t numFeaturesInFile = token.size() - 2;
-    if (numFeaturesInFile < numFeatureValuesInConfig) {
-      util::StringStream strme;
-      strme << m_filePath << ":" << lineNum << ": expected " << numFeatureValuesInConfig
-            << " feature values, but found " << numFeaturesInFile << "\n";
-      throw strme.str();
-    }
-    std::vector<float> scores(numFeatureValuesInConfig, 0.0f);
-    for (size_t i = 0; i < numFeatureValuesInConfig; i++)
-      scores[i] = FloorScore(TransformScore(Scan<float>(token[2+i])));
-
-    Collection::iterator iterWord = m_collection.find(inputWord);
-    if (iterWord == m_collection.end()) {
-      m_collection[inputWord][outputWord].Assign(this, scores);
-    } else {
-      // source word already in there. delete input word to avoid mem leak
-      (iterWord->second)[outputWord].Assign(this, scores);
-      delete inputWord;
-    }
+  if (GenerationTable::IsBinary(m_filePath)) {
+    m_table.LoadBinary(m_filePath);
+    UTIL_THROW_IF2(m_table.GetNumInputFactors() != GetInput().size(),
+                   m_filePath << " has " << m_table.GetNumInputFactors()
+                   << " input factors, but the feature has " << GetInput().size());
+    UTIL_THROW_IF2(m_table.GetNumOutputFactors() < GetOutput().size(),
+                   m_filePath << " has " << m_table.GetNumOutputFactors()
+                   << " output factors, but the feature has " << GetOutput().size());
+    UTIL_THROW_IF2(m_table.GetNumScores() < numFeatureValuesInConfig,
+                   m_filePath << " has " << m_table.GetNumScores()
+                   << " feature values, but the feature has " << numFeatureValuesInConfig);
+  } else {
+    // data from file
+    InputFileStream inFile(m_filePath);
+    UTIL_THROW_IF2(!inFile.good(), "Couldn't read " << m_filePath);
+    m_table.Load(inFile, m_filePath, GetInput().size(), GetOutput().size(),
+                 numFeatureValuesInConfig);
+    inFile.Close();
   }
 
-  inFile.Close();
+  // map between the ids of the table and the factors
+  m_factors.resize(m_table.GetVocabSize());
+  size_t maxFactorId = 0;
+  for (size_t id = 0; id < m_factors.size(); ++id) {
+    m_factors[id] = factorCollection.AddFactor(m_table.GetString(id));
+    maxFactorId = std::max(maxFactorId, m_factors[id]->GetId());
+  }
+  m_tableIds.assign(m_factors.empty() ? 0 : maxFactorId + 1, NO_ID);
+  for (size_t id = 0; id < m_factors.size(); ++id) {
+    m_tableIds[m_factors[id]->GetId()] = id;
+  }
 }
 
 GenerationDictionary::~GenerationDictionary()
 {
-  Collection::const_iterator iter;
-  for (iter = m_collection.begin() ; iter != m_collection.end() ; ++iter) {
-    delete iter->first;
-  }
 }
 
-const OutputWordCollection *GenerationDictionary::FindWord(const Word &word) const
+bool GenerationDictionary::FindWord(const Word &word, size_t &begin, size_t &end) const
 {
-  const OutputWordCollection *ret;
-
-  Collection::const_iterator iter = m_collection.find(&word);
-  if (iter == m_collection.end()) {
-    // can't find source phrase
-    ret = NULL;
-  } else {
-    ret = &iter->second;
+  uint32_t ids[MAX_NUM_FACTORS];
+  for (size_t i = 0; i < GetInput().size(); ++i) {
+    const Factor *factor = word[GetInput()[i]];
+    if (factor == NULL || factor->GetId() >= m_tableIds.size()) {
+      return false;
+    }
+    ids[i] = m_tableIds[factor->GetId()];
+    if (ids[i] == NO_ID) {
+      return false;
+    }
   }
-  return ret;
+  return m_table.Find(ids, begin, end);
 }
 
 void GenerationDictionary::SetParameter(const std::string& key, const std::string& value)
@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "ScoreComponentCollection.h"
 #include "Phrase.h"
 #include "TypeDef.h"
+#include "GenerationTable.h"
 #include "moses/FF/DecodeFeature.h"
 
 namespace Moses
@@ -36,21 +37,19 @@ namespace Moses
 
 class FactorCollection;
 
-typedef boost::unordered_map < Word , ScoreComponentCollection > OutputWordCollection;
-// 1st = output phrase
-// 2nd = log probability (score)
-
-/** Implementation of a generation table in a trie.
+/** A generation table.  The path is either a text table or a binary one
+ *  written by CreateBinaryGeneration, which is memory mapped.
  */
 class GenerationDictionary : public DecodeFeature
 {
-  typedef boost::unordered_map<const Word* , OutputWordCollection, UnorderedComparer<Word>, UnorderedComparer<Word> > Collection;
 protected:
   static std::vector<GenerationDictionary*> s_staticColl;
 
-  Collection m_collection;
-  // 1st = source
-  // 2nd = target
+  GenerationTable m_table;
+  std::vector<const Factor*> m_factors; //! by id in m_table
+  std::vector<uint32_t> m_tableIds; //! by Factor::GetId(), or NO_ID
+
+  static const uint32_t NO_ID = 0xffffffff;
   std::string						m_filePath;
 
 public:
@@ -68,12 +67,25 @@ public:
   * NOT the number of lines in the generation table
   */
   size_t GetSize() const {
-    return m_collection.size();
+    return m_table.GetNumSources();
   }
-  /** returns a bag of output words, OutputWordCollection, for a particular input word.
-  *	Or NULL if the input word isn't found. The search function used is the WordComparer functor
+  /** finds the output words of an input word.  Returns false if the input
+  *	word isn't found, otherwise sets [begin, end) to the output words, which
+  *	are read with GetOutputWord() and GetScores().  Doesn't allocate
   */
-  const OutputWordCollection *FindWord(const Word &word) const;
+  bool FindWord(const Word &word, size_t &begin, size_t &end) const;
+
+  //! sets the output factors of word to those of an output word
+  void GetOutputWord(size_t output, Word &word) const {
+    const uint32_t *ids = m_table.GetTargetIds(output);
+    for (size_t i = 0; i < GetOutput().size(); ++i) {
+      word[GetOutput()[i]] = m_factors[ids[i]];
+    }
+  }
+  //! the scores of an output word, one for each score component
+  const float *GetScores(size_t output) const {
+    return m_table.GetScores(output);
+  }
   void SetParameter(const std::string& key, const std::string& value);
 
 };
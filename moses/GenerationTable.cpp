@@ -0,0 +1,332 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include <boost/unordered_map.hpp>
+
+#include "GenerationTable.h"
+#include "Util.h"
+#include "util/exception.hh"
+#include "util/file.hh"
+
+using namespace std;
+
+namespace Moses
+{
+
+namespace
+{
+
+// lexicographic order of two keys of length size
+int CompareIds(const uint32_t *a, const uint32_t *b, size_t size)
+{
+  for (size_t i = 0; i < size; ++i) {
+    if (a[i] != b[i]) {
+      return a[i] < b[i] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+// orders the lines of a text table by source, then target
+class LineOrder
+{
+public:
+  LineOrder(const vector<uint32_t> &sourceIds, size_t numInputFactors,
+            const vector<uint32_t> &targetIds, size_t numOutputFactors)
+    : m_sourceIds(sourceIds)
+    , m_numInputFactors(numInputFactors)
+    , m_targetIds(targetIds)
+    , m_numOutputFactors(numOutputFactors) {
+  }
+
+  int CompareSources(uint32_t a, uint32_t b) const {
+    return CompareIds(&m_sourceIds[a * m_numInputFactors],
+                      &m_sourceIds[b * m_numInputFactors], m_numInputFactors);
+  }
+
+  int CompareTargets(uint32_t a, uint32_t b) const {
+    return CompareIds(&m_targetIds[a * m_numOutputFactors],
+                      &m_targetIds[b * m_numOutputFactors], m_numOutputFactors);
+  }
+
+  bool operator()(uint32_t a, uint32_t b) const {
+    int c = CompareSources(a, b);
+    return c < 0 || (c == 0 && CompareTargets(a, b) < 0);
+  }
+
+private:
+  const vector<uint32_t> &m_sourceIds;
+  size_t m_numInputFactors;
+  const vector<uint32_t> &m_targetIds;
+  size_t m_numOutputFactors;
+};
+
+class Vocabulary
+{
+public:
+  Vocabulary(string &strings, vector<uint64_t> &offsets)
+    : m_strings(strings)
+    , m_offsets(offsets) {
+    m_strings.clear();
+    m_offsets.assign(1, 0);
+  }
+
+  uint32_t Insert(const string &str) {
+    boost::unordered_map<string, uint32_t>::const_iterator iter = m_ids.find(str);
+    if (iter != m_ids.end()) {
+      return iter->second;
+    }
+    UTIL_THROW_IF2(m_ids.size() >= numeric_limits<uint32_t>::max(),
+                   "Generation table has too many distinct factors");
+    uint32_t id = m_ids.size();
+    m_ids[str] = id;
+    m_strings += str;
+    m_offsets.push_back(m_strings.size());
+    return id;
+  }
+
+  size_t Size() const {
+    return m_ids.size();
+  }
+
+private:
+  string &m_strings;
+  vector<uint64_t> &m_offsets;
+  boost::unordered_map<string, uint32_t> m_ids;
+};
+
+}
+
+const char GenerationTable::kMagic[8] = {'m', 'o', 's', 'e', 's', 'g', 'e', 'n'};
+
+GenerationTable::GenerationTable()
+  : m_numInputFactors(0)
+  , m_numOutputFactors(0)
+  , m_numScores(0)
+  , m_numVocab(0)
+  , m_numSources(0)
+  , m_vocabOffsets(NULL)
+  , m_vocab(NULL)
+  , m_targetOffsets(NULL)
+  , m_sourceIds(NULL)
+  , m_targetIds(NULL)
+  , m_scores(NULL)
+{
+}
+
+void GenerationTable::Load(istream &in, const string &path,
+                           size_t numInputFactors, size_t numOutputFactors,
+                           size_t numScores)
+{
+  m_numInputFactors = numInputFactors;
+  m_numOutputFactors = numOutputFactors;
+  m_numScores = numScores;
+
+  Vocabulary vocab(m_vocabVec, m_vocabOffsetsVec);
+  vector<uint32_t> sourceIds, targetIds;
+  vector<float> scores;
+
+  string line;
+  size_t lineNum = 0;
+  while (getline(in, line)) {
+    ++lineNum;
+    vector<string> token = Tokenize(line);
+    if (token.empty()) {
+      continue;
+    }
+    UTIL_THROW_IF2(token.size() < 2 + numScores,
+                   path << ":" << lineNum << ": expected " << numScores
+                   << " feature values, but found "
+                   << (token.size() < 2 ? 0 : token.size() - 2));
+
+    vector<string> factorString = Tokenize(token[0], "|");
+    UTIL_THROW_IF2(factorString.size() < numInputFactors,
+                   path << ":" << lineNum << ": expected " << numInputFactors
+                   << " input factors, but found " << factorString.size());
+    for (size_t i = 0; i < numInputFactors; ++i) {
+      sourceIds.push_back(vocab.Insert(factorString[i]));
+    }
+
+    factorString = Tokenize(token[1], "|");
+    UTIL_THROW_IF2(factorString.size() < numOutputFactors,
+                   path << ":" << lineNum << ": expected " << numOutputFactors
+                   << " output factors, but found " << factorString.size());
+    for (size_t i = 0; i < numOutputFactors; ++i) {
+      targetIds.push_back(vocab.Insert(factorString[i]));
+    }
+
+    for (size_t i = 0; i < numScores; ++i) {
+      scores.push_back(FloorScore(TransformScore(Scan<float>(token[2+i]))));
+    }
+  }
+  m_numVocab = vocab.Size();
+
+  const size_t numLines = numInputFactors ? sourceIds.size() / numInputFactors
+                          : (numOutputFactors ? targetIds.size() / numOutputFactors : 0);
+  UTIL_THROW_IF2(numLines > numeric_limits<uint32_t>::max(),
+                 "Generation table " << path << " has too many entries");
+  vector<uint32_t> lines(numLines);
+  for (size_t i = 0; i < numLines; ++i) {
+    lines[i] = i;
+  }
+  // stable, so that the last of several equal pairs is the last one read
+  LineOrder order(sourceIds, numInputFactors, targetIds, numOutputFactors);
+  stable_sort(lines.begin(), lines.end(), order);
+
+  m_sourceIdsVec.clear();
+  m_targetIdsVec.clear();
+  m_scoresVec.clear();
+  m_targetOffsetsVec.assign(1, 0);
+  for (size_t i = 0; i < numLines; ++i) {
+    uint32_t curr = lines[i];
+    if (i + 1 < numLines && order.CompareSources(curr, lines[i+1]) == 0
+        && order.CompareTargets(curr, lines[i+1]) == 0) {
+      continue;
+    }
+    if (m_targetIdsVec.empty() ||
+        CompareIds(&sourceIds[curr * numInputFactors],
+                   &m_sourceIdsVec[m_sourceIdsVec.size() - numInputFactors],
+                   numInputFactors) != 0) {
+      // a new source
+      m_sourceIdsVec.insert(m_sourceIdsVec.end(),
+                            sourceIds.begin() + curr * numInputFactors,
+                            sourceIds.begin() + (curr + 1) * numInputFactors);
+      m_targetOffsetsVec.push_back(m_targetOffsetsVec.back());
+    }
+    m_targetIdsVec.insert(m_targetIdsVec.end(),
+                          targetIds.begin() + curr * numOutputFactors,
+                          targetIds.begin() + (curr + 1) * numOutputFactors);
+    m_scoresVec.insert(m_scoresVec.end(),
+                       scores.begin() + curr * numScores,
+                       scores.begin() + (curr + 1) * numScores);
+    ++m_targetOffsetsVec.back();
+  }
+  m_numSources = m_targetOffsetsVec.size() - 1;
+
+  SetArrays(&m_vocabOffsetsVec[0], m_vocabVec.data(), &m_targetOffsetsVec[0],
+            m_sourceIdsVec.empty() ? NULL : &m_sourceIdsVec[0],
+            m_targetIdsVec.empty() ? NULL : &m_targetIdsVec[0],
+            m_scoresVec.empty() ? NULL : &m_scoresVec[0]);
+}
+
+bool GenerationTable::IsBinary(const string &path)
+{
+  ifstream in(path.c_str(), ios::binary);
+  char magic[sizeof(kMagic)];
+  return in.read(magic, sizeof(magic)) &&
+         memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+void GenerationTable::WriteBinary(const string &path) const
+{
+  ofstream out(path.c_str(), ios::binary);
+  UTIL_THROW_IF2(!out, "Couldn't open " << path << " for writing");
+
+  Header header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.numInputFactors = m_numInputFactors;
+  header.numOutputFactors = m_numOutputFactors;
+  header.numScores = m_numScores;
+  header.numVocab = m_numVocab;
+  header.numSources = m_numSources;
+  header.numTargets = m_targetOffsets[m_numSources];
+  header.vocabBytes = m_vocabOffsets[m_numVocab];
+
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(m_vocabOffsets),
+            (m_numVocab + 1) * sizeof(uint64_t));
+  out.write(reinterpret_cast<const char *>(m_targetOffsets),
+            (m_numSources + 1) * sizeof(uint64_t));
+  out.write(reinterpret_cast<const char *>(m_sourceIds),
+            m_numSources * m_numInputFactors * sizeof(uint32_t));
+  out.write(reinterpret_cast<const char *>(m_targetIds),
+            header.numTargets * m_numOutputFactors * sizeof(uint32_t));
+  out.write(reinterpret_cast<const char *>(m_scores),
+            header.numTargets * m_numScores * sizeof(float));
+  out.write(m_vocab, header.vocabBytes);
+  out.close();
+  UTIL_THROW_IF2(!out, "Couldn't write " << path);
+}
+
+void GenerationTable::LoadBinary(const string &path)
+{
+  util::scoped_fd file(util::OpenReadOrThrow(path.c_str()));
+  const uint64_t size = util::SizeOrThrow(file.get());
+  UTIL_THROW_IF2(size < sizeof(Header),
+                 path << " is not a binary generation table");
+  util::MapRead(util::POPULATE_OR_READ, file.get(), 0, size, m_memory);
+
+  const char *begin = static_cast<const char *>(m_memory.get());
+  const Header *header = reinterpret_cast<const Header *>(begin);
+  UTIL_THROW_IF2(memcmp(header->magic, kMagic, sizeof(kMagic)) != 0,
+                 path << " is not a binary generation table");
+  UTIL_THROW_IF2(header->version != kVersion,
+                 path << " has an unsupported version");
+
+  const uint64_t arraysSize = (header->numVocab + 1) * sizeof(uint64_t)
+                              + (header->numSources + 1) * sizeof(uint64_t)
+                              + header->numSources * header->numInputFactors * sizeof(uint32_t)
+                              + header->numTargets * header->numOutputFactors * sizeof(uint32_t)
+                              + header->numTargets * header->numScores * sizeof(float)
+                              + header->vocabBytes;
+  UTIL_THROW_IF2(size - sizeof(Header) < arraysSize,
+                 "Binary generation table " << path << " is truncated");
+
+  m_numInputFactors = header->numInputFactors;
+  m_numOutputFactors = header->numOutputFactors;
+  m_numScores = header->numScores;
+  m_numVocab = header->numVocab;
+  m_numSources = header->numSources;
+
+  const char *p = begin + sizeof(Header);
+  const uint64_t *vocabOffsets = reinterpret_cast<const uint64_t *>(p);
+  p += (header->numVocab + 1) * sizeof(uint64_t);
+  const uint64_t *targetOffsets = reinterpret_cast<const uint64_t *>(p);
+  p += (header->numSources + 1) * sizeof(uint64_t);
+  const uint32_t *sourceIds = reinterpret_cast<const uint32_t *>(p);
+  p += header->numSources * header->numInputFactors * sizeof(uint32_t);
+  const uint32_t *targetIds = reinterpret_cast<const uint32_t *>(p);
+  p += header->numTargets * header->numOutputFactors * sizeof(uint32_t);
+  const float *scores = reinterpret_cast<const float *>(p);
+  p += header->numTargets * header->numScores * sizeof(float);
+
+  SetArrays(vocabOffsets, p, targetOffsets, sourceIds, targetIds, scores);
+}
+
+bool GenerationTable::Find(const uint32_t *sourceIds, size_t &begin, size_t &end) const
+{
+  size_t lo = 0, hi = m_numSources;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int c = CompareIds(m_sourceIds + mid * m_numInputFactors, sourceIds,
+                       m_numInputFactors);
+    if (c == 0) {
+      begin = m_targetOffsets[mid];
+      end = m_targetOffsets[mid+1];
+      return true;
+    } else if (c < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return false;
+}
+
+void GenerationTable::SetArrays(const uint64_t *vocabOffsets, const char *vocab,
+                                const uint64_t *targetOffsets,
+                                const uint32_t *sourceIds,
+                                const uint32_t *targetIds, const float *scores)
+{
+  m_vocabOffsets = vocabOffsets;
+  m_vocab = vocab;
+  m_targetOffsets = targetOffsets;
+  m_sourceIds = sourceIds;
+  m_targetIds = targetIds;
+  m_scores = scores;
+}
+
+}
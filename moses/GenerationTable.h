@@ -0,0 +1,128 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "util/mmap.hh"
+#include "util/string_piece.hh"
+
+namespace Moses
+{
+
+/** The entries of a generation table, keyed by the factors of the source
+ *  word, in flat arrays.  Factors are stored as ids into the table's own
+ *  vocabulary, and the targets of each source are contiguous, so a lookup
+ *  is a binary search and doesn't allocate.
+ *
+ *  The table can be written to a binary file, which is memory mapped when
+ *  loaded.  The layout is the byte order of the machine that wrote it:
+ *
+ *    Header
+ *    uint64_t vocabOffsets[numVocab+1]     into vocab
+ *    uint64_t targetOffsets[numSources+1]  into targetIds and scores
+ *    uint32_t sourceIds[numSources*numInputFactors], in ascending order
+ *    uint32_t targetIds[numTargets*numOutputFactors]
+ *    float scores[numTargets*numScores]
+ *    char vocab[vocabBytes]
+ */
+class GenerationTable
+{
+public:
+  GenerationTable();
+
+  /** Loads a table in text format (input factors, output factors, scores).
+   *  Only the first numInputFactors, numOutputFactors and numScores of each
+   *  line are kept.  The scores are stored as the decoder uses them, in log
+   *  space and floored.  If a pair occurs more than once, the last one wins.
+   */
+  void Load(std::istream &in, const std::string &path, size_t numInputFactors,
+            size_t numOutputFactors, size_t numScores);
+
+  //! Loads a binary table written by WriteBinary()
+  void LoadBinary(const std::string &path);
+
+  void WriteBinary(const std::string &path) const;
+
+  //! Returns true if the file at path is a binary table
+  static bool IsBinary(const std::string &path);
+
+  size_t GetNumInputFactors() const {
+    return m_numInputFactors;
+  }
+  size_t GetNumOutputFactors() const {
+    return m_numOutputFactors;
+  }
+  size_t GetNumScores() const {
+    return m_numScores;
+  }
+  size_t GetNumSources() const {
+    return m_numSources;
+  }
+  size_t GetVocabSize() const {
+    return m_numVocab;
+  }
+  StringPiece GetString(uint32_t id) const {
+    return StringPiece(m_vocab + m_vocabOffsets[id],
+                       m_vocabOffsets[id+1] - m_vocabOffsets[id]);
+  }
+
+  /** Finds the targets of a source word, given the ids of its input factors.
+   *  Returns false if it isn't in the table, otherwise sets [begin, end) to
+   *  the indices of its targets.
+   */
+  bool Find(const uint32_t *sourceIds, size_t &begin, size_t &end) const;
+
+  const uint32_t *GetTargetIds(size_t target) const {
+    return m_targetIds + target * m_numOutputFactors;
+  }
+  const float *GetScores(size_t target) const {
+    return m_scores + target * m_numScores;
+  }
+
+private:
+  struct Header {
+    char magic[8];
+    uint64_t version;
+    uint64_t numInputFactors;
+    uint64_t numOutputFactors;
+    uint64_t numScores;
+    uint64_t numVocab;
+    uint64_t numSources;
+    uint64_t numTargets;
+    uint64_t vocabBytes;
+  };
+
+  static const char kMagic[8];
+  static const uint64_t kVersion = 1;
+
+  void SetArrays(const uint64_t *vocabOffsets, const char *vocab,
+                 const uint64_t *targetOffsets, const uint32_t *sourceIds,
+                 const uint32_t *targetIds, const float *scores);
+
+  size_t m_numInputFactors;
+  size_t m_numOutputFactors;
+  size_t m_numScores;
+  size_t m_numVocab;
+  size_t m_numSources;
+
+  // The table, either in the vectors or in the mapped file.
+  std::vector<uint64_t> m_vocabOffsetsVec;
+  std::string m_vocabVec;
+  std::vector<uint64_t> m_targetOffsetsVec;
+  std::vector<uint32_t> m_sourceIdsVec;
+  std::vector<uint32_t> m_targetIdsVec;
+  std::vector<float> m_scoresVec;
+  util::scoped_memory m_memory;
+
+  const uint64_t *m_vocabOffsets;
+  const char *m_vocab;
+  const uint64_t *m_targetOffsets;
+  const uint32_t *m_sourceIds;
+  const uint32_t *m_targetIds;
+  const float *m_scores;
+};
+
+}
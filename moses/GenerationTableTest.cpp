@@ -0,0 +1,86 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+
+#include <cmath>
+#include <sstream>
+#include <string>
+
+#include "GenerationTable.h"
+
+using namespace Moses;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(generation_table)
+
+namespace
+{
+
+const char *const kTable =
+  "house|NN haus|NN 0.5 1\n"
+  "the|DT der|DT 0.25 1\n"
+  "house|NN haeuser|NNS 0.125 1\n"
+  "the|DT die|DT 0.75 1\n"
+  "\n"
+  "the|DT der|DT 0.5 1\n";
+
+uint32_t Id(const GenerationTable &table, const string &str)
+{
+  for (uint32_t id = 0; id < table.GetVocabSize(); ++id) {
+    if (table.GetString(id) == str) {
+      return id;
+    }
+  }
+  return table.GetVocabSize();
+}
+
+void CheckTable(const GenerationTable &table)
+{
+  BOOST_CHECK_EQUAL(table.GetNumSources(), 2);
+  BOOST_CHECK_EQUAL(table.GetNumInputFactors(), 2);
+  BOOST_CHECK_EQUAL(table.GetNumOutputFactors(), 1);
+  BOOST_CHECK_EQUAL(table.GetNumScores(), 1);
+
+  uint32_t the[2] = {Id(table, "the"), Id(table, "DT")};
+  size_t begin, end;
+  BOOST_REQUIRE(table.Find(the, begin, end));
+  BOOST_REQUIRE_EQUAL(end - begin, 2);
+  for (size_t i = begin; i < end; ++i) {
+    StringPiece word = table.GetString(table.GetTargetIds(i)[0]);
+    // the last of the two lines for der
+    float expected = word == "der" ? log(0.5) : log(0.75);
+    BOOST_CHECK(word == "der" || word == "die");
+    BOOST_CHECK_CLOSE(table.GetScores(i)[0], expected, 0.001);
+  }
+
+  uint32_t houseDT[2] = {Id(table, "house"), Id(table, "DT")};
+  BOOST_CHECK(!table.Find(houseDT, begin, end));
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(text)
+{
+  istringstream in(kTable);
+  GenerationTable table;
+  table.Load(in, "test", 2, 1, 1);
+  CheckTable(table);
+}
+
+BOOST_AUTO_TEST_CASE(binary)
+{
+  const string path = (boost::filesystem::temp_directory_path()
+                       / boost::filesystem::unique_path()).string();
+  {
+    istringstream in(kTable);
+    GenerationTable table;
+    table.Load(in, "test", 2, 1, 1);
+    table.WriteBinary(path);
+  }
+  BOOST_CHECK(GenerationTable::IsBinary(path));
+  GenerationTable table;
+  table.LoadBinary(path);
+  CheckTable(table);
+  boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
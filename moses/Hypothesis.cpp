@@ -33,6 +33,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "InputType.h"
 #include "Manager.h"
 #include "IOWrapper.h"
+#include "Profiler.h"
 #include "moses/FF/FFState.h"
 #include "moses/FF/StatefulFeatureFunction.h"
 #include "moses/FF/StatelessFeatureFunction.h"
@@ -58,6 +59,7 @@ Hypothesis(Manager& manager, InputType const& source, const TranslationOption &i
   , m_futureScore(0.0f)
   , m_estimatedScore(0.0f)
   , m_ffStates(StatefulFeatureFunction::GetStatefulFeatureFunctions().size())
+  , m_hash(0)
   , m_arcList(NULL)
   , m_transOpt(initialTransOpt)
   , m_manager(manager)
@@ -71,6 +73,7 @@ Hypothesis(Manager& manager, InputType const& source, const TranslationOption &i
   const vector<const StatefulFeatureFunction*>& ffs = StatefulFeatureFunction::GetStatefulFeatureFunctions();
   for (unsigned i = 0; i < ffs.size(); ++i)
     m_ffStates[i] = ffs[i]->EmptyHypothesisState(source);
+  ComputeHash();
 }
 
 /***
@@ -89,6 +92,7 @@ Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt, const
   , m_futureScore(0.0f)
   , m_estimatedScore(0.0f)
   , m_ffStates(prevHypo.m_ffStates.size())
+  , m_hash(0)
   , m_arcList(NULL)
   , m_transOpt(transOpt)
   , m_manager(prevHypo.GetManager())
@@ -160,11 +164,13 @@ EvaluateWhenApplied(float estimatedScore)
 
   // compute values of stateless feature functions that were not
   // cached in the translation option
+  Profiler::Data *profile = Profiler::GetData();
   const vector<const StatelessFeatureFunction*>& sfs =
     StatelessFeatureFunction::GetStatelessFeatureFunctions();
   for (unsigned i = 0; i < sfs.size(); ++i) {
     const StatelessFeatureFunction &ff = *sfs[i];
     if(!staticData.IsFeatureFunctionIgnored(ff)) {
+      ProfileTimer timer(profile, ff, Profiler::WhenApplied);
       ff.EvaluateWhenApplied(*this, &m_currScoreBreakdown);
     }
   }
@@ -175,9 +181,11 @@ EvaluateWhenApplied(float estimatedScore)
     const StatefulFeatureFunction &ff = *ffs[i];
     if(!staticData.IsFeatureFunctionIgnored(ff)) {
       FFState const* s = m_prevHypo ? m_prevHypo->m_ffStates[i] : NULL;
+      ProfileTimer timer(profile, ff, Profiler::WhenApplied);
       m_ffStates[i] = ff.EvaluateWhenApplied(*this, s, &m_currScoreBreakdown);
     }
   }
+  ComputeHash();
 
   // FUTURE COST
   m_estimatedScore = estimatedScore;
@@ -398,7 +406,7 @@ GetPlaceholders(const Hypothesis &hypo, FactorType placeholderFactor) const
   return ret;
 }
 
-size_t Hypothesis::hash() const
+void Hypothesis::ComputeHash()
 {
   size_t seed;
 
@@ -418,11 +426,17 @@ size_t Hypothesis::hash() const
     size_t hash = state->hash();
     boost::hash_combine(seed, hash);
   }
-  return seed;
+  m_hash = seed;
 }
 
 bool Hypothesis::operator==(const Hypothesis& other) const
 {
+  // equal states have equal hashes, so most hypotheses that can't be
+  // recombined are told apart without comparing their states
+  if (m_hash != other.m_hash) {
+    return false;
+  }
+
   // coverage
   if (&m_sourceCompleted != &other.m_sourceCompleted) {
     return false;
@@ -78,6 +78,7 @@ protected:
   mutable boost::scoped_ptr<ScoreComponentCollection> m_scoreBreakdown;
   ScoreComponentCollection m_currScoreBreakdown; /*! scores for this hypothesis only */
   std::vector<const FFState*> m_ffStates;
+  size_t m_hash; /*! recombination key of the coverage and the states, computed once they are set */
   const Hypothesis 	*m_winningHypo;
   ArcList 					*m_arcList; /*! all arcs that end at the same trellis point as this hypothesis */
   const TranslationOption &m_transOpt;
@@ -85,6 +86,8 @@ protected:
 
   int m_id; /*! numeric ID of this hypothesis, used for logging */
 
+  void ComputeHash();
+
 public:
   /*! used by initial seeding of the translation process */
   Hypothesis(Manager& manager, InputType const& source, const TranslationOption &initialTransOpt, const Bitmap &bitmap, int id);
@@ -248,7 +251,9 @@ public:
   std::map<size_t, const Moses::Factor*> GetPlaceholders(const Moses::Hypothesis &hypo, Moses::FactorType placeholderFactor) const;
 
   // for unordered_set in stack
-  size_t hash() const;
+  size_t hash() const {
+    return m_hash;
+  }
   bool operator==(const Hypothesis& other) const;
 
 #ifdef HAVE_XMLRPC_C
@@ -27,6 +27,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "Util.h"
 #include "StaticData.h"
 #include "Manager.h"
+#include "Profiler.h"
 #include "util/exception.hh"
 
 using namespace std;
@@ -83,8 +84,12 @@ pair<HypothesisStackCubePruning::iterator, bool> HypothesisStackCubePruning::Add
 
 bool HypothesisStackCubePruning::AddPrune(Hypothesis *hypo)
 {
+  size_t stack = hypo->GetWordsBitmap().GetNumWordsCovered();
+  Profiler::AddCreated(stack);
+
   if (hypo->GetFutureScore() == - std::numeric_limits<float>::infinity()) {
     m_manager.GetSentenceStats().AddDiscarded();
+    Profiler::AddPruned(stack);
     VERBOSE(3,"discarded, constraint" << std::endl);
     delete hypo;
     return false;
@@ -93,6 +98,7 @@ bool HypothesisStackCubePruning::AddPrune(Hypothesis *hypo)
   if (hypo->GetFutureScore() < m_worstScore) {
     // too bad for stack. don't bother adding hypo into collection
     m_manager.GetSentenceStats().AddDiscarded();
+    Profiler::AddPruned(stack);
     VERBOSE(3,"discarded, too bad for stack" << std::endl);
     delete hypo;
     return false;
@@ -111,6 +117,7 @@ bool HypothesisStackCubePruning::AddPrune(Hypothesis *hypo)
   Hypothesis *hypoExisting = *iterExisting;
 
   m_manager.GetSentenceStats().AddRecombination(*hypo, **iterExisting);
+  Profiler::AddRecombined(stack);
 
   // found existing hypo with same target ending.
   // keep the best 1
@@ -188,6 +195,7 @@ void HypothesisStackCubePruning::PruneToSize(size_t newSize)
       float score = hypo->GetFutureScore();
       if (score < scoreThreshold) {
         iterator iterRemove = iter++;
+        Profiler::AddPruned(hypo->GetWordsBitmap().GetNumWordsCovered());
         Remove(iterRemove);
         m_manager.GetSentenceStats().AddPruning();
       } else {
@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TypeDef.h"
 #include "Util.h"
 #include "Manager.h"
+#include "Profiler.h"
 #include "util/exception.hh"
 
 using namespace std;
@@ -92,8 +93,12 @@ pair<HypothesisStackNormal::iterator, bool> HypothesisStackNormal::Add(Hypothesi
 
 bool HypothesisStackNormal::AddPrune(Hypothesis *hypo)
 {
+  size_t stack = hypo->GetWordsBitmap().GetNumWordsCovered();
+  Profiler::AddCreated(stack);
+
   if (hypo->GetFutureScore() == - std::numeric_limits<float>::infinity()) {
     m_manager.GetSentenceStats().AddDiscarded();
+    Profiler::AddPruned(stack);
     VERBOSE(3,"discarded, constraint" << std::endl);
     delete hypo;
     return false;
@@ -105,6 +110,7 @@ bool HypothesisStackNormal::AddPrune(Hypothesis *hypo)
       && ! ( m_minHypoStackDiversity > 0
              && hypo->GetFutureScore() >= GetWorstScoreForBitmap( hypo->GetWordsBitmap() ) ) ) {
     m_manager.GetSentenceStats().AddDiscarded();
+    Profiler::AddPruned(stack);
     VERBOSE(3,"discarded, too bad for stack" << std::endl);
     delete hypo;
     return false;
@@ -123,6 +129,7 @@ bool HypothesisStackNormal::AddPrune(Hypothesis *hypo)
   assert(iterExisting != m_hypos.end());
 
   m_manager.GetSentenceStats().AddRecombination(*hypo, **iterExisting);
+  Profiler::AddRecombined(stack);
 
   // found existing hypo with same target ending.
   // keep the best 1
@@ -208,6 +215,7 @@ void HypothesisStackNormal::PruneToSize(size_t newSize)
   // delete hypotheses that have not been included
   for(size_t i=0; i<hypos.size(); i++) {
     if (! included[i]) {
+      Profiler::AddPruned(hypos[i]->GetWordsBitmap().GetNumWordsCovered());
       delete hypos[i];
       m_manager.GetSentenceStats().AddPruning();
     }
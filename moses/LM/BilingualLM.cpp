@@ -1,6 +1,7 @@
 #include <vector>
 #include "BilingualLM.h"
 #include "moses/ScoreComponentCollection.h"
+#include "moses/TranslationOption.h"
 
 using namespace std;
 
@@ -27,12 +28,11 @@ void BilingualLM::Load(AllOptions::ptr const& opts)
   loadModel();
 }
 
-//Populates words with amount words from the targetPhrase from the previous hypothesis where
+//Populates words with amount words from the target phrases of prev_hyp and its predecessors where
 //words[0] is the last word of the previous hypothesis, words[1] is the second last etc...
 void BilingualLM::requestPrevTargetNgrams(
-  const Hypothesis &cur_hypo, int amount, std::vector<int> &words) const
+  const Hypothesis *prev_hyp, int amount, std::vector<int> &words) const
 {
-  const Hypothesis * prev_hyp = cur_hypo.GetPrevHypo();
   int found = 0;
 
   while (prev_hyp && found != amount) {
@@ -59,7 +59,7 @@ void BilingualLM::requestPrevTargetNgrams(
 //Populates the words vector with target_ngrams sized that also contains the current word we are looking at.
 //(in effect target_ngrams + 1)
 void BilingualLM::getTargetWords(
-  const Hypothesis &cur_hypo,
+  const Hypothesis *prev_hypo,
   const TargetPhrase &targetPhrase,
   int current_word_index,
   std::vector<int> &words) const
@@ -69,7 +69,7 @@ void BilingualLM::getTargetWords(
   if (additional_needed < 0) {
     additional_needed = -additional_needed;
     std::vector<int> prev_words(additional_needed);
-    requestPrevTargetNgrams(cur_hypo, additional_needed, prev_words);
+    requestPrevTargetNgrams(prev_hypo, additional_needed, prev_words);
     for (int i = additional_needed - 1; i >= 0; i--) {
       words.push_back(prev_words[i]);
     }
@@ -165,7 +165,7 @@ size_t BilingualLM::getState(const Hypothesis& cur_hypo) const
   if (additional_needed < 0) {
     additional_needed = -additional_needed;
     std::vector<int> prev_words(additional_needed);
-    requestPrevTargetNgrams(cur_hypo, additional_needed, prev_words);
+    requestPrevTargetNgrams(cur_hypo.GetPrevHypo(), additional_needed, prev_words);
     for (int i = additional_needed - 1; i >= 0; i--) {
       boost::hash_combine(hashCode, prev_words[i]);
     }
@@ -189,35 +189,59 @@ size_t BilingualLM::getState(const Hypothesis& cur_hypo) const
   return hashCode;
 }
 
-FFState* BilingualLM::EvaluateWhenApplied(
-  const Hypothesis& cur_hypo,
-  const FFState* prev_state,
-  ScoreComponentCollection* accumulator) const
+float BilingualLM::ScoreBatch(std::vector<int>& ngrams) const
 {
-  Manager& manager = cur_hypo.GetManager();
-  const Sentence& source_sent = static_cast<const Sentence&>(manager.GetSource());
+  const size_t width = source_ngrams + target_ngrams + 1;
+  std::vector<int> source_words, target_words;
+  float value = 0;
+  for (size_t i = 0; i < ngrams.size(); i += width) {
+    source_words.assign(ngrams.begin() + i, ngrams.begin() + i + source_ngrams);
+    target_words.assign(ngrams.begin() + i + source_ngrams, ngrams.begin() + i + width);
+    value += Score(source_words, target_words);
+  }
+  return value;
+}
 
+void BilingualLM::getNgrams(
+  const Hypothesis *prev_hypo,
+  const TargetPhrase &targetPhrase,
+  const Sentence &source_sent,
+  const Range &sourceWordRange,
+  std::vector<int> &ngrams) const
+{
   // Init vectors.
   std::vector<int> source_words;
   source_words.reserve(source_ngrams);
   std::vector<int> target_words;
   target_words.reserve(target_ngrams);
 
-  float value = 0;
-  const TargetPhrase& currTargetPhrase = cur_hypo.GetCurrTargetPhrase();
-  const Range& sourceWordRange = cur_hypo.GetCurrSourceWordsRange(); //Source words range to calculate offsets
-
-  // For each word in the current target phrase get its LM score.
-  for (int i = 0; i < currTargetPhrase.GetSize(); i++) {
+  ngrams.reserve(ngrams.size() + targetPhrase.GetSize() * (source_ngrams + target_ngrams + 1));
+  for (int i = 0; i < targetPhrase.GetSize(); i++) {
     getSourceWords(
-      currTargetPhrase, i, source_sent, sourceWordRange, source_words);
-    getTargetWords(cur_hypo, currTargetPhrase, i, target_words);
-    value += Score(source_words, target_words);
+      targetPhrase, i, source_sent, sourceWordRange, source_words);
+    getTargetWords(prev_hypo, targetPhrase, i, target_words);
+    ngrams.insert(ngrams.end(), source_words.begin(), source_words.end());
+    ngrams.insert(ngrams.end(), target_words.begin(), target_words.end());
 
     // Clear the vectors.
     source_words.clear();
     target_words.clear();
   }
+}
+
+FFState* BilingualLM::EvaluateWhenApplied(
+  const Hypothesis& cur_hypo,
+  const FFState* prev_state,
+  ScoreComponentCollection* accumulator) const
+{
+  Manager& manager = cur_hypo.GetManager();
+  const Sentence& source_sent = static_cast<const Sentence&>(manager.GetSource());
+
+  // Collect the n-gram of each word in the current target phrase and score them together.
+  std::vector<int> ngrams;
+  getNgrams(cur_hypo.GetPrevHypo(), cur_hypo.GetCurrTargetPhrase(),
+            source_sent, cur_hypo.GetCurrSourceWordsRange(), ngrams);
+  float value = ScoreBatch(ngrams);
 
   size_t new_state = getState(cur_hypo);
   accumulator->PlusEquals(this, value);
@@ -225,6 +249,24 @@ FFState* BilingualLM::EvaluateWhenApplied(
   return new BilingualLMState(new_state);
 }
 
+//Scores the n-grams of all the expansions of a stack in one batch, which puts
+//them in the cache for EvaluateWhenApplied.
+void BilingualLM::EvaluateWhenAppliedBatch(const std::vector<HypothesisExpansion> &expansions) const
+{
+  Manager& manager = expansions[0].first->GetManager();
+  const Sentence& source_sent = static_cast<const Sentence&>(manager.GetSource());
+
+  std::vector<int> ngrams;
+  for (size_t i = 0; i < expansions.size(); ++i) {
+    const TranslationOption &transOpt = *expansions[i].second;
+    getNgrams(expansions[i].first, transOpt.GetTargetPhrase(),
+              source_sent, transOpt.GetSourceWordsRange(), ngrams);
+  }
+  if (!ngrams.empty()) {
+    ScoreBatch(ngrams);
+  }
+}
+
 void BilingualLM::getAllTargetIdsChart(const ChartHypothesis& cur_hypo, size_t featureID, std::vector<int>& wordIds) const
 {
   const TargetPhrase targetPhrase = cur_hypo.GetCurrTargetPhrase();
@@ -439,19 +481,23 @@ FFState* BilingualLM::EvaluateWhenApplied(
   const ChartManager& manager = cur_hypo.GetManager();
   const Sentence& source_sent = static_cast<const Sentence&>(manager.GetSource());
 
+  std::vector<int> ngrams;
+  ngrams.reserve(neuralLMids.size() * (source_ngrams + target_ngrams + 1));
   for (int i = 0; i < neuralLMids.size(); i++) { //This loop should be bigger as non terminals expand
 
     //We already have resolved the nonterminals, we are left with a simple loop.
     appendSourceWordsToVector(source_sent, source_words, alignments[i]);
     getTargetWordsChart(neuralLMids, i, target_words, sentence_begin);
 
-    value += Score(source_words, target_words); // Get the score
+    ngrams.insert(ngrams.end(), source_words.begin(), source_words.end());
+    ngrams.insert(ngrams.end(), target_words.begin(), target_words.end());
 
     //Clear the vectors before the next iteration
     source_words.clear();
     target_words.clear();
 
   }
+  value = ScoreBatch(ngrams); // Get the scores
   size_t new_state = getStateChart(neuralLMids);
 
   // we're rescoring the full hypothesis, so we need to detract scores from previous hypos
@@ -52,6 +52,17 @@ class BilingualLM : public StatefulFeatureFunction
 private:
   virtual float Score(std::vector<int>& source_words, std::vector<int>& target_words) const = 0;
 
+  //Sum of the scores of n-grams of source_ngrams source and target_ngrams+1
+  //target words each, stored one after another. By default calls Score() on
+  //each; implementations that can evaluate many n-grams at once override it.
+  virtual float ScoreBatch(std::vector<int>& ngrams) const;
+
+  //True if ScoreBatch() caches the scores. Then the n-grams of all the
+  //expansions of a stack are scored in one batch before their hypotheses.
+  virtual bool CachesScores() const {
+    return false;
+  }
+
   virtual int getNeuralLMId(const Word& word, bool is_source_word) const = 0;
 
   virtual void loadModel() = 0;
@@ -70,14 +81,22 @@ private:
   void appendSourceWordsToVector(const Sentence &source_sent, std::vector<int> &words, int source_word_mid_idx) const;
 
   void getTargetWords(
-    const Hypothesis &cur_hypo,
+    const Hypothesis *prev_hypo,
     const TargetPhrase &targetPhrase,
     int current_word_index,
     std::vector<int> &words) const;
 
   size_t getState(const Hypothesis &cur_hypo) const;
 
-  void requestPrevTargetNgrams(const Hypothesis &cur_hypo, int amount, std::vector<int> &words) const;
+  void requestPrevTargetNgrams(const Hypothesis *prev_hypo, int amount, std::vector<int> &words) const;
+
+  //Appends the n-grams of the words of targetPhrase, as appended to prev_hypo
+  void getNgrams(
+    const Hypothesis *prev_hypo,
+    const TargetPhrase &targetPhrase,
+    const Sentence &source_sent,
+    const Range &sourceWordRange,
+    std::vector<int> &ngrams) const;
 
   //Chart decoder
   void getTargetWordsChart(
@@ -113,6 +132,11 @@ public:
   bool IsUseable(const FactorMask &mask) const {
     return true;
   }
+
+  // the neural models keep a model per thread
+  bool CanEvaluateInWorkerThreads() const {
+    return false;
+  }
   virtual const FFState* EmptyHypothesisState(const InputType &input) const {
     return new BilingualLMState(0);
   }
@@ -124,6 +148,12 @@ public:
     const FFState* prev_state,
     ScoreComponentCollection* accumulator) const;
 
+  void EvaluateWhenAppliedBatch(const std::vector<HypothesisExpansion> &expansions) const;
+
+  bool UsesWhenAppliedBatch() const {
+    return CachesScores();
+  }
+
   FFState* EvaluateWhenApplied(
     const ChartHypothesis& cur_hypo ,
     int featureID, /* - used to index the state in the previous hypotheses */
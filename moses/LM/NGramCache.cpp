@@ -0,0 +1,51 @@
+#include <algorithm>
+#include "NGramCache.h"
+#include "util/murmur_hash.hh"
+
+namespace Moses
+{
+
+NGramCache::NGramCache(std::size_t order, std::size_t size, std::size_t shards)
+  :m_order(order)
+  ,m_size(size)
+  ,m_numShards(std::max<std::size_t>(std::min(shards, size), 1))
+  ,m_keys(size * order, -1)
+  ,m_scores(size)
+{
+#ifdef WITH_THREADS
+  m_shards.reset(new boost::mutex[m_numShards]);
+#endif
+}
+
+std::size_t NGramCache::Slot(const int *ngram) const
+{
+  return util::MurmurHashNative(ngram, m_order * sizeof(int)) % m_size;
+}
+
+bool NGramCache::Find(const int *ngram, float &score) const
+{
+  if (m_size == 0) return false;
+
+  std::size_t slot = Slot(ngram);
+  const int *key = &m_keys[slot * m_order];
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_shards[slot % m_numShards]);
+#endif
+  if (!std::equal(key, key + m_order, ngram)) return false;
+  score = m_scores[slot];
+  return true;
+}
+
+void NGramCache::Insert(const int *ngram, float score)
+{
+  if (m_size == 0) return;
+
+  std::size_t slot = Slot(ngram);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_shards[slot % m_numShards]);
+#endif
+  std::copy(ngram, ngram + m_order, m_keys.begin() + slot * m_order);
+  m_scores[slot] = score;
+}
+
+}
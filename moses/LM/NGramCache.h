@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <boost/scoped_array.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+namespace Moses
+{
+
+/** Score cache for neural language models, keyed on n-grams of vocabulary
+ *  ids. Direct mapped: an n-gram that hashes to an occupied slot replaces
+ *  what was there. Unlike the per-thread cache inside nplm, one instance is
+ *  shared by all decoding threads; slots are split into shards with a lock
+ *  each so that threads rarely wait for each other.
+ */
+class NGramCache
+{
+public:
+  /** size is the number of n-grams kept. 0 disables the cache */
+  NGramCache(std::size_t order, std::size_t size, std::size_t shards = 64);
+
+  bool Find(const int *ngram, float &score) const;
+  void Insert(const int *ngram, float score);
+
+  std::size_t GetOrder() const {
+    return m_order;
+  }
+
+protected:
+  std::size_t m_order;
+  std::size_t m_size;
+  std::size_t m_numShards;
+
+  std::vector<int> m_keys; // m_order ids per slot, first id -1 if empty
+  std::vector<float> m_scores;
+
+#ifdef WITH_THREADS
+  mutable boost::scoped_array<boost::mutex> m_shards;
+#endif
+
+  std::size_t Slot(const int *ngram) const;
+};
+
+}
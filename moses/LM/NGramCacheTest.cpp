@@ -0,0 +1,42 @@
+#define BOOST_TEST_MODULE NGramCacheTest
+#include <boost/test/unit_test.hpp>
+
+#include "NGramCache.h"
+
+using namespace Moses;
+
+BOOST_AUTO_TEST_CASE(find_inserted)
+{
+  NGramCache cache(3, 1000);
+  int a[] = {1, 2, 3};
+  int b[] = {1, 2, 4};
+  float score = 0;
+  BOOST_CHECK(!cache.Find(a, score));
+  cache.Insert(a, -1.5);
+  BOOST_CHECK(cache.Find(a, score));
+  BOOST_CHECK_EQUAL(-1.5, score);
+  BOOST_CHECK(!cache.Find(b, score));
+}
+
+BOOST_AUTO_TEST_CASE(collision_replaces)
+{
+  // a single slot: every n-gram evicts the previous one
+  NGramCache cache(2, 1);
+  int a[] = {5, 6};
+  int b[] = {6, 5};
+  float score = 0;
+  cache.Insert(a, -1);
+  cache.Insert(b, -2);
+  BOOST_CHECK(!cache.Find(a, score));
+  BOOST_CHECK(cache.Find(b, score));
+  BOOST_CHECK_EQUAL(-2, score);
+}
+
+BOOST_AUTO_TEST_CASE(disabled)
+{
+  NGramCache cache(2, 0);
+  int a[] = {-1, -1};
+  float score = 0;
+  cache.Insert(a, -1);
+  BOOST_CHECK(!cache.Find(a, score));
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+// Only include from translation units that are built against nplm
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <boost/unordered_map.hpp>
+#include <Eigen/Dense>
+
+#include "NGramCache.h"
+
+namespace Moses
+{
+
+/** Collects the n-gram queries of a hypothesis (or tree, or phrase, or all
+ *  the expansions of a stack) and scores them together. n-grams found in the
+ *  shared cache are skipped, and repeated ones are scored once; the rest go
+ *  through the network as the columns of one matrix, so there is a
+ *  matrix-matrix product per layer instead of a matrix-vector product per
+ *  n-gram. Model is nplm::neuralLM or nplm::neuralTM; it must be the calling
+ *  thread's copy since its width is changed to fit the batch.
+ */
+template <class Model>
+class NPLMBatch
+{
+public:
+  // wider batches are split; this bounds the size of the activations
+  static const std::size_t kMaxWidth = 256;
+
+  NPLMBatch(std::size_t order, NGramCache *cache)
+    :m_order(order)
+    ,m_cache(cache)
+  {}
+
+  /** Queue an n-gram of exactly order ids and return its index */
+  std::size_t Add(const int *ngram) {
+    m_ngrams.insert(m_ngrams.end(), ngram, ngram + m_order);
+    return Size() - 1;
+  }
+
+  /** Queue an n-gram of up to order ids. Shorter n-grams are padded on the
+   *  left as nplm does: with start if they begin with it, else with null */
+  std::size_t Add(const std::vector<int> &ngram, int start, int null) {
+    std::size_t missing = m_order - ngram.size();
+    m_ngrams.insert(m_ngrams.end(), missing, ngram[0] == start ? start : null);
+    m_ngrams.insert(m_ngrams.end(), ngram.begin(), ngram.end());
+    return Size() - 1;
+  }
+
+  std::size_t Size() const {
+    return m_ngrams.size() / m_order;
+  }
+
+  const int *NGram(std::size_t i) const {
+    return &m_ngrams[i * m_order];
+  }
+
+  /** Score everything queued since the last Clear() */
+  void Score(Model &model) {
+    m_scores.resize(Size());
+
+    // the distinct n-grams that aren't in the cache (by their first index),
+    // and for each n-gram the one it is scored as
+    std::vector<std::size_t> misses;
+    std::vector<std::size_t> missOf(Size(), kHit);
+    boost::unordered_map<std::string, std::size_t> firstMiss;
+    for (std::size_t i = 0; i < Size(); ++i) {
+      if (m_cache && m_cache->Find(NGram(i), m_scores[i])) {
+        continue;
+      }
+      std::string key(reinterpret_cast<const char*>(NGram(i)), m_order * sizeof(int));
+      std::pair<boost::unordered_map<std::string, std::size_t>::iterator, bool> ins
+        = firstMiss.insert(std::make_pair(key, misses.size()));
+      if (ins.second) {
+        misses.push_back(i);
+      }
+      missOf[i] = ins.first->second;
+    }
+
+    for (std::size_t begin = 0; begin < misses.size(); begin += kMaxWidth) {
+      std::size_t width = std::min(kMaxWidth, misses.size() - begin);
+      Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> ngrams(m_order, width);
+      for (std::size_t col = 0; col < width; ++col) {
+        const int *ngram = NGram(misses[begin + col]);
+        for (std::size_t row = 0; row < m_order; ++row) {
+          ngrams(row, col) = ngram[row];
+        }
+      }
+
+      Eigen::Matrix<double, Eigen::Dynamic, 1> scores(width);
+      model.set_width(width);
+      model.lookup_ngram(ngrams, scores);
+
+      for (std::size_t col = 0; col < width; ++col) {
+        std::size_t i = misses[begin + col];
+        m_scores[i] = scores(col);
+        if (m_cache) m_cache->Insert(NGram(i), m_scores[i]);
+      }
+    }
+
+    for (std::size_t i = 0; i < Size(); ++i) {
+      if (missOf[i] != kHit) {
+        m_scores[i] = m_scores[misses[missOf[i]]];
+      }
+    }
+  }
+
+  /** Log probability of the i-th n-gram, after Score() */
+  float Get(std::size_t i) const {
+    return m_scores[i];
+  }
+
+  void Clear() {
+    m_ngrams.clear();
+    m_scores.clear();
+  }
+
+protected:
+  static const std::size_t kHit = static_cast<std::size_t>(-1);
+
+  std::size_t m_order;
+  NGramCache *m_cache;
+  std::vector<int> m_ngrams;
+  std::vector<float> m_scores;
+};
+
+template <class Model> const std::size_t NPLMBatch<Model>::kMaxWidth;
+template <class Model> const std::size_t NPLMBatch<Model>::kHit;
+
+}
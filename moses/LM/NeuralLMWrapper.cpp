@@ -1,8 +1,12 @@
-
 #include "moses/StaticData.h"
 #include "moses/FactorCollection.h"
+#include "moses/Hypothesis.h"
+#include "moses/Manager.h"
+#include "moses/TranslationOption.h"
 #include <boost/functional/hash.hpp>
 #include "NeuralLMWrapper.h"
+#include "NPLMBatch.h"
+#include "PointerState.h"
 #include "neuralLM.h"
 
 using namespace std;
@@ -11,6 +15,7 @@ namespace Moses
 {
 NeuralLMWrapper::NeuralLMWrapper(const std::string &line)
   :LanguageModelSingleFactor(line)
+  ,m_cacheSize(1000000)
 {
   ReadParameters();
 }
@@ -22,6 +27,16 @@ NeuralLMWrapper::~NeuralLMWrapper()
 }
 
 
+void NeuralLMWrapper::SetParameter(const std::string& key, const std::string& value)
+{
+  if (key == "cache_size") {
+    m_cacheSize = Scan<size_t>(value);
+  } else {
+    LanguageModelSingleFactor::SetParameter(key, value);
+  }
+}
+
+
 void NeuralLMWrapper::Load(AllOptions::ptr const& opts)
 {
 
@@ -35,34 +50,62 @@ void NeuralLMWrapper::Load(AllOptions::ptr const& opts)
   m_neuralLM_shared = new nplm::neuralLM();
   m_neuralLM_shared->read(m_filePath);
   m_neuralLM_shared->premultiply();
-  //TODO: config option?
-  m_neuralLM_shared->set_cache(1000000);
 
   m_unk = m_neuralLM_shared->lookup_word("<unk>");
+  m_start = m_neuralLM_shared->lookup_word("<s>");
+  m_null = m_neuralLM_shared->lookup_word("<null>");
 
   UTIL_THROW_IF2(m_nGramOrder != m_neuralLM_shared->get_order(),
                  "Wrong order of neuralLM: LM has " << m_neuralLM_shared->get_order() << ", but Moses expects " << m_nGramOrder);
 
+  // Map every word the model knows to its id now, so that queries don't
+  // have to look up strings. Factors that don't get an entry are unknown.
+  const std::vector<std::string> &words = m_neuralLM_shared->get_vocabulary().words();
+  for (size_t i = 0; i < words.size(); ++i) {
+    const Factor *factor = factorCollection.AddFactor(Output, m_factorType, words[i]);
+    if (factor->GetId() >= m_factor2id.size()) {
+      m_factor2id.resize(factor->GetId() + 1, m_unk);
+    }
+    m_factor2id[factor->GetId()] = i;
+  }
+
+  m_cache.reset(new NGramCache(m_nGramOrder, m_cacheSize));
 }
 
 
-LMResult NeuralLMWrapper::GetValue(const vector<const Word*> &contextFactor, State* finalState) const
+nplm::neuralLM &NeuralLMWrapper::GetThreadLM() const
 {
-
   if (!m_neuralLM.get()) {
     m_neuralLM.reset(new nplm::neuralLM(*m_neuralLM_shared));
-    //TODO: config option?
-    m_neuralLM->set_cache(1000000);
   }
+  return *m_neuralLM;
+}
+
+
+int NeuralLMWrapper::GetId(const Word &word) const
+{
+  size_t id = word.GetFactor(m_factorType)->GetId();
+  return id < m_factor2id.size() ? m_factor2id[id] : m_unk;
+}
+
+
+// Hash of the last n-1 words of an n-gram, which represents the next LM state
+size_t NeuralLMWrapper::GetStateHash(const int *ngram) const
+{
+  size_t hashCode = 0;
+  for (size_t i=1; i<m_nGramOrder; ++i) {
+    boost::hash_combine(hashCode, ngram[i]);
+  }
+  return hashCode;
+}
+
 
+LMResult NeuralLMWrapper::GetValue(const vector<const Word*> &contextFactor, State* finalState) const
+{
   vector<int> words(contextFactor.size());
   const size_t n = contextFactor.size();
   for (size_t i=0; i<n; i++) {
-    const Word* word = contextFactor[i];
-    const Factor* factor = word->GetFactor(m_factorType);
-    const std::string string = factor->GetString().as_string();
-    int neuralLM_wordID = m_neuralLM->lookup_word(string);
-    words[i] = neuralLM_wordID;
+    words[i] = GetId(*contextFactor[i]);
   }
   // Generate hashCode for only the last n-1 words, that represents the next LM
   // state
@@ -71,11 +114,13 @@ LMResult NeuralLMWrapper::GetValue(const vector<const Word*> &contextFactor, Sta
     boost::hash_combine(hashCode, words[i]);
   }
 
-  double value = m_neuralLM->lookup_ngram(words);
+  NPLMBatch<nplm::neuralLM> batch(m_nGramOrder, m_cache.get());
+  batch.Add(words, m_start, m_null);
+  batch.Score(GetThreadLM());
 
   // Create a new struct to hold the result
   LMResult ret;
-  ret.score = FloorScore(value);
+  ret.score = FloorScore(batch.Get(0));
   ret.unknown = (words.back() == m_unk);
 
   (*finalState) = (State*) hashCode;
@@ -83,6 +128,174 @@ LMResult NeuralLMWrapper::GetValue(const vector<const Word*> &contextFactor, Sta
   return ret;
 }
 
+
+// Same as LanguageModelImplementation::CalcScore, but the n-grams of the
+// phrase are scored as one batch
+void NeuralLMWrapper::CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const
+{
+  fullScore  = 0;
+  ngramScore = 0;
+
+  oovCount = 0;
+
+  size_t phraseSize = phrase.GetSize();
+  if (!phraseSize) return;
+
+  NPLMBatch<nplm::neuralLM> batch(m_nGramOrder, m_cache.get());
+  vector<bool> isFullNGram;
+  vector<int> context;
+  context.reserve(m_nGramOrder);
+
+  for (size_t currPos = 0; currPos < phraseSize; ++currPos) {
+    const Word &word = phrase.GetWord(currPos);
+
+    if (word.IsNonTerminal()) {
+      // reset ngram. needed to score target phrases during pt loading in chart decoding
+      context.clear();
+      continue;
+    }
+
+    if (context.size() == m_nGramOrder) {
+      context.erase(context.begin());
+    }
+    context.push_back(GetId(word));
+
+    if (word == GetSentenceStartWord()) {
+      // do nothing, don't include prob for <s> unigram
+      if (currPos != 0) {
+        UTIL_THROW2("Either your data contains <s> in a position other than the first word or your language model is missing <s>.  Did you build your ARPA using IRSTLM and forget to run add-start-end.sh?");
+      }
+      continue;
+    }
+
+    batch.Add(context, m_start, m_null);
+    isFullNGram.push_back(context.size() == m_nGramOrder);
+    if (context.back() == m_unk) ++oovCount;
+  }
+
+  if (!batch.Size()) return;
+  batch.Score(GetThreadLM());
+
+  for (size_t i = 0; i < batch.Size(); ++i) {
+    float score = FloorScore(batch.Get(i));
+    fullScore += score;
+    if (isFullNGram[i]) ngramScore += score;
+  }
 }
 
 
+// Queues the n-grams that appending phrase to prevHypo adds to the score:
+// those that end in the first n-1 words of phrase, and the one of </s> if the
+// source is completed. The others are within phrase and are scored with it,
+// in CalcScore. Returns the hash of the new state.
+size_t NeuralLMWrapper::AddNGrams(const Hypothesis *prevHypo, const Phrase &phrase,
+                                  bool isSourceCompleted,
+                                  NPLMBatch<nplm::neuralLM> &batch) const
+{
+  const size_t startPos = prevHypo ? prevHypo->GetSize() : 0;
+  const size_t currEndPos = startPos + phrase.GetSize() - 1;
+
+  // ids from n-1 words before the phrase up to its end; the n-gram ending
+  // at position pos starts at ids[pos - startPos]
+  vector<int> ids;
+  ids.reserve(m_nGramOrder + currEndPos - startPos);
+  for (int currPos = (int) startPos - (int) m_nGramOrder + 1 ; currPos <= (int) currEndPos ; currPos++) {
+    if (currPos < 0) {
+      ids.push_back(GetId(GetSentenceStartWord()));
+    } else if ((size_t) currPos < startPos) {
+      ids.push_back(GetId(prevHypo->GetWord(currPos)));
+    } else {
+      ids.push_back(GetId(phrase.GetWord(currPos - startPos)));
+    }
+  }
+
+  size_t endPos = std::min(startPos + m_nGramOrder - 2
+                           , currEndPos);
+  for (size_t currPos = startPos ; currPos <= endPos ; currPos++) {
+    batch.Add(&ids[currPos - startPos]);
+  }
+
+  // state is the n-1 words at the end of the hypothesis, with </s> if complete
+  if (isSourceCompleted) {
+    vector<int> last(ids.end() - (m_nGramOrder - 1), ids.end());
+    last.push_back(GetId(GetSentenceEndWord()));
+    batch.Add(&last[0]);
+    return GetStateHash(&last[0]);
+  }
+  return GetStateHash(&ids[ids.size() - m_nGramOrder]);
+}
+
+
+// Same n-grams and state as LanguageModelImplementation::EvaluateWhenApplied,
+// which asks for one n-gram at a time
+FFState *NeuralLMWrapper::EvaluateWhenApplied(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const
+{
+  if(GetNGramOrder() <= 1)
+    return NULL;
+
+  // Empty phrase added? nothing to be done
+  if (hypo.GetCurrTargetLength() == 0)
+    return ps ? NewState(ps) : NULL;
+
+  IFVERBOSE(2) {
+    hypo.GetManager().GetSentenceStats().StartTimeCalcLM();
+  }
+
+  NPLMBatch<nplm::neuralLM> batch(m_nGramOrder, m_cache.get());
+  size_t hashCode = AddNGrams(hypo.GetPrevHypo(), hypo.GetCurrTargetPhrase(),
+                              hypo.IsSourceCompleted(), batch);
+
+  batch.Score(GetThreadLM());
+  float lmScore = 0;
+  for (size_t i = 0; i < batch.Size(); ++i) {
+    lmScore += FloorScore(batch.Get(i));
+  }
+
+  FFState *res = NewState(ps);
+  static_cast<PointerState*>(res)->lmstate = (State) hashCode;
+
+  if (OOVFeatureEnabled()) {
+    vector<float> scores(2);
+    scores[0] = lmScore;
+    scores[1] = 0;
+    out->PlusEquals(this, scores);
+  } else {
+    out->PlusEquals(this, lmScore);
+  }
+
+  IFVERBOSE(2) {
+    hypo.GetManager().GetSentenceStats().StopTimeCalcLM();
+  }
+  return res;
+}
+
+
+// Scores the n-grams of all the expansions of a stack in one batch, and so
+// puts them in the cache, where EvaluateWhenApplied finds them
+void NeuralLMWrapper::EvaluateWhenAppliedBatch(const std::vector<HypothesisExpansion> &expansions) const
+{
+  if(GetNGramOrder() <= 1)
+    return;
+
+  NPLMBatch<nplm::neuralLM> batch(m_nGramOrder, m_cache.get());
+  for (size_t i = 0; i < expansions.size(); ++i) {
+    const Hypothesis &prevHypo = *expansions[i].first;
+    const TranslationOption &transOpt = *expansions[i].second;
+    const TargetPhrase &phrase = transOpt.GetTargetPhrase();
+    if (phrase.GetSize() == 0) continue;
+
+    const Bitmap &bitmap = prevHypo.GetWordsBitmap();
+    bool isSourceCompleted
+      = bitmap.GetNumWordsCovered() + transOpt.GetSize() == bitmap.GetSize();
+    AddNGrams(&prevHypo, phrase, isSourceCompleted, batch);
+  }
+
+  if (batch.Size()) {
+    batch.Score(GetThreadLM());
+  }
+}
+
+}
+
+
+
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "SingleFactor.h"
+#include "NGramCache.h"
 
+#include <boost/scoped_ptr.hpp>
 #include <boost/thread/tss.hpp>
 
 namespace nplm
@@ -12,14 +14,31 @@ class neuralLM;
 namespace Moses
 {
 
+template <class Model> class NPLMBatch;
+
 class NeuralLMWrapper : public LanguageModelSingleFactor
 {
 protected:
-  // big data (vocab, weights, cache) shared among threads
+  // big data (vocab, weights) shared among threads
   nplm::neuralLM *m_neuralLM_shared;
   // thread-specific nplm for thread-safety
   mutable boost::thread_specific_ptr<nplm::neuralLM> m_neuralLM;
   int m_unk;
+  int m_start, m_null;
+
+  // nplm id of each factor in the model's vocabulary, indexed by Factor::GetId()
+  std::vector<int> m_factor2id;
+
+  // scores shared among threads
+  size_t m_cacheSize;
+  boost::scoped_ptr<NGramCache> m_cache;
+
+  nplm::neuralLM &GetThreadLM() const;
+  int GetId(const Word &word) const;
+  size_t GetStateHash(const int *ngram) const;
+  size_t AddNGrams(const Hypothesis *prevHypo, const Phrase &phrase,
+                   bool isSourceCompleted,
+                   NPLMBatch<nplm::neuralLM> &batch) const;
 
 public:
   NeuralLMWrapper(const std::string &line);
@@ -27,6 +46,25 @@ public:
 
   virtual LMResult GetValue(const std::vector<const Word*> &contextFactor, State* finalState = 0) const;
 
+  virtual void CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const;
+
+  virtual FFState *EvaluateWhenApplied(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const;
+  using LanguageModelSingleFactor::EvaluateWhenApplied;
+
+  virtual void EvaluateWhenAppliedBatch(const std::vector<HypothesisExpansion> &expansions) const;
+
+  // the batch only fills the cache
+  virtual bool UsesWhenAppliedBatch() const {
+    return m_cacheSize > 0;
+  }
+
+  virtual void SetParameter(const std::string& key, const std::string& value);
+
+  // one nplm model per thread
+  virtual bool CanEvaluateInWorkerThreads() const {
+    return false;
+  }
+
   virtual void Load(AllOptions::ptr const& opts);
 
 };
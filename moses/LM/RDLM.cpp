@@ -6,6 +6,7 @@
 #include "moses/InputFileStream.h"
 #include "moses/Util.h"
 #include "util/exception.hh"
+#include "NPLMBatch.h"
 #include "neuralTM.h"
 
 namespace Moses
@@ -13,25 +14,58 @@ namespace Moses
 
 namespace rdlm
 {
-ThreadLocal::ThreadLocal(nplm::neuralTM *lm_head_base_instance_, nplm::neuralTM *lm_label_base_instance_, bool normalizeHeadLM, bool normalizeLabelLM, int cacheSize)
+ThreadLocal::ThreadLocal(nplm::neuralTM *lm_head_base_instance_, nplm::neuralTM *lm_label_base_instance_, bool normalizeHeadLM, bool normalizeLabelLM, NGramCache *head_cache, NGramCache *label_cache)
 {
   lm_head = new nplm::neuralTM(*lm_head_base_instance_);
   lm_label = new nplm::neuralTM(*lm_label_base_instance_);
   lm_head->set_normalization(normalizeHeadLM);
   lm_label->set_normalization(normalizeLabelLM);
-  lm_head->set_cache(cacheSize);
-  lm_label->set_cache(cacheSize);
+  head_batch = new NPLMBatch<nplm::neuralTM>(head_cache->GetOrder(), head_cache);
+  label_batch = new NPLMBatch<nplm::neuralTM>(label_cache->GetOrder(), label_cache);
 }
 
 ThreadLocal::~ThreadLocal()
 {
   delete lm_head;
   delete lm_label;
+  delete head_batch;
+  delete label_batch;
+}
+
+void ThreadLocal::QueueHead(const std::vector<int> &ngram, size_t slot)
+{
+  head_batch->Add(&ngram[0]);
+  head_slots.push_back(slot);
+}
+
+void ThreadLocal::QueueLabel(const std::vector<int> &ngram, size_t slot)
+{
+  label_batch->Add(&ngram[0]);
+  label_slots.push_back(slot);
+}
+
+void ThreadLocal::ScoreQueued(boost::array<float, 4> &score)
+{
+  if (head_batch->Size()) {
+    head_batch->Score(*lm_head);
+    for (size_t i = 0; i < head_slots.size(); ++i) {
+      score[head_slots[i]] += FloorScore(head_batch->Get(i));
+    }
+  }
+  if (label_batch->Size()) {
+    label_batch->Score(*lm_label);
+    for (size_t i = 0; i < label_slots.size(); ++i) {
+      score[label_slots[i]] += FloorScore(label_batch->Get(i));
+    }
+  }
+  head_batch->Clear();
+  label_batch->Clear();
+  head_slots.clear();
+  label_slots.clear();
 }
 
 }
 
-typedef Eigen::Map<Eigen::Matrix<int,Eigen::Dynamic,1> > EigenMap;
 
 RDLM::~RDLM()
 {
@@ -56,9 +90,6 @@ void RDLM::Load(AllOptions::ptr const& opts)
     lm_label_base_instance_->premultiply();
   }
 
-  lm_head_base_instance_->set_cache(m_cacheSize);
-  lm_label_base_instance_->set_cache(m_cacheSize);
-
   StaticData &staticData = StaticData::InstanceNonConst();
   if (staticData.GetTreeStructure() == NULL) {
     staticData.SetTreeStructure(this);
@@ -70,6 +101,9 @@ void RDLM::Load(AllOptions::ptr const& opts)
   size_head = 2*m_context_left + 2*m_context_right + 2*m_context_up + 2;
   size_label = 2*m_context_left + 2*m_context_right + 2*m_context_up + 1;
 
+  m_headCache.reset(new NGramCache(size_head, std::max(m_cacheSize, 0)));
+  m_labelCache.reset(new NGramCache(size_label, std::max(m_cacheSize, 0)));
+
   UTIL_THROW_IF2(size_head != lm_head_base_instance_->get_order(),
                  "Error: order of head LM (" << lm_head_base_instance_->get_order() << ") does not match context size specified (left_context=" << m_context_left << " , right_context=" << m_context_right << " , up_context=" << m_context_up << " for a total order of " << size_head);
   UTIL_THROW_IF2(size_label != lm_label_base_instance_->get_order(),
@@ -121,7 +155,7 @@ void RDLM::Load(AllOptions::ptr const& opts)
 //
 //     rdlm::ThreadLocal *thread_objects = thread_objects_backend_.get();
 //     if (!thread_objects) {
-//       thread_objects = new rdlm::ThreadLocal(lm_head_base_instance_, lm_label_base_instance_, m_normalizeHeadLM, m_normalizeLabelLM, m_cacheSize);
+//       thread_objects = new rdlm::ThreadLocal(lm_head_base_instance_, lm_label_base_instance_, m_normalizeHeadLM, m_normalizeLabelLM, m_headCache.get(), m_labelCache.get());
 //       thread_objects_backend_.reset(thread_objects);
 //     }
 //
@@ -179,7 +213,7 @@ void RDLM::Load(AllOptions::ptr const& opts)
 //
 //    rdlm::ThreadLocal *thread_objects = thread_objects_backend_.get();
 //     if (!thread_objects) {
-//       thread_objects = new rdlm::ThreadLocal(lm_head_base_instance_, lm_label_base_instance_, m_normalizeHeadLM, m_normalizeLabelLM, m_cacheSize);
+//       thread_objects = new rdlm::ThreadLocal(lm_head_base_instance_, lm_label_base_instance_, m_normalizeHeadLM, m_normalizeLabelLM, m_headCache.get(), m_labelCache.get());
 //       thread_objects_backend_.reset(thread_objects);
 //     }
 //
@@ -297,10 +331,10 @@ void RDLM::Score(InternalTree* root, const TreePointerMap & back_pointers, boost
         it = std::copy(ancestor_labels.end()-context_up_nonempty, ancestor_labels.end(), it);
       }
       if (ancestor_labels.size() >= m_context_up && !num_virtual) {
-        score[0] += FloorScore(thread_objects.lm_head->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+        thread_objects.QueueHead(ngram, 0);
       } else {
         boost::hash_combine(boundary_hash, ngram.back());
-        score[1] += FloorScore(thread_objects.lm_head->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+        thread_objects.QueueHead(ngram, 1);
       }
     }
     return;
@@ -366,19 +400,19 @@ void RDLM::Score(InternalTree* root, const TreePointerMap & back_pointers, boost
       it += m_context_right;
       it = std::copy(ancestor_heads.end()-context_up_nonempty, ancestor_heads.end(), it);
       it = std::copy(ancestor_labels.end()-context_up_nonempty, ancestor_labels.end(), it);
-      score[2] += FloorScore(thread_objects.lm_label->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+      thread_objects.QueueLabel(ngram, 2);
     } else {
       boost::hash_combine(boundary_hash, ngram.back());
-      score[3] += FloorScore(thread_objects.lm_label->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+      thread_objects.QueueLabel(ngram, 3);
     }
     if (head_idx != static_dummy_head && head_idx != static_head_head) {
       ngram.push_back(head_ids.second);
       *(ngram.end()-2) = label_idx;
       if (ancestor_heads.size() == m_context_up && ancestor_heads.back() == static_root_head && !num_virtual) {
-        score[0] += FloorScore(thread_objects.lm_head->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+        thread_objects.QueueHead(ngram, 0);
       } else {
         boost::hash_combine(boundary_hash, ngram.back());
-        score[1] += FloorScore(thread_objects.lm_head->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+        thread_objects.QueueHead(ngram, 1);
       }
     }
   }
@@ -493,10 +527,10 @@ void RDLM::Score(InternalTree* root, const TreePointerMap & back_pointers, boost
     ngram.back() = labels_output[i];
 
     if (ancestor_labels.size() >= m_context_up && !num_virtual) {
-      score[2] += FloorScore(thread_objects.lm_label->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+      thread_objects.QueueLabel(ngram, 2);
     } else {
       boost::hash_combine(boundary_hash, ngram.back());
-      score[3] += FloorScore(thread_objects.lm_label->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+      thread_objects.QueueLabel(ngram, 3);
     }
 
     // construct context of head model and predict head
@@ -506,10 +540,10 @@ void RDLM::Score(InternalTree* root, const TreePointerMap & back_pointers, boost
       ngram.push_back(heads_output[i]);
 
       if (ancestor_labels.size() >= m_context_up && !num_virtual) {
-        score[0] += FloorScore(thread_objects.lm_head->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+        thread_objects.QueueHead(ngram, 0);
       } else {
         boost::hash_combine(boundary_hash, ngram.back());
-        score[1] += FloorScore(thread_objects.lm_head->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+        thread_objects.QueueHead(ngram, 1);
       }
       ngram.pop_back();
     }
@@ -752,7 +786,7 @@ void RDLM::ScoreFile(std::string &path)
   InputFileStream inStream(path);
   rdlm::ThreadLocal *thread_objects = thread_objects_backend_.get();
   if (!thread_objects) {
-    thread_objects = new rdlm::ThreadLocal(lm_head_base_instance_, lm_label_base_instance_, m_normalizeHeadLM, m_normalizeLabelLM, m_cacheSize);
+    thread_objects = new rdlm::ThreadLocal(lm_head_base_instance_, lm_label_base_instance_, m_normalizeHeadLM, m_normalizeLabelLM, m_headCache.get(), m_labelCache.get());
     thread_objects_backend_.reset(thread_objects);
   }
   std::string line, null;
@@ -771,6 +805,7 @@ void RDLM::ScoreFile(std::string &path)
     InternalTree* mytree (new InternalTree(line));
     size_t boundary_hash = 0;
     Score(mytree, back_pointers, score, boundary_hash, *thread_objects);
+    thread_objects->ScoreQueued(score);
     std::cerr << "head LM: " << score[0] << "label LM: " << score[2] << std::endl;
   }
 #ifdef WITH_THREADS
@@ -868,7 +903,7 @@ FFState* RDLM::EvaluateWhenApplied(const ChartHypothesis& cur_hypo
 #endif
       rdlm::ThreadLocal *thread_objects = thread_objects_backend_.get();
       if (!thread_objects) {
-        thread_objects = new rdlm::ThreadLocal(lm_head_base_instance_, lm_label_base_instance_, m_normalizeHeadLM, m_normalizeLabelLM, m_cacheSize);
+        thread_objects = new rdlm::ThreadLocal(lm_head_base_instance_, lm_label_base_instance_, m_normalizeHeadLM, m_normalizeLabelLM, m_headCache.get(), m_labelCache.get());
         thread_objects_backend_.reset(thread_objects);
       }
       thread_objects->ancestor_heads.resize(0);
@@ -876,6 +911,7 @@ FFState* RDLM::EvaluateWhenApplied(const ChartHypothesis& cur_hypo
       thread_objects->ancestor_heads.resize((full_sentence ? m_context_up : 0), static_root_head);
       thread_objects->ancestor_labels.resize((full_sentence ? m_context_up : 0), static_root_label);
       Score(mytree.get(), back_pointers, score, boundary_hash, *thread_objects);
+      thread_objects->ScoreQueued(score);
 #ifdef WITH_THREADS
       m_accessLock.unlock_shared();
 #endif
@@ -890,7 +926,7 @@ FFState* RDLM::EvaluateWhenApplied(const ChartHypothesis& cur_hypo
 #endif
       rdlm::ThreadLocal *thread_objects = thread_objects_backend_.get();
       if (!thread_objects) {
-        thread_objects = new rdlm::ThreadLocal(lm_head_base_instance_, lm_label_base_instance_, m_normalizeHeadLM, m_normalizeLabelLM, m_cacheSize);
+        thread_objects = new rdlm::ThreadLocal(lm_head_base_instance_, lm_label_base_instance_, m_normalizeHeadLM, m_normalizeLabelLM, m_headCache.get(), m_labelCache.get());
         thread_objects_backend_.reset(thread_objects);
       }
       thread_objects->ancestor_heads.resize(0);
@@ -898,6 +934,7 @@ FFState* RDLM::EvaluateWhenApplied(const ChartHypothesis& cur_hypo
       thread_objects->ancestor_heads.resize((full_sentence ? m_context_up : 0), static_root_head);
       thread_objects->ancestor_labels.resize((full_sentence ? m_context_up : 0), static_root_label);
       Score(mytree.get(), back_pointers, score, boundary_hash, *thread_objects);
+      thread_objects->ScoreQueued(score);
 #ifdef WITH_THREADS
       m_accessLock.unlock_shared();
 #endif
@@ -4,9 +4,11 @@
 #include "moses/FF/FFState.h"
 #include "moses/FF/InternalTree.h"
 #include "moses/Word.h"
+#include "NGramCache.h"
 
 #include <boost/thread/tss.hpp>
 #include <boost/array.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #ifdef WITH_THREADS
 #include <boost/thread/shared_mutex.hpp>
@@ -25,6 +27,8 @@ class neuralTM;
 namespace Moses
 {
 
+template <class Model> class NPLMBatch;
+
 namespace rdlm
 {
 
@@ -45,8 +49,19 @@ public:
   nplm::neuralTM* lm_head;
   nplm::neuralTM* lm_label;
 
-  ThreadLocal(nplm::neuralTM *lm_head_base_instance_, nplm::neuralTM *lm_label_base_instance_, bool normalizeHeadLM, bool normalizeLabelLM, int cacheSize);
+  // n-grams of the tree being scored and the index in the score array they add to
+  NPLMBatch<nplm::neuralTM>* head_batch;
+  NPLMBatch<nplm::neuralTM>* label_batch;
+  std::vector<size_t> head_slots;
+  std::vector<size_t> label_slots;
+
+  ThreadLocal(nplm::neuralTM *lm_head_base_instance_, nplm::neuralTM *lm_label_base_instance_, bool normalizeHeadLM, bool normalizeLabelLM, NGramCache *head_cache, NGramCache *label_cache);
   ~ThreadLocal();
+
+  void QueueHead(const std::vector<int> &ngram, size_t slot);
+  void QueueLabel(const std::vector<int> &ngram, size_t slot);
+  // score the queued n-grams in one batch per model and add them to score
+  void ScoreQueued(boost::array<float, 4> &score);
 };
 }
 
@@ -111,6 +126,9 @@ class RDLM : public StatefulFeatureFunction
   std::string m_debugPath; // score all trees in the provided file, then exit
   int m_binarized;
   int m_cacheSize;
+  // scores shared among threads
+  boost::scoped_ptr<NGramCache> m_headCache;
+  boost::scoped_ptr<NGramCache> m_labelCache;
 
   size_t offset_up_head;
   size_t offset_up_label;
@@ -195,6 +213,11 @@ public:
     return true;
   }
 
+  // the models and n-gram queues are thread_objects_backend_
+  bool CanEvaluateInWorkerThreads() const {
+    return false;
+  }
+
   void SetParameter(const std::string& key, const std::string& value);
 
   FFState* EvaluateWhenApplied(
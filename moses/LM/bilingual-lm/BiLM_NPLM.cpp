@@ -1,4 +1,5 @@
 #include "BiLM_NPLM.h"
+#include "moses/LM/NPLMBatch.h"
 #include "neuralLM.h"
 #include "vocabulary.h"
 
@@ -18,11 +19,52 @@ BilingualLM_NPLM::BilingualLM_NPLM(const std::string &line)
   NULL_word.SetFactor(0, NULL_factor);
 }
 
+namespace
+{
+int LookupId(const std::vector<int> &neuralLMids, const Factor *factor)
+{
+  if (!factor || factor->GetId() >= neuralLMids.size()) {
+    return -1;
+  }
+  return neuralLMids[factor->GetId()];
+}
+
+void InsertId(std::vector<int> &neuralLMids, const Factor *factor, int id)
+{
+  if (factor->GetId() >= neuralLMids.size()) {
+    neuralLMids.resize(factor->GetId() + 1, -1);
+  }
+  // the first occurrence in the vocab file wins
+  if (neuralLMids[factor->GetId()] == -1) {
+    neuralLMids[factor->GetId()] = id;
+  }
+}
+}
+
 float BilingualLM_NPLM::Score(std::vector<int>& source_words, std::vector<int>& target_words) const
 {
   source_words.reserve(source_ngrams+target_ngrams+1);
   source_words.insert( source_words.end(), target_words.begin(), target_words.end() );
-  return FloorScore(m_neuralLM->lookup_ngram(source_words));
+  return ScoreBatch(source_words);
+}
+
+float BilingualLM_NPLM::ScoreBatch(std::vector<int>& ngrams) const
+{
+  initSharedPointer();
+
+  const size_t width = source_ngrams + target_ngrams + 1;
+  NPLMBatch<nplm::neuralLM> batch(width, m_cache.get());
+  for (size_t i = 0; i < ngrams.size(); i += width) {
+    batch.Add(&ngrams[i]);
+  }
+  if (!batch.Size()) return 0;
+  batch.Score(*m_neuralLM);
+
+  float value = 0;
+  for (size_t i = 0; i < batch.Size(); ++i) {
+    value += FloorScore(batch.Get(i));
+  }
+  return value;
 }
 
 const Word& BilingualLM_NPLM::getNullWord() const
@@ -32,10 +74,8 @@ const Word& BilingualLM_NPLM::getNullWord() const
 
 int BilingualLM_NPLM::getNeuralLMId(const Word& word, bool is_source_word) const
 {
-  initSharedPointer();
-
   //Decide if we are doing source or target side first.
-  boost::unordered_map<const Factor*, int> * neuralLMids;
+  const std::vector<int> * neuralLMids;
   int unknown_word_id;
   if (is_source_word) {
     neuralLMids = &source_neuralLMids;
@@ -45,23 +85,19 @@ int BilingualLM_NPLM::getNeuralLMId(const Word& word, bool is_source_word) const
     unknown_word_id = target_unknown_word_id;
   }
 
-  boost::unordered_map<const Factor*, int>::iterator it;
-  const Factor* factor = word.GetFactor(word_factortype);
-
-  it = neuralLMids->find(factor);
+  int id = LookupId(*neuralLMids, word.GetFactor(word_factortype));
   //If we know the word return immediately
-  if (it != neuralLMids->end()) {
-    return it->second;
+  if (id != -1) {
+    return id;
   }
   //If we don't know the word and we aren't factored, return the word.
   if (!factored) {
     return unknown_word_id;
   }
   //Else try to get a pos_factor
-  const Factor* pos_factor = word.GetFactor(pos_factortype);
-  it = neuralLMids->find(pos_factor);
-  if (it != neuralLMids->end()) {
-    return it->second;
+  id = LookupId(*neuralLMids, word.GetFactor(pos_factortype));
+  if (id != -1) {
+    return id;
   } else {
     return unknown_word_id;
   }
@@ -115,7 +151,7 @@ void BilingualLM_NPLM::loadModel()
     "Wrong order of neuralLM: LM has " << m_neuralLM_shared->get_order() <<
     ", but Moses expects " << ngram_order);
 
-  m_neuralLM_shared->set_cache(neuralLM_cache); //Default 1000000
+  m_cache.reset(new NGramCache(ngram_order, neuralLM_cache)); //Default 1000000
 
   //Setup factor -> NeuralLMId cache. First target words
   FactorCollection& factorFactory = FactorCollection::Instance(); //To do the conversion from string to vocabID
@@ -125,7 +161,7 @@ void BilingualLM_NPLM::loadModel()
   std::ifstream infile_target(target_vocab_path.c_str());
   while (infile_target >> raw_word) {
     const Factor * factor = factorFactory.AddFactor(raw_word);
-    target_neuralLMids.insert(std::make_pair(factor, wordid_counter));
+    InsertId(target_neuralLMids, factor, wordid_counter);
     wordid_counter++;
   }
   infile_target.close();
@@ -135,7 +171,7 @@ void BilingualLM_NPLM::loadModel()
   std::ifstream infile_source(source_vocab_path.c_str());
   while (infile_source >> raw_word) {
     const Factor * factor = factorFactory.AddFactor(raw_word);
-    source_neuralLMids.insert(std::make_pair(factor, wordid_counter));
+    InsertId(source_neuralLMids, factor, wordid_counter);
     wordid_counter++;
   }
   infile_source.close();
@@ -1,5 +1,6 @@
 #include "moses/LM/BilingualLM.h"
-#include <boost/unordered_map.hpp>
+#include "moses/LM/NGramCache.h"
+#include <boost/scoped_ptr.hpp>
 #include <utility> //make_pair
 #include <fstream> //Read vocabulary files
 
@@ -19,6 +20,12 @@ public:
 private:
   float Score(std::vector<int>& source_words, std::vector<int>& target_words) const;
 
+  float ScoreBatch(std::vector<int>& ngrams) const;
+
+  bool CachesScores() const {
+    return neuralLM_cache > 0;
+  }
+
   int getNeuralLMId(const Word& word, bool is_source_word) const;
 
   void initSharedPointer() const;
@@ -32,8 +39,12 @@ private:
   nplm::neuralLM *m_neuralLM_shared;
   mutable boost::thread_specific_ptr<nplm::neuralLM> m_neuralLM;
 
-  mutable boost::unordered_map<const Factor*, int> target_neuralLMids;
-  mutable boost::unordered_map<const Factor*, int> source_neuralLMids;
+  //NeuralLM ids indexed by Factor::GetId(), -1 if the word isn't in the vocab
+  std::vector<int> target_neuralLMids;
+  std::vector<int> source_neuralLMids;
+
+  //Scores shared among threads
+  boost::scoped_ptr<NGramCache> m_cache;
 
   //const Factor* NULL_factor_overwrite;
   std::string NULL_string;
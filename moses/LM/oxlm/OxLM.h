@@ -34,6 +34,11 @@ public:
 
   virtual void CleanUpAfterSentenceProcessing(const InputType& source);
 
+  // the query cache is per thread and per sentence
+  bool CanEvaluateInWorkerThreads() const {
+    return false;
+  }
+
 private:
   double GetScore(int word, const vector<int>& context) const;
 
@@ -9,15 +9,18 @@
 
 #include "LatticeMBR.h"
 #include "moses/StaticData.h"
+#include "moses/ParallelSpans.h"
 #include <algorithm>
+#include <cmath>
 #include <set>
+#include <boost/bind.hpp>
+#include <boost/unordered_set.hpp>
 
 using namespace std;
 
 namespace Moses
 {
 
-size_t bleu_order = 4;
 float UNKNGRAMLOGPROB = -20;
 void GetOutputWords(const TrellisPath &path, vector <Word> &translation)
 {
@@ -35,45 +38,32 @@ void GetOutputWords(const TrellisPath &path, vector <Word> &translation)
 }
 
 
-void extract_ngrams(const vector<Word >& sentence, map < Phrase, int >  & allngrams)
+
+void extract_ngrams(const vector<Word >& sentence, const LatticeVocab& vocab, boost::unordered_map<LatticeNgram, int>& allngrams)
 {
-  for (int k = 0; k < (int)bleu_order; k++) {
-    for(int i =0; i < max((int)sentence.size()-k,0); i++) {
-      Phrase ngram( k+1);
-      for ( int j = i; j<= i+k; j++) {
-        ngram.AddWord(sentence[j]);
+  vector<uint32_t> ids(sentence.size());
+  for (size_t i = 0; i < sentence.size(); ++i) {
+    ids[i] = vocab.Find(sentence[i]);
+  }
+  for (size_t k = 0; k < kLatticeNgramOrder; k++) {
+    for (size_t i = 0; i + k < ids.size(); i++) {
+      LatticeNgram ngram;
+      for (size_t j = 0; j <= k; j++) {
+        ngram.words[j] = ids[i + j];
       }
       ++allngrams[ngram];
     }
   }
 }
 
-
-
-void NgramScores::addScore(const Hypothesis* node, const Phrase& ngram, float score)
+uint32_t LatticeVocab::Insert(const Word &word)
 {
-  set<Phrase>::const_iterator ngramIter = m_ngrams.find(ngram);
-  if (ngramIter == m_ngrams.end()) {
-    ngramIter = m_ngrams.insert(ngram).first;
-  }
-  map<const Phrase*,float>& ngramScores = m_scores[node];
-  map<const Phrase*,float>::iterator scoreIter = ngramScores.find(&(*ngramIter));
-  if (scoreIter == ngramScores.end()) {
-    ngramScores[&(*ngramIter)] = score;
-  } else {
-    ngramScores[&(*ngramIter)] = log_sum(score,scoreIter->second);
+  pair<boost::unordered_map<Word, uint32_t>::iterator, bool> ret
+    = m_ids.insert(make_pair(word, (uint32_t) m_words.size() + 1));
+  if (ret.second) {
+    m_words.push_back(word);
   }
-}
-
-NgramScores::NodeScoreIterator NgramScores::nodeBegin(const Hypothesis* node)
-{
-  return m_scores[node].begin();
-}
-
-
-NgramScores::NodeScoreIterator NgramScores::nodeEnd(const Hypothesis* node)
-{
-  return m_scores[node].end();
+  return ret.first->second;
 }
 
 LatticeMBRSolution::LatticeMBRSolution(const TrellisPath& path, bool isMap) :
@@ -97,20 +87,21 @@ LatticeMBRSolution::LatticeMBRSolution(const TrellisPath& path, bool isMap) :
 }
 
 
-void LatticeMBRSolution::CalcScore(map<Phrase, float>& finalNgramScores, const vector<float>& thetas, float mapWeight)
+
+void LatticeMBRSolution::CalcScore(const LatticeVocab& vocab, const LatticeNgramScores& finalNgramScores, const vector<float>& thetas, float mapWeight)
 {
   m_ngramScores.assign(thetas.size()-1, -10000);
 
-  map < Phrase, int > counts;
-  extract_ngrams(m_words,counts);
+  boost::unordered_map<LatticeNgram, int> counts;
+  extract_ngrams(m_words, vocab, counts);
 
   //Now score this translation
   m_score = thetas[0] * m_words.size();
 
   //Calculate the ngramScores, working in log space at first
-  for (map < Phrase, int >::iterator ngrams = counts.begin(); ngrams != counts.end(); ++ngrams) {
+  for (boost::unordered_map<LatticeNgram, int>::const_iterator ngrams = counts.begin(); ngrams != counts.end(); ++ngrams) {
     float ngramPosterior = UNKNGRAMLOGPROB;
-    map<Phrase,float>::const_iterator ngramPosteriorIt = finalNgramScores.find(ngrams->first);
+    LatticeNgramScores::const_iterator ngramPosteriorIt = finalNgramScores.find(ngrams->first);
     if (ngramPosteriorIt != finalNgramScores.end()) {
       ngramPosterior = ngramPosteriorIt->second;
     }
@@ -129,10 +120,40 @@ void LatticeMBRSolution::CalcScore(map<Phrase, float>& finalNgramScores, const v
   m_score += m_mapScore*mapWeight;
 }
 
+namespace
+{
+
+struct CompareEstimatedScore {
+  bool operator()(const pair<float, const Hypothesis*> &a, const pair<float, const Hypothesis*> &b) const {
+    return a.first < b.first;
+  }
+};
 
-void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const Hypothesis* > > & outgoingHyps, map<const Hypothesis*, vector<Edge> >& incomingEdges,
-                    const vector< float> & estimatedScores, const Hypothesis* bestHypo, size_t edgeDensity, float scale)
+struct CompareCoverage {
+  bool operator()(const Hypothesis* a, const Hypothesis* b) const {
+    size_t coveredA = a->GetWordsBitmap().GetNumWordsCovered();
+    size_t coveredB = b->GetWordsBitmap().GetNumWordsCovered();
+    return coveredA < coveredB || (coveredA == coveredB && a->GetId() < b->GetId());
+  }
+};
+
+// an edge of the lattice while it is being pruned
+struct PendingEdge {
+  const Hypothesis *tail;
+  float score;
+  const TargetPhrase *phrase;
+};
+
+}
+
+PrunedLattice::PrunedLattice(const Manager& manager, size_t edgeDensity, float scale)
 {
+  std::map < int, bool > connected;
+  std::vector< const Hypothesis *> connectedHyp;
+  std::map < const Hypothesis*, set <const Hypothesis*> > outgoingHyps;
+  vector< float> estimatedScores;
+  manager.GetForwardBackwardSearchGraph(&connected, &connectedHyp, &outgoingHyps, &estimatedScores);
+  const Hypothesis *bestHypo = manager.GetBestHypothesis();
 
   //Need hyp 0 in connectedHyp - Find empty hypothesis
   VERBOSE(2,"Pruning lattice to edge density " << edgeDensity << endl);
@@ -148,27 +169,27 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
       outgoingHyps[emptyHyp].insert(connectedHyp[i]);
   }
 
-  //sort hyps based on estimated scores - do so by copying to multimap
-  multimap<float, const Hypothesis*> sortHypsByVal;
+  //sort hyps based on estimated scores, hyps with the same score stay in the order they were added
+  vector<pair<float, const Hypothesis*> > sortHypsByVal;
+  sortHypsByVal.reserve(estimatedScores.size() + 1);
   for (size_t i =0; i < estimatedScores.size(); ++i) {
-    sortHypsByVal.insert(make_pair(estimatedScores[i], connectedHyp[i]));
+    sortHypsByVal.push_back(make_pair(estimatedScores[i], connectedHyp[i]));
   }
+  stable_sort(sortHypsByVal.begin(), sortHypsByVal.end(), CompareEstimatedScore());
 
-  multimap<float, const Hypothesis*>::const_iterator it = --sortHypsByVal.end();
-  float bestScore = it->first;
+  float bestScore = sortHypsByVal.back().first;
   //store best score as score of hyp 0
-  sortHypsByVal.insert(make_pair(bestScore, emptyHyp));
-
+  sortHypsByVal.push_back(make_pair(bestScore, emptyHyp));
 
   IFVERBOSE(3) {
-    for (multimap<float, const Hypothesis*>::const_iterator it = --sortHypsByVal.end(); it != --sortHypsByVal.begin(); --it) {
+    for (vector<pair<float, const Hypothesis*> >::const_reverse_iterator it = sortHypsByVal.rbegin(); it != sortHypsByVal.rend(); ++it) {
       const Hypothesis* currHyp =  it->second;
       cerr << "Hyp " << currHyp->GetId() << ", estimated score: " << it->first << endl;
     }
   }
 
-
-  set <const Hypothesis*> survivingHyps; //store hyps that make the cut in this
+  boost::unordered_set<const Hypothesis*> survivingHyps; //store hyps that make the cut in this
+  boost::unordered_map<const Hypothesis*, vector<PendingEdge> > incomingEdges;
 
   VERBOSE(2, "BEST HYPO TARGET LENGTH : " << bestHypo->GetSize() << endl)
   size_t numEdgesTotal = edgeDensity * bestHypo->GetSize(); //as per Shankar, aim for (density * target length of MAP solution) arcs
@@ -177,8 +198,8 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
 
   float prevScore = -999999;
 
-  //now iterate over multimap
-  for (multimap<float, const Hypothesis*>::const_iterator it = --sortHypsByVal.end(); it != --sortHypsByVal.begin(); --it) {
+  //now iterate over the hyps, best first
+  for (vector<pair<float, const Hypothesis*> >::const_reverse_iterator it = sortHypsByVal.rbegin(); it != sortHypsByVal.rend(); ++it) {
     float currEstimatedScore = it->first;
     const Hypothesis* currHyp =  it->second;
 
@@ -189,13 +210,14 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
     VERBOSE(3, "Num edges created : "<< numEdgesCreated << ", numEdges wanted " << numEdgesTotal << endl)
     VERBOSE(3, "Considering hyp " << currHyp->GetId() << ", estimated score: " << it->first << endl)
 
-    survivingHyps.insert(currHyp); //CurrHyp made the cut
+    if (survivingHyps.insert(currHyp).second) { //CurrHyp made the cut
+      m_nodes.push_back(currHyp);
+    }
 
     // is its best predecessor already included ?
     if (survivingHyps.find(currHyp->GetPrevHypo()) != survivingHyps.end()) { //yes, then add an edge
-      vector <Edge>& edges = incomingEdges[currHyp];
-      Edge winningEdge(currHyp->GetPrevHypo(),currHyp,scale*(currHyp->GetScore() - currHyp->GetPrevHypo()->GetScore()),currHyp->GetCurrTargetPhrase());
-      edges.push_back(winningEdge);
+      PendingEdge winningEdge = {currHyp->GetPrevHypo(), (float) (scale*(currHyp->GetScore() - currHyp->GetPrevHypo()->GetScore())), &currHyp->GetCurrTargetPhrase()};
+      incomingEdges[currHyp].push_back(winningEdge);
       ++numEdgesCreated;
     }
 
@@ -208,9 +230,8 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
         const Hypothesis* loserPrevHypo = loserHypo->GetPrevHypo();
         if (survivingHyps.find(loserPrevHypo) != survivingHyps.end()) { //found it, add edge
           double arcScore = loserHypo->GetScore() - loserPrevHypo->GetScore();
-          Edge losingEdge(loserPrevHypo, currHyp, arcScore*scale, loserHypo->GetCurrTargetPhrase());
-          vector <Edge>& edges = incomingEdges[currHyp];
-          edges.push_back(losingEdge);
+          PendingEdge losingEdge = {loserPrevHypo, (float) (arcScore*scale), &loserHypo->GetCurrTargetPhrase()};
+          incomingEdges[currHyp].push_back(losingEdge);
           ++numEdgesCreated;
         }
       }
@@ -229,10 +250,8 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
 
         //Curr Hyp can be : a) the best predecessor  of succ b) or an arc attached to succ
         if (succHyp->GetPrevHypo() == currHyp) { //best predecessor
-          vector <Edge>& succEdges = incomingEdges[succHyp];
-          Edge succWinningEdge(currHyp, succHyp, scale*(succHyp->GetScore() - currHyp->GetScore()), succHyp->GetCurrTargetPhrase());
-          succEdges.push_back(succWinningEdge);
-          survivingHyps.insert(succHyp);
+          PendingEdge succWinningEdge = {currHyp, (float) (scale*(succHyp->GetScore() - currHyp->GetScore())), &succHyp->GetCurrTargetPhrase()};
+          incomingEdges[succHyp].push_back(succWinningEdge);
           ++numEdgesCreated;
         }
 
@@ -245,10 +264,9 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
             const Hypothesis *loserHypo = *iterArcList;
             const Hypothesis* loserPrevHypo = loserHypo->GetPrevHypo();
             if (loserPrevHypo == currHyp) { //found it
-              vector <Edge>& succEdges = incomingEdges[succHyp];
               double arcScore = loserHypo->GetScore() - currHyp->GetScore();
-              Edge losingEdge(currHyp, succHyp,scale* arcScore, loserHypo->GetCurrTargetPhrase());
-              succEdges.push_back(losingEdge);
+              PendingEdge losingEdge = {currHyp, (float) (scale* arcScore), &loserHypo->GetCurrTargetPhrase()};
+              incomingEdges[succHyp].push_back(losingEdge);
               ++numEdgesCreated;
             }
           }
@@ -257,269 +275,381 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
     }
   }
 
-  connectedHyp.clear();
-  for (set <const Hypothesis*>::iterator it =  survivingHyps.begin(); it != survivingHyps.end(); ++it) {
-    connectedHyp.push_back(*it);
-  }
-
   VERBOSE(2, "Done! Num edges created : "<< numEdgesCreated << ", numEdges wanted " << numEdgesTotal << endl)
 
+  //the edges go from hyps that cover fewer source words to hyps that cover more
+  sort(m_nodes.begin(), m_nodes.end(), CompareCoverage());
+
   IFVERBOSE(3) {
     cerr << "Surviving hyps: " ;
-    for (set <const Hypothesis*>::iterator it =  survivingHyps.begin(); it != survivingHyps.end(); ++it) {
-      cerr << (*it)->GetId() << " ";
+    for (size_t node = 0; node < m_nodes.size(); ++node) {
+      cerr << m_nodes[node]->GetId() << " ";
     }
     cerr << endl;
   }
 
+  boost::unordered_map<const Hypothesis*, size_t> nodeIndex;
+  for (size_t node = 0; node < m_nodes.size(); ++node) {
+    nodeIndex[m_nodes[node]] = node;
+  }
+
+  m_edgeOffsets.reserve(m_nodes.size() + 1);
+  m_edges.reserve(numEdgesCreated);
+  for (size_t node = 0; node < m_nodes.size(); ++node) {
+    if (node == 0 || m_nodes[node-1]->GetWordsBitmap().GetNumWordsCovered()
+        != m_nodes[node]->GetWordsBitmap().GetNumWordsCovered()) {
+      m_levelOffsets.push_back(node);
+    }
+    m_edgeOffsets.push_back(m_edges.size());
 
+    boost::unordered_map<const Hypothesis*, vector<PendingEdge> >::const_iterator edges = incomingEdges.find(m_nodes[node]);
+    if (edges == incomingEdges.end()) {
+      continue;
+    }
+    for (vector<PendingEdge>::const_iterator pending = edges->second.begin(); pending != edges->second.end(); ++pending) {
+      Edge edge;
+      edge.tail = nodeIndex[pending->tail];
+      edge.score = pending->score;
+      edge.wordsBegin = m_words.size();
+      for (size_t pos = 0; pos < pending->phrase->GetSize(); ++pos) {
+        m_words.push_back(m_vocab.Insert(pending->phrase->GetWord(pos)));
+      }
+      edge.wordsEnd = m_words.size();
+      m_edges.push_back(edge);
+    }
+  }
+  m_edgeOffsets.push_back(m_edges.size());
+  m_levelOffsets.push_back(m_nodes.size());
 }
 
-void calcNgramExpectations(Lattice & connectedHyp, map<const Hypothesis*, vector<Edge> >& incomingEdges,
-                           map<Phrase, float>& finalNgramScores, bool posteriors)
+namespace
 {
 
-  sort(connectedHyp.begin(),connectedHyp.end(),ascendingCoverageCmp); //sort by increasing source word cov
+// A path of edges that an n-gram spans.  Only what its score needs is kept.
+struct NgramPath {
+  size_t firstTail; //< the node the path starts from
+  float score; //< sum of the scores of the edges
+};
 
-  /*cerr << "Lattice:" << endl;
-  for (Lattice::const_iterator i = connectedHyp.begin(); i != connectedHyp.end(); ++i) {
-      const Hypothesis* h = *i;
-      cerr << *h << endl;
-      const vector<Edge>& edges = incomingEdges[h];
-      for (size_t e = 0; e < edges.size(); ++e) {
-          cerr << edges[e];
-      }
-  }*/
+// An n-gram that ends in an edge, the path it spans and how often it occurs on it
+struct NgramHistoryEntry {
+  LatticeNgram ngram;
+  size_t path; //< in EdgeHistory::paths
+  size_t count;
 
-  map<const Hypothesis*, float> forwardScore;
-  forwardScore[connectedHyp[0]] = 0.0f; //forward score of hyp 0 is 1 (or 0 in logprob space)
-  set< const Hypothesis *> finalHyps; //store completed hyps
+  bool operator<(const NgramHistoryEntry &other) const {
+    return ngram < other.ngram || (ngram == other.ngram && path < other.path);
+  }
+};
 
-  NgramScores ngramScores;//ngram scores for each hyp
+struct CompareHistoryNgram {
+  bool operator()(const NgramHistoryEntry &entry, const LatticeNgram &ngram) const {
+    return entry.ngram < ngram;
+  }
+};
+
+// The n-grams that end in an edge: those inside the edge and those that
+// extend the n-grams ending at the end of an edge before it
+struct EdgeHistory {
+  vector<NgramPath> paths; //< the first one is the edge on its own
+  vector<NgramHistoryEntry> ngrams; //< sorted, each (n-gram, path) once
+
+  bool Contains(const LatticeNgram &ngram) const {
+    vector<NgramHistoryEntry>::const_iterator iter
+      = lower_bound(ngrams.begin(), ngrams.end(), ngram, CompareHistoryNgram());
+    return iter != ngrams.end() && iter->ngram == ngram;
+  }
+};
 
-  for (size_t i = 1; i < connectedHyp.size(); ++i) {
-    const Hypothesis* currHyp = connectedHyp[i];
-    if (currHyp->GetWordsBitmap().IsComplete()) {
-      finalHyps.insert(currHyp);
-    }
+// count times a log score of an n-gram
+struct NgramScore {
+  LatticeNgram ngram;
+  float score;
+  size_t count;
 
-    VERBOSE(3, "Processing hyp: " << currHyp->GetId() << ", num words cov= " << currHyp->GetWordsBitmap().GetNumWordsCovered() <<  endl)
+  bool operator<(const NgramScore &other) const {
+    return ngram < other.ngram;
+  }
+};
 
-    vector <Edge> & edges = incomingEdges[currHyp];
-    for (size_t e = 0; e < edges.size(); ++e) {
-      const Edge& edge = edges[e];
-      if (forwardScore.find(currHyp) == forwardScore.end()) {
-        forwardScore[currHyp] = forwardScore[edge.GetTailNode()] + edge.GetScore();
-        VERBOSE(3, "Fwd score["<<currHyp->GetId()<<"] = fwdScore["<<edge.GetTailNode()->GetId() << "] + edge Score: " << edge.GetScore() << endl)
-      } else {
-        forwardScore[currHyp] = log_sum(forwardScore[currHyp], forwardScore[edge.GetTailNode()] + edge.GetScore());
-        VERBOSE(3, "Fwd score["<<currHyp->GetId()<<"] += fwdScore["<<edge.GetTailNode()->GetId() << "] + edge Score: " << edge.GetScore() << endl)
-      }
+// log of the sum of the probabilities [begin, end), which must not be empty
+float LogSumExp(vector<float>::const_iterator begin, vector<float>::const_iterator end)
+{
+  float max = *max_element(begin, end);
+  double sum = 0;
+  for (vector<float>::const_iterator iter = begin; iter != end; ++iter) {
+    sum += exp(*iter - max);
+  }
+  return max + log(sum);
+}
+
+float LogSumExp(vector<NgramScore>::const_iterator begin, vector<NgramScore>::const_iterator end)
+{
+  float max = begin->score;
+  for (vector<NgramScore>::const_iterator iter = begin + 1; iter != end; ++iter) {
+    max = std::max(max, iter->score);
+  }
+  double sum = 0;
+  for (vector<NgramScore>::const_iterator iter = begin; iter != end; ++iter) {
+    sum += iter->count * exp(iter->score - max);
+  }
+  return max + log(sum);
+}
+
+typedef vector<pair<LatticeNgram, float> > NodeNgramScores; //< sorted by n-gram
+
+// the log sum of the scores of each n-gram
+void SumNgramScores(vector<NgramScore> &scores, NodeNgramScores &sums)
+{
+  sort(scores.begin(), scores.end());
+  vector<NgramScore>::const_iterator begin = scores.begin();
+  while (begin != scores.end()) {
+    vector<NgramScore>::const_iterator end = begin + 1;
+    while (end != scores.end() && end->ngram == begin->ngram) {
+      ++end;
     }
+    sums.push_back(make_pair(begin->ngram, LogSumExp(begin, end)));
+    begin = end;
+  }
+}
 
-    //Process ngrams now
-    for (size_t j =0 ; j < edges.size(); ++j) {
-      Edge& edge = edges[j];
-      const NgramHistory & incomingPhrases = edge.GetNgrams(incomingEdges);
+/**
+* Expected counts of the n-grams of a pruned lattice.  The forward scores, the
+* n-gram histories of the incoming edges and the n-gram scores of a node only
+* depend on nodes that cover fewer source words, so the nodes of a level can be
+* processed at the same time.
+*/
+class NgramExpectationCalculator
+{
+public:
+  NgramExpectationCalculator(const PrunedLattice &lattice, bool posteriors)
+    : m_lattice(lattice)
+    , m_posteriors(posteriors)
+    , m_forwardScores(lattice.GetNumNodes(), 0.0f)
+    , m_nodeScores(lattice.GetNumNodes())
+    , m_histories(lattice.GetNumEdges()) {
+  }
 
-      //let's first score ngrams introduced by this edge
-      for (NgramHistory::const_iterator it = incomingPhrases.begin(); it != incomingPhrases.end(); ++it) {
-        const Phrase& ngram = it->first;
-        const PathCounts& pathCounts = it->second;
-        VERBOSE(4, "Calculating score for: " << it->first << endl)
-
-        for (PathCounts::const_iterator pathCountIt = pathCounts.begin(); pathCountIt != pathCounts.end(); ++pathCountIt) {
-          //Score of an n-gram is forward score of head node of leftmost edge + all edge scores
-          const Path&  path = pathCountIt->first;
-          //cerr << "path count for " << ngram << " is " << pathCountIt->second << endl;
-          float score = forwardScore[path[0]->GetTailNode()];
-          for (size_t i = 0; i < path.size(); ++i) {
-            score += path[i]->GetScore();
-          }
-          //if we're doing expectations, then the number of times the ngram
-          //appears on the path is relevant.
-          size_t count = posteriors ? 1 : pathCountIt->second;
-          for (size_t k = 0; k < count; ++k) {
-            ngramScores.addScore(currHyp,ngram,score);
-          }
-        }
-      }
+  void ProcessNodes(size_t begin, size_t end);
 
-      //Now score ngrams that are just being propagated from the history
-      for (NgramScores::NodeScoreIterator it = ngramScores.nodeBegin(edge.GetTailNode());
-           it != ngramScores.nodeEnd(edge.GetTailNode()); ++it) {
-        const Phrase & currNgram = *(it->first);
-        float currNgramScore = it->second;
-        VERBOSE(4, "Calculating score for: " << currNgram << endl)
+  void GetFinalScores(LatticeNgramScores &finalNgramScores) const;
 
-        // For posteriors, don't double count ngrams
-        if (!posteriors || incomingPhrases.find(currNgram) == incomingPhrases.end()) {
-          float score = edge.GetScore() + currNgramScore;
-          ngramScores.addScore(currHyp,currNgram,score);
-        }
-      }
+private:
+  void CalcHistory(size_t edge);
+
+  const PrunedLattice &m_lattice;
+  bool m_posteriors;
+  vector<float> m_forwardScores;
+  vector<NodeNgramScores> m_nodeScores; //< log scores of the n-grams on the paths to each node
+  vector<EdgeHistory> m_histories;
+};
+
+void NgramExpectationCalculator::CalcHistory(size_t edgeIndex)
+{
+  const PrunedLattice::Edge &edge = m_lattice.GetEdge(edgeIndex);
+  EdgeHistory &history = m_histories[edgeIndex];
+  const size_t size = edge.wordsEnd - edge.wordsBegin;
+
+  NgramPath ownPath = {edge.tail, edge.score};
+  history.paths.push_back(ownPath);
 
+  //Extract the n-grams local to this edge
+  for (size_t start = 0; start < size; ++start) {
+    LatticeNgram ngram;
+    for (size_t end = start; end < start + kLatticeNgramOrder && end < size; ++end) {
+      ngram.words[end - start] = m_lattice.GetWord(edge.wordsBegin + end);
+      NgramHistoryEntry entry = {ngram, 0, 1};
+      history.ngrams.push_back(entry);
     }
   }
 
-  float Z = 9999999; //the total score of the lattice
+  //add the ngrams straddling prev and curr edge
+  for (size_t prev = m_lattice.GetEdgesBegin(edge.tail); size > 0 && prev < m_lattice.GetEdgesBegin(edge.tail + 1); ++prev) {
+    const PrunedLattice::Edge &prevEdge = m_lattice.GetEdge(prev);
+    const EdgeHistory &prevHistory = m_histories[prev];
+    const size_t prevSize = prevEdge.wordsEnd - prevEdge.wordsBegin;
 
-  //Done - Print out ngram posteriors for final hyps
-  for (set< const Hypothesis *>::iterator finalHyp = finalHyps.begin(); finalHyp != finalHyps.end(); ++finalHyp) {
-    const Hypothesis* hyp = *finalHyp;
+    //the paths of the previous edge, continued by this one
+    vector<size_t> paths(prevHistory.paths.size(), NOT_FOUND);
 
-    for (NgramScores::NodeScoreIterator it = ngramScores.nodeBegin(hyp); it != ngramScores.nodeEnd(hyp); ++it) {
-      const Phrase& ngram = *(it->first);
-      if (finalNgramScores.find(ngram) == finalNgramScores.end()) {
-        finalNgramScores[ngram] = it->second;
-      } else {
-        finalNgramScores[ngram] = log_sum(it->second,  finalNgramScores[ngram]);
+    for (vector<NgramHistoryEntry>::const_iterator prevEntry = prevHistory.ngrams.begin(); prevEntry != prevHistory.ngrams.end(); ++prevEntry) {
+      const size_t ngramSize = prevEntry->ngram.GetSize();
+      if (ngramSize >= kLatticeNgramOrder) {
+        continue;
       }
-    }
 
-    if (Z == 9999999) {
-      Z = forwardScore[hyp];
-    } else {
-      Z = log_sum(Z, forwardScore[hyp]);
-    }
-  }
+      //do the n-gram and the previous edge end with the same words?
+      const size_t back = min(ngramSize, prevSize);
+      bool isSuffix = true;
+      for (size_t i = 1; i <= back && isSuffix; ++i) {
+        isSuffix = prevEntry->ngram.words[ngramSize - i] == m_lattice.GetWord(prevEdge.wordsEnd - i);
+      }
+      if (!isSuffix) {
+        continue;
+      }
 
-  //Z *= scale;  //scale the score
+      size_t &path = paths[prevEntry->path];
+      if (path == NOT_FOUND) {
+        const NgramPath &prevPath = prevHistory.paths[prevEntry->path];
+        NgramPath newPath = {prevPath.firstTail, prevPath.score + edge.score};
+        path = history.paths.size();
+        history.paths.push_back(newPath);
+      }
 
-  for (map<Phrase, float>::iterator finalScoresIt = finalNgramScores.begin();  finalScoresIt != finalNgramScores.end(); ++finalScoresIt) {
-    finalScoresIt->second =  finalScoresIt->second - Z;
-    IFVERBOSE(2) {
-      VERBOSE(2,finalScoresIt->first << " [" << finalScoresIt->second << "]" << endl);
+      LatticeNgram ngram = prevEntry->ngram;
+      for (size_t i = 0; i < size && i + ngramSize < kLatticeNgramOrder; ++i) {
+        ngram.words[ngramSize + i] = m_lattice.GetWord(edge.wordsBegin + i);
+        NgramHistoryEntry entry = {ngram, path, prevEntry->count};
+        history.ngrams.push_back(entry);
+      }
     }
   }
 
+  //the same n-gram on the same path is counted once, with the counts added
+  vector<NgramHistoryEntry> &ngrams = history.ngrams;
+  sort(ngrams.begin(), ngrams.end());
+  size_t unique = 0;
+  for (size_t i = 0; i < ngrams.size(); ++i) {
+    if (unique > 0 && ngrams[unique-1].ngram == ngrams[i].ngram && ngrams[unique-1].path == ngrams[i].path) {
+      ngrams[unique-1].count += ngrams[i].count;
+    } else {
+      ngrams[unique++] = ngrams[i];
+    }
+  }
+  ngrams.resize(unique);
 }
 
-const NgramHistory& Edge::GetNgrams(map<const Hypothesis*, vector<Edge> > & incomingEdges)
+void NgramExpectationCalculator::ProcessNodes(size_t begin, size_t end)
 {
-
-  if (m_ngrams.size() > 0)
-    return m_ngrams;
-
-  const Phrase& currPhrase = GetWords();
-  //Extract the n-grams local to this edge
-  for (size_t start = 0; start < currPhrase.GetSize(); ++start) {
-    for (size_t end = start; end < start + bleu_order; ++end) {
-      if (end < currPhrase.GetSize()) {
-        Phrase edgeNgram(end-start+1);
-        for (size_t index = start; index <= end; ++index) {
-          edgeNgram.AddWord(currPhrase.GetWord(index));
-        }
-        //cout << "Inserting Phrase : " << edgeNgram << endl;
-        vector<const Edge*> edgeHistory;
-        edgeHistory.push_back(this);
-        storeNgramHistory(edgeNgram, edgeHistory);
-      } else {
-        break;
-      }
+  vector<float> forwardScores;
+  vector<NgramScore> scores;
+
+  for (size_t node = begin; node < end; ++node) {
+    const size_t edgesBegin = m_lattice.GetEdgesBegin(node);
+    const size_t edgesEnd = m_lattice.GetEdgesBegin(node + 1);
+    if (edgesBegin == edgesEnd) {
+      continue;
     }
-  }
 
-  map<const Hypothesis*, vector<Edge> >::iterator it = incomingEdges.find(m_tailNode);
-  if (it != incomingEdges.end()) { //node has incoming edges
-    vector<Edge> & inEdges = it->second;
+    VERBOSE(3, "Processing hyp: " << m_lattice.GetNode(node)->GetId() << ", num words cov= " << m_lattice.GetNode(node)->GetWordsBitmap().GetNumWordsCovered() <<  endl)
 
-    for (vector<Edge>::iterator edge = inEdges.begin(); edge != inEdges.end(); ++edge) {//add the ngrams straddling prev and curr edge
-      const NgramHistory & edgeIncomingNgrams = edge->GetNgrams(incomingEdges);
-      for (NgramHistory::const_iterator edgeInNgramHist = edgeIncomingNgrams.begin(); edgeInNgramHist != edgeIncomingNgrams.end(); ++edgeInNgramHist) {
-        const Phrase& edgeIncomingNgram = edgeInNgramHist->first;
-        const PathCounts &  edgeIncomingNgramPaths = edgeInNgramHist->second;
-        size_t back = min(edgeIncomingNgram.GetSize(), edge->GetWordsSize());
-        const Phrase&  edgeWords = edge->GetWords();
-        IFVERBOSE(3) {
-          cerr << "Edge: "<< *edge <<endl;
-          cerr << "edgeWords: " << edgeWords << endl;
-          cerr << "edgeInNgram: " << edgeIncomingNgram << endl;
-        }
-
-        Phrase edgeSuffix(ARRAY_SIZE_INCR);
-        Phrase ngramSuffix(ARRAY_SIZE_INCR);
-        GetPhraseSuffix(edgeWords,back,edgeSuffix);
-        GetPhraseSuffix(edgeIncomingNgram,back,ngramSuffix);
+    forwardScores.clear();
+    for (size_t e = edgesBegin; e < edgesEnd; ++e) {
+      const PrunedLattice::Edge &edge = m_lattice.GetEdge(e);
+      CalcHistory(e);
+      forwardScores.push_back(m_forwardScores[edge.tail] + edge.score);
+    }
+    m_forwardScores[node] = LogSumExp(forwardScores.begin(), forwardScores.end());
 
-        if (ngramSuffix == edgeSuffix) { //we've got the suffix of previous edge
-          size_t  edgeInNgramSize =  edgeIncomingNgram.GetSize();
+    scores.clear();
+    for (size_t e = edgesBegin; e < edgesEnd; ++e) {
+      const PrunedLattice::Edge &edge = m_lattice.GetEdge(e);
+      const EdgeHistory &history = m_histories[e];
 
-          for (size_t i = 0; i < GetWordsSize() && i + edgeInNgramSize < bleu_order ; ++i) {
-            Phrase newNgram(edgeIncomingNgram);
-            for (size_t j = 0; j <= i ; ++j) {
-              newNgram.AddWord(GetWords().GetWord(j));
-            }
-            VERBOSE(3, "Inserting New Phrase : " << newNgram << endl)
+      //let's first score ngrams introduced by this edge
+      for (vector<NgramHistoryEntry>::const_iterator entry = history.ngrams.begin(); entry != history.ngrams.end(); ++entry) {
+        //Score of an n-gram is forward score of head node of leftmost edge + all edge scores
+        const NgramPath &path = history.paths[entry->path];
+        //if we're doing expectations, then the number of times the ngram
+        //appears on the path is relevant.
+        NgramScore score = {entry->ngram, m_forwardScores[path.firstTail] + path.score, m_posteriors ? 1 : entry->count};
+        scores.push_back(score);
+      }
 
-            for (PathCounts::const_iterator pathIt = edgeIncomingNgramPaths.begin(); pathIt !=  edgeIncomingNgramPaths.end(); ++pathIt) {
-              Path newNgramPath = pathIt->first;
-              newNgramPath.push_back(this);
-              storeNgramHistory(newNgram, newNgramPath, pathIt->second);
-            }
-          }
+      //Now score ngrams that are just being propagated from the history
+      const NodeNgramScores &tailScores = m_nodeScores[edge.tail];
+      for (NodeNgramScores::const_iterator tailScore = tailScores.begin(); tailScore != tailScores.end(); ++tailScore) {
+        // For posteriors, don't double count ngrams
+        if (!m_posteriors || !history.Contains(tailScore->first)) {
+          NgramScore score = {tailScore->first, edge.score + tailScore->second, 1};
+          scores.push_back(score);
         }
       }
     }
+    SumNgramScores(scores, m_nodeScores[node]);
   }
-  return m_ngrams;
 }
 
-//Add the last lastN words of origPhrase to targetPhrase
-void Edge::GetPhraseSuffix(const Phrase&  origPhrase, size_t lastN, Phrase& targetPhrase) const
+void NgramExpectationCalculator::GetFinalScores(LatticeNgramScores &finalNgramScores) const
 {
-  size_t origSize = origPhrase.GetSize();
-  size_t startIndex = origSize - lastN;
-  for (size_t index = startIndex; index < origPhrase.GetSize(); ++index) {
-    targetPhrase.AddWord(origPhrase.GetWord(index));
+  //the n-gram scores and forward scores of the final hyps
+  vector<NgramScore> scores;
+  vector<float> forwardScores;
+  for (size_t node = 0; node < m_lattice.GetNumNodes(); ++node) {
+    if (!m_lattice.GetNode(node)->GetWordsBitmap().IsComplete()) {
+      continue;
+    }
+    const NodeNgramScores &nodeScores = m_nodeScores[node];
+    for (NodeNgramScores::const_iterator nodeScore = nodeScores.begin(); nodeScore != nodeScores.end(); ++nodeScore) {
+      NgramScore score = {nodeScore->first, nodeScore->second, 1};
+      scores.push_back(score);
+    }
+    forwardScores.push_back(m_forwardScores[node]);
+  }
+
+  float Z = 9999999; //the total score of the lattice
+  if (!forwardScores.empty()) {
+    Z = LogSumExp(forwardScores.begin(), forwardScores.end());
+  }
+
+  NodeNgramScores sums;
+  SumNgramScores(scores, sums);
+  for (NodeNgramScores::const_iterator sum = sums.begin(); sum != sums.end(); ++sum) {
+    finalNgramScores[sum->first] = sum->second - Z;
+    IFVERBOSE(2) {
+      for (size_t i = 0; i < sum->first.GetSize(); ++i) {
+        cerr << m_lattice.GetVocab().GetWord(sum->first.words[i]) << " ";
+      }
+      cerr << "[" << sum->second - Z << "]" << endl;
+    }
   }
 }
 
-bool Edge::operator< (const Edge& compare ) const
+//levels with fewer nodes than this are not shared out
+const size_t kMinNodesPerTask = 16;
+
+//the nodes of chunk number chunk of the level [begin, end)
+void ProcessChunk(NgramExpectationCalculator &calculator, size_t begin, size_t end,
+                  size_t step, size_t chunk)
 {
-  if (m_headNode->GetId() < compare.m_headNode->GetId())
-    return true;
-  if (compare.m_headNode->GetId() < m_headNode->GetId())
-    return false;
-  if (m_tailNode->GetId() < compare.m_tailNode->GetId())
-    return true;
-  if (compare.m_tailNode->GetId() < m_tailNode->GetId())
-    return false;
-  return GetScore() <  compare.GetScore();
+  const size_t start = begin + chunk * step;
+  calculator.ProcessNodes(start, min(start + step, end));
 }
 
-ostream& operator<< (ostream& out, const Edge& edge)
-{
-  out << "Head: " << edge.m_headNode->GetId()
-      << ", Tail: " << edge.m_tailNode->GetId()
-      << ", Score: " << edge.m_score
-      << ", Phrase: " << edge.m_targetPhrase << endl;
-  return out;
 }
 
-bool ascendingCoverageCmp(const Hypothesis* a, const Hypothesis* b)
+void calcNgramExpectations(const PrunedLattice& lattice, LatticeNgramScores& finalNgramScores, bool posteriors, size_t numThreads)
 {
-  return (a->GetWordsBitmap().GetNumWordsCovered()
-          <
-          b->GetWordsBitmap().GetNumWordsCovered());
+  NgramExpectationCalculator calculator(lattice, posteriors);
+
+  for (size_t level = 0; level < lattice.GetNumLevels(); ++level) {
+    const size_t begin = lattice.GetLevelBegin(level);
+    const size_t end = lattice.GetLevelBegin(level + 1);
+    if (numThreads > 1 && end - begin >= 2 * kMinNodesPerTask) {
+      const size_t step = max(kMinNodesPerTask, (end - begin + numThreads - 1) / numThreads);
+      const size_t numChunks = (end - begin + step - 1) / step;
+      //the chunks of a level are shared out like the spans of width 1 of a
+      //sentence of numChunks words, on the workers that live across sentences.
+      //The next level needs all of this one, which is done when this returns
+      ParallelSpans::ForEachSpan(numChunks, 1, numThreads,
+                                 boost::bind(&ProcessChunk, boost::ref(calculator),
+                                             begin, end, step, _1));
+      continue;
+    }
+    calculator.ProcessNodes(begin, end);
+  }
+
+  calculator.GetFinalScores(finalNgramScores);
 }
 
 void getLatticeMBRNBest(const Manager& manager, const TrellisPathList& nBestList,
                         vector<LatticeMBRSolution>& solutions, size_t n)
 {
-  std::map < int, bool > connected;
-  std::vector< const Hypothesis *> connectedList;
-  map<Phrase, float> ngramPosteriors;
-  std::map < const Hypothesis*, set <const Hypothesis*> > outgoingHyps;
-  map<const Hypothesis*, vector<Edge> > incomingEdges;
-  vector< float> estimatedScores;
-  manager.GetForwardBackwardSearchGraph(&connected, &connectedList,
-                                        &outgoingHyps, &estimatedScores);
   LMBR_Options const& lmbr = manager.options()->lmbr;
   MBR_Options  const& mbr  = manager.options()->mbr;
-  pruneLatticeFB(connectedList, outgoingHyps, incomingEdges, estimatedScores,
-                 manager.GetBestHypothesis(), lmbr.pruning_factor, mbr.scale);
-  calcNgramExpectations(connectedList, incomingEdges, ngramPosteriors,true);
+  PrunedLattice lattice(manager, lmbr.pruning_factor, mbr.scale);
+  LatticeNgramScores ngramPosteriors;
+  calcNgramExpectations(lattice, ngramPosteriors, true, lmbr.threads);
 
   vector<float> mbrThetas = lmbr.theta;
   float p = lmbr.precision;
@@ -528,8 +658,8 @@ void getLatticeMBRNBest(const Manager& manager, const TrellisPathList& nBestList
   if (mbrThetas.size() == 0) {
     // thetas were not specified on the command line, so use p and r instead
     mbrThetas.push_back(-1); //Theta 0
-    mbrThetas.push_back(1/(bleu_order*p));
-    for (size_t i = 2; i <= bleu_order; ++i) {
+    mbrThetas.push_back(1/(kLatticeNgramOrder*p));
+    for (size_t i = 2; i <= kLatticeNgramOrder; ++i) {
       mbrThetas.push_back(mbrThetas[i-1] / r);
     }
   }
@@ -546,7 +676,7 @@ void getLatticeMBRNBest(const Manager& manager, const TrellisPathList& nBestList
   for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter, ++ctr) {
     const TrellisPath &path = **iter;
     solutions.push_back(LatticeMBRSolution(path,iter==nBestList.begin()));
-    solutions.back().CalcScore(ngramPosteriors, mbrThetas, mapWeight);
+    solutions.back().CalcScore(lattice.GetVocab(), ngramPosteriors, mbrThetas, mapWeight);
     sort(solutions.begin(), solutions.end(), comparator);
     while (solutions.size() > n) {
       solutions.pop_back();
@@ -570,23 +700,16 @@ const TrellisPath doConsensusDecoding(const Manager& manager, const TrellisPathL
 
   //calculate the ngram expectations
   const StaticData& staticData = StaticData::Instance();
-  std::map < int, bool > connected;
-  std::vector< const Hypothesis *> connectedList;
-  map<Phrase, float> ngramExpectations;
-  std::map < const Hypothesis*, set <const Hypothesis*> > outgoingHyps;
-  map<const Hypothesis*, vector<Edge> > incomingEdges;
-  vector< float> estimatedScores;
-  manager.GetForwardBackwardSearchGraph(&connected, &connectedList, &outgoingHyps, &estimatedScores);
   LMBR_Options const& lmbr = manager.options()->lmbr;
   MBR_Options  const&  mbr = manager.options()->mbr;
-  pruneLatticeFB(connectedList, outgoingHyps, incomingEdges, estimatedScores,
-                 manager.GetBestHypothesis(), lmbr.pruning_factor, mbr.scale);
-  calcNgramExpectations(connectedList, incomingEdges, ngramExpectations,false);
+  PrunedLattice lattice(manager, lmbr.pruning_factor, mbr.scale);
+  LatticeNgramScores ngramExpectations;
+  calcNgramExpectations(lattice, ngramExpectations, false, lmbr.threads);
 
   //expected length is sum of expected unigram counts
   //cerr << "Thread " << pthread_self() <<  " Ngram expectations size: " << ngramExpectations.size() << endl;
   float ref_length = 0.0f;
-  for (map<Phrase,float>::const_iterator ref_iter = ngramExpectations.begin();
+  for (LatticeNgramScores::const_iterator ref_iter = ngramExpectations.begin();
        ref_iter != ngramExpectations.end(); ++ref_iter) {
     //cerr << "Ngram: " << ref_iter->first << " score: " <<
     //    ref_iter->second << endl;
@@ -606,14 +729,14 @@ const TrellisPath doConsensusDecoding(const Manager& manager, const TrellisPathL
   for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter) {
     const TrellisPath &path = **iter;
     vector<Word> words;
-    map<Phrase,int> ngrams;
+    boost::unordered_map<LatticeNgram,int> ngrams;
     GetOutputWords(path,words);
     /*for (size_t i = 0; i < words.size(); ++i) {
         cerr << words[i].GetFactor(0)->GetString() << " ";
     }
     cerr << endl;
     */
-    extract_ngrams(words,ngrams);
+    extract_ngrams(words,lattice.GetVocab(),ngrams);
 
     vector<float> comps(2*BLEU_ORDER+1);
     float logbleu = 0.0;
@@ -624,9 +747,9 @@ const TrellisPath doConsensusDecoding(const Manager& manager, const TrellisPathL
       comps[2*i+1] = max(hyp_length-i,0);
     }
 
-    for (map<Phrase,int>::const_iterator hyp_iter = ngrams.begin();
+    for (boost::unordered_map<LatticeNgram,int>::const_iterator hyp_iter = ngrams.begin();
          hyp_iter != ngrams.end(); ++hyp_iter) {
-      map<Phrase,float>::const_iterator ref_iter = ngramExpectations.find(hyp_iter->first);
+      LatticeNgramScores::const_iterator ref_iter = ngramExpectations.find(hyp_iter->first);
       if (ref_iter != ngramExpectations.end()) {
         comps[2*(hyp_iter->first.GetSize()-1)] += min(exp(ref_iter->second), (float)(hyp_iter->second));
       }
@@ -10,91 +10,149 @@
 #ifndef moses_cmd_LatticeMBR_h
 #define moses_cmd_LatticeMBR_h
 
-#include <map>
+#include <stdint.h>
+#include <cstring>
 #include <vector>
-#include <set>
+#include <boost/unordered_map.hpp>
 #include "moses/Hypothesis.h"
 #include "moses/Manager.h"
 #include "moses/TrellisPathList.h"
+#include "util/murmur_hash.hh"
 
 
 
 namespace Moses
 {
 
-class Edge;
+//! the longest n-grams counted by lattice MBR and consensus decoding
+const size_t kLatticeNgramOrder = 4;
 
-typedef std::vector< const Moses::Hypothesis *> Lattice;
-typedef std::vector<const Edge*> Path;
-typedef std::map<Path, size_t> PathCounts;
-typedef std::map<Moses::Phrase, PathCounts > NgramHistory;
-
-class Edge
-{
-  const Moses::Hypothesis* m_tailNode;
-  const Moses::Hypothesis* m_headNode;
-  float m_score;
-  Moses::TargetPhrase m_targetPhrase;
-  NgramHistory m_ngrams;
+/**
+* An n-gram of up to kLatticeNgramOrder words, as ids in a LatticeVocab.  The
+* ids start at 1, the positions after the end of the n-gram are 0.
+*/
+struct LatticeNgram {
+  uint32_t words[kLatticeNgramOrder];
 
-public:
-  Edge(const Moses::Hypothesis* from, const Moses::Hypothesis* to, float score, const Moses::TargetPhrase& targetPhrase) : m_tailNode(from), m_headNode(to), m_score(score), m_targetPhrase(targetPhrase) {
-    //cout << "Creating new edge from Node " << from->GetId() << ", to Node : " << to->GetId() << ", score: " << score << " phrase: " << targetPhrase << endl;
+  LatticeNgram() {
+    std::memset(words, 0, sizeof(words));
   }
 
-  const Moses::Hypothesis* GetHeadNode() const {
-    return m_headNode;
+  size_t GetSize() const {
+    size_t size = 0;
+    while (size < kLatticeNgramOrder && words[size] != 0) {
+      ++size;
+    }
+    return size;
   }
 
-  const Moses::Hypothesis* GetTailNode() const {
-    return m_tailNode;
+  bool operator==(const LatticeNgram &other) const {
+    return std::memcmp(words, other.words, sizeof(words)) == 0;
   }
 
-  float GetScore() const {
-    return m_score;
-  }
-
-  size_t GetWordsSize() const {
-    return m_targetPhrase.GetSize();
+  //! arbitrary but fixed order, for sorting
+  bool operator<(const LatticeNgram &other) const {
+    return std::memcmp(words, other.words, sizeof(words)) < 0;
   }
+};
 
-  const Moses::Phrase& GetWords() const {
-    return m_targetPhrase;
-  }
+inline size_t hash_value(const LatticeNgram &ngram)
+{
+  return util::MurmurHashNative(ngram.words, sizeof(ngram.words));
+}
 
-  friend std::ostream& operator<< (std::ostream& out, const Edge& edge);
+//! log expected counts or log posteriors of n-grams
+typedef boost::unordered_map<LatticeNgram, float> LatticeNgramScores;
 
-  const NgramHistory&  GetNgrams(  std::map<const Moses::Hypothesis*, std::vector<Edge> > & incomingEdges) ;
+/**
+* The target words of a lattice, as ids
+*/
+class LatticeVocab
+{
+public:
+  //! id of the words that aren't in the lattice
+  static const uint32_t kUnknown = 0xffffffff;
 
-  bool operator < (const Edge & compare) const;
+  uint32_t Insert(const Moses::Word &word);
 
-  void GetPhraseSuffix(const Moses::Phrase& origPhrase, size_t lastN, Moses::Phrase& targetPhrase) const;
+  //! kUnknown if the word isn't in the lattice
+  uint32_t Find(const Moses::Word &word) const {
+    boost::unordered_map<Moses::Word, uint32_t>::const_iterator iter = m_ids.find(word);
+    return iter == m_ids.end() ? kUnknown : iter->second;
+  }
 
-  void storeNgramHistory(const Moses::Phrase& phrase, Path & path, size_t count = 1) {
-    m_ngrams[phrase][path]+= count;
+  const Moses::Word &GetWord(uint32_t id) const {
+    return m_words[id - 1];
   }
 
+private:
+  boost::unordered_map<Moses::Word, uint32_t> m_ids;
+  std::vector<Moses::Word> m_words;
 };
 
 /**
-* Data structure to hold the ngram scores as we traverse the lattice. Maps (hypo,ngram) to score
+* The search graph pruned with forward-backward scores, on flat arrays.  The
+* nodes are sorted by the number of source words they cover, which is a
+* topological order, and each node has the range of its incoming edges.
 */
-class NgramScores
+class PrunedLattice
 {
 public:
-  NgramScores() {}
+  struct Edge {
+    size_t tail; //< index of the node the edge comes from
+    float score; //< scaled log probability of the edge
+    size_t wordsBegin; //< target words, in GetWord()
+    size_t wordsEnd;
+  };
+
+  /** Keeps the hypotheses with the best forward-backward scores until there
+   *  are about edgeDensity edges per word of the best translation
+   */
+  PrunedLattice(const Moses::Manager& manager, size_t edgeDensity, float scale);
+
+  size_t GetNumNodes() const {
+    return m_nodes.size();
+  }
+  const Moses::Hypothesis *GetNode(size_t node) const {
+    return m_nodes[node];
+  }
+
+  //! incoming edges of node are [GetEdgesBegin(node), GetEdgesBegin(node+1))
+  size_t GetEdgesBegin(size_t node) const {
+    return m_edgeOffsets[node];
+  }
+  const Edge &GetEdge(size_t edge) const {
+    return m_edges[edge];
+  }
+  size_t GetNumEdges() const {
+    return m_edges.size();
+  }
+
+  uint32_t GetWord(size_t pos) const {
+    return m_words[pos];
+  }
 
-  /** logsum this score to the existing score */
-  void addScore(const Moses::Hypothesis* node, const Moses::Phrase& ngram, float score);
+  /** nodes covering the same number of source words, [GetLevelBegin(level),
+   *  GetLevelBegin(level+1)).  There are no edges between them.
+   */
+  size_t GetNumLevels() const {
+    return m_levelOffsets.size() - 1;
+  }
+  size_t GetLevelBegin(size_t level) const {
+    return m_levelOffsets[level];
+  }
 
-  /** Iterate through ngrams for selected node */
-  typedef std::map<const Moses::Phrase*, float>::const_iterator NodeScoreIterator;
-  NodeScoreIterator nodeBegin(const Moses::Hypothesis* node);
-  NodeScoreIterator nodeEnd(const Moses::Hypothesis* node);
+  const LatticeVocab &GetVocab() const {
+    return m_vocab;
+  }
 
 private:
-  std::set<Moses::Phrase> m_ngrams;
-  std::map<const Moses::Hypothesis*, std::map<const Moses::Phrase*, float> > m_scores;
+  std::vector<const Moses::Hypothesis*> m_nodes;
+  std::vector<size_t> m_edgeOffsets;
+  std::vector<Edge> m_edges;
+  std::vector<uint32_t> m_words;
+  std::vector<size_t> m_levelOffsets;
+  LatticeVocab m_vocab;
 };
 
 
@@ -118,7 +176,7 @@ public:
   }
 
   /** Initialise ngram scores */
-  void CalcScore(std::map<Moses::Phrase, float>& finalNgramScores, const std::vector<float>& thetas, float mapWeight);
+  void CalcScore(const LatticeVocab& vocab, const LatticeNgramScores& finalNgramScores, const std::vector<float>& thetas, float mapWeight);
 
 private:
   std::vector<Moses::Word> m_words;
@@ -133,17 +191,14 @@ struct LatticeMBRSolutionComparator {
   }
 };
 
-void pruneLatticeFB(Lattice & connectedHyp, std::map < const Moses::Hypothesis*, std::set <const Moses::Hypothesis* > > & outgoingHyps, std::map<const Moses::Hypothesis*, std::vector<Edge> >& incomingEdges,
-                    const std::vector< float> & estimatedScores, const Moses::Hypothesis*, size_t edgeDensity,float scale);
-
 //Use the ngram scores to rerank the nbest list, return at most n solutions
 void getLatticeMBRNBest(const Moses::Manager& manager, const Moses::TrellisPathList& nBestList, std::vector<LatticeMBRSolution>& solutions, size_t n);
 //calculate expectated ngram counts, clipping at 1 (ie calculating posteriors) if posteriors==true.
-void calcNgramExpectations(Lattice & connectedHyp, std::map<const Moses::Hypothesis*, std::vector<Edge> >& incomingEdges, std::map<Moses::Phrase,
-                           float>& finalNgramScores, bool posteriors);
+//The nodes that cover the same number of source words are shared out between numThreads threads.
+void calcNgramExpectations(const PrunedLattice& lattice, LatticeNgramScores& finalNgramScores, bool posteriors, size_t numThreads);
 void GetOutputFactors(const Moses::TrellisPath &path, std::vector <Moses::Word> &translation);
-void extract_ngrams(const std::vector<Moses::Word >& sentence, std::map < Moses::Phrase, int >  & allngrams);
-bool ascendingCoverageCmp(const Moses::Hypothesis* a, const Moses::Hypothesis* b);
+//Words that aren't in the lattice are all given the id LatticeVocab::kUnknown
+void extract_ngrams(const std::vector<Moses::Word >& sentence, const LatticeVocab& vocab, boost::unordered_map<LatticeNgram, int>& allngrams);
 std::vector<Moses::Word> doLatticeMBR(const Moses::Manager& manager, const Moses::TrellisPathList& nBestList);
 const Moses::TrellisPath doConsensusDecoding(const Moses::Manager& manager, const Moses::TrellisPathList& nBestList);
 //std::vector<Moses::Word> doConsensusDecoding(Moses::Manager& manager, Moses::TrellisPathList& nBestList);
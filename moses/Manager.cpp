@@ -38,6 +38,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TranslationOption.h"
 #include "TranslationOptionCollection.h"
 #include "Timer.h"
+#include "Profiler.h"
 #include "moses/OutputCollector.h"
 #include "moses/FF/DistortionScoreProducer.h"
 #include "moses/LM/Base.h"
@@ -50,6 +51,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/SearchNormal.h"
 #include "moses/SearchCubePruning.h"
 #include <boost/foreach.hpp>
+#include <boost/unordered_set.hpp>
 
 #ifdef HAVE_PROTOBUF
 #include "hypergraph.pb.h"
@@ -130,7 +132,10 @@ void Manager::Decode()
   IFVERBOSE(1) {
     GetSentenceStats().StartTimeCollectOpts();
   }
-  m_transOptColl->CreateTranslationOptions();
+  {
+    ProfileTimer timer(Profiler::GetData(), Profiler::CollectOptions);
+    m_transOptColl->CreateTranslationOptions();
+  }
 
   // some reporting on how long this took
   IFVERBOSE(1) {
@@ -144,7 +149,10 @@ void Manager::Decode()
   // search for best translation with the specified algorithm
   Timer searchTime;
   searchTime.start();
-  m_search->Decode();
+  {
+    ProfileTimer timer(Profiler::GetData(), Profiler::Search);
+    m_search->Decode();
+  }
   VERBOSE(1, "Line " << m_source.GetTranslationId()
           << ": Search took " << searchTime << " seconds" << endl);
   IFVERBOSE(2) {
@@ -254,6 +262,11 @@ printThisHypothesis(long translationId, const Hypothesis* hypo,
  * \param ret holds the n-best list that was calculated
  */
 void Manager::CalcNBest(size_t count, TrellisPathList &ret, bool onlyDistinct) const
+{
+  CalcNBest(count, onlyDistinct, &ret, NULL);
+}
+
+void Manager::CalcNBest(size_t count, bool onlyDistinct, TrellisPathList *ret, std::ostream *out) const
 {
   if (count <= 0)
     return;
@@ -265,9 +278,11 @@ void Manager::CalcNBest(size_t count, TrellisPathList &ret, bool onlyDistinct) c
   if (sortedPureHypo.size() == 0)
     return;
 
-  TrellisPathCollection contenders;
+  TrellisPathCollection contenders(options()->output.factor_order);
 
-  set<Phrase> distinctHyps;
+  // hashes of the surface phrases of the distinct paths so far
+  boost::unordered_set<uint64_t> distinctHyps;
+  size_t numPaths = 0;
 
   // add all pure paths
   vector<const Hypothesis*>::const_iterator iterBestHypo;
@@ -283,25 +298,25 @@ void Manager::CalcNBest(size_t count, TrellisPathList &ret, bool onlyDistinct) c
   if (nBestFactor < 1) nBestFactor = 1000; // 0 = unlimited
 
   // MAIN loop
-  for (size_t iteration = 0 ; (onlyDistinct ? distinctHyps.size() : ret.GetSize()) < count && contenders.GetSize() > 0 && (iteration < count * nBestFactor) ; iteration++) {
+  for (size_t iteration = 0 ; numPaths < count && contenders.GetSize() > 0 && (iteration < count * nBestFactor) ; iteration++) {
     // get next best from list of contenders
     TrellisPath *path = contenders.pop();
     UTIL_THROW_IF2(path == NULL, "path is NULL");
     // create deviations from current best
     path->CreateDeviantPaths(contenders);
-    if(onlyDistinct) {
-      Phrase tgtPhrase = path->GetSurfacePhrase();
-      if (distinctHyps.insert(tgtPhrase).second) {
-        ret.Add(path);
+    if (onlyDistinct && !distinctHyps.insert(path->GetSurfaceHash(contenders)).second) {
+      delete path;
+      path = NULL;
+    } else {
+      ++numPaths;
+      if (ret) {
+        ret->Add(path);
       } else {
+        OutputNBest(*out, *path);
         delete path;
-        path = NULL;
       }
-    } else {
-      ret.Add(path);
     }
 
-
     if(onlyDistinct) {
       const size_t nBestFactor = options()->nbest.factor;
       if (nBestFactor > 0)
@@ -1591,11 +1606,12 @@ void Manager::OutputNBest(OutputCollector *collector) const
       collector->Write(m_source.GetTranslationId(), m_latticeNBestOut.str());
     }
   } else {
-    TrellisPathList nBestList;
+    // Each line is formatted as soon as its path is found, but the list goes
+    // to the collector as a whole, which keeps the sentences in order when
+    // several threads decode.
     ostringstream out;
     NBestOptions const& nbo = options()->nbest;
-    CalcNBest(nbo.nbest_size, nBestList, nbo.only_distinct);
-    OutputNBest(out, nBestList);
+    CalcNBest(nbo.nbest_size, nbo.only_distinct, NULL, &out);
     collector->Write(m_source.GetTranslationId(), out.str());
   }
 
@@ -1604,74 +1620,81 @@ void Manager::OutputNBest(OutputCollector *collector) const
 void
 Manager::
 OutputNBest(std::ostream& out, Moses::TrellisPathList const& nBestList) const
+{
+  TrellisPathList::const_iterator iter;
+  for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter) {
+    OutputNBest(out, **iter);
+  }
+
+  out << std::flush;
+}
+
+//! one line of the n-best list
+void
+Manager::
+OutputNBest(std::ostream& out, const Moses::TrellisPath &path) const
 {
   NBestOptions const& nbo = options()->nbest;
   bool reportAllFactors     = nbo.include_all_factors;
   bool includeSegmentation  = nbo.include_segmentation;
   bool includeWordAlignment = nbo.include_alignment_info;
 
-  TrellisPathList::const_iterator iter;
-  for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter) {
-    const TrellisPath &path = **iter;
-    const std::vector<const Hypothesis *> &edges = path.GetEdges();
-
-    // print the surface factor of the translation
-    out << m_source.GetTranslationId() << " ||| ";
-    for (int currEdge = (int)edges.size() - 1 ; currEdge >= 0 ; currEdge--) {
-      const Hypothesis &edge = *edges[currEdge];
-      OutputSurface(out, edge);
-    }
-    out << " |||";
+  const std::vector<const Hypothesis *> &edges = path.GetEdges();
 
-    // print scores with feature names
-    bool with_labels = options()->nbest.include_feature_labels;
-    path.GetScoreBreakdown()->OutputAllFeatureScores(out, with_labels);
-
-    // total
-    out << " ||| " << path.GetFutureScore();
-
-    //phrase-to-phrase segmentation
-    if (includeSegmentation) {
-      out << " |||";
-      for (int currEdge = (int)edges.size() - 2 ; currEdge >= 0 ; currEdge--) {
-        const Hypothesis &edge = *edges[currEdge];
-        const Range &sourceRange = edge.GetCurrSourceWordsRange();
-        Range targetRange = path.GetTargetWordsRange(edge);
-        out << " " << sourceRange.GetStartPos();
-        if (sourceRange.GetStartPos() < sourceRange.GetEndPos()) {
-          out << "-" << sourceRange.GetEndPos();
-        }
-        out<< "=" << targetRange.GetStartPos();
-        if (targetRange.GetStartPos() < targetRange.GetEndPos()) {
-          out<< "-" << targetRange.GetEndPos();
-        }
-      }
-    }
+  // print the surface factor of the translation
+  out << m_source.GetTranslationId() << " ||| ";
+  for (int currEdge = (int)edges.size() - 1 ; currEdge >= 0 ; currEdge--) {
+    const Hypothesis &edge = *edges[currEdge];
+    OutputSurface(out, edge);
+  }
+  out << " |||";
 
-    if (includeWordAlignment) {
-      out << " ||| ";
-      for (int currEdge = (int)edges.size() - 2 ; currEdge >= 0 ; currEdge--) {
-        const Hypothesis &edge = *edges[currEdge];
-        const Range &sourceRange = edge.GetCurrSourceWordsRange();
-        Range targetRange = path.GetTargetWordsRange(edge);
-        const int sourceOffset = sourceRange.GetStartPos();
-        const int targetOffset = targetRange.GetStartPos();
-        const AlignmentInfo &ai = edge.GetCurrTargetPhrase().GetAlignTerm();
+  // print scores with feature names
+  bool with_labels = options()->nbest.include_feature_labels;
+  path.GetScoreBreakdown()->OutputAllFeatureScores(out, with_labels);
 
-        OutputAlignment(out, ai, sourceOffset, targetOffset);
+  // total
+  out << " ||| " << path.GetFutureScore();
 
+  //phrase-to-phrase segmentation
+  if (includeSegmentation) {
+    out << " |||";
+    for (int currEdge = (int)edges.size() - 2 ; currEdge >= 0 ; currEdge--) {
+      const Hypothesis &edge = *edges[currEdge];
+      const Range &sourceRange = edge.GetCurrSourceWordsRange();
+      Range targetRange = path.GetTargetWordsRange(edge);
+      out << " " << sourceRange.GetStartPos();
+      if (sourceRange.GetStartPos() < sourceRange.GetEndPos()) {
+        out << "-" << sourceRange.GetEndPos();
+      }
+      out<< "=" << targetRange.GetStartPos();
+      if (targetRange.GetStartPos() < targetRange.GetEndPos()) {
+        out<< "-" << targetRange.GetEndPos();
       }
     }
+  }
+
+  if (includeWordAlignment) {
+    out << " ||| ";
+    for (int currEdge = (int)edges.size() - 2 ; currEdge >= 0 ; currEdge--) {
+      const Hypothesis &edge = *edges[currEdge];
+      const Range &sourceRange = edge.GetCurrSourceWordsRange();
+      Range targetRange = path.GetTargetWordsRange(edge);
+      const int sourceOffset = sourceRange.GetStartPos();
+      const int targetOffset = targetRange.GetStartPos();
+      const AlignmentInfo &ai = edge.GetCurrTargetPhrase().GetAlignTerm();
+
+      OutputAlignment(out, ai, sourceOffset, targetOffset);
 
-    if (options()->output.RecoverPath) {
-      out << " ||| ";
-      OutputInput(out, edges[0]);
     }
+  }
 
-    out << endl;
+  if (options()->output.RecoverPath) {
+    out << " ||| ";
+    OutputInput(out, edges[0]);
   }
 
-  out << std::flush;
+  out << endl;
 }
 
 //////////////////////////////////////////////////////////////////////////
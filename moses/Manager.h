@@ -131,8 +131,14 @@ protected:
   // nbest
   mutable std::ostringstream m_latticeNBestOut;
   mutable std::ostringstream m_alignmentOut;
+  /** the n-best paths, each given to ret or, if ret is NULL, written to
+   *  out as soon as it is found and then deleted
+   */
+  void CalcNBest(size_t count, bool onlyDistinct, TrellisPathList *ret, std::ostream *out) const;
+
 public:
   void OutputNBest(std::ostream& out, const Moses::TrellisPathList &nBestList) const;
+  void OutputNBest(std::ostream& out, const Moses::TrellisPath &path) const;
   void OutputSurface(std::ostream &out,
                      Hypothesis const& edge,
                      bool const recursive=false) const;
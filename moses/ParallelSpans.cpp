@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#ifdef WITH_THREADS
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#endif
+
+#include "ParallelSpans.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "util/exception.hh"
+
+namespace Moses
+{
+
+#ifdef WITH_THREADS
+namespace
+{
+
+/** The spans of one width.  Each task visits every stride-th span,
+ *  beginning with the first-th.
+ */
+class SpanJob
+{
+public:
+  SpanJob(std::size_t numSpans, const ParallelSpans::SpanFunction &fn)
+    : m_numSpans(numSpans), m_fn(fn), m_profile(Profiler::GetData()),
+      m_numRunning(0) {
+  }
+
+  void Run(ThreadPool &pool, std::size_t numThreads) {
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      const std::size_t numTasks = std::min(numThreads, m_numSpans);
+      for (std::size_t i = 0; i < numTasks; ++i) {
+        ++m_numRunning;
+        pool.Submit(boost::shared_ptr<Task>(new SpanTask(*this, i, numTasks)));
+      }
+      while (m_numRunning > 0) {
+        m_done.wait(lock);
+      }
+    }
+    UTIL_THROW_IF2(!m_error.empty(), m_error);
+  }
+
+  void Visit(std::size_t first, std::size_t stride) {
+    std::string error;
+    try {
+      for (std::size_t start = first; start < m_numSpans; start += stride) {
+        m_fn(start);
+      }
+    } catch (const std::exception &e) {
+      error = e.what();
+    } catch (...) {
+      error = "unknown error";
+    }
+
+    Profiler::Data *profile = Profiler::GetData();
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (!error.empty() && m_error.empty()) {
+      m_error = error;
+    }
+    if (profile && m_profile && profile != m_profile) {
+      m_profile->Add(*profile);
+      profile->Clear();
+    }
+    if (--m_numRunning == 0) {
+      m_done.notify_all();
+    }
+  }
+
+private:
+  class SpanTask : public Task
+  {
+  public:
+    SpanTask(SpanJob &job, std::size_t first, std::size_t stride)
+      : m_job(job), m_first(first), m_stride(stride) {}
+    void Run() {
+      m_job.Visit(m_first, m_stride);
+    }
+  private:
+    SpanJob &m_job;
+    std::size_t m_first;
+    std::size_t m_stride;
+  };
+
+  const std::size_t m_numSpans;
+  const ParallelSpans::SpanFunction &m_fn;
+  Profiler::Data *m_profile; //! of the thread that submitted the job
+  boost::mutex m_mutex;
+  boost::condition_variable m_done;
+  std::size_t m_numRunning; //! submitted and not finished
+  std::string m_error;
+};
+
+// The pool with numThreads workers, started on first use.  The pools are
+// never stopped: their workers wait for jobs until the decoder exits.
+ThreadPool &GetPool(std::size_t numThreads)
+{
+  static boost::mutex mutex;
+  static std::map<std::size_t, ThreadPool *> pools;
+  boost::mutex::scoped_lock lock(mutex);
+  ThreadPool *&pool = pools[numThreads];
+  if (!pool) {
+    pool = new ThreadPool(numThreads);
+  }
+  return *pool;
+}
+
+}
+#endif
+
+void ParallelSpans::ForEachSpan(std::size_t size, std::size_t width,
+                                std::size_t numThreads, const SpanFunction &fn)
+{
+  const std::size_t numSpans = size-width+1;
+#ifdef WITH_THREADS
+  if (numThreads > 1 && numSpans > 1) {
+    SpanJob job(numSpans, fn);
+    job.Run(GetPool(numThreads), numThreads);
+    return;
+  }
+#endif
+  for (std::size_t start = 0; start < numSpans; ++start) {
+    fn(start);
+  }
+}
+
+}
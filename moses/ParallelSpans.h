@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+#include <boost/function.hpp>
+
+namespace Moses
+{
+
+/** Bottom-up chart decoding over several threads.  A cell of the chart only
+ *  depends on the cells of narrower spans, so a decoder can visit the spans
+ *  in order of increasing width and work on the spans of one width in
+ *  parallel.
+ *
+ *  The work is done by a ThreadPool of numThreads workers that lives until
+ *  the decoder exits and is shared by all sentences decoded with that number
+ *  of threads, so thread-specific state survives from one width (and
+ *  sentence) to the next.  Whatever a worker counts for the Profiler is added
+ *  to the counts of the thread that asked for the work.  Built without
+ *  threads, the spans are visited one at a time.
+ */
+class ParallelSpans
+{
+public:
+  typedef boost::function<void (std::size_t)> SpanFunction;
+
+  // Calls fn(start) for the start of each span of the given width in a
+  // sentence of size words, and returns once all calls have finished.  If
+  // any call throws, the first error is thrown after that.
+  static void ForEachSpan(std::size_t size, std::size_t width,
+                          std::size_t numThreads, const SpanFunction &fn);
+};
+
+}
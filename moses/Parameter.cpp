@@ -109,6 +109,9 @@ Parameter::Parameter()
   AddParam(search_opts,"disable-discarding", "dd", "disable hypothesis discarding"); // ??? memory management? UG
   AddParam(search_opts,"phrase-drop-allowed", "da", "if present, allow dropping of source words"); //da = drop any (word); see -du for comparison
   AddParam(search_opts,"threads","th", "number of threads to use in decoding (defaults to single-threaded)");
+  AddParam(search_opts,"load-threads", "number of threads to load the feature functions and phrase tables with (default = 1)");
+  AddParam(search_opts,"profile", "write the time spent in each feature function and decoding phase, and the hypotheses in each stack, to this file as a line of JSON per sentence");
+  AddParam(search_opts,"profile-sample-rate", "time 1 in this many calls of each kind when profiling (default = 1)");
 
   // distortion options
   po::options_description disto_opts("Distortion options");
@@ -142,6 +145,7 @@ Parameter::Parameter()
   AddParam(mbr_opts,"lmbr-map-weight", "weight given to map solution when doing lattice MBR (default 0)");
   AddParam(mbr_opts,"lmbr-pruning-factor", "average number of nodes/word wanted in pruned lattice");
   AddParam(mbr_opts,"lattice-hypo-set", "to use lattice as hypo set during lattice MBR");
+  AddParam(mbr_opts,"lmbr-threads", "threads computing the n-gram posteriors of each sentence in lattice MBR and consensus decoding (default 1)");
 
   ///////////////////////////////////////////////////////////////////////////////////////
   // OOV handling options
@@ -223,6 +227,7 @@ Parameter::Parameter()
   AddParam(server_opts,"server-port", "Port for moses server");
   AddParam(server_opts,"server-log", "Log destination for moses server");
   AddParam(server_opts,"serial", "Run server in serial mode, processing only one request at a time.");
+  AddParam(server_opts,"server-ready-file", "Create this file when the models are loaded and the server accepts requests.");
 
   AddParam(server_opts,"server-maxconn",
            "Max. No of simultaneous HTTP transactions allowed by the server.");
@@ -258,6 +263,8 @@ Parameter::Parameter()
   AddParam(misc_opts,"no-cache", "Disable all phrase-table caching. Default = false (ie. enable caching)");
   AddParam(misc_opts,"default-non-term-for-empty-range-only", "Don't add [X] to all ranges, just ranges where there isn't a source non-term. Default = false (ie. add [X] everywhere)");
   AddParam(misc_opts,"s2t-parsing-algorithm", "Which S2T parsing algorithm to use. 0=recursive CYK+, 1=scope-3 (default = 0)");
+  AddParam(misc_opts,"s2t-parsing-threads", "Number of threads used to parse the spans of each width in parallel. Scope-3 only (default = 1)");
+  AddParam(misc_opts,"chart-cell-threads", "Number of threads used to decode the chart cells of each width in parallel. Chart decoder only (default = 1)");
 
   //AddParam(o,"continue-partial-translation", "cpt", "start from nonempty hypothesis");
   AddParam(misc_opts,"decoding-graph-backoff", "dpb", "only use subsequent decoding paths for unknown spans of given length");
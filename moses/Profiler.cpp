@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <ostream>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#endif
+
+#include "Profiler.h"
+#include "FF/FeatureFunction.h"
+#include "util/exception.hh"
+
+namespace Moses
+{
+
+bool Profiler::s_enabled = false;
+size_t Profiler::s_sampleRate = 1;
+double Profiler::s_ticksPerSecond = 1e9;
+
+namespace
+{
+
+#ifdef WITH_THREADS
+boost::thread_specific_ptr<Profiler::Data> s_threadData;
+boost::mutex s_mutex;
+#else
+boost::scoped_ptr<Profiler::Data> s_threadData;
+#endif
+
+std::ofstream s_out;
+Profiler::Data s_totals;
+
+// of the feature functions, by profile id.  Kept here because the feature
+// functions are destroyed before the totals are written
+std::vector<std::string> s_names;
+
+const char *const kPhaseNames[Profiler::NumPhases] = {
+  "collect-options",
+  "search",
+  "n-best"
+};
+
+const char *const kCallTypeNames[Profiler::NumCallTypes] = {
+  "in-isolation",
+  "with-source-context",
+  "when-applied",
+  "lookup"
+};
+
+void WriteString(std::ostream &out, const std::string &str)
+{
+  out << '"';
+  for (size_t i = 0; i < str.size(); ++i) {
+    char c = str[i];
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out << ' ';
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+// calls, sampled calls and the estimated time of all the calls
+void WriteEntry(std::ostream &out, const Profiler::Entry &entry, double ticksPerSecond)
+{
+  double seconds = entry.sampled ? entry.ticks / ticksPerSecond * entry.calls / entry.sampled : 0;
+  out << "{\"calls\":" << entry.calls
+      << ",\"sampled\":" << entry.sampled
+      << ",\"seconds\":" << seconds << "}";
+}
+
+void WriteData(std::ostream &out, const Profiler::Data &data, double ticksPerSecond)
+{
+  out << "{\"id\":";
+  if (data.translationId < 0) {
+    out << "\"total\"";
+  } else {
+    out << data.translationId;
+  }
+  out << ",\"seconds\":" << data.ticks / ticksPerSecond;
+
+  out << ",\"phases\":{";
+  for (size_t i = 0; i < Profiler::NumPhases; ++i) {
+    out << (i ? "," : "") << '"' << kPhaseNames[i] << "\":";
+    WriteEntry(out, data.phases[i], ticksPerSecond);
+  }
+  out << "}";
+
+  out << ",\"features\":[";
+  bool first = true;
+  for (size_t id = 0; id * Profiler::NumCallTypes < data.features.size(); ++id) {
+    out << (first ? "" : ",") << "{\"name\":";
+    first = false;
+    WriteString(out, id < s_names.size() ? s_names[id] : std::string());
+    for (size_t type = 0; type < Profiler::NumCallTypes; ++type) {
+      const Profiler::Entry &entry = data.features[id * Profiler::NumCallTypes + type];
+      if (entry.calls) {
+        out << ",\"" << kCallTypeNames[type] << "\":";
+        WriteEntry(out, entry, ticksPerSecond);
+      }
+    }
+    out << "}";
+  }
+  out << "]";
+
+  out << ",\"stacks\":[";
+  for (size_t i = 0; i < data.stacks.size(); ++i) {
+    const Profiler::StackCounts &stack = data.stacks[i];
+    out << (i ? "," : "")
+        << "{\"created\":" << stack.created
+        << ",\"recombined\":" << stack.recombined
+        << ",\"pruned\":" << stack.pruned << "}";
+  }
+  out << "]}\n";
+}
+
+}
+
+void Profiler::Data::Clear()
+{
+  translationId = -1;
+  startTicks = 0;
+  ticks = 0;
+  // zeroed, not emptied: a ProfileTimer may hold on to an entry
+  std::fill(features.begin(), features.end(), Entry());
+  for (size_t i = 0; i < NumPhases; ++i) {
+    phases[i] = Entry();
+  }
+  stacks.clear();
+}
+
+void Profiler::Data::Add(const Data &other)
+{
+  ticks += other.ticks;
+  if (features.size() < other.features.size()) {
+    features.resize(other.features.size());
+  }
+  for (size_t i = 0; i < other.features.size(); ++i) {
+    features[i] += other.features[i];
+  }
+  for (size_t i = 0; i < NumPhases; ++i) {
+    phases[i] += other.phases[i];
+  }
+  if (stacks.size() < other.stacks.size()) {
+    stacks.resize(other.stacks.size());
+  }
+  for (size_t i = 0; i < other.stacks.size(); ++i) {
+    stacks[i].created += other.stacks[i].created;
+    stacks[i].recombined += other.stacks[i].recombined;
+    stacks[i].pruned += other.stacks[i].pruned;
+  }
+}
+
+Profiler::Entry &Profiler::Data::GetEntry(const FeatureFunction &ff, CallType type)
+{
+  // Sized for all the feature functions at once, so that the entries of the
+  // timers that are still running aren't moved.  They are all registered
+  // before decoding starts.
+  size_t ind = ff.GetProfileId() * NumCallTypes + type;
+  if (ind >= features.size()) {
+    size_t numFeatures = std::max(FeatureFunction::GetFeatureFunctions().size(),
+                                  ff.GetProfileId() + 1);
+    features.resize(numFeatures * NumCallTypes);
+  }
+  return features[ind];
+}
+
+void Profiler::Init(const std::string &path, size_t sampleRate)
+{
+  UTIL_THROW_IF2(sampleRate == 0, "profile-sample-rate must be at least 1");
+  s_out.open(path.c_str());
+  UTIL_THROW_IF2(!s_out.good(), "Couldn't open profile file " << path);
+
+#if defined(__x86_64__) || defined(__i386__)
+  // how fast the time stamp counter runs
+  double startTime = util::WallTime();
+  uint64_t startTicks = GetTicks();
+  double time;
+  do {
+    time = util::WallTime();
+  } while (time - startTime < 0.02);
+  s_ticksPerSecond = (GetTicks() - startTicks) / (time - startTime);
+#endif
+
+  s_sampleRate = sampleRate;
+  s_enabled = true;
+  atexit(WriteTotals);
+}
+
+Profiler::Data *Profiler::GetThreadData()
+{
+  Data *data = s_threadData.get();
+  if (data == NULL) {
+    data = new Data;
+    s_threadData.reset(data);
+  }
+  return data;
+}
+
+void Profiler::StartSentence(long translationId)
+{
+  if (!s_enabled) return;
+  Data &data = *GetThreadData();
+  data.Clear();
+  data.translationId = translationId;
+  data.startTicks = GetTicks();
+}
+
+void Profiler::EndSentence()
+{
+  if (!s_enabled) return;
+  Data &data = *GetThreadData();
+  data.ticks = GetTicks() - data.startTicks;
+
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(s_mutex);
+#endif
+  const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+  for (size_t i = s_names.size(); i < ffs.size(); ++i) {
+    s_names.push_back(ffs[i]->GetScoreProducerDescription());
+  }
+  WriteData(s_out, data, s_ticksPerSecond);
+  s_out.flush();
+  s_totals.Add(data);
+}
+
+void Profiler::WriteTotals()
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(s_mutex);
+#endif
+  WriteData(s_out, s_totals, s_ticksPerSecond);
+  s_out.close();
+}
+
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#else
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "util/usage.hh"
+
+namespace Moses
+{
+
+class FeatureFunction;
+
+/** Instrumentation of the decoder's hot paths, switched on with
+ *  -profile <file>.  For every sentence it records the calls to each feature
+ *  function's Evaluate* methods and each phrase table's lookups, the time
+ *  spent in them, in collecting options, search and n-best extraction, and
+ *  the hypotheses created, recombined and pruned in each stack.
+ *
+ *  Each thread counts into its own ProfileData.  Only 1 in
+ *  profile-sample-rate calls of each kind is timed, with the time stamp
+ *  counter where there is one, and the time of all of them is estimated from
+ *  the sample.  At the end of a sentence its counts are written to the file
+ *  as a line of JSON and added to the totals, which are written as the last
+ *  line when the decoder exits.  When profiling is off each hook only tests
+ *  a static bool.
+ */
+class Profiler
+{
+public:
+  enum Phase {
+    CollectOptions,
+    Search,
+    NBest,
+    NumPhases
+  };
+
+  enum CallType {
+    InIsolation,
+    WithSourceContext,
+    WhenApplied,
+    Lookup,
+    NumCallTypes
+  };
+
+  struct Entry {
+    uint64_t calls;
+    uint64_t sampled;
+    uint64_t ticks;
+
+    Entry() : calls(0), sampled(0), ticks(0) {}
+
+    void operator+=(const Entry &other) {
+      calls += other.calls;
+      sampled += other.sampled;
+      ticks += other.ticks;
+    }
+  };
+
+  struct StackCounts {
+    uint64_t created;
+    uint64_t recombined;
+    uint64_t pruned;
+
+    StackCounts() : created(0), recombined(0), pruned(0) {}
+  };
+
+  struct Data {
+    long translationId;
+    uint64_t startTicks;
+    uint64_t ticks;
+    // NumCallTypes entries for each feature function, by FeatureFunction::GetProfileId()
+    std::vector<Entry> features;
+    Entry phases[NumPhases];
+    // by the number of source words covered
+    std::vector<StackCounts> stacks;
+
+    Data() : translationId(-1), startTicks(0), ticks(0) {}
+
+    void Clear();
+    void Add(const Data &other);
+
+    Entry &GetEntry(const FeatureFunction &ff, CallType type);
+
+    StackCounts &GetStack(size_t stack) {
+      if (stack >= stacks.size()) {
+        stacks.resize(stack + 1);
+      }
+      return stacks[stack];
+    }
+  };
+
+  static bool IsEnabled() {
+    return s_enabled;
+  }
+
+  // Opens the output file and starts profiling.  Times 1 in sampleRate calls.
+  static void Init(const std::string &path, size_t sampleRate);
+
+  // The counters of this thread, or NULL if profiling is off.
+  static Data *GetData() {
+    return s_enabled ? GetThreadData() : NULL;
+  }
+
+  static void StartSentence(long translationId);
+  static void EndSentence();
+
+  static void AddCreated(size_t stack) {
+    if (s_enabled) ++GetThreadData()->GetStack(stack).created;
+  }
+  static void AddRecombined(size_t stack) {
+    if (s_enabled) ++GetThreadData()->GetStack(stack).recombined;
+  }
+  static void AddPruned(size_t stack) {
+    if (s_enabled) ++GetThreadData()->GetStack(stack).pruned;
+  }
+
+  static uint64_t GetTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(util::WallTime() * 1e9);
+#endif
+  }
+
+  static size_t GetSampleRate() {
+    return s_sampleRate;
+  }
+
+private:
+  static Data *GetThreadData();
+  static void WriteTotals();
+
+  static bool s_enabled;
+  static size_t s_sampleRate;
+  static double s_ticksPerSecond;
+};
+
+/** Times one call, if it is sampled, and counts it.  Does nothing if
+ *  constructed with NULL data, i.e. if profiling is off.
+ */
+class ProfileTimer
+{
+public:
+  ProfileTimer(Profiler::Data *data, const FeatureFunction &ff, Profiler::CallType type)
+    : m_entry(data ? &data->GetEntry(ff, type) : NULL) {
+    Start();
+  }
+
+  ProfileTimer(Profiler::Data *data, Profiler::Phase phase)
+    : m_entry(data ? &data->phases[phase] : NULL) {
+    Start();
+  }
+
+  ~ProfileTimer() {
+    if (m_entry && m_start) {
+      m_entry->ticks += Profiler::GetTicks() - m_start;
+    }
+  }
+
+private:
+  void Start() {
+    m_start = 0;
+    if (m_entry && m_entry->calls++ % Profiler::GetSampleRate() == 0) {
+      ++m_entry->sampled;
+      m_start = Profiler::GetTicks();
+    }
+  }
+
+  Profiler::Entry *m_entry;
+  uint64_t m_start;
+};
+
+}
@@ -2,6 +2,9 @@
 #include "Timer.h"
 #include "SearchNormal.h"
 #include "SentenceStats.h"
+#include "StaticData.h"
+#include "Profiler.h"
+#include "moses/FF/StatefulFeatureFunction.h"
 
 #include <boost/foreach.hpp>
 
@@ -20,9 +23,17 @@ SearchNormal(Manager& manager, const TranslationOptionCollection &transOptColl)
   : Search(manager)
   , m_hypoStackColl(manager.GetSource().GetSize() + 1)
   , m_transOptColl(transOptColl)
+  , m_deferExpansions(false)
 {
   VERBOSE(1, "Translating: " << m_source << endl);
 
+  BOOST_FOREACH(const StatefulFeatureFunction *ff,
+                StatefulFeatureFunction::GetStatefulFeatureFunctions()) {
+    if (ff->UsesWhenAppliedBatch()) {
+      m_batchFFs.push_back(ff);
+    }
+  }
+
   // initialize the stacks: create data structure and set limits
   std::vector < HypothesisStackNormal >::iterator iterStack;
   for (size_t ind = 0 ; ind < m_hypoStackColl.size() ; ++ind) {
@@ -60,11 +71,94 @@ ProcessOneStack(HypothesisStack* hstack)
   // go through each hypothesis on the stack and try to expand it
   // BOOST_FOREACH(Hypothesis* h, sourceHypoColl)
   HypothesisStackNormal::const_iterator h;
+  if (m_batchFFs.empty()) {
+    for (h = sourceHypoColl.begin(); h != sourceHypoColl.end(); ++h)
+      ProcessOneHypothesis(**h);
+    return true;
+  }
+
+  // find all expansions of the stack first, let the feature functions
+  // evaluate them in one batch, then build them in the same order as above
+  m_deferExpansions = true;
   for (h = sourceHypoColl.begin(); h != sourceHypoColl.end(); ++h)
     ProcessOneHypothesis(**h);
+  m_deferExpansions = false;
+
+  EvaluateDeferredExpansions();
+
+  for (size_t i = 0; i < m_deferredExpansions.size(); ++i) {
+    const Range &range = m_deferredExpansions[i].second;
+    ExpandAllHypotheses(*m_deferredExpansions[i].first,
+                        range.GetStartPos(), range.GetEndPos());
+  }
+  m_deferredExpansions.clear();
   return true;
 }
 
+/** Pass the expansions recorded while m_deferExpansions to the feature
+ * functions that evaluate them in a batch.  With early discarding, those
+ * that would already be discarded now are left out; the worst score of a
+ * stack only goes up while it is filled, so they would be later, too.
+ */
+void
+SearchNormal::
+EvaluateDeferredExpansions() const
+{
+  std::vector<HypothesisExpansion> expansions;
+  for (size_t i = 0; i < m_deferredExpansions.size(); ++i) {
+    const Hypothesis &hypothesis = *m_deferredExpansions[i].first;
+    const Range &range = m_deferredExpansions[i].second;
+    const TranslationOptionList* tol
+    = m_transOptColl.GetTranslationOptionList(range.GetStartPos(), range.GetEndPos());
+    if (!tol) continue;
+
+    float expectedScore = 0.0f;
+    if (m_options.search.UseEarlyDiscarding()) {
+      expectedScore = hypothesis.GetScore()
+                      + m_transOptColl.GetEstimatedScores().CalcEstimatedScore(
+                        hypothesis.GetWordsBitmap(), range.GetStartPos(), range.GetEndPos());
+    }
+
+    TranslationOptionList::const_iterator iter;
+    for (iter = tol->begin() ; iter != tol->end() ; ++iter) {
+      const TranslationOption &transOpt = **iter;
+      if (m_options.search.UseEarlyDiscarding()
+          && expectedScore + transOpt.GetFutureScore() < GetAllowedScore(hypothesis, transOpt)) {
+        continue;
+      }
+      expansions.push_back(HypothesisExpansion(&hypothesis, &transOpt));
+    }
+  }
+
+  if (expansions.empty()) return;
+  const StaticData &staticData = StaticData::Instance();
+  Profiler::Data *profile = Profiler::GetData();
+  BOOST_FOREACH(const StatefulFeatureFunction *ff, m_batchFFs) {
+    if (!staticData.IsFeatureFunctionIgnored(*ff)) {
+      ProfileTimer timer(profile, *ff, Profiler::WhenApplied);
+      ff->EvaluateWhenAppliedBatch(expansions);
+    }
+  }
+}
+
+/** Lowest score with which a hypothesis that applies transOpt to hypothesis
+ * is still built, for early discarding
+ */
+float
+SearchNormal::
+GetAllowedScore(const Hypothesis &hypothesis, const TranslationOption &transOpt) const
+{
+  // worst possible score may have changed -> recompute
+  size_t wordsTranslated = hypothesis.GetWordsBitmap().GetNumWordsCovered() + transOpt.GetSize();
+  float allowedScore = m_hypoStackColl[wordsTranslated]->GetWorstScore();
+  if (m_options.search.stack_diversity) {
+    WordsBitmapID id = hypothesis.GetWordsBitmap().GetIDPlus(transOpt.GetStartPos(), transOpt.GetEndPos());
+    float allowedScoreForBitmap = m_hypoStackColl[wordsTranslated]->GetWorstScoreForBitmap( id );
+    allowedScore = std::min( allowedScore, allowedScoreForBitmap );
+  }
+  return allowedScore + m_options.search.early_discarding_threshold;
+}
+
 
 /**
  * Main decoder loop that translates a sentence by expanding
@@ -233,6 +327,11 @@ void
 SearchNormal::
 ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos)
 {
+  if (m_deferExpansions) {
+    m_deferredExpansions.push_back(std::make_pair(&hypothesis, Range(startPos, endPos)));
+    return;
+  }
+
   // early discarding: check if hypothesis is too bad to build
   // this idea is explained in (Moore&Quirk, MT Summit 2007)
   float expectedScore = 0.0f;
@@ -318,15 +417,7 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis,
   } else
     // early discarding: check if hypothesis is too bad to build
   {
-    // worst possible score may have changed -> recompute
-    size_t wordsTranslated = hypothesis.GetWordsBitmap().GetNumWordsCovered() + transOpt.GetSize();
-    float allowedScore = m_hypoStackColl[wordsTranslated]->GetWorstScore();
-    if (m_options.search.stack_diversity) {
-      WordsBitmapID id = hypothesis.GetWordsBitmap().GetIDPlus(transOpt.GetStartPos(), transOpt.GetEndPos());
-      float allowedScoreForBitmap = m_hypoStackColl[wordsTranslated]->GetWorstScoreForBitmap( id );
-      allowedScore = std::min( allowedScore, allowedScoreForBitmap );
-    }
-    allowedScore += m_options.search.early_discarding_threshold;
+    float allowedScore = GetAllowedScore(hypothesis, transOpt);
 
     // add expected score of translation option
     expectedScore += transOpt.GetFutureScore();
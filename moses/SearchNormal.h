@@ -30,6 +30,15 @@ protected:
   /** pre-computed list of translation options for the phrases in this sentence */
   const TranslationOptionCollection &m_transOptColl;
 
+  /** feature functions that evaluate the expansions of a stack in a batch */
+  std::vector<const StatefulFeatureFunction*> m_batchFFs;
+
+  /** while m_deferExpansions, ExpandAllHypotheses() only records its
+   * arguments, so that the expansions of a stack are known before any of
+   * them is built */
+  bool m_deferExpansions;
+  std::vector<std::pair<const Hypothesis*, Range> > m_deferredExpansions;
+
   // functions for creating hypotheses
 
   virtual bool
@@ -48,6 +57,11 @@ protected:
                    float estimatedScore,
                    const Bitmap &bitmap);
 
+  void EvaluateDeferredExpansions() const;
+
+  float GetAllowedScore(const Hypothesis &hypothesis,
+                        const TranslationOption &transOpt) const;
+
 public:
   SearchNormal(Manager& manager, const TranslationOptionCollection &transOptColl);
   ~SearchNormal();
@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <string>
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/foreach.hpp>
 
 #include "moses/FF/Factory.h"
 #include "TypeDef.h"
@@ -39,6 +40,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "Util.h"
 #include "FactorCollection.h"
 #include "Timer.h"
+#include "Profiler.h"
 #include "TranslationOption.h"
 #include "DecodeGraph.h"
 #include "InputFileStream.h"
@@ -49,6 +51,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #ifdef WITH_THREADS
 #include <boost/thread.hpp>
+#include "ThreadPool.h"
 #endif
 #ifdef HAVE_CMPH
 #include "moses/TranslationModel/CompactPT/PhraseDictionaryCompact.h"
@@ -67,6 +70,7 @@ StaticData StaticData::s_instance;
 StaticData::StaticData()
   : m_options(new AllOptions)
   , m_requireSortingAfterSourceContext(false)
+  , m_loadThreadCount(1)
   , m_currentWeightSetting("default")
   , m_treeStructure(NULL)
   , m_coordSpaceNextID(1)
@@ -170,6 +174,44 @@ StaticData
 #endif
     }
   }
+
+  params = m_parameter->GetParam("load-threads");
+  if (params && params->size()) {
+    if (params->at(0) == "all") {
+#ifdef WITH_THREADS
+      m_loadThreadCount = boost::thread::hardware_concurrency();
+      if (!m_loadThreadCount) {
+        std::cerr << "-load-threads all specified but Boost doesn't know how many cores there are";
+        return false;
+      }
+#else
+      std::cerr << "-load-threads all specified but moses not built with thread support";
+      return false;
+#endif
+    } else {
+      int loadThreadCount = Scan<int>(params->at(0));
+      if (loadThreadCount < 1) {
+        std::cerr << "Specify at least one load thread.";
+        return false;
+      }
+      m_loadThreadCount = loadThreadCount;
+#ifndef WITH_THREADS
+      if (m_loadThreadCount > 1) {
+        std::cerr << "Error: Load thread count of " << params->at(0)
+                  << " but moses not built with thread support";
+        return false;
+      }
+#endif
+    }
+  }
+
+  string profile;
+  m_parameter->SetParameter<string>(profile, "profile", "");
+  if (!profile.empty()) {
+    size_t sampleRate;
+    m_parameter->SetParameter<size_t>(sampleRate, "profile-sample-rate", 1);
+    Profiler::Init(profile, sampleRate);
+  }
   return true;
 }
 
@@ -591,34 +633,209 @@ CleanUpAfterSentenceProcessing(ttasksptr const& ttask) const
   }
 }
 
+namespace
+{
+
+//! a feature function to be loaded, and those that wait for it
+struct ModelLoad {
+  FeatureFunction *ff;
+  size_t numWaitingFor; //! dependencies not loaded yet
+  std::vector<size_t> dependents;
+};
+
+void LoadModel(FeatureFunction &ff, AllOptions::ptr const& opts)
+{
+  VERBOSE(1, "Loading " << ff.GetScoreProducerDescription() << endl);
+  Timer timer;
+  timer.start();
+  ff.Load(opts);
+  VERBOSE(1, "Loaded " << ff.GetScoreProducerDescription() << " in "
+          << timer.get_elapsed_time() << " seconds" << endl);
+}
+
+#ifdef WITH_THREADS
+/** Loads each feature function in a thread pool as soon as the ones it
+ *  depends on are loaded.  The first error is thrown once the loads that
+ *  are running have finished.
+ */
+class ParallelModelLoader
+{
+public:
+  ParallelModelLoader(std::vector<ModelLoad> &models, AllOptions::ptr const& opts, size_t numThreads)
+    : m_models(models), m_opts(opts), m_pool(numThreads), m_numRunning(0) {
+  }
+
+  void Run() {
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      for (size_t i = 0; i < m_models.size(); ++i) {
+        if (m_models[i].numWaitingFor == 0) {
+          Submit(i);
+        }
+      }
+      while (m_numRunning > 0) {
+        m_done.wait(lock);
+      }
+    }
+    m_pool.Stop();
+    UTIL_THROW_IF2(!m_error.empty(), m_error);
+  }
+
+  void Load(size_t i) {
+    std::string error;
+    try {
+      LoadModel(*m_models[i].ff, m_opts);
+    } catch (const std::exception &e) {
+      error = e.what();
+    } catch (...) {
+      error = "unknown error";
+    }
+
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (!error.empty()) {
+      if (m_error.empty()) {
+        m_error = "Couldn't load " + m_models[i].ff->GetScoreProducerDescription() + ": " + error;
+      }
+    } else if (m_error.empty()) {
+      BOOST_FOREACH(size_t next, m_models[i].dependents) {
+        if (--m_models[next].numWaitingFor == 0) {
+          Submit(next);
+        }
+      }
+    }
+    if (--m_numRunning == 0) {
+      m_done.notify_all();
+    }
+  }
+
+private:
+  class LoadTask : public Task
+  {
+  public:
+    LoadTask(ParallelModelLoader &loader, size_t i) : m_loader(loader), m_i(i) {}
+    void Run() {
+      m_loader.Load(m_i);
+    }
+  private:
+    ParallelModelLoader &m_loader;
+    size_t m_i;
+  };
+
+  // with m_mutex held
+  void Submit(size_t i) {
+    ++m_numRunning;
+    m_pool.Submit(boost::shared_ptr<Task>(new LoadTask(*this, i)));
+  }
+
+  std::vector<ModelLoad> &m_models;
+  AllOptions::ptr const& m_opts;
+  ThreadPool m_pool;
+  boost::mutex m_mutex;
+  boost::condition_variable m_done;
+  size_t m_numRunning; //! submitted and not finished
+  std::string m_error;
+};
+#endif
+
+}
+
 void StaticData::LoadFeatureFunctions()
 {
+  // Phrase tables are loaded after the other feature functions, which may
+  // be applied to the rules as they are read.  Otherwise, a feature function
+  // waits for those it names with load-after=, and a combined phrase table
+  // for its members.
+  std::vector<ModelLoad> models;
+  std::map<std::string, size_t> indices;
   const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
-  std::vector<FeatureFunction*>::const_iterator iter;
-  for (iter = ffs.begin(); iter != ffs.end(); ++iter) {
-    FeatureFunction *ff = *iter;
-    bool doLoad = true;
-
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    FeatureFunction *ff = ffs[i];
     if (ff->RequireSortingAfterSourceContext()) {
       m_requireSortingAfterSourceContext = true;
     }
+    if (!dynamic_cast<PhraseDictionary*>(ff)) {
+      ModelLoad model = { ff, 0, std::vector<size_t>() };
+      indices[ff->GetScoreProducerDescription()] = models.size();
+      models.push_back(model);
+    }
+  }
+  const size_t numFeatures = models.size();
+
+  const std::vector<PhraseDictionary*> &pts = PhraseDictionary::GetColl();
+  for (size_t i = 0; i < pts.size(); ++i) {
+    ModelLoad model = { pts[i], numFeatures, std::vector<size_t>() };
+    for (size_t j = 0; j < numFeatures; ++j) {
+      models[j].dependents.push_back(models.size());
+    }
+    indices[pts[i]->GetScoreProducerDescription()] = models.size();
+    models.push_back(model);
+  }
 
-    if (dynamic_cast<PhraseDictionary*>(ff)) {
-      doLoad = false;
+  for (size_t i = 0; i < models.size(); ++i) {
+    BOOST_FOREACH(const std::string &name, models[i].ff->GetLoadDependencies()) {
+      std::map<std::string, size_t>::const_iterator iter = indices.find(name);
+      UTIL_THROW_IF2(iter == indices.end(),
+                     models[i].ff->GetScoreProducerDescription()
+                     << ": can't load after unknown feature function " << name);
+      models[iter->second].dependents.push_back(i);
+      ++models[i].numWaitingFor;
     }
+  }
 
-    if (doLoad) {
-      VERBOSE(1, "Loading " << ff->GetScoreProducerDescription() << endl);
-      ff->Load(options());
+  // the order of loading, to check there are no cycles.  Without load-after=
+  // it is the order they used to be loaded in, one after the other
+  std::vector<size_t> order;
+  {
+    std::vector<size_t> numWaitingFor(models.size());
+    std::set<size_t> ready;
+    for (size_t i = 0; i < models.size(); ++i) {
+      numWaitingFor[i] = models[i].numWaitingFor;
+      if (numWaitingFor[i] == 0) {
+        ready.insert(i);
+      }
+    }
+    while (!ready.empty()) {
+      size_t i = *ready.begin();
+      ready.erase(ready.begin());
+      order.push_back(i);
+      BOOST_FOREACH(size_t next, models[i].dependents) {
+        if (--numWaitingFor[next] == 0) {
+          ready.insert(next);
+        }
+      }
     }
   }
+  if (order.size() < models.size()) {
+    util::StringStream msg;
+    msg << "Circular load-after dependencies between feature functions:";
+    std::vector<bool> ordered(models.size(), false);
+    BOOST_FOREACH(size_t i, order) {
+      ordered[i] = true;
+    }
+    for (size_t i = 0; i < models.size(); ++i) {
+      if (!ordered[i]) {
+        msg << " " << models[i].ff->GetScoreProducerDescription();
+      }
+    }
+    UTIL_THROW2(msg.str());
+  }
 
-  const std::vector<PhraseDictionary*> &pts = PhraseDictionary::GetColl();
-  for (size_t i = 0; i < pts.size(); ++i) {
-    PhraseDictionary *pt = pts[i];
-    VERBOSE(1, "Loading " << pt->GetScoreProducerDescription() << endl);
-    pt->Load(options());
+  Timer timer;
+  timer.start();
+#ifdef WITH_THREADS
+  if (m_loadThreadCount > 1) {
+    ParallelModelLoader loader(models, options(), m_loadThreadCount);
+    loader.Run();
+  } else
+#endif
+  {
+    BOOST_FOREACH(size_t i, order) {
+      LoadModel(*models[i].ff, options());
+    }
   }
+  VERBOSE(1, "Loaded " << models.size() << " feature functions in "
+          << timer.get_elapsed_time() << " seconds with "
+          << m_loadThreadCount << " thread(s)" << endl);
 
   CheckLEGACYPT();
 }
@@ -111,6 +111,7 @@ protected:
   UnknownLHSList m_unknownLHS;
 
   int m_threadCount;
+  size_t m_loadThreadCount; //! threads to load the feature functions with
   // long m_startTranslationId;
 
   // alternate weight settings
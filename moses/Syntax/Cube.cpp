@@ -6,6 +6,7 @@
 #include "moses/StaticData.h"
 
 #include "SVertex.h"
+#include "SVertexRecombinationHasher.h"
 
 namespace Moses
 {
@@ -130,6 +131,7 @@ SHyperedge *Cube::CreateHyperedge(const std::vector<int> &coordinates)
         ffs[i]->EvaluateWhenApplied(*hyperedge, i, &hyperedge->label.deltas);
     }
   }
+  head->recombinationHash = SVertexRecombinationHasher::HashStates(head->states);
 
   // Calculate future score.
 
@@ -1,11 +1,16 @@
 // -*- c++ -*-
 #pragma once
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
+#include <boost/bind.hpp>
+
 #include "moses/DecodeGraph.h"
+#include "moses/ParallelSpans.h"
 #include "moses/StaticData.h"
+#include "moses/Timer.h"
 #include "moses/Syntax/BoundedPriorityContainer.h"
 #include "moses/Syntax/CubeQueue.h"
 #include "moses/Syntax/PHyperedge.h"
@@ -160,10 +165,7 @@ void Manager<Parser>::FindOovs(const PChart &pchart, boost::unordered_set<Word>
 template<typename Parser>
 void Manager<Parser>::Decode()
 {
-  // Get various pruning-related constants.
-  const std::size_t popLimit = options()->cube.pop_limit;
   const std::size_t ruleLimit = options()->syntax.rule_limit;
-  const std::size_t stackLimit = options()->search.stack_size;
 
   // Initialise the PChart and SChart.
   InitializeCharts();
@@ -171,85 +173,160 @@ void Manager<Parser>::Decode()
   // Initialize the parsers.
   InitializeParsers(m_pchart, ruleLimit);
 
-  // Create a callback to process the PHyperedges produced by the parsers.
-  typename Parser::CallbackType callback(m_schart, ruleLimit);
+  // Time spent parsing (i.e. enumerating PHyperedges and converting them to
+  // SHyperedgeBundles) and time spent in cube pruning, reported separately.
+  Timer timer;
+  timer.start();
+  double parseTime = 0.0;
+  double searchTime = 0.0;
 
-  // Visit each cell of PChart in right-to-left depth-first order.
   std::size_t size = m_source.GetSize();
-  for (int start = size-1; start >= 0; --start) {
-    for (std::size_t width = 1; width <= size-start; ++width) {
-      std::size_t end = start + width - 1;
-
-      //PChart::Cell &pcell = m_pchart.GetCell(start, end);
-      SChart::Cell &scell = m_schart.GetCell(start, end);
-
-      Range range(start, end);
-
-      // Call the parsers to generate PHyperedges for this span and convert
-      // each one to a SHyperedgeBundle (via the callback).  The callback
-      // prunes the SHyperedgeBundles and keeps the best ones (up to ruleLimit).
-      callback.InitForRange(range);
-      for (typename std::vector<boost::shared_ptr<Parser> >::iterator
-           p = m_parsers.begin(); p != m_parsers.end(); ++p) {
-        (*p)->EnumerateHyperedges(range, callback);
-      }
 
-      // Retrieve the (pruned) set of SHyperedgeBundles from the callback.
-      const BoundedPriorityContainer<SHyperedgeBundle> &bundles =
-        callback.GetContainer();
-
-      // Use cube pruning to extract SHyperedges from SHyperedgeBundles.
-      // Collect the SHyperedges into buffers, one for each category.
-      CubeQueue cubeQueue(bundles.Begin(), bundles.End());
-      std::size_t count = 0;
-      typedef boost::unordered_map<Word, std::vector<SHyperedge*>,
-              SymbolHasher, SymbolEqualityPred > BufferMap;
-      BufferMap buffers;
-      while (count < popLimit && !cubeQueue.IsEmpty()) {
-        SHyperedge *hyperedge = cubeQueue.Pop();
-        // BEGIN{HACK}
-        // The way things currently work, the LHS of each hyperedge is not
-        // determined until just before the point of its creation, when a
-        // target phrase is selected from the list of possible phrases (which
-        // happens during cube pruning).  The cube pruning code doesn't (and
-        // shouldn't) know about the contents of PChart and so creation of
-        // the PVertex is deferred until this point.
-        const Word &lhs = hyperedge->label.translation->GetTargetLHS();
-        hyperedge->head->pvertex = &m_pchart.AddVertex(PVertex(range, lhs));
-        // END{HACK}
-        buffers[lhs].push_back(hyperedge);
-        ++count;
+  const std::size_t numThreads = options()->syntax.s2t_parsing_threads;
+  if (numThreads > 1 && Parser::SupportsParallelParsing()) {
+    // The spans of each width are parsed in parallel, then searched one at a
+    // time: feature functions are only ever called from this thread.
+    std::vector<boost::shared_ptr<typename Parser::CallbackType> > callbacks;
+    for (std::size_t i = 0; i < size; ++i) {
+      callbacks.push_back(boost::shared_ptr<typename Parser::CallbackType>(
+                            new typename Parser::CallbackType(m_schart,
+                                ruleLimit)));
+    }
+    for (std::size_t width = 1; width <= size; ++width) {
+      const double t0 = timer.get_elapsed_time();
+      const std::size_t numSpans = size-width+1;
+      ParallelSpans::ForEachSpan(size, width, numThreads,
+                                 boost::bind(&Manager<Parser>::ParseSpan, this,
+                                             width, boost::ref(callbacks), _1));
+      const double t1 = timer.get_elapsed_time();
+      for (int start = numSpans-1; start >= 0; --start) {
+        Range range(start, start+width-1);
+        SearchSpan(range, callbacks[start]->GetContainer());
       }
+      parseTime += t1-t0;
+      searchTime += timer.get_elapsed_time()-t1;
+    }
+  } else {
+    // Create a callback to process the PHyperedges produced by the parsers.
+    typename Parser::CallbackType callback(m_schart, ruleLimit);
+
+    // Visit each cell of PChart in right-to-left depth-first order.
+    for (int start = size-1; start >= 0; --start) {
+      for (std::size_t width = 1; width <= size-start; ++width) {
+        std::size_t end = start + width - 1;
+
+        Range range(start, end);
+
+        const double t0 = timer.get_elapsed_time();
+
+        // Call the parsers to generate PHyperedges for this span and convert
+        // each one to a SHyperedgeBundle (via the callback).  The callback
+        // prunes the SHyperedgeBundles and keeps the best ones (up to
+        // ruleLimit).
+        callback.InitForRange(range);
+        for (typename std::vector<boost::shared_ptr<Parser> >::iterator
+             p = m_parsers.begin(); p != m_parsers.end(); ++p) {
+          (*p)->EnumerateHyperedges(range, callback);
+        }
+
+        const double t1 = timer.get_elapsed_time();
 
-      // Recombine SVertices and sort into stacks.
-      for (BufferMap::const_iterator p = buffers.begin(); p != buffers.end();
-           ++p) {
-        const Word &category = p->first;
-        const std::vector<SHyperedge*> &buffer = p->second;
-        std::pair<SChart::Cell::NMap::Iterator, bool> ret =
-          scell.nonTerminalStacks.Insert(category, SVertexStack());
-        assert(ret.second);
-        SVertexStack &stack = ret.first->second;
-        RecombineAndSort(buffer, stack);
+        // Retrieve the (pruned) set of SHyperedgeBundles from the callback
+        // and search them.
+        SearchSpan(range, callback.GetContainer());
+
+        parseTime += t1-t0;
+        searchTime += timer.get_elapsed_time()-t1;
       }
+    }
+  }
 
-      // Prune stacks.
-      if (stackLimit > 0) {
-        for (SChart::Cell::NMap::Iterator p = scell.nonTerminalStacks.Begin();
-             p != scell.nonTerminalStacks.End(); ++p) {
-          SVertexStack &stack = p->second;
-          if (stack.size() > stackLimit) {
-            stack.resize(stackLimit);
-          }
-        }
+  VERBOSE(2, "Line " << m_source.GetTranslationId() << ": Parsing took "
+          << parseTime << " seconds, search took " << searchTime
+          << " seconds" << std::endl);
+}
+
+// Parse the span of the given width starting at start, leaving its bundles
+// in callbacks[start].
+template<typename Parser>
+void Manager<Parser>::ParseSpan(
+  std::size_t width,
+  std::vector<boost::shared_ptr<typename Parser::CallbackType> > &callbacks,
+  std::size_t start)
+{
+  Range range(start, start+width-1);
+  typename Parser::CallbackType &callback = *callbacks[start];
+  callback.InitForRange(range);
+  for (typename std::vector<boost::shared_ptr<Parser> >::iterator
+       p = m_parsers.begin(); p != m_parsers.end(); ++p) {
+    (*p)->EnumerateHyperedges(range, callback);
+  }
+}
+
+// Use the bundles produced by the parsers for a span to fill its SChart cell
+// (and add the vertices for the new categories to its PChart cell).
+template<typename Parser>
+void Manager<Parser>::SearchSpan(
+  const Range &range, const BoundedPriorityContainer<SHyperedgeBundle> &bundles)
+{
+  // Get various pruning-related constants.
+  const std::size_t popLimit = options()->cube.pop_limit;
+  const std::size_t stackLimit = options()->search.stack_size;
+
+  //PChart::Cell &pcell = m_pchart.GetCell(start, end);
+  SChart::Cell &scell = m_schart.GetCell(range.GetStartPos(),
+                                         range.GetEndPos());
+
+  // Use cube pruning to extract SHyperedges from SHyperedgeBundles.
+  // Collect the SHyperedges into buffers, one for each category.
+  CubeQueue cubeQueue(bundles.Begin(), bundles.End());
+  std::size_t count = 0;
+  typedef boost::unordered_map<Word, std::vector<SHyperedge*>,
+          SymbolHasher, SymbolEqualityPred > BufferMap;
+  BufferMap buffers;
+  while (count < popLimit && !cubeQueue.IsEmpty()) {
+    SHyperedge *hyperedge = cubeQueue.Pop();
+    // BEGIN{HACK}
+    // The way things currently work, the LHS of each hyperedge is not
+    // determined until just before the point of its creation, when a
+    // target phrase is selected from the list of possible phrases (which
+    // happens during cube pruning).  The cube pruning code doesn't (and
+    // shouldn't) know about the contents of PChart and so creation of
+    // the PVertex is deferred until this point.
+    const Word &lhs = hyperedge->label.translation->GetTargetLHS();
+    hyperedge->head->pvertex = &m_pchart.AddVertex(PVertex(range, lhs));
+    // END{HACK}
+    buffers[lhs].push_back(hyperedge);
+    ++count;
+  }
+
+  // Recombine SVertices and sort into stacks.
+  for (BufferMap::const_iterator p = buffers.begin(); p != buffers.end();
+       ++p) {
+    const Word &category = p->first;
+    const std::vector<SHyperedge*> &buffer = p->second;
+    std::pair<SChart::Cell::NMap::Iterator, bool> ret =
+      scell.nonTerminalStacks.Insert(category, SVertexStack());
+    assert(ret.second);
+    SVertexStack &stack = ret.first->second;
+    RecombineAndSort(buffer, stack);
+  }
+
+  // Prune stacks.
+  if (stackLimit > 0) {
+    for (SChart::Cell::NMap::Iterator p = scell.nonTerminalStacks.Begin();
+         p != scell.nonTerminalStacks.End(); ++p) {
+      SVertexStack &stack = p->second;
+      if (stack.size() > stackLimit) {
+        stack.resize(stackLimit);
       }
+    }
+  }
 
-      // Prune the PChart cell for this span by removing vertices for
-      // categories that don't occur in the SChart.
+  // Prune the PChart cell for this span by removing vertices for
+  // categories that don't occur in the SChart.
 // Note: see HACK above.  Pruning the chart isn't currently necessary.
 //      PrunePChart(scell, pcell);
-    }
-  }
 }
 
 template<typename Parser>
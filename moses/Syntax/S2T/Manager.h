@@ -6,8 +6,10 @@
 #include <boost/shared_ptr.hpp>
 
 #include "moses/InputType.h"
+#include "moses/Syntax/BoundedPriorityContainer.h"
 #include "moses/Syntax/KBestExtractor.h"
 #include "moses/Syntax/Manager.h"
+#include "moses/Syntax/SHyperedgeBundle.h"
 #include "moses/Syntax/SVertexStack.h"
 #include "moses/Word.h"
 
@@ -51,6 +53,13 @@ private:
 
   void InitializeParsers(PChart &, std::size_t);
 
+  void ParseSpan(std::size_t,
+                 std::vector<boost::shared_ptr<typename Parser::CallbackType> > &,
+                 std::size_t);
+
+  void SearchSpan(const Range &,
+                  const BoundedPriorityContainer<SHyperedgeBundle> &);
+
   void RecombineAndSort(const std::vector<SHyperedge*> &, SVertexStack &);
 
   void PrunePChart(const SChart::Cell &, PChart::Cell &);
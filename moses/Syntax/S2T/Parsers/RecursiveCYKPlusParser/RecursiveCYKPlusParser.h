@@ -31,6 +31,12 @@ public:
     return true;
   }
 
+  // The eager callback relies on spans being visited in right-to-left,
+  // depth-first order.
+  static bool SupportsParallelParsing() {
+    return false;
+  }
+
   RecursiveCYKPlusParser(PChart &, const RuleTrie &, std::size_t);
 
   ~RecursiveCYKPlusParser() {}
@@ -24,6 +24,7 @@ template<typename Callback>
 Scope3Parser<Callback>::Scope3Parser(PChart &chart, const RuleTrie &trie,
                                      std::size_t maxChartSpan)
   : Parser<Callback>(chart)
+  , m_patPool("PatternApplicationTrie", 1000)
   , m_ruleTable(trie)
   , m_maxChartSpan(maxChartSpan)
   , m_latticeBuilder(chart)
@@ -31,12 +32,6 @@ Scope3Parser<Callback>::Scope3Parser(PChart &chart, const RuleTrie &trie,
   Init();
 }
 
-template<typename Callback>
-Scope3Parser<Callback>::~Scope3Parser()
-{
-  delete m_patRoot;
-}
-
 template<typename Callback>
 void Scope3Parser<Callback>::
 EnumerateHyperedges(const Range &range, Callback &callback)
@@ -47,20 +42,29 @@ EnumerateHyperedges(const Range &range, Callback &callback)
   const std::vector<const PatternApplicationTrie *> &patNodes =
     m_patSpans[start][end-start+1];
 
+  if (patNodes.empty()) {
+    return;
+  }
+
+  Workspace &ws = *AcquireWorkspace();
+
   for (std::vector<const PatternApplicationTrie *>::const_iterator
        p = patNodes.begin(); p != patNodes.end(); ++p) {
     const PatternApplicationTrie *patNode = *p;
 
     // Read off the sequence of PAT nodes ending at patNode.
-    patNode->ReadOffPatternApplicationKey(m_patKey);
+    patNode->ReadOffPatternApplicationKey(ws.patKey);
 
     // Calculate the start and end ranges for each symbol in the PAT key.
-    m_symbolRangeCalculator.Calc(m_patKey, start, end, m_symbolRanges);
+    ws.symbolRangeCalculator.Calc(ws.patKey, start, end, ws.symbolRanges);
 
     // Build a lattice that encodes the set of PHyperedge tails that can be
-    // generated from this pattern + span.
-    m_latticeBuilder.Build(m_patKey, m_symbolRanges, m_lattice,
-                           m_quickCheckTable);
+    // generated from this pattern + span.  If one of the gaps can't be
+    // filled then there are no tails.
+    if (!m_latticeBuilder.Build(ws.patKey, ws.symbolRanges, ws.lattice,
+                                ws.quickCheckTable)) {
+      continue;
+    }
 
     // Ask the grammar for the mapping from label sequences to target phrase
     // collections for this pattern.
@@ -68,21 +72,22 @@ EnumerateHyperedges(const Range &range, Callback &callback)
 
     // For each label sequence, search the lattice for the set of PHyperedge
     // tails.
-    TailLatticeSearcher<Callback> searcher(m_lattice, m_patKey, m_symbolRanges);
+    TailLatticeSearcher<Callback> searcher(ws.lattice, ws.patKey,
+                                           ws.symbolRanges);
     RuleTrie::Node::LabelMap::const_iterator q = labelMap.begin();
     for (; q != labelMap.end(); ++q) {
       const std::vector<int> &labelSeq = q->first;
       TargetPhraseCollection::shared_ptr tpc = q->second;
       // For many label sequences there won't be any corresponding paths through
-      // the lattice.  As an optimisation, we use m_quickCheckTable to test
+      // the lattice.  As an optimisation, we use the quick check table to test
       // for this and we don't begin a search if there are no paths to find.
       bool failCheck = false;
       std::size_t nonTermIndex = 0;
-      for (std::size_t i = 0; i < m_patKey.size(); ++i) {
-        if (m_patKey[i]->IsTerminalNode()) {
+      for (std::size_t i = 0; i < ws.patKey.size(); ++i) {
+        if (ws.patKey[i]->IsTerminalNode()) {
           continue;
         }
-        if (!m_quickCheckTable[nonTermIndex][labelSeq[nonTermIndex]]) {
+        if (!ws.quickCheckTable[nonTermIndex][labelSeq[nonTermIndex]]) {
           failCheck = true;
           break;
         }
@@ -94,6 +99,33 @@ EnumerateHyperedges(const Range &range, Callback &callback)
       searcher.Search(labelSeq, tpc, callback);
     }
   }
+
+  ReleaseWorkspace(&ws);
+}
+
+template<typename Callback>
+typename Scope3Parser<Callback>::Workspace *
+Scope3Parser<Callback>::AcquireWorkspace()
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_workspaceMutex);
+#endif
+  if (m_idleWorkspaces.empty()) {
+    m_workspaces.push_back(boost::shared_ptr<Workspace>(new Workspace()));
+    return m_workspaces.back().get();
+  }
+  Workspace *ws = m_idleWorkspaces.back();
+  m_idleWorkspaces.pop_back();
+  return ws;
+}
+
+template<typename Callback>
+void Scope3Parser<Callback>::ReleaseWorkspace(Workspace *ws)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_workspaceMutex);
+#endif
+  m_idleWorkspaces.push_back(ws);
 }
 
 template<typename Callback>
@@ -105,8 +137,9 @@ void Scope3Parser<Callback>::Init()
 
   // Build the pattern application trie (PAT) for this input sentence.
   const RuleTrie::Node &root = m_ruleTable.GetRootNode();
-  m_patRoot = new PatternApplicationTrie(-1, -1, root, 0, 0);
-  m_patRoot->Extend(root, -1, sentMap, false);
+  m_patRoot = new (m_patPool.getPtr()) PatternApplicationTrie(-1, -1, root,
+      0, 0);
+  m_patRoot->Extend(root, -1, sentMap, false, m_patPool);
 
   // Generate per-span lists of PAT node pointers.
   InitRuleApplicationVector();
@@ -3,6 +3,12 @@
 #include <memory>
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
 #include "moses/Syntax/S2T/Parsers/Parser.h"
 #include "moses/Syntax/S2T/RuleTrieScope3.h"
 #include "moses/Range.h"
@@ -37,27 +43,49 @@ public:
     return false;
   }
 
+  // EnumerateHyperedges only reads the chart cells inside the span, so it
+  // can be called concurrently for spans of the same width.
+  static bool SupportsParallelParsing() {
+    return true;
+  }
+
   Scope3Parser(PChart &, const RuleTrie &, std::size_t);
 
-  ~Scope3Parser();
+  ~Scope3Parser() {}
 
   void EnumerateHyperedges(const Range &, Callback &);
 
 private:
+  // Scratch space used by EnumerateHyperedges.  It is kept from span to span
+  // so that the vectors don't have to be reallocated.  There is one per
+  // concurrent call.
+  struct Workspace {
+    std::vector<std::vector<bool> > quickCheckTable;
+    TailLattice lattice;
+    SymbolRangeCalculator symbolRangeCalculator;
+    std::vector<SymbolRange> symbolRanges;
+    PatternApplicationKey patKey;
+  };
+
   void Init();
   void InitRuleApplicationVector();
   void FillSentenceMap(SentenceMap &);
   void RecordPatternApplicationSpans(const PatternApplicationTrie &);
 
+  Workspace *AcquireWorkspace();
+  void ReleaseWorkspace(Workspace *);
+
+  PatternApplicationTriePool m_patPool;
   PatternApplicationTrie *m_patRoot;
-  std::vector<std::vector<bool> > m_quickCheckTable;
   const RuleTrie &m_ruleTable;
   const std::size_t m_maxChartSpan;
-  TailLattice m_lattice;
   TailLatticeBuilder m_latticeBuilder;
-  SymbolRangeCalculator m_symbolRangeCalculator;
-  std::vector<SymbolRange> m_symbolRanges;
-  PatternApplicationKey m_patKey;
+
+  std::vector<boost::shared_ptr<Workspace> > m_workspaces;
+  std::vector<Workspace *> m_idleWorkspaces;
+#ifdef WITH_THREADS
+  boost::mutex m_workspaceMutex;
+#endif
 
   /* m_patSpans[i][j] records the set of all PAT nodes for span [i,i+j]
      i.e. j is the width of the span */
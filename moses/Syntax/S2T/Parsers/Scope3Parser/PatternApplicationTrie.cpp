@@ -9,14 +9,6 @@ namespace Syntax
 namespace S2T
 {
 
-int PatternApplicationTrie::Depth() const
-{
-  if (m_parent) {
-    return m_parent->Depth() + 1;
-  }
-  return 0;
-}
-
 const PatternApplicationTrie *
 PatternApplicationTrie::GetHighestTerminalNode() const
 {
@@ -135,7 +127,8 @@ void PatternApplicationTrie::DetermineEndRange(int sentenceLength,
 
 void PatternApplicationTrie::Extend(const RuleTrieScope3::Node &node,
                                     int minPos, const SentenceMap &sentMap,
-                                    bool followsGap)
+                                    bool followsGap,
+                                    PatternApplicationTriePool &pool)
 {
   const RuleTrieScope3::Node::TerminalMap &termMap = node.GetTerminalMap();
   for (RuleTrieScope3::Node::TerminalMap::const_iterator p = termMap.begin();
@@ -154,9 +147,9 @@ void PatternApplicationTrie::Extend(const RuleTrieScope3::Node &node,
       if (start == (std::size_t)minPos ||
           (followsGap && start > (std::size_t)minPos) ||
           minPos == -1) {
-        PatternApplicationTrie *subTrie =
-          new PatternApplicationTrie(start, end, child, v, this);
-        subTrie->Extend(child, end+1, sentMap, false);
+        PatternApplicationTrie *subTrie = new (pool.getPtr())
+        PatternApplicationTrie(start, end, child, v, this);
+        subTrie->Extend(child, end+1, sentMap, false, pool);
         m_children.push_back(subTrie);
       }
     }
@@ -167,10 +160,10 @@ void PatternApplicationTrie::Extend(const RuleTrieScope3::Node &node,
     return;
   }
   int start = followsGap ? -1 : minPos;
-  PatternApplicationTrie *subTrie =
-    new PatternApplicationTrie(start, -1, *child, 0, this);
+  PatternApplicationTrie *subTrie = new (pool.getPtr())
+  PatternApplicationTrie(start, -1, *child, 0, this);
   int newMinPos = (minPos == -1 ? 1 : minPos+1);
-  subTrie->Extend(*child, newMinPos, sentMap, true);
+  subTrie->Extend(*child, newMinPos, sentMap, true, pool);
   m_children.push_back(subTrie);
 }
 
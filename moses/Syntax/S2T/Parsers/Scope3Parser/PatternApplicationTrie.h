@@ -2,6 +2,7 @@
 
 #include <vector>
 
+#include "moses/ObjectPool.h"
 #include "moses/Syntax/S2T/RuleTrieScope3.h"
 #include "moses/Util.h"
 
@@ -18,6 +19,10 @@ struct PatternApplicationTrie;
 
 typedef std::vector<const PatternApplicationTrie*> PatternApplicationKey;
 
+// Nodes are allocated from a per-sentence pool, which owns them.  A node does
+// not delete its children.
+typedef ObjectPool<PatternApplicationTrie> PatternApplicationTriePool;
+
 struct PatternApplicationTrie {
 public:
   PatternApplicationTrie(int start, int end, const RuleTrieScope3::Node &node,
@@ -27,15 +32,14 @@ public:
     , m_node(&node)
     , m_pvertex(pvertex)
     , m_parent(parent)
+    , m_depth(parent ? parent->m_depth+1 : 0)
     , m_highestTerminalNode(0)
     , m_lowestTerminalNode(0) {}
 
-  ~PatternApplicationTrie() {
-    RemoveAllInColl(m_children);
+  int Depth() const {
+    return m_depth;
   }
 
-  int Depth() const;
-
   bool IsGapNode() const {
     return m_end == -1;
   }
@@ -50,7 +54,8 @@ public:
   void DetermineEndRange(int, int &, int &) const;
 
   void Extend(const RuleTrieScope3::Node &node, int minPos,
-              const SentenceMap &sentMap, bool followsGap);
+              const SentenceMap &sentMap, bool followsGap,
+              PatternApplicationTriePool &pool);
 
   void ReadOffPatternApplicationKey(PatternApplicationKey &) const;
 
@@ -59,6 +64,7 @@ public:
   const RuleTrieScope3::Node *m_node;
   const PVertex *m_pvertex;
   PatternApplicationTrie *m_parent;
+  int m_depth;
   std::vector<PatternApplicationTrie*> m_children;
   mutable const PatternApplicationTrie *m_highestTerminalNode;
   mutable const PatternApplicationTrie *m_lowestTerminalNode;
@@ -9,7 +9,7 @@ namespace Syntax
 namespace S2T
 {
 
-void TailLatticeBuilder::Build(
+bool TailLatticeBuilder::Build(
   const std::vector<const PatternApplicationTrie *> &key,
   const std::vector<SymbolRange> &ranges,
   TailLattice &lattice,
@@ -41,25 +41,42 @@ void TailLatticeBuilder::Build(
     }
     const std::vector<Word> &labelVec = labelTable[nonTermIndex];
     assert(checkTable[nonTermIndex].size() == labelVec.size());
+    bool fillable = false;
     for (int s = range.minStart; s <= range.maxStart; ++s) {
       for (int e = std::max(s, range.minEnd); e <= range.maxEnd; ++e) {
         assert(e-s >= 0);
         std::size_t offset = s - spanStart;
         std::size_t width = e - s + 1;
-        assert(lattice[offset][nonTermIndex+1][width].empty());
+        std::vector<const PVertex *> &arcs =
+          lattice[offset][nonTermIndex+1][width];
+        assert(arcs.empty());
+        const PChart::Cell::NMap &vertices =
+          m_chart.GetCell(s, e).nonTerminalVertices;
+        // Most cells have no non-terminal vertices, so don't bother looking
+        // up the labels.
+        if (vertices.IsEmpty()) {
+          arcs.resize(labelVec.size(), 0);
+          continue;
+        }
         std::vector<bool>::iterator q = checkTable[nonTermIndex].begin();
         for (std::vector<Word>::const_iterator p = labelVec.begin();
              p != labelVec.end(); ++p, ++q) {
           const Word &label = *p;
-          const PVertex *v =
-            m_chart.GetCell(s, e).nonTerminalVertices.Find(label);
-          lattice[offset][nonTermIndex+1][width].push_back(v);
-          *q = (*q || static_cast<bool>(v));
+          const PVertex *v = vertices.Find(label);
+          arcs.push_back(v);
+          if (v) {
+            *q = true;
+            fillable = true;
+          }
         }
       }
     }
+    if (!fillable) {
+      return false;
+    }
     ++nonTermIndex;
   }
+  return true;
 }
 
 // Extend the lattice if necessary and clear the innermost vectors.
@@ -21,8 +21,9 @@ public:
   TailLatticeBuilder(PChart &chart) : m_chart(chart) {}
 
   // Given a key from a PatternApplicationTrie and the valid ranges of its
-  // symbols, construct a TailLattice.
-  void Build(const std::vector<const PatternApplicationTrie *> &,
+  // symbols, construct a TailLattice.  Returns false if there is a gap that
+  // no PVertex can fill, in which case the lattice has no full paths.
+  bool Build(const std::vector<const PatternApplicationTrie *> &,
              const std::vector<SymbolRange> &,
              TailLattice &, std::vector<std::vector<bool> > &);
 
@@ -27,6 +27,14 @@ public:
             const std::string &inFile,
             const RuleTableFF &,
             RuleTrie &);
+
+private:
+  bool LoadBinary(Moses::AllOptions const& opts,
+                  const std::vector<FactorType> &input,
+                  const std::vector<FactorType> &output,
+                  const std::string &inFile,
+                  const RuleTableFF &,
+                  RuleTrie &);
 };
 
 }  // namespace S2T
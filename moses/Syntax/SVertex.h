@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 
 namespace Moses
@@ -18,12 +19,17 @@ struct SHyperedge;
 // Important: a SVertex owns its incoming SHyperedge objects and its FFState
 // objects and will delete them on destruction.
 struct SVertex {
+  SVertex() : best(0), pvertex(0), recombinationHash(0) {}
+
   ~SVertex();
 
   SHyperedge *best;
   std::vector<SHyperedge*> recombined;
   const PVertex *pvertex;
   std::vector<FFState*> states;
+  // Hash of the states, for recombination.  Set with the states; until then
+  // 0, the hash of no states (as for the lexical vertices of the charts).
+  std::size_t recombinationHash;
 };
 
 }  // Syntax
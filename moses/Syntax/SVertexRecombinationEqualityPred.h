@@ -14,6 +14,10 @@ class SVertexRecombinationEqualityPred
 public:
   bool operator()(const SVertex *v1, const SVertex *v2) const {
     assert(v1->states.size() == v2->states.size());
+    // Equal states have equal hashes.
+    if (v1->recombinationHash != v2->recombinationHash) {
+      return false;
+    }
     for (std::size_t i = 0; i < v1->states.size(); ++i) {
       if (*(v1->states[i]) != *(v2->states[i])) {
         return false;
@@ -13,9 +13,14 @@ class SVertexRecombinationHasher
 {
 public:
   std::size_t operator()(const SVertex *v) const {
+    return v->recombinationHash;
+  }
+
+  // Computes the value of SVertex::recombinationHash.
+  static std::size_t HashStates(const std::vector<FFState*> &states) {
     std::size_t seed = 0;
-    for (std::vector<FFState*>::const_iterator p = v->states.begin();
-         p != v->states.end(); ++p) {
+    for (std::vector<FFState*>::const_iterator p = states.begin();
+         p != states.end(); ++p) {
       boost::hash_combine(seed, (*p)->hash());
     }
     return seed;
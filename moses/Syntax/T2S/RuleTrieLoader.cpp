@@ -19,6 +19,7 @@
 #include "moses/ChartTranslationOptionList.h"
 #include "moses/FactorCollection.h"
 #include "moses/Syntax/RuleTableFF.h"
+#include "moses/TranslationModel/RuleTable/BinaryRuleTable.h"
 #include "util/file_piece.hh"
 #include "util/string_piece.hh"
 #include "util/tokenize_piece.hh"
@@ -42,6 +43,10 @@ bool RuleTrieLoader::Load(Moses::AllOptions const& opts,
                           const RuleTableFF &ff,
                           RuleTrie &trie)
 {
+  if (BinaryRuleTable::IsBinary(inFile)) {
+    return LoadBinary(opts, input, output, inFile, ff, trie);
+  }
+
   PrintUserTime(std::string("Start loading text phrase table. Moses format"));
 
   std::size_t count = 0;
@@ -149,6 +154,53 @@ bool RuleTrieLoader::Load(Moses::AllOptions const& opts,
   return true;
 }
 
+bool RuleTrieLoader::LoadBinary(Moses::AllOptions const& opts,
+                                const std::vector<FactorType> &input,
+                                const std::vector<FactorType> &output,
+                                const std::string &inFile,
+                                const RuleTableFF &ff,
+                                RuleTrie &trie)
+{
+  PrintUserTime(std::string("Start loading binary rule table"));
+
+  BinaryRuleTable table(inFile);
+  const std::size_t numScoreComponents = ff.GetNumScoreComponents();
+  UTIL_THROW_IF2(table.GetNumScores() != numScoreComponents,
+                 "Size of scoreVector != number (" << table.GetNumScores()
+                 << "!=" << numScoreComponents << ") of score components in "
+                 << inFile);
+
+  std::size_t count = 0;
+  Phrase sourcePhrase;
+  while (table.Next()) {
+    if (table.IsSourceEmpty() && !opts.unk.word_deletion_enabled) {
+      TRACE_ERR( ff.GetFilePath() << ":" << count << ": pt entry contains empty target, skipping\n");
+      continue;
+    }
+
+    Word *sourceLHS;
+    table.CreateSource(input, sourcePhrase, sourceLHS);
+    TargetPhrase *targetPhrase = table.CreateTargetPhrase(ff, output);
+    targetPhrase->EvaluateInIsolation(sourcePhrase, ff.GetFeaturesToApply());
+
+    TargetPhraseCollection::shared_ptr phraseColl
+    = GetOrCreateTargetPhraseCollection(trie, *sourceLHS, sourcePhrase);
+    phraseColl->Add(targetPhrase);
+
+    // not implemented correctly in memory pt. just delete it for now
+    delete sourceLHS;
+
+    count++;
+  }
+
+  // sort and prune each target phrase collection
+  if (ff.GetTableLimit()) {
+    SortAndPrune(trie, ff.GetTableLimit());
+  }
+
+  return true;
+}
+
 }  // namespace T2S
 }  // namespace Syntax
 }  // namespace Moses
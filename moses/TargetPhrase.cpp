@@ -31,6 +31,7 @@
 #include "Util.h"
 #include "AlignmentInfoCollection.h"
 #include "InputPath.h"
+#include "Profiler.h"
 #include "TranslationTask.h"
 #include "moses/TranslationModel/PhraseDictionary.h"
 #include <boost/foreach.hpp>
@@ -187,9 +188,11 @@ void TargetPhrase::EvaluateInIsolation(const Phrase &source, const std::vector<F
   if (ffs.size()) {
     const StaticData &staticData = StaticData::Instance();
     ScoreComponentCollection estimatedScores;
+    Profiler::Data *profile = Profiler::GetData();
     for (size_t i = 0; i < ffs.size(); ++i) {
       const FeatureFunction &ff = *ffs[i];
       if (! staticData.IsFeatureFunctionIgnored( ff )) {
+        ProfileTimer timer(profile, ff, Profiler::InIsolation);
         ff.EvaluateInIsolation(source, *this, m_scoreBreakdown, estimatedScores);
       }
     }
@@ -205,9 +208,11 @@ void TargetPhrase::EvaluateWithSourceContext(const InputType &input, const Input
   const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
   const StaticData &staticData = StaticData::Instance();
   ScoreComponentCollection futureScoreBreakdown;
+  Profiler::Data *profile = Profiler::GetData();
   for (size_t i = 0; i < ffs.size(); ++i) {
     const FeatureFunction &ff = *ffs[i];
     if (! staticData.IsFeatureFunctionIgnored( ff )) {
+      ProfileTimer timer(profile, ff, Profiler::WithSourceContext);
       ff.EvaluateWithSourceContext(input, inputPath, *this, NULL, m_scoreBreakdown, &futureScoreBreakdown);
     }
   }
@@ -35,6 +35,31 @@ using namespace std;
 namespace Moses
 {
 
+namespace
+{
+
+bool HasTerminals(const PhraseDictionaryNodeMemory *node)
+{
+  return !node->GetTerminalMap().empty();
+}
+
+bool HasTerminals(const BinaryRuleTable::Node *node)
+{
+  return node->terminalCount;
+}
+
+bool HasNonTerminals(const PhraseDictionaryNodeMemory *node)
+{
+  return !node->GetNonTerminalMap().empty();
+}
+
+bool HasNonTerminals(const BinaryRuleTable::Node *node)
+{
+  return node->nonTerminalCount;
+}
+
+}
+
 ChartRuleLookupManagerMemory::ChartRuleLookupManagerMemory(
   const ChartParser &parser,
   const ChartCellCollectionBase &cellColl,
@@ -42,6 +67,8 @@ ChartRuleLookupManagerMemory::ChartRuleLookupManagerMemory(
   : ChartRuleLookupManagerCYKPlus(parser, cellColl)
   , m_ruleTable(ruleTable)
   , m_softMatchingMap(StaticData::Instance().GetSoftMatches())
+  , m_widthOrder(false)
+  , m_matrixWidth(0)
 {
 
   size_t sourceSize = parser.GetSize();
@@ -66,18 +93,21 @@ void ChartRuleLookupManagerMemory::GetChartRuleCollection(
   m_outColl = &outColl;
   m_unaryPos = absEndPos-1; // rules ending in this position are unary and should not be added to collection
 
-  // create/update data structure to quickly look up all chart cells that match start position and label.
-  UpdateCompressedMatrix(startPos, absEndPos, lastPos);
-
-  const PhraseDictionaryNodeMemory &rootNode = m_ruleTable.GetRootNode();
-
-  // all rules starting with terminal
-  if (startPos == absEndPos) {
-    GetTerminalExtension(&rootNode, startPos);
+  if (m_widthOrder) {
+    // only the rules that end at the end of the span.  Their non-terminals
+    // cover narrower spans, which are complete
+    m_lastPos = absEndPos;
+    m_unaryPos = NOT_FOUND;
+    UpdateCompressedMatrixByWidth(startPos, absEndPos);
+  } else {
+    // create/update data structure to quickly look up all chart cells that match start position and label.
+    UpdateCompressedMatrix(startPos, absEndPos, lastPos);
   }
-  // all rules starting with nonterminal
-  else if (absEndPos > startPos) {
-    GetNonTerminalExtension(&rootNode, startPos);
+
+  if (const BinaryRuleTable *binaryTable = m_ruleTable.GetBinaryTable()) {
+    LookUp(&binaryTable->GetRoot(), startPos, absEndPos);
+  } else {
+    LookUp(&m_ruleTable.GetRootNode(), startPos, absEndPos);
   }
 
   // copy temporarily stored rules to out collection
@@ -90,6 +120,21 @@ void ChartRuleLookupManagerMemory::GetChartRuleCollection(
 
 }
 
+template<typename Node>
+void ChartRuleLookupManagerMemory::LookUp(const Node *root, size_t startPos,
+    size_t endPos)
+{
+  // all rules starting with terminal.  Looking up by width, the rules of
+  // wider spans can start with one too
+  if (m_widthOrder || startPos == endPos) {
+    GetTerminalExtension(root, startPos);
+  }
+  // all rules starting with nonterminal
+  if (endPos > startPos) {
+    GetNonTerminalExtension(root, startPos);
+  }
+}
+
 // Create/update compressed matrix that stores all valid ChartCellLabels for a given start position and label.
 void ChartRuleLookupManagerMemory::UpdateCompressedMatrix(size_t startPos,
     size_t origEndPos,
@@ -132,53 +177,90 @@ void ChartRuleLookupManagerMemory::UpdateCompressedMatrix(size_t startPos,
   cellMatrix.clear();
   cellMatrix.resize(numNonTerms);
   for (std::vector<size_t>::iterator p = endPosVec.begin(); p != endPosVec.end(); ++p) {
+    AddToCompressedMatrix(startPos, *p);
+  }
+}
 
-    size_t endPos = *p;
-    // target non-terminal labels for the span
-    const ChartCellLabelSet &targetNonTerms = GetTargetLabelSet(startPos, endPos);
+// Looking up spans by width: add the cells of the spans narrower than
+// [startPos, endPos] that aren't in the compressed matrix yet, and make room
+// for all labels at the positions the span's rules can visit.
+void ChartRuleLookupManagerMemory::UpdateCompressedMatrixByWidth(size_t startPos,
+    size_t endPos)
+{
+  const size_t sourceSize = GetParser().GetSize();
+  m_compressedMatrixVec.resize(sourceSize);
+
+  const size_t width = endPos - startPos + 1;
+  for (; m_matrixWidth + 1 < width; ++m_matrixWidth) {
+    const size_t cellWidth = m_matrixWidth + 1;
+    for (size_t pos = 0; pos + cellWidth <= sourceSize; ++pos) {
+      AddToCompressedMatrix(pos, pos + cellWidth - 1);
+    }
+  }
 
-    if (targetNonTerms.GetSize() == 0) {
-      continue;
+  size_t numNonTerms = FactorCollection::Instance().GetNumNonTerminals();
+  for (size_t pos = startPos; pos <= endPos; ++pos) {
+    if (m_compressedMatrixVec[pos].size() < numNonTerms) {
+      m_compressedMatrixVec[pos].resize(numNonTerms);
     }
+  }
+}
+
+// Add the labels of the chart cell [startPos, endPos] to the compressed matrix.
+void ChartRuleLookupManagerMemory::AddToCompressedMatrix(size_t startPos, size_t endPos)
+{
+  size_t numNonTerms = FactorCollection::Instance().GetNumNonTerminals();
+  CompressedMatrix & cellMatrix = m_compressedMatrixVec[startPos];
+  if (cellMatrix.size() < numNonTerms) {
+    cellMatrix.resize(numNonTerms);
+  }
+
+  // target non-terminal labels for the span
+  const ChartCellLabelSet &targetNonTerms = GetTargetLabelSet(startPos, endPos);
+
+  if (targetNonTerms.GetSize() == 0) {
+    return;
+  }
 
 #if !defined(UNLABELLED_SOURCE)
-    // source non-terminal labels for the span
-    const InputPath &inputPath = GetParser().GetInputPath(startPos, endPos);
+  // source non-terminal labels for the span
+  const InputPath &inputPath = GetParser().GetInputPath(startPos, endPos);
 
-    // can this ever be true? Moses seems to pad the non-terminal set of the input with [X]
-    if (inputPath.GetNonTerminalSet().size() == 0) {
-      continue;
-    }
+  // can this ever be true? Moses seems to pad the non-terminal set of the input with [X]
+  if (inputPath.GetNonTerminalSet().size() == 0) {
+    return;
+  }
 #endif
 
-    for (size_t i = 0; i < numNonTerms; i++) {
-      const ChartCellLabel *cellLabel = targetNonTerms.Find(i);
-      if (cellLabel != NULL) {
-        float score = cellLabel->GetBestScore(m_outColl);
-        cellMatrix[i].push_back(ChartCellCache(endPos, cellLabel, score));
-      }
+  for (size_t i = 0; i < numNonTerms; i++) {
+    const ChartCellLabel *cellLabel = targetNonTerms.Find(i);
+    if (cellLabel != NULL) {
+      float score = cellLabel->GetBestScore(m_outColl);
+      cellMatrix[i].push_back(ChartCellCache(endPos, cellLabel, score));
     }
   }
 }
 
 // if a (partial) rule matches, add it to list completed rules (if non-unary and non-empty), and try find expansions that have this partial rule as prefix.
+template<typename Node>
 void ChartRuleLookupManagerMemory::AddAndExtend(
-  const PhraseDictionaryNodeMemory *node,
+  const Node *node,
   size_t endPos)
 {
 
-  TargetPhraseCollection::shared_ptr tpc = node->GetTargetPhraseCollection();
+  TargetPhraseCollection::shared_ptr tpc = GetTargetPhrases(node);
   // add target phrase collection (except if rule is empty or a unary non-terminal rule)
-  if (!tpc->IsEmpty() && (m_stackVec.empty() || endPos != m_unaryPos)) {
+  if (tpc && !tpc->IsEmpty() && (m_stackVec.empty() || endPos != m_unaryPos)
+      && (!m_widthOrder || endPos == m_lastPos)) {
     m_completedRules[endPos].Add(*tpc, m_stackVec, m_stackScores, *m_outColl);
   }
 
   // get all further extensions of rule (until reaching end of sentence or max-chart-span)
   if (endPos < m_lastPos) {
-    if (!node->GetTerminalMap().empty()) {
+    if (HasTerminals(node)) {
       GetTerminalExtension(node, endPos+1);
     }
-    if (!node->GetNonTerminalMap().empty()) {
+    if (HasNonTerminals(node)) {
       GetNonTerminalExtension(node, endPos+1);
     }
   }
@@ -215,6 +297,18 @@ void ChartRuleLookupManagerMemory::GetTerminalExtension(
   }
 }
 
+void ChartRuleLookupManagerMemory::GetTerminalExtension(
+  const BinaryRuleTable::Node *node,
+  size_t pos)
+{
+  const Word &sourceWord = GetSourceAt(pos).GetLabel();
+  const BinaryRuleTable::Node *child =
+    m_ruleTable.GetBinaryTable()->GetTerminalChild(*node, sourceWord);
+  if (child != NULL) {
+    AddAndExtend(child, pos);
+  }
+}
+
 // search all nonterminal possible nonterminal extensions of a partial rule (pointed at by node) for a variable span (starting from startPos).
 // recursively try to expand partial rules into full rules up to m_lastPos.
 void ChartRuleLookupManagerMemory::GetNonTerminalExtension(
@@ -242,29 +336,67 @@ void ChartRuleLookupManagerMemory::GetNonTerminalExtension(
     const Word &targetNonTerm = p->first.second;
 #endif
     const PhraseDictionaryNodeMemory *child = &p->second;
-    //soft matching of NTs
-    if (m_isSoftMatching && !m_softMatchingMap[targetNonTerm[0]->GetId()].empty()) {
-      const std::vector<Word>& softMatches = m_softMatchingMap[targetNonTerm[0]->GetId()];
-      for (std::vector<Word>::const_iterator softMatch = softMatches.begin(); softMatch != softMatches.end(); ++softMatch) {
-        const CompressedColumn &matches = compressedMatrix[(*softMatch)[0]->GetId()];
-        for (CompressedColumn::const_iterator match = matches.begin(); match != matches.end(); ++match) {
-          m_stackVec.back() = match->cellLabel;
-          m_stackScores.back() = match->score;
-          AddAndExtend(child, match->endPos);
-        }
-      }
-    } // end of soft matches lookup
+    ExtendNonTerminal(targetNonTerm, child, compressedMatrix);
+  }
+  // remove last back pointer
+  m_stackVec.pop_back();
+  m_stackScores.pop_back();
+}
 
-    const CompressedColumn &matches = compressedMatrix[targetNonTerm[0]->GetId()];
-    for (CompressedColumn::const_iterator match = matches.begin(); match != matches.end(); ++match) {
-      m_stackVec.back() = match->cellLabel;
-      m_stackScores.back() = match->score;
-      AddAndExtend(child, match->endPos);
-    }
+void ChartRuleLookupManagerMemory::GetNonTerminalExtension(
+  const BinaryRuleTable::Node *node,
+  size_t startPos)
+{
+  const BinaryRuleTable &table = *m_ruleTable.GetBinaryTable();
+  const CompressedMatrix &compressedMatrix = m_compressedMatrixVec[startPos];
+
+  // make room for back pointer
+  m_stackVec.push_back(NULL);
+  m_stackScores.push_back(0);
+
+  // loop over possible expansions of the rule
+  const BinaryRuleTable::Edge *end = table.EndNonTerminals(*node);
+  for (const BinaryRuleTable::Edge *p = table.BeginNonTerminals(*node); p != end; ++p) {
+    ExtendNonTerminal(table.GetTargetNonTerm(*p), &table.GetChild(*p),
+                      compressedMatrix);
   }
   // remove last back pointer
   m_stackVec.pop_back();
   m_stackScores.pop_back();
 }
 
+// extend a partial rule by the non-terminal edge to child, over each chart cell from the start position with a matching label
+template<typename Node>
+void ChartRuleLookupManagerMemory::ExtendNonTerminal(
+  const Word &targetNonTerm,
+  const Node *child,
+  const CompressedMatrix &compressedMatrix)
+{
+  //soft matching of NTs
+  if (m_isSoftMatching && !m_softMatchingMap[targetNonTerm[0]->GetId()].empty()) {
+    const std::vector<Word>& softMatches = m_softMatchingMap[targetNonTerm[0]->GetId()];
+    for (std::vector<Word>::const_iterator softMatch = softMatches.begin(); softMatch != softMatches.end(); ++softMatch) {
+      const CompressedColumn &matches = compressedMatrix[(*softMatch)[0]->GetId()];
+      for (CompressedColumn::const_iterator match = matches.begin(); match != matches.end(); ++match) {
+        if (match->endPos > m_lastPos) {
+          break; // sorted by end position
+        }
+        m_stackVec.back() = match->cellLabel;
+        m_stackScores.back() = match->score;
+        AddAndExtend(child, match->endPos);
+      }
+    }
+  } // end of soft matches lookup
+
+  const CompressedColumn &matches = compressedMatrix[targetNonTerm[0]->GetId()];
+  for (CompressedColumn::const_iterator match = matches.begin(); match != matches.end(); ++match) {
+    if (match->endPos > m_lastPos) {
+      break; // sorted by end position
+    }
+    m_stackVec.back() = match->cellLabel;
+    m_stackScores.back() = match->score;
+    AddAndExtend(child, match->endPos);
+  }
+}
+
 }  // namespace Moses
@@ -26,6 +26,7 @@
 #include "moses/NonTerminal.h"
 #include "moses/TranslationModel/PhraseDictionaryMemory.h"
 #include "moses/TranslationModel/PhraseDictionaryNodeMemory.h"
+#include "moses/TranslationModel/RuleTable/BinaryRuleTable.h"
 #include "moses/StackVec.h"
 
 namespace Moses
@@ -35,6 +36,9 @@ class ChartParserCallback;
 class Range;
 
 //! Implementation of ChartRuleLookupManager for in-memory rule tables.
+//! The search is the same for the trie of a table loaded from a text file
+//! (PhraseDictionaryNodeMemory) and the mapped trie of a compiled one
+//! (BinaryRuleTable::Node).
 class ChartRuleLookupManagerMemory : public ChartRuleLookupManagerCYKPlus
 {
 public:
@@ -53,24 +57,66 @@ public:
     size_t lastPos, // last position to consider if using lookahead
     ChartParserCallback &outColl);
 
+  // Each span's rules are then searched for from scratch, so the search
+  // repeats the prefixes shared with narrower spans.
+  virtual bool SupportsWidthOrder() const {
+    return true;
+  }
+
+  virtual void UseWidthOrder() {
+    m_widthOrder = true;
+  }
+
 private:
 
+  template<typename Node>
+  void LookUp(const Node *root, size_t startPos, size_t endPos);
+
   void GetTerminalExtension(
     const PhraseDictionaryNodeMemory *node,
     size_t pos);
 
+  void GetTerminalExtension(
+    const BinaryRuleTable::Node *node,
+    size_t pos);
+
   void GetNonTerminalExtension(
     const PhraseDictionaryNodeMemory *node,
     size_t startPos);
 
+  void GetNonTerminalExtension(
+    const BinaryRuleTable::Node *node,
+    size_t startPos);
+
+  template<typename Node>
+  void ExtendNonTerminal(
+    const Word &targetNonTerm,
+    const Node *child,
+    const CompressedMatrix &compressedMatrix);
+
+  template<typename Node>
   void AddAndExtend(
-    const PhraseDictionaryNodeMemory *node,
+    const Node *node,
     size_t endPos);
 
+  TargetPhraseCollection::shared_ptr
+  GetTargetPhrases(const PhraseDictionaryNodeMemory *node) const {
+    return node->GetTargetPhraseCollection();
+  }
+
+  TargetPhraseCollection::shared_ptr
+  GetTargetPhrases(const BinaryRuleTable::Node *node) const {
+    return m_ruleTable.GetTargetPhraseCollection(*node);
+  }
+
   void UpdateCompressedMatrix(size_t startPos,
                               size_t endPos,
                               size_t lastPos);
 
+  void UpdateCompressedMatrixByWidth(size_t startPos, size_t endPos);
+
+  void AddToCompressedMatrix(size_t startPos, size_t endPos);
+
   const PhraseDictionaryMemory &m_ruleTable;
 
   // permissible soft nonterminal matches (target side)
@@ -90,6 +136,12 @@ private:
 
   std::vector<CompressedMatrix> m_compressedMatrixVec;
 
+  // looking up spans in order of increasing width, rather than right to left
+  bool m_widthOrder;
+  // with m_widthOrder, the cells of spans up to this width are in
+  // m_compressedMatrixVec
+  size_t m_matrixWidth;
+
 
 };
 
@@ -42,6 +42,8 @@ ChartRuleLookupManagerMemoryPerSentence::ChartRuleLookupManagerMemoryPerSentence
   : ChartRuleLookupManagerCYKPlus(parser, cellColl)
   , m_ruleTable(ruleTable)
   , m_softMatchingMap(StaticData::Instance().GetSoftMatches())
+  , m_widthOrder(false)
+  , m_matrixWidth(0)
 {
 
   size_t sourceSize = parser.GetSize();
@@ -66,18 +68,30 @@ void ChartRuleLookupManagerMemoryPerSentence::GetChartRuleCollection(
   m_outColl = &outColl;
   m_unaryPos = absEndPos-1; // rules ending in this position are unary and should not be added to collection
 
-  // create/update data structure to quickly look up all chart cells that match start position and label.
-  UpdateCompressedMatrix(startPos, absEndPos, lastPos);
-
   const PhraseDictionaryNodeMemory &rootNode = m_ruleTable.GetRootNode(GetParser().GetTranslationId());
 
-  // all rules starting with terminal
-  if (startPos == absEndPos) {
+  if (m_widthOrder) {
+    // only the rules that end at the end of the span.  Their non-terminals
+    // cover narrower spans, which are complete
+    m_lastPos = absEndPos;
+    m_unaryPos = NOT_FOUND;
+    UpdateCompressedMatrixByWidth(startPos, absEndPos);
     GetTerminalExtension(&rootNode, startPos);
-  }
-  // all rules starting with nonterminal
-  else if (absEndPos > startPos) {
-    GetNonTerminalExtension(&rootNode, startPos);
+    if (absEndPos > startPos) {
+      GetNonTerminalExtension(&rootNode, startPos);
+    }
+  } else {
+    // create/update data structure to quickly look up all chart cells that match start position and label.
+    UpdateCompressedMatrix(startPos, absEndPos, lastPos);
+
+    // all rules starting with terminal
+    if (startPos == absEndPos) {
+      GetTerminalExtension(&rootNode, startPos);
+    }
+    // all rules starting with nonterminal
+    else if (absEndPos > startPos) {
+      GetNonTerminalExtension(&rootNode, startPos);
+    }
   }
 
   // copy temporarily stored rules to out collection
@@ -132,31 +146,66 @@ void ChartRuleLookupManagerMemoryPerSentence::UpdateCompressedMatrix(size_t star
   cellMatrix.clear();
   cellMatrix.resize(numNonTerms);
   for (std::vector<size_t>::iterator p = endPosVec.begin(); p != endPosVec.end(); ++p) {
+    AddToCompressedMatrix(startPos, *p);
+  }
+}
 
-    size_t endPos = *p;
-    // target non-terminal labels for the span
-    const ChartCellLabelSet &targetNonTerms = GetTargetLabelSet(startPos, endPos);
+// Looking up spans by width: add the cells of the spans narrower than
+// [startPos, endPos] that aren't in the compressed matrix yet, and make room
+// for all labels at the positions the span's rules can visit.
+void ChartRuleLookupManagerMemoryPerSentence::UpdateCompressedMatrixByWidth(size_t startPos,
+    size_t endPos)
+{
+  const size_t sourceSize = GetParser().GetSize();
+  m_compressedMatrixVec.resize(sourceSize);
+
+  const size_t width = endPos - startPos + 1;
+  for (; m_matrixWidth + 1 < width; ++m_matrixWidth) {
+    const size_t cellWidth = m_matrixWidth + 1;
+    for (size_t pos = 0; pos + cellWidth <= sourceSize; ++pos) {
+      AddToCompressedMatrix(pos, pos + cellWidth - 1);
+    }
+  }
 
-    if (targetNonTerms.GetSize() == 0) {
-      continue;
+  size_t numNonTerms = FactorCollection::Instance().GetNumNonTerminals();
+  for (size_t pos = startPos; pos <= endPos; ++pos) {
+    if (m_compressedMatrixVec[pos].size() < numNonTerms) {
+      m_compressedMatrixVec[pos].resize(numNonTerms);
     }
+  }
+}
+
+// Add the labels of the chart cell [startPos, endPos] to the compressed matrix.
+void ChartRuleLookupManagerMemoryPerSentence::AddToCompressedMatrix(size_t startPos, size_t endPos)
+{
+  size_t numNonTerms = FactorCollection::Instance().GetNumNonTerminals();
+  CompressedMatrix & cellMatrix = m_compressedMatrixVec[startPos];
+  if (cellMatrix.size() < numNonTerms) {
+    cellMatrix.resize(numNonTerms);
+  }
+
+  // target non-terminal labels for the span
+  const ChartCellLabelSet &targetNonTerms = GetTargetLabelSet(startPos, endPos);
+
+  if (targetNonTerms.GetSize() == 0) {
+    return;
+  }
 
 #if !defined(UNLABELLED_SOURCE)
-    // source non-terminal labels for the span
-    const InputPath &inputPath = GetParser().GetInputPath(startPos, endPos);
+  // source non-terminal labels for the span
+  const InputPath &inputPath = GetParser().GetInputPath(startPos, endPos);
 
-    // can this ever be true? Moses seems to pad the non-terminal set of the input with [X]
-    if (inputPath.GetNonTerminalSet().size() == 0) {
-      continue;
-    }
+  // can this ever be true? Moses seems to pad the non-terminal set of the input with [X]
+  if (inputPath.GetNonTerminalSet().size() == 0) {
+    return;
+  }
 #endif
 
-    for (size_t i = 0; i < numNonTerms; i++) {
-      const ChartCellLabel *cellLabel = targetNonTerms.Find(i);
-      if (cellLabel != NULL) {
-        float score = cellLabel->GetBestScore(m_outColl);
-        cellMatrix[i].push_back(ChartCellCache(endPos, cellLabel, score));
-      }
+  for (size_t i = 0; i < numNonTerms; i++) {
+    const ChartCellLabel *cellLabel = targetNonTerms.Find(i);
+    if (cellLabel != NULL) {
+      float score = cellLabel->GetBestScore(m_outColl);
+      cellMatrix[i].push_back(ChartCellCache(endPos, cellLabel, score));
     }
   }
 }
@@ -170,7 +219,8 @@ void ChartRuleLookupManagerMemoryPerSentence::AddAndExtend(
   TargetPhraseCollection::shared_ptr tpc
   = node->GetTargetPhraseCollection();
   // add target phrase collection (except if rule is empty or a unary non-terminal rule)
-  if (!tpc->IsEmpty() && (m_stackVec.empty() || endPos != m_unaryPos)) {
+  if (!tpc->IsEmpty() && (m_stackVec.empty() || endPos != m_unaryPos)
+      && (!m_widthOrder || endPos == m_lastPos)) {
     m_completedRules[endPos].Add(*tpc, m_stackVec, m_stackScores, *m_outColl);
   }
 
@@ -249,6 +299,9 @@ void ChartRuleLookupManagerMemoryPerSentence::GetNonTerminalExtension(
       for (std::vector<Word>::const_iterator softMatch = softMatches.begin(); softMatch != softMatches.end(); ++softMatch) {
         const CompressedColumn &matches = compressedMatrix[(*softMatch)[0]->GetId()];
         for (CompressedColumn::const_iterator match = matches.begin(); match != matches.end(); ++match) {
+          if (match->endPos > m_lastPos) {
+            break; // sorted by end position
+          }
           m_stackVec.back() = match->cellLabel;
           m_stackScores.back() = match->score;
           AddAndExtend(child, match->endPos);
@@ -258,6 +311,9 @@ void ChartRuleLookupManagerMemoryPerSentence::GetNonTerminalExtension(
 
     const CompressedColumn &matches = compressedMatrix[targetNonTerm[0]->GetId()];
     for (CompressedColumn::const_iterator match = matches.begin(); match != matches.end(); ++match) {
+      if (match->endPos > m_lastPos) {
+        break; // sorted by end position
+      }
       m_stackVec.back() = match->cellLabel;
       m_stackScores.back() = match->score;
       AddAndExtend(child, match->endPos);
@@ -54,6 +54,16 @@ public:
     size_t lastPos, // last position to consider if using lookahead
     ChartParserCallback &outColl);
 
+  // Each span's rules are then searched for from scratch, so the search
+  // repeats the prefixes shared with narrower spans.
+  virtual bool SupportsWidthOrder() const {
+    return true;
+  }
+
+  virtual void UseWidthOrder() {
+    m_widthOrder = true;
+  }
+
 private:
 
   void GetTerminalExtension(
@@ -72,6 +82,10 @@ private:
                               size_t endPos,
                               size_t lastPos);
 
+  void UpdateCompressedMatrixByWidth(size_t startPos, size_t endPos);
+
+  void AddToCompressedMatrix(size_t startPos, size_t endPos);
+
   const PhraseDictionaryFuzzyMatch &m_ruleTable;
 
   // permissible soft nonterminal matches (target side)
@@ -91,6 +105,12 @@ private:
 
   std::vector<CompressedMatrix> m_compressedMatrixVec;
 
+  // looking up spans in order of increasing width, rather than right to left
+  bool m_widthOrder;
+  // with m_widthOrder, the cells of spans up to this width are in
+  // m_compressedMatrixVec
+  size_t m_matrixWidth;
+
 };
 
 }  // namespace Moses
@@ -49,6 +49,12 @@ public:
                                       size_t last,
                                       ChartParserCallback &outColl);
 
+  // The dotted rules of a span only extend those of the span one word
+  // narrower, with the same start.
+  virtual bool SupportsWidthOrder() const {
+    return true;
+  }
+
 private:
   const PhraseDictionaryOnDisk &m_dictionary;
   OnDiskPt::OnDiskWrapper &m_dbWrapper;
@@ -363,7 +363,7 @@ TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
             // if range smaller than source phrase retrieve subphrase
             if(unsigned(srcEnd - srcStart + 1) != srcSize) {
               Phrase subPhrase = sourcePhrase.GetSubString(Range(srcStart, srcEnd));
-              subTpv = CreateTargetPhraseCollection(subPhrase, false);
+              subTpv = CreateTargetPhraseCollection(subPhrase, false, false);
             } else {
               // false positive consistency check
               if(rank >= tpv->size()-1)
@@ -109,24 +109,40 @@ GetTargetPhraseCollectionNonCacheLEGACY(const Phrase &sourcePhrase) const
   if(sourcePhrase.GetSize() > m_phraseDecoder->GetMaxSourcePhraseLength())
     return ret;
 
-  // Retrieve target phrase collection from phrase table
+  // Retrieve target phrase collection from phrase table, not yet scored by
+  // the other feature functions
   TargetPhraseVectorPtr decodedPhraseColl
-  = m_phraseDecoder->CreateTargetPhraseCollection(sourcePhrase, true, true);
+  = m_phraseDecoder->CreateTargetPhraseCollection(sourcePhrase, true, false);
 
   if(decodedPhraseColl != NULL && decodedPhraseColl->size()) {
-    TargetPhraseVectorPtr tpv(new TargetPhraseVector(*decodedPhraseColl));
     TargetPhraseCollection::shared_ptr  phraseColl(new TargetPhraseCollection);
 
-    // Score phrases and if possible apply ttable_limit
-    TargetPhraseVector::iterator nth =
-      (m_tableLimit == 0 || tpv->size() < m_tableLimit) ?
-      tpv->end() : tpv->begin() + m_tableLimit;
-    NTH_ELEMENT4(tpv->begin(), nth, tpv->end(), CompareTargetPhrase());
-    for(TargetPhraseVector::iterator it = tpv->begin(); it != nth; it++) {
-      TargetPhrase *tp = new TargetPhrase(*it);
-      phraseColl->Add(tp);
+    size_t preselectLimit = GetPreselectLimit();
+    if(preselectLimit && decodedPhraseColl->size() > preselectLimit) {
+      // Rank phrases by their weighted scores in this table, and only copy
+      // and score the best of them
+      std::vector<std::pair<float, size_t> > ranked(decodedPhraseColl->size());
+      for(size_t i = 0; i < ranked.size(); i++)
+        ranked[i] = std::make_pair((*decodedPhraseColl)[i].GetScoreBreakdown().GetWeightedScore(), i);
+      std::nth_element(ranked.begin(), ranked.begin() + preselectLimit, ranked.end(),
+                       std::greater<std::pair<float, size_t> >());
+      for(size_t i = 0; i < preselectLimit; i++) {
+        TargetPhrase *tp = new TargetPhrase((*decodedPhraseColl)[ranked[i].second]);
+        tp->EvaluateInIsolation(sourcePhrase, GetFeaturesToApply());
+        phraseColl->Add(tp);
+      }
+    } else {
+      for(TargetPhraseVector::const_iterator it = decodedPhraseColl->begin();
+          it != decodedPhraseColl->end(); it++) {
+        TargetPhrase *tp = new TargetPhrase(*it);
+        tp->EvaluateInIsolation(sourcePhrase, GetFeaturesToApply());
+        phraseColl->Add(tp);
+      }
     }
 
+    // Apply ttable_limit
+    phraseColl->Prune(true, m_tableLimit);
+
     // Cache phrase pair for clean-up or retrieval with PREnc
     const_cast<PhraseDictionaryCompact*>(this)->CacheForCleanup(phraseColl);
 
@@ -38,6 +38,7 @@ std::vector<PhraseDictionary*> PhraseDictionary::s_staticColl;
 PhraseDictionary::PhraseDictionary(const std::string &line, bool registerNow)
   : DecodeFeature(line, registerNow)
   , m_tableLimit(20) // default
+  , m_preselectLimit(0) // off
   , m_maxCacheSize(DEFAULT_MAX_TRANS_OPT_CACHE_SIZE)
 {
   m_id = s_staticColl.size();
@@ -109,6 +110,8 @@ SetParameter(const std::string& key, const std::string& value)
     m_filePath = value;
   } else if (key == "table-limit") {
     m_tableLimit = Scan<size_t>(value);
+  } else if (key == "preselect-limit") {
+    m_preselectLimit = Scan<size_t>(value);
   } else {
     DecodeFeature::SetParameter(key, value);
   }
@@ -85,6 +85,15 @@ public:
     return m_tableLimit;
   }
 
+  /** The number of rules of a source phrase that are built and scored by all
+   *  feature functions, chosen by their weighted scores in this table.  Only
+   *  used by tables that can rank their rules before building them (compact
+   *  and probing).  0 (the default) for all of them.
+   */
+  size_t GetPreselectLimit() const {
+    return m_preselectLimit;
+  }
+
   //! continguous id for each pt, starting from 0
   size_t GetId() const {
     return m_id;
@@ -157,6 +166,7 @@ protected:
   static std::vector<PhraseDictionary*> s_staticColl;
 
   size_t m_tableLimit;
+  size_t m_preselectLimit;
   std::string m_filePath;
 
   // features to apply evaluate target phrase when loading.
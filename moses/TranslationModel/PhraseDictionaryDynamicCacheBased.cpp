@@ -18,6 +18,8 @@
  License along with this library; if not, write to the Free Software
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  ***********************************************************************/
+#include <boost/foreach.hpp>
+
 #include "util/exception.hh"
 
 #include "moses/TranslationModel/PhraseDictionary.h"
@@ -37,6 +39,7 @@ PhraseDictionaryDynamicCacheBased *PhraseDictionaryDynamicCacheBased::s_instance
 //! contructor
 PhraseDictionaryDynamicCacheBased::PhraseDictionaryDynamicCacheBased(const std::string &line)
   : PhraseDictionary(line, true)
+  , m_cacheTM(new Cache())
 {
   std::cerr << "Initializing PhraseDictionaryDynamicCacheBased feature..." << std::endl;
 
@@ -45,7 +48,6 @@ PhraseDictionaryDynamicCacheBased::PhraseDictionaryDynamicCacheBased(const std::
 
   m_score_type = CBTM_SCORE_TYPE_HYPERBOLA;
   m_maxAge = 1000;
-  m_entries = 0;
   m_name = "default";
   m_constant = false;
   ReadParameters();
@@ -83,12 +85,20 @@ void PhraseDictionaryDynamicCacheBased::Load(const std::string filestr)
 void PhraseDictionaryDynamicCacheBased::Load_Multiple_Files(std::vector<std::string> files)
 {
   VERBOSE(2,"PhraseDictionaryDynamicCacheBased::Load_Multiple_Files(std::vector<std::string> files)" << std::endl);
-  for(size_t j = 0; j < files.size(); ++j) {
-    Load_Single_File(files[j]);
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_updateLock);
+#endif
+    boost::shared_ptr<Cache> cache = CopyCache(false);
+    for(size_t j = 0; j < files.size(); ++j) {
+      Load_Single_File(*cache, files[j]);
+    }
+    SetCache(cache);
   }
+  IFVERBOSE(2) Print();
 }
 
-void PhraseDictionaryDynamicCacheBased::Load_Single_File(const std::string file)
+void PhraseDictionaryDynamicCacheBased::Load_Single_File(Cache &cache, const std::string file)
 {
   VERBOSE(2,"PhraseDictionaryDynamicCacheBased::Load_Single_File(const std::string file)" << std::endl);
   //file format
@@ -118,12 +128,11 @@ void PhraseDictionaryDynamicCacheBased::Load_Single_File(const std::string file)
     if (vecStr.size() >= 2) {
       std::string ageString = vecStr[0];
       vecStr.erase(vecStr.begin());
-      Update(vecStr,ageString);
+      Update(cache, vecStr, ageString);
     } else {
       UTIL_THROW_IF2(false, "The format of the loaded file is wrong: " << line);
     }
   }
-  IFVERBOSE(2) Print();
 }
 
 
@@ -153,19 +162,19 @@ void PhraseDictionaryDynamicCacheBased::InitializeForInput(ttasksptr const& ttas
 
 TargetPhraseCollection::shared_ptr PhraseDictionaryDynamicCacheBased::GetTargetPhraseCollection(const Phrase &source) const
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
+  boost::shared_ptr<const Cache> cache = GetCache();
   TargetPhraseCollection::shared_ptr tpc;
-  cacheMap::const_iterator it = m_cacheTM.find(source);
-  if(it != m_cacheTM.end()) {
-    tpc.reset(new TargetPhraseCollection(*(it->second).first));
-
-    std::vector<const TargetPhrase*>::const_iterator it2 = tpc->begin();
-
-    while (it2 != tpc->end()) {
-      ((TargetPhrase*) *it2)->EvaluateInIsolation(source, GetFeaturesToApply());
-      it2++;
+  cacheMap::const_iterator it = cache->entries.find(source);
+  if(it != cache->entries.end()) {
+    tpc.reset(new TargetPhraseCollection);
+
+    // the scores of this table follow from the age of the entries now
+    BOOST_FOREACH(const CacheTarget &target, *it->second) {
+      TargetPhrase *tp = new TargetPhrase(*target.targetPhrase);
+      unsigned int age = target.age + (cache->decays - target.decays);
+      tp->GetScoreBreakdown().Assign(this, GetPreComputedScores(age));
+      tp->EvaluateInIsolation(source, GetFeaturesToApply());
+      tpc->Add(tp);
     }
   }
   if (tpc)  {
@@ -194,10 +203,6 @@ ChartRuleLookupManager* PhraseDictionaryDynamicCacheBased::CreateRuleLookupManag
 
 void PhraseDictionaryDynamicCacheBased::SetScoreType(size_t type)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
-
   m_score_type = type;
   if ( m_score_type != CBTM_SCORE_TYPE_HYPERBOLA
        && m_score_type != CBTM_SCORE_TYPE_POWER
@@ -216,9 +221,6 @@ void PhraseDictionaryDynamicCacheBased::SetScoreType(size_t type)
 
 void PhraseDictionaryDynamicCacheBased::SetMaxAge(unsigned int age)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
   m_maxAge = age;
   VERBOSE(2, "PhraseDictionaryCache MaxAge:  " << m_maxAge << std::endl);
 }
@@ -264,9 +266,6 @@ float PhraseDictionaryDynamicCacheBased::decaying_score(const int age)
 void PhraseDictionaryDynamicCacheBased::SetPreComputedScores(const unsigned int numScoreComponent)
 {
   VERBOSE(2, "PhraseDictionaryDynamicCacheBased SetPreComputedScores:  " << m_maxAge << std::endl);
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
   float sc;
   for (size_t i=0; i<=m_maxAge; i++) {
     if (i==m_maxAge) {
@@ -291,7 +290,7 @@ void PhraseDictionaryDynamicCacheBased::SetPreComputedScores(const unsigned int
   VERBOSE(3, "SetPreComputedScores(const unsigned int): lower_age:|" << m_maxAge << "| lower_score:|" << m_lower_score << "|" << std::endl);
 }
 
-Scores PhraseDictionaryDynamicCacheBased::GetPreComputedScores(const unsigned int age)
+const Scores &PhraseDictionaryDynamicCacheBased::GetPreComputedScores(const unsigned int age) const
 {
   if (age < m_maxAge) {
     return precomputedScores.at(age);
@@ -300,17 +299,81 @@ Scores PhraseDictionaryDynamicCacheBased::GetPreComputedScores(const unsigned in
   }
 }
 
+boost::shared_ptr<const PhraseDictionaryDynamicCacheBased::Cache> PhraseDictionaryDynamicCacheBased::GetCache() const
+{
+#ifdef WITH_THREADS
+  return boost::atomic_load(&m_cacheTM);
+#else
+  return m_cacheTM;
+#endif
+}
+
+void PhraseDictionaryDynamicCacheBased::SetCache(const boost::shared_ptr<const Cache> &cache)
+{
+#ifdef WITH_THREADS
+  boost::atomic_store(&m_cacheTM, cache);
+#else
+  m_cacheTM = cache;
+#endif
+}
+
+boost::shared_ptr<PhraseDictionaryDynamicCacheBased::Cache> PhraseDictionaryDynamicCacheBased::CopyCache(bool decay) const
+{
+  boost::shared_ptr<const Cache> cache = GetCache();
+  if (!decay) {
+    return boost::shared_ptr<Cache>(new Cache(*cache));
+  }
+
+  // leave out the entries that have become too old.  The target phrases of
+  // a source phrase are copied only if some of them go
+  boost::shared_ptr<Cache> ret(new Cache());
+  ret->decays = cache->decays + 1;
+  ret->entries.rehash(cache->entries.size());
+  cacheMap::const_iterator it;
+  for(it = cache->entries.begin(); it!=cache->entries.end(); it++) {
+    const CacheTargets &targets = *it->second;
+    size_t numKept = 0;
+    BOOST_FOREACH(const CacheTarget &target, targets) {
+      unsigned int age = target.age + (ret->decays - target.decays);
+      if (age <= m_maxAge) {
+        ++numKept;
+      }
+    }
+    if (numKept == targets.size()) {
+      ret->entries.insert(*it);
+    } else if (numKept > 0) {
+      boost::shared_ptr<CacheTargets> kept(new CacheTargets);
+      kept->reserve(numKept);
+      BOOST_FOREACH(const CacheTarget &target, targets) {
+        unsigned int age = target.age + (ret->decays - target.decays);
+        if (age <= m_maxAge) {
+          kept->push_back(target);
+        } else {
+          VERBOSE(3,"sp:|" << it->first << "| tp:|" << *target.targetPhrase << "| tp_age:|" << age << "| TOO BIG" << std::endl);
+        }
+      }
+      ret->entries[it->first] = kept;
+    }
+  }
+  return ret;
+}
+
 void PhraseDictionaryDynamicCacheBased::ClearEntries(std::string &entries)
 {
   if (entries != "") {
     VERBOSE(3,"entries:|" << entries << "|" << std::endl);
     std::vector<std::string> elements = TokenizeMultiCharSeparator(entries, "||||");
     VERBOSE(3,"elements.size() after:|" << elements.size() << "|" << std::endl);
-    ClearEntries(elements);
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_updateLock);
+#endif
+    boost::shared_ptr<Cache> cache = CopyCache(false);
+    ClearEntries(*cache, elements);
+    SetCache(cache);
   }
 }
 
-void PhraseDictionaryDynamicCacheBased::ClearEntries(std::vector<std::string> entries)
+void PhraseDictionaryDynamicCacheBased::ClearEntries(Cache &cache, std::vector<std::string> entries)
 {
   VERBOSE(3,"PhraseDictionaryDynamicCacheBased::ClearEntries(std::vector<std::string> entries)" << std::endl);
   std::vector<std::string> pp;
@@ -322,11 +385,11 @@ void PhraseDictionaryDynamicCacheBased::ClearEntries(std::vector<std::string> en
     VERBOSE(3,"pp[0]:|" << pp[0] << "|" << std::endl);
     VERBOSE(3,"pp[1]:|" << pp[1] << "|" << std::endl);
 
-    ClearEntries(pp[0], pp[1]);
+    ClearEntries(cache, pp[0], pp[1]);
   }
 }
 
-void PhraseDictionaryDynamicCacheBased::ClearEntries(std::string sourcePhraseString, std::string targetPhraseString)
+void PhraseDictionaryDynamicCacheBased::ClearEntries(Cache &cache, std::string sourcePhraseString, std::string targetPhraseString)
 {
   VERBOSE(3,"PhraseDictionaryDynamicCacheBased::ClearEntries(std::string sourcePhraseString, std::string targetPhraseString)" << std::endl);
   const StaticData &staticData = StaticData::Instance();
@@ -347,63 +410,42 @@ void PhraseDictionaryDynamicCacheBased::ClearEntries(std::string sourcePhraseStr
   sourcePhrase.CreateFromString(Input, staticData.options()->input.factor_order,
                                 sourcePhraseString, /*factorDelimiter,*/ NULL);
   VERBOSE(3, "sourcePhrase:|" << sourcePhrase << "|" << std::endl);
-  ClearEntries(sourcePhrase, targetPhrase);
+  ClearEntries(cache, sourcePhrase, targetPhrase);
 
 }
 
-void PhraseDictionaryDynamicCacheBased::ClearEntries(Phrase sp, Phrase tp)
+void PhraseDictionaryDynamicCacheBased::ClearEntries(Cache &cache, Phrase sp, Phrase tp)
 {
   VERBOSE(3,"PhraseDictionaryDynamicCacheBased::ClearEntries(Phrase sp, Phrase tp)" << std::endl);
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
   VERBOSE(3, "PhraseDictionaryCache deleting sp:|" << sp << "| tp:|" << tp << "|" << std::endl);
 
-  cacheMap::const_iterator it = m_cacheTM.find(sp);
+  cacheMap::iterator it = cache.entries.find(sp);
   VERBOSE(3,"sp:|" << sp << "|" << std::endl);
-  if(it!=m_cacheTM.end()) {
+  if(it!=cache.entries.end()) {
     VERBOSE(3,"sp:|" << sp << "| FOUND" << std::endl);
     // sp is found
-    // here we have to remove the target phrase from targetphrasecollection and from the TargetAgeMap
-    // and then add new entry
-
-    TargetCollectionAgePair TgtCollAgePair = it->second;
-    TargetPhraseCollection::shared_ptr  tpc = TgtCollAgePair.first;
-    AgeCollection* ac = TgtCollAgePair.second;
-    const Phrase* p_ptr = NULL;
-    TargetPhrase* tp_ptr = NULL;
-    bool found = false;
+    // here we have to remove the target phrase from the target phrases of sp
+
+    const CacheTargets &targets = *it->second;
     size_t tp_pos=0;
-    while (!found && tp_pos < tpc->GetSize()) {
-      tp_ptr = (TargetPhrase*) tpc->GetTargetPhrase(tp_pos);
-      p_ptr = (const Phrase*) tp_ptr;
-      if (tp == *p_ptr) {
-        found = true;
-        continue;
-      }
+    while (tp_pos < targets.size() && !(tp == *targets[tp_pos].targetPhrase)) {
       tp_pos++;
     }
-    if (!found) {
+    if (tp_pos == targets.size()) {
       VERBOSE(3,"tp:|" << tp << "| NOT FOUND" << std::endl);
       //do nothing
+    } else if (targets.size() == 1) {
+      // delete the entry from the cache rather than leave it with no target phrases
+      VERBOSE(3,"tp:|" << tp << "| DELETED" << std::endl);
+      cache.entries.erase(it);
     } else {
       VERBOSE(3,"tp:|" << tp << "| FOUND" << std::endl);
-
-      tpc->Remove(tp_pos); //delete entry in the Target Phrase Collection
-      ac->erase(ac->begin() + tp_pos); //delete entry in the Age Collection
-      m_entries--;
-      VERBOSE(3,"tpc size:|" << tpc->GetSize() << "|" << std::endl);
-      VERBOSE(3,"ac size:|" << ac->size() << "|" << std::endl);
+      boost::shared_ptr<CacheTargets> newTargets(new CacheTargets(targets));
+      newTargets->erase(newTargets->begin() + tp_pos);
+      it->second = newTargets;
+      VERBOSE(3,"tpc size:|" << newTargets->size() << "|" << std::endl);
       VERBOSE(3,"tp:|" << tp << "| DELETED" << std::endl);
     }
-    if (tpc->GetSize() == 0) {
-      // delete the entry from m_cacheTM in case it points to an empty TargetPhraseCollection and AgeCollection
-      ac->clear();
-      tpc.reset();
-      delete ac;
-      m_cacheTM.erase(sp);
-    }
-
   } else {
     VERBOSE(3,"sp:|" << sp << "| NOT FOUND" << std::endl);
     //do nothing
@@ -419,11 +461,19 @@ void PhraseDictionaryDynamicCacheBased::ClearSource(std::string &entries)
     VERBOSE(3,"entries:|" << entries << "|" << std::endl);
     std::vector<std::string> elements = TokenizeMultiCharSeparator(entries, "||||");
     VERBOSE(3,"elements.size() after:|" << elements.size() << "|" << std::endl);
-    ClearEntries(elements);
+    {
+#ifdef WITH_THREADS
+      boost::mutex::scoped_lock lock(m_updateLock);
+#endif
+      boost::shared_ptr<Cache> cache = CopyCache(false);
+      ClearSource(*cache, elements);
+      SetCache(cache);
+    }
+    IFVERBOSE(2) Print();
   }
 }
 
-void PhraseDictionaryDynamicCacheBased::ClearSource(std::vector<std::string> entries)
+void PhraseDictionaryDynamicCacheBased::ClearSource(Cache &cache, std::vector<std::string> entries)
 {
   VERBOSE(3,"entries.size():|" << entries.size() << "|" << std::endl);
   const StaticData &staticData = StaticData::Instance();
@@ -438,34 +488,14 @@ void PhraseDictionaryDynamicCacheBased::ClearSource(std::vector<std::string> ent
                                   *it, /*factorDelimiter,*/ NULL);
     VERBOSE(3, "sourcePhrase:|" << sourcePhrase << "|" << std::endl);
 
-    ClearSource(sourcePhrase);
+    ClearSource(cache, sourcePhrase);
   }
-
-  IFVERBOSE(2) Print();
 }
 
-void PhraseDictionaryDynamicCacheBased::ClearSource(Phrase sp)
+void PhraseDictionaryDynamicCacheBased::ClearSource(Cache &cache, Phrase sp)
 {
   VERBOSE(3,"void PhraseDictionaryDynamicCacheBased::ClearSource(Phrase sp) sp:|" << sp << "|" << std::endl);
-  cacheMap::const_iterator it = m_cacheTM.find(sp);
-  if (it != m_cacheTM.end()) {
-    VERBOSE(3,"found:|" << sp << "|" << std::endl);
-    //sp is found
-
-    TargetCollectionAgePair TgtCollAgePair = it->second;
-    TargetPhraseCollection::shared_ptr  tpc = TgtCollAgePair.first;
-    AgeCollection* ac = TgtCollAgePair.second;
-
-    m_entries-=tpc->GetSize(); //reduce the total amount of entries of the cache
-
-    // delete the entry from m_cacheTM in case it points to an empty TargetPhraseCollection and AgeCollection
-    ac->clear();
-    tpc.reset();
-    delete ac;
-    m_cacheTM.erase(sp);
-  } else {
-    //do nothing
-  }
+  cache.entries.erase(sp);
 }
 
 void PhraseDictionaryDynamicCacheBased::Insert(std::string &entries)
@@ -481,15 +511,19 @@ void PhraseDictionaryDynamicCacheBased::Insert(std::string &entries)
 void PhraseDictionaryDynamicCacheBased::Insert(std::vector<std::string> entries)
 {
   VERBOSE(3,"entries.size():|" << entries.size() << "|" << std::endl);
-  if (m_constant == false) {
-    Decay();
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_updateLock);
+#endif
+    boost::shared_ptr<Cache> cache = CopyCache(m_constant == false);
+    Update(*cache, entries, "1");
+    SetCache(cache);
   }
-  Update(entries, "1");
   IFVERBOSE(3) Print();
 }
 
 
-void PhraseDictionaryDynamicCacheBased::Update(std::vector<std::string> entries, std::string ageString)
+void PhraseDictionaryDynamicCacheBased::Update(Cache &cache, std::vector<std::string> entries, std::string ageString)
 {
   VERBOSE(3,"PhraseDictionaryDynamicCacheBased::Update(std::vector<std::string> entries, std::string ageString)" << std::endl);
   std::vector<std::string> pp;
@@ -504,14 +538,14 @@ void PhraseDictionaryDynamicCacheBased::Update(std::vector<std::string> entries,
 
     if (pp.size() > 2) {
       VERBOSE(3,"pp[2]:|" << pp[2] << "|" << std::endl);
-      Update(pp[0], pp[1], ageString, pp[2]);
+      Update(cache, pp[0], pp[1], ageString, pp[2]);
     } else {
-      Update(pp[0], pp[1], ageString);
+      Update(cache, pp[0], pp[1], ageString);
     }
   }
 }
 
-void PhraseDictionaryDynamicCacheBased::Update(std::string sourcePhraseString, std::string targetPhraseString, std::string ageString, std::string waString)
+void PhraseDictionaryDynamicCacheBased::Update(Cache &cache, std::string sourcePhraseString, std::string targetPhraseString, std::string ageString, std::string waString)
 {
   VERBOSE(3,"PhraseDictionaryDynamicCacheBased::Update(std::string sourcePhraseString, std::string targetPhraseString, std::string ageString, std::string waString)" << std::endl);
   const StaticData &staticData = StaticData::Instance();
@@ -540,138 +574,50 @@ void PhraseDictionaryDynamicCacheBased::Update(std::string sourcePhraseString, s
 
   if (!waString.empty()) VERBOSE(3, "waString:|" << waString << "|" << std::endl);
 
-  Update(sourcePhrase, targetPhrase, age, waString);
+  Update(cache, sourcePhrase, targetPhrase, age, waString);
 }
 
-void PhraseDictionaryDynamicCacheBased::Update(Phrase sp, TargetPhrase tp, int age, std::string waString)
+void PhraseDictionaryDynamicCacheBased::Update(Cache &cache, Phrase sp, TargetPhrase tp, int age, std::string waString)
 {
   VERBOSE(3,"PhraseDictionaryDynamicCacheBased::Update(Phrase sp, TargetPhrase tp, int age, std::string waString)" << std::endl);
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
   VERBOSE(3, "PhraseDictionaryCache inserting sp:|" << sp << "| tp:|" << tp << "| age:|" << age << "| word-alignment |" << waString << "|" << std::endl);
 
-  cacheMap::const_iterator it = m_cacheTM.find(sp);
+  // the target phrases of sp may be shared with the published cache, so they
+  // are changed in a copy
+  boost::shared_ptr<CacheTargets> targets(new CacheTargets);
+  cacheMap::const_iterator it = cache.entries.find(sp);
   VERBOSE(3,"sp:|" << sp << "|" << std::endl);
-  if(it!=m_cacheTM.end()) {
+  if(it!=cache.entries.end()) {
     VERBOSE(3,"sp:|" << sp << "| FOUND" << std::endl);
-    // sp is found
-    // here we have to remove the target phrase from targetphrasecollection and from the TargetAgeMap
-    // and then add new entry
-
-    TargetCollectionAgePair TgtCollAgePair = it->second;
-    TargetPhraseCollection::shared_ptr  tpc = TgtCollAgePair.first;
-    AgeCollection* ac = TgtCollAgePair.second;
-//    const TargetPhrase* p_ptr = NULL;
-    const Phrase* p_ptr = NULL;
-    TargetPhrase* tp_ptr = NULL;
-    bool found = false;
-    size_t tp_pos=0;
-    while (!found && tp_pos < tpc->GetSize()) {
-      tp_ptr = (TargetPhrase*) tpc->GetTargetPhrase(tp_pos);
-      p_ptr = (const TargetPhrase*) tp_ptr;
-      if ((Phrase) tp == *p_ptr) {
-        found = true;
-        continue;
-      }
-      tp_pos++;
-    }
-    if (!found) {
-      VERBOSE(3,"tp:|" << tp << "| NOT FOUND" << std::endl);
-      std::auto_ptr<TargetPhrase> targetPhrase(new TargetPhrase(tp));
-
-      targetPhrase->GetScoreBreakdown().Assign(this, GetPreComputedScores(age));
-      if (!waString.empty()) targetPhrase->SetAlignmentInfo(waString);
-
-      tpc->Add(targetPhrase.release());
-
-      tp_pos = tpc->GetSize()-1;
-      ac->push_back(age);
-      m_entries++;
-      VERBOSE(3,"sp:|" << sp << "tp:|" << tp << "| INSERTED" << std::endl);
-    } else {
-      tp_ptr->GetScoreBreakdown().Assign(this, GetPreComputedScores(age));
-      if (!waString.empty()) tp_ptr->SetAlignmentInfo(waString);
-      ac->at(tp_pos) = age;
-      VERBOSE(3,"sp:|" << sp << "tp:|" << tp << "| UPDATED" << std::endl);
-    }
+    *targets = *it->second;
   } else {
     VERBOSE(3,"sp:|" << sp << "| NOT FOUND" << std::endl);
-    // p is not found
-    // create target collection
-    // we have to create new target collection age pair and add new entry to target collection age pair
-
-    TargetPhraseCollection::shared_ptr tpc(new TargetPhraseCollection);
-    AgeCollection* ac = new AgeCollection();
-    m_cacheTM.insert(make_pair(sp,make_pair(tpc,ac)));
-
-    //tp is not found
-    std::auto_ptr<TargetPhrase> targetPhrase(new TargetPhrase(tp));
-    targetPhrase->GetScoreBreakdown().Assign(this, GetPreComputedScores(age));
-    if (!waString.empty()) targetPhrase->SetAlignmentInfo(waString);
-
-    tpc->Add(targetPhrase.release());
-    ac->push_back(age);
-    m_entries++;
-    VERBOSE(3,"sp:|" << sp << "| tp:|" << tp << "| INSERTED" << std::endl);
   }
-}
 
-void PhraseDictionaryDynamicCacheBased::Decay()
-{
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
-  cacheMap::iterator it;
-  for(it = m_cacheTM.begin(); it!=m_cacheTM.end(); it++) {
-    Decay((*it).first);
+  size_t tp_pos=0;
+  while (tp_pos < targets->size() && !((Phrase) tp == *(*targets)[tp_pos].targetPhrase)) {
+    tp_pos++;
   }
-}
-
-void PhraseDictionaryDynamicCacheBased::Decay(Phrase sp)
-{
-  VERBOSE(3,"void PhraseDictionaryDynamicCacheBased::Decay(Phrase sp) sp:|" << sp << "|" << std::endl);
-  cacheMap::iterator it = m_cacheTM.find(sp);
-  if (it != m_cacheTM.end()) {
-    VERBOSE(3,"found:|" << sp << "|" << std::endl);
-    //sp is found
-
-    TargetCollectionAgePair TgtCollAgePair = it->second;
-    TargetPhraseCollection::shared_ptr  tpc = TgtCollAgePair.first;
-    AgeCollection* ac = TgtCollAgePair.second;
-
-    //loop in inverted order to allow a correct deletion of std::vectors tpc and ac
-    for (int tp_pos = tpc->GetSize() - 1 ; tp_pos >= 0; tp_pos--) {
-      unsigned int tp_age = ac->at(tp_pos); //increase the age by 1
-      tp_age++; //increase the age by 1
-      VERBOSE(3,"sp:|" << sp << "| " << " new tp_age:|" << tp_age << "|" << std::endl);
-
-      TargetPhrase* tp_ptr = (TargetPhrase*) tpc->GetTargetPhrase(tp_pos);
+  if (tp_pos == targets->size()) {
+    VERBOSE(3,"tp:|" << tp << "| NOT FOUND" << std::endl);
+    boost::shared_ptr<TargetPhrase> targetPhrase(new TargetPhrase(tp));
+    if (!waString.empty()) targetPhrase->SetAlignmentInfo(waString);
 
-      if (tp_age > m_maxAge) {
-        VERBOSE(3,"tp_age:|" << tp_age << "| TOO BIG" << std::endl);
-        tpc->Remove(tp_pos); //delete entry in the Target Phrase Collection
-        ac->erase(ac->begin() + tp_pos); //delete entry in the Age Collection
-        m_entries--;
-      } else {
-        VERBOSE(3,"tp_age:|" << tp_age << "| STILL GOOD" << std::endl);
-        tp_ptr->GetScoreBreakdown().Assign(this, GetPreComputedScores(tp_age));
-        ac->at(tp_pos) = tp_age;
-      }
-    }
-    if (tpc->GetSize() == 0) {
-      // delete the entry from m_cacheTM in case it points to an empty TargetPhraseCollection and AgeCollection
-      (((*it).second).second)->clear();
-      delete ((*it).second).second;
-      ((*it).second).first.reset();
-      m_cacheTM.erase(sp);
-    }
+    CacheTarget target = { targetPhrase, age, cache.decays };
+    targets->push_back(target);
+    VERBOSE(3,"sp:|" << sp << "tp:|" << tp << "| INSERTED" << std::endl);
   } else {
-    //do nothing
-    VERBOSE(3,"sp:|" << sp << "| NOT FOUND" << std::endl);
+    CacheTarget &target = (*targets)[tp_pos];
+    if (!waString.empty()) {
+      boost::shared_ptr<TargetPhrase> targetPhrase(new TargetPhrase(*target.targetPhrase));
+      targetPhrase->SetAlignmentInfo(waString);
+      target.targetPhrase = targetPhrase;
+    }
+    target.age = age;
+    target.decays = cache.decays;
+    VERBOSE(3,"sp:|" << sp << "tp:|" << tp << "| UPDATED" << std::endl);
   }
-
-  //put here the removal of entries with age greater than m_maxAge
+  cache.entries[sp] = targets;
 }
 
 void PhraseDictionaryDynamicCacheBased::Execute(std::string command)
@@ -703,16 +649,11 @@ void PhraseDictionaryDynamicCacheBased::Execute_Single_Command(std::string comma
 void PhraseDictionaryDynamicCacheBased::Clear()
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::mutex::scoped_lock lock(m_updateLock);
 #endif
-  cacheMap::iterator it;
-  for(it = m_cacheTM.begin(); it!=m_cacheTM.end(); it++) {
-    (((*it).second).second)->clear();
-    delete ((*it).second).second;
-    ((*it).second).first.reset();
-  }
-  m_cacheTM.clear();
-  m_entries = 0;
+  boost::shared_ptr<Cache> cache(new Cache());
+  cache->decays = GetCache()->decays;
+  SetCache(cache);
 }
 
 
@@ -742,17 +683,13 @@ void PhraseDictionaryDynamicCacheBased::ExecuteDlt(std::map<std::string, std::st
 void PhraseDictionaryDynamicCacheBased::Print() const
 {
   VERBOSE(2,"PhraseDictionaryDynamicCacheBased::Print()" << std::endl);
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
+  boost::shared_ptr<const Cache> cache = GetCache();
   cacheMap::const_iterator it;
-  for(it = m_cacheTM.begin(); it!=m_cacheTM.end(); it++) {
+  for(it = cache->entries.begin(); it!=cache->entries.end(); it++) {
     std::string source = (it->first).ToString();
-    TargetPhraseCollection::shared_ptr  tpc = (it->second).first;
-    TargetPhraseCollection::iterator itr;
-    for(itr = tpc->begin(); itr != tpc->end(); itr++) {
-      std::string target = (*itr)->ToString();
-      std::cout << source << " ||| " << target << std::endl;
+    BOOST_FOREACH(const CacheTarget &target, *it->second) {
+      std::string target_str = target.targetPhrase->ToString();
+      std::cout << source << " ||| " << target_str << std::endl;
     }
     source.clear();
   }
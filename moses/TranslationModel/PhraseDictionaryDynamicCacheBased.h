@@ -22,12 +22,14 @@
 #ifndef moses_PhraseDictionaryDynamicCacheBased_H
 #define moses_PhraseDictionaryDynamicCacheBased_H
 
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
 #include "moses/TypeDef.h"
 #include "moses/TranslationModel/PhraseDictionary.h"
 
 #ifdef WITH_THREADS
-#include <boost/thread/shared_mutex.hpp>
-#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
 #endif
 
 #define CBTM_SCORE_TYPE_UNDEFINED (-1)
@@ -52,24 +54,42 @@ class ChartRuleLookupManager;
 class PhraseDictionaryDynamicCacheBased : public PhraseDictionary
 {
 
-  typedef std::vector<unsigned int> AgeCollection;
-  typedef std::pair<TargetPhraseCollection::shared_ptr , AgeCollection*> TargetCollectionAgePair;
-  typedef std::map<Phrase, TargetCollectionAgePair> cacheMap;
+  /** a target phrase in the cache, without the scores of this table: its
+   *  age when it was set, and how many times the cache had decayed by then.
+   *  Its age now follows from the decays since, so decaying the cache
+   *  doesn't touch the entries.
+   */
+  struct CacheTarget {
+    boost::shared_ptr<const TargetPhrase> targetPhrase;
+    int age;
+    unsigned int decays;
+  };
+  typedef std::vector<CacheTarget> CacheTargets;
+  typedef boost::unordered_map<Phrase, boost::shared_ptr<const CacheTargets> > cacheMap;
 
   // data structure for the cache
-  cacheMap m_cacheTM;
+  struct Cache {
+    cacheMap entries;
+    unsigned int decays; //! times the cache has decayed
+
+    Cache() : decays(0) {}
+  };
+
+  // The cache is never changed once it's published: an update copies it,
+  // with the target phrases of the source phrases it changes, and publishes
+  // the copy, so the decoding threads read it without locking.
+  boost::shared_ptr<const Cache> m_cacheTM;
   std::vector<Scores> precomputedScores;
   unsigned int m_maxAge;
   size_t m_score_type; //scoring type of the match
-  size_t m_entries; //total number of entries in the cache
   float m_lower_score; //lower_bound_score for no match
   bool m_constant; //flag for setting a non-decaying cache
   std::string m_initfiles; // vector of files loaded in the initialization phase
   std::string m_name; // internal name to identify this instance of the Cache-based phrase table
 
 #ifdef WITH_THREADS
-  //multiple readers - single writer lock
-  mutable boost::shared_mutex m_cacheLock;
+  //one update at a time
+  boost::mutex m_updateLock;
 #endif
 
   friend std::ostream& operator<<(std::ostream&, const PhraseDictionaryDynamicCacheBased&);
@@ -153,28 +173,30 @@ protected:
   float decaying_score(const int age);  // calculates the decay score given the age
   void Insert(std::vector<std::string> entries);
 
-  void Decay();   // traverse through the cache and decay each entry
-  void Decay(Phrase p);   // traverse through the cache and decay each entry for a given Phrase
-  void Update(std::vector<std::string> entries, std::string ageString);
-  void Update(std::string sourceString, std::string targetString, std::string ageString, std::string waString="");
-  void Update(Phrase p, TargetPhrase tp, int age, std::string waString="");
+  boost::shared_ptr<const Cache> GetCache() const;
+  void SetCache(const boost::shared_ptr<const Cache> &cache);
+  boost::shared_ptr<Cache> CopyCache(bool decay) const; // copies the cache, with every entry a step older if decay
+
+  void Update(Cache &cache, std::vector<std::string> entries, std::string ageString);
+  void Update(Cache &cache, std::string sourceString, std::string targetString, std::string ageString, std::string waString="");
+  void Update(Cache &cache, Phrase p, TargetPhrase tp, int age, std::string waString="");
 
-  void ClearEntries(std::vector<std::string> entries);
-  void ClearEntries(std::string sourceString, std::string targetString);
-  void ClearEntries(Phrase p, Phrase tp);
+  void ClearEntries(Cache &cache, std::vector<std::string> entries);
+  void ClearEntries(Cache &cache, std::string sourceString, std::string targetString);
+  void ClearEntries(Cache &cache, Phrase p, Phrase tp);
 
-  void ClearSource(std::vector<std::string> entries);
-  void ClearSource(Phrase sp);
+  void ClearSource(Cache &cache, std::vector<std::string> entries);
+  void ClearSource(Cache &cache, Phrase sp);
 
   void Execute(std::vector<std::string> commands);
   void Execute_Single_Command(std::string command);
 
 
   void SetPreComputedScores(const unsigned int numScoreComponent);
-  Scores GetPreComputedScores(const unsigned int age);
+  const Scores &GetPreComputedScores(const unsigned int age) const;
 
   void Load_Multiple_Files(std::vector<std::string> files);
-  void Load_Single_File(const std::string file);
+  void Load_Single_File(Cache &cache, const std::string file);
 
   TargetPhrase *CreateTargetPhrase(const Phrase &sourcePhrase) const;
 };
@@ -137,6 +137,13 @@ void PhraseDictionaryGroup::Load(AllOptions::ptr const& opts)
   }
 }
 
+std::vector<std::string> PhraseDictionaryGroup::GetLoadDependencies() const
+{
+  std::vector<std::string> ret = PhraseDictionary::GetLoadDependencies();
+  ret.insert(ret.end(), m_memberPDStrs.begin(), m_memberPDStrs.end());
+  return ret;
+}
+
 void PhraseDictionaryGroup::InitializeForInput(const ttasksptr& ttask)
 {
   // Member models are registered as FFs and should already be initialized
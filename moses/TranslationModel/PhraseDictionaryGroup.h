@@ -64,6 +64,7 @@ class PhraseDictionaryGroup: public PhraseDictionary
 public:
   PhraseDictionaryGroup(const std::string& line);
   void Load(AllOptions::ptr const& opts);
+  std::vector<std::string> GetLoadDependencies() const;
   TargetPhraseCollection::shared_ptr
   CreateTargetPhraseCollection(const ttasksptr& ttask,
                                const Phrase& src) const;
@@ -34,6 +34,7 @@
 #include "moses/TranslationModel/RuleTable/Loader.h"
 #include "moses/TranslationModel/CYKPlusParser/ChartRuleLookupManagerMemory.h"
 #include "moses/InputPath.h"
+#include "moses/TargetPhraseCollection.h"
 
 using namespace std;
 
@@ -43,10 +44,69 @@ PhraseDictionaryMemory::PhraseDictionaryMemory(const std::string &line)
   : RuleTableTrie(line)
 {
   ReadParameters();
+}
+
+void PhraseDictionaryMemory::Load(AllOptions::ptr const& opts)
+{
+  if (!BinaryRuleTable::IsBinary(m_filePath)) {
+    RuleTableTrie::Load(opts);
+
+    // caching for memory pt is pointless
+    m_maxCacheSize = 0;
+    return;
+  }
 
-  // caching for memory pt is pointless
-  m_maxCacheSize = 0;
+  m_options = opts;
+  SetFeaturesToApply();
 
+  PrintUserTime("Start mapping binary rule table");
+  m_binaryTable.reset(new BinaryRuleTable(m_filePath));
+  UTIL_THROW_IF2(m_binaryTable->GetNumScores() != GetNumScoreComponents(),
+                 "Size of scoreVector != number (" << m_binaryTable->GetNumScores()
+                 << "!=" << GetNumScoreComponents() << ") of score components in "
+                 << m_filePath);
+  m_binaryTable->InitializeLookup(m_input, m_output);
+}
+
+void PhraseDictionaryMemory::InitializeForInput(ttasksptr const& ttask)
+{
+  if (!m_binaryTable) {
+    return;
+  }
+  if (m_maxCacheSize) {
+    ReduceCache();
+  } else {
+    GetCache().clear();
+  }
+}
+
+TargetPhraseCollection::shared_ptr
+PhraseDictionaryMemory::
+GetTargetPhraseCollection(const BinaryRuleTable::Node &node) const
+{
+  TargetPhraseCollection::shared_ptr ret;
+  if (node.ruleCount == 0) {
+    return ret;
+  }
+
+  CacheColl &cache = GetCache();
+  size_t hash = m_binaryTable->GetIndex(node);
+  CacheColl::iterator iter = cache.find(hash);
+  if (iter != cache.end()) {
+    // in cache. just use it
+    iter->second.second = clock();
+    return iter->second.first;
+  }
+
+  ret.reset(new TargetPhraseCollection);
+  m_binaryTable->CreateTargetPhrases(node, *this, m_input, m_output,
+                                     options()->unk.word_deletion_enabled,
+                                     *ret);
+  if (GetTableLimit()) {
+    ret->Sort(true, GetTableLimit());
+  }
+  cache[hash] = CacheCollEntry(ret, clock());
+  return ret;
 }
 
 TargetPhraseCollection::shared_ptr
@@ -69,6 +129,16 @@ GetTargetPhraseCollectionLEGACY(const Phrase& sourceOrig) const
   // exactly like CreateTargetPhraseCollection, but don't create
   const size_t size = source.GetSize();
 
+  if (m_binaryTable) {
+    const BinaryRuleTable::Node *currNode = &m_binaryTable->GetRoot();
+    for (size_t pos = 0 ; pos < size && currNode; ++pos) {
+      currNode = m_binaryTable->GetTerminalChild(*currNode, source.GetWord(pos));
+    }
+    if (currNode == NULL)
+      return TargetPhraseCollection::shared_ptr();
+    return GetTargetPhraseCollection(*currNode);
+  }
+
   const PhraseDictionaryNodeMemory *currNode = &m_collection;
   for (size_t pos = 0 ; pos < size ; ++pos) {
     const Word& word = source.GetWord(pos);
@@ -149,14 +219,18 @@ GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
     const Phrase &phrase = inputPath.GetPhrase();
     const InputPath *prevPath = inputPath.GetPrevPath();
 
-    const PhraseDictionaryNodeMemory *prevPtNode = NULL;
+    const void *prevPtNode = NULL;
 
     if (prevPath) {
-      prevPtNode = static_cast<const PhraseDictionaryNodeMemory*>(prevPath->GetPtNode(*this));
+      prevPtNode = prevPath->GetPtNode(*this);
     } else {
       // Starting subphrase.
       assert(phrase.GetSize() == 1);
-      prevPtNode = &GetRootNode();
+      if (m_binaryTable) {
+        prevPtNode = &m_binaryTable->GetRoot();
+      } else {
+        prevPtNode = &GetRootNode();
+      }
     }
 
     // backoff
@@ -168,8 +242,18 @@ GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
       Word lastWord = phrase.GetWord(phrase.GetSize() - 1);
       lastWord.OnlyTheseFactors(m_inputFactors);
 
-      const PhraseDictionaryNodeMemory *ptNode = prevPtNode->GetChild(lastWord);
       TargetPhraseCollection::shared_ptr targetPhrases;
+      if (m_binaryTable) {
+        const BinaryRuleTable::Node *ptNode = m_binaryTable->GetTerminalChild(
+                                                *static_cast<const BinaryRuleTable::Node*>(prevPtNode), lastWord);
+        if (ptNode) {
+          targetPhrases = GetTargetPhraseCollection(*ptNode);
+        }
+        inputPath.SetTargetPhrases(*this, targetPhrases, ptNode);
+        continue;
+      }
+
+      const PhraseDictionaryNodeMemory *ptNode = static_cast<const PhraseDictionaryNodeMemory*>(prevPtNode)->GetChild(lastWord);
       if (ptNode) {
         targetPhrases = ptNode->GetTargetPhraseCollection();
       }
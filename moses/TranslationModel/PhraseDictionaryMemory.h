@@ -19,10 +19,13 @@
 
 #pragma once
 
+#include <boost/scoped_ptr.hpp>
+
 #include "PhraseDictionaryNodeMemory.h"
 #include "moses/TranslationModel/PhraseDictionary.h"
 #include "moses/InputType.h"
 #include "moses/NonTerminal.h"
+#include "moses/TranslationModel/RuleTable/BinaryRuleTable.h"
 #include "moses/TranslationModel/RuleTable/Trie.h"
 
 namespace Moses
@@ -31,6 +34,10 @@ class ChartParser;
 
 /** Implementation of a in-memory rule table in a trie.  Looking up a rule of
  * length n symbols requires n look-ups to find the TargetPhraseCollection.
+ *
+ * A table compiled by CreateBinaryRuleTable isn't loaded into a trie: the
+ * lookups walk the trie of the mapped file, and the TargetPhraseCollection of
+ * a node is created when it's first looked up and kept in the cache.
  */
 class PhraseDictionaryMemory : public RuleTableTrie
 {
@@ -45,10 +52,24 @@ protected:
 public:
   PhraseDictionaryMemory(const std::string &line);
 
+  void Load(AllOptions::ptr const& opts);
+
+  void InitializeForInput(ttasksptr const& ttask);
+
   const PhraseDictionaryNodeMemory &GetRootNode() const {
     return m_collection;
   }
 
+  // The compiled table, or NULL if the table was loaded from a text file.
+  const BinaryRuleTable *GetBinaryTable() const {
+    return m_binaryTable.get();
+  }
+
+  // The target phrases of a node of the compiled table, or NULL if it has
+  // no rules.
+  TargetPhraseCollection::shared_ptr
+  GetTargetPhraseCollection(const BinaryRuleTable::Node &node) const;
+
   ChartRuleLookupManager*
   CreateRuleLookupManager(
     const ChartParser &,
@@ -76,6 +97,7 @@ protected:
   void SortAndPrune();
 
   PhraseDictionaryNodeMemory m_collection;
+  boost::scoped_ptr<BinaryRuleTable> m_binaryTable;
 };
 
 }  // namespace Moses
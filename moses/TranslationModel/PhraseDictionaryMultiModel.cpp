@@ -94,6 +94,13 @@ void PhraseDictionaryMultiModel::Load(AllOptions::ptr const& opts)
   }
 }
 
+std::vector<std::string> PhraseDictionaryMultiModel::GetLoadDependencies() const
+{
+  std::vector<std::string> ret = PhraseDictionary::GetLoadDependencies();
+  ret.insert(ret.end(), m_pdStr.begin(), m_pdStr.end());
+  return ret;
+}
+
 TargetPhraseCollection::shared_ptr
 PhraseDictionaryMultiModel::
 GetTargetPhraseCollectionLEGACY(const Phrase& src) const
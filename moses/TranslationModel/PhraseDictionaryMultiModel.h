@@ -71,6 +71,7 @@ public:
   PhraseDictionaryMultiModel(int type, const std::string &line);
   ~PhraseDictionaryMultiModel();
   void Load(AllOptions::ptr const& opts);
+  std::vector<std::string> GetLoadDependencies() const;
 
   virtual void
   CollectSufficientStatistics
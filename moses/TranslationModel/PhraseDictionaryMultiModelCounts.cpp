@@ -120,6 +120,13 @@ void PhraseDictionaryMultiModelCounts::Load(AllOptions::ptr const& opts)
 
 }
 
+std::vector<std::string> PhraseDictionaryMultiModelCounts::GetLoadDependencies() const
+{
+  std::vector<std::string> ret = PhraseDictionaryMultiModel::GetLoadDependencies();
+  ret.insert(ret.end(), m_targetTable.begin(), m_targetTable.end());
+  return ret;
+}
+
 
 TargetPhraseCollection::shared_ptr PhraseDictionaryMultiModelCounts::GetTargetPhraseCollectionLEGACY(const Phrase& src) const
 {
@@ -80,6 +80,7 @@ public:
   PhraseDictionaryMultiModelCounts(const std::string &line);
   ~PhraseDictionaryMultiModelCounts();
   void Load(AllOptions::ptr const& opts);
+  std::vector<std::string> GetLoadDependencies() const;
   TargetPhraseCollection::shared_ptr  CreateTargetPhraseCollectionCounts(const Phrase &src, std::vector<float> &fs, std::map<std::string,multiModelCountsStats*>* allStats, std::vector<std::vector<float> > &multimodelweights) const;
   void CollectSufficientStats(const Phrase &src, std::vector<float> &fs, std::map<std::string,multiModelCountsStats*>* allStats) const;
   float GetTargetCount(const Phrase& target, size_t modelIndex) const;
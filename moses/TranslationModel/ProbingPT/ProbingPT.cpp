@@ -1,4 +1,5 @@
 // vim:tabstop=2
+#include <algorithm>
 #include "ProbingPT.h"
 #include "moses/StaticData.h"
 #include "moses/FactorCollection.h"
@@ -233,16 +234,41 @@ TargetPhraseCollection *ProbingPT::CreateTargetPhrases(
     const char *offset = data + query_result.second;
     uint64_t *numTP = (uint64_t*) offset;
 
+    offset += sizeof(uint64_t);
+
     tps = new TargetPhraseCollection();
 
-    offset += sizeof(uint64_t);
-    for (size_t i = 0; i < *numTP; ++i) {
-      TargetPhrase *tp = CreateTargetPhrase(offset);
-      assert(tp);
-      tp->EvaluateInIsolation(sourcePhrase, GetFeaturesToApply());
+    size_t preselectLimit = GetPreselectLimit();
+    if (preselectLimit && *numTP > preselectLimit) {
+      // Rank the rules by their weighted scores in this table, read from the
+      // mapped file, and only build and score the best of them.  The weights
+      // are the current sentence's, which may differ from the moses.ini ones.
+      const std::vector<float> weights = StaticData::Instance().GetWeights(this);
+      std::vector<std::pair<float, const char*> > rules(*numTP);
+      for (size_t i = 0; i < *numTP; ++i) {
+        rules[i].second = offset;
+        rules[i].first = ReadWeightedScore(offset, weights);
+      }
+      std::nth_element(rules.begin(), rules.begin() + preselectLimit,
+                       rules.end(), std::greater<std::pair<float, const char*> >());
+
+      for (size_t i = 0; i < preselectLimit; ++i) {
+        const char *ruleOffset = rules[i].second;
+        TargetPhrase *tp = CreateTargetPhrase(ruleOffset);
+        assert(tp);
+        tp->EvaluateInIsolation(sourcePhrase, GetFeaturesToApply());
+
+        tps->Add(tp);
+      }
+    } else {
+      for (size_t i = 0; i < *numTP; ++i) {
+        TargetPhrase *tp = CreateTargetPhrase(offset);
+        assert(tp);
+        tp->EvaluateInIsolation(sourcePhrase, GetFeaturesToApply());
 
-      tps->Add(tp);
+        tps->Add(tp);
 
+      }
     }
 
     tps->Prune(true, m_tableLimit);
@@ -327,6 +353,29 @@ TargetPhrase *ProbingPT::CreateTargetPhrase(
   return tp;
 }
 
+// The weighted score of the rule at offset, from the scores of this table.
+// Moves offset to the next rule.
+float ProbingPT::ReadWeightedScore(
+  const char *&offset, const std::vector<float> &weights) const
+{
+  const TargetPhraseInfo *tpInfo = (const TargetPhraseInfo*) offset;
+  size_t numRealWords = tpInfo->numWords / m_output.size();
+  offset += sizeof(TargetPhraseInfo);
+
+  const float *scores = (const float*) offset;
+  float ret = 0;
+  for (size_t i = 0; i < weights.size(); ++i) {
+    float score = m_engine->logProb ? scores[i] : FloorScore(TransformScore(scores[i]));
+    ret += weights[i] * score;
+  }
+
+  size_t totalNumScores = m_engine->num_scores + m_engine->num_lex_scores;
+  offset += sizeof(float) * totalNumScores;
+  offset += sizeof(uint32_t) * numRealWords * m_output.size();
+
+  return ret;
+}
+
 //////////////////////////////////////////////////////////////////
 
 
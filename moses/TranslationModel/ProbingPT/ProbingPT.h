@@ -67,6 +67,8 @@ protected:
     const Phrase &sourcePhrase, uint64_t key) const;
   TargetPhrase *CreateTargetPhrase(
     const char *&offset) const;
+  float ReadWeightedScore(
+    const char *&offset, const std::vector<float> &weights) const;
 
   inline const Factor *GetTargetFactor(uint32_t probingId) const {
     if (probingId >= m_targetVocab.size()) {
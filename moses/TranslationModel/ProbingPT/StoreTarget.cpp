@@ -104,8 +104,32 @@ void StoreTarget::SaveAlignment()
 }
 
 void StoreTarget::Append(const line_text &line, bool log_prob, bool scfg)
+{
+  parsed_target parsed;
+  Parse(line, log_prob, scfg, parsed);
+  Append(parsed);
+}
+
+void StoreTarget::Append(parsed_target &parsed)
 {
   target_text *rule = new target_text;
+  rule->prob.swap(parsed.rule.prob);
+  rule->word_align_term.swap(parsed.rule.word_align_term);
+  rule->word_align_non_term.swap(parsed.rule.word_align_non_term);
+
+  rule->target_phrase.reserve(parsed.target_factors.size());
+  for (size_t i = 0; i < parsed.target_factors.size(); ++i) {
+    string factorStr = parsed.target_factors[i].as_string();
+    rule->target_phrase.push_back(m_vocab.GetVocabId(factorStr));
+  }
+
+  m_coll.push_back(rule);
+}
+
+void StoreTarget::Parse(const line_text &line, bool log_prob, bool scfg,
+                        parsed_target &out)
+{
+  target_text *rule = &out.rule;
   //cerr << "line.target_phrase=" << line.target_phrase << endl;
 
   // target_phrase
@@ -131,13 +155,7 @@ void StoreTarget::Append(const line_text &line, bool log_prob, bool scfg)
     itFactor = util::TokenIter<util::SingleCharacter>(word,
                util::SingleCharacter('|'));
     while (itFactor) {
-      StringPiece factor = *itFactor;
-
-      string factorStr = factor.as_string();
-      uint32_t vocabId = m_vocab.GetVocabId(factorStr);
-
-      rule->target_phrase.push_back(vocabId);
-
+      out.target_factors.push_back(*itFactor);
       itFactor++;
     }
 
@@ -214,7 +232,6 @@ void StoreTarget::Append(const line_text &line, bool log_prob, bool scfg)
    rule->property.push_back(prop[i]);
    }
    */
-  m_coll.push_back(rule);
 }
 
 uint32_t StoreTarget::GetAlignId(const std::vector<size_t> &align)
@@ -231,7 +248,7 @@ uint32_t StoreTarget::GetAlignId(const std::vector<size_t> &align)
 }
 
 void StoreTarget::AppendLexRO(std::string &prop, std::vector<float> &retvector,
-                              bool log_prob) const
+                              bool log_prob)
 {
   size_t startPos = prop.find("{{LexRO ");
 
@@ -12,12 +12,17 @@
 #include <boost/unordered_map.hpp>
 #include <boost/unordered_set.hpp>
 #include "StoreVocab.h"
+#include "line_splitter.hh"
 
 namespace Moses
 {
 
-class line_text;
-class target_text;
+//A target phrase whose words haven't been given vocab ids yet.
+//Parsing into this doesn't touch any state so it can be done on worker threads
+struct parsed_target {
+  std::vector<StringPiece> target_factors;
+  target_text rule;
+};
 
 class StoreTarget
 {
@@ -29,6 +34,10 @@ public:
   void SaveAlignment();
 
   void Append(const line_text &line, bool log_prob, bool scfg);
+  void Append(parsed_target &parsed);
+
+  static void Parse(const line_text &line, bool log_prob, bool scfg,
+                    parsed_target &out);
 protected:
   std::string m_basePath;
   std::fstream m_fileTargetColl;
@@ -42,8 +51,8 @@ protected:
   uint32_t GetAlignId(const std::vector<size_t> &align);
   void Save(const target_text &rule);
 
-  void AppendLexRO(std::string &prop, std::vector<float> &retvector,
-                   bool log_prob) const;
+  static void AppendLexRO(std::string &prop, std::vector<float> &retvector,
+                          bool log_prob);
 
 };
 
@@ -1,11 +1,19 @@
 #include <sys/stat.h>
+#include <deque>
 #include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
 #include "line_splitter.hh"
 #include "storing.hh"
 #include "StoreTarget.h"
 #include "StoreVocab.h"
+#include "moses/ThreadPool.h"
 #include "moses/Util.h"
-#include "moses/InputFileStream.h"
+#include "util/mmap.hh"
 
 using namespace std;
 
@@ -13,7 +21,57 @@ namespace Moses
 {
 
 ///////////////////////////////////////////////////////////////////////
-void Node::Add(Table &table, const SourcePhrase &sourcePhrase, size_t pos)
+GrowingTable::GrowingTable(const std::string &basepath, uint64_t estimated_entries)
+  :m_file(util::MakeTemp(basepath + "/probing_hash"))
+  ,m_size(Table::Size(std::max<uint64_t>(estimated_entries, 1024), 1.2))
+{
+  m_mem = util::MapZeroedWrite(m_file.get(), m_size);
+  Table table(m_mem, m_size);
+  m_table = table;
+}
+
+GrowingTable::~GrowingTable()
+{
+  util::UnmapOrThrow(m_mem, m_size);
+}
+
+void GrowingTable::Insert(const Entry &entry)
+{
+  if ((m_table.SizeNoSerialization() + 1) * 1.2 >= m_size / sizeof(Entry)) {
+    Grow();
+  }
+  m_table.Insert(entry);
+}
+
+void GrowingTable::Grow()
+{
+  //The file grows with zeros, which is the invalid key, so Double() needn't clear it
+  std::size_t new_size = m_table.DoubleTo();
+  util::UnmapOrThrow(m_mem, m_size);
+  util::ResizeOrThrow(m_file.get(), new_size);
+  m_mem = util::MapOrThrow(new_size, true, util::kFileFlags, false, m_file.get());
+  m_size = new_size;
+  m_table.Double(m_mem, false);
+}
+
+void GrowingTable::Write(const std::string &path) const
+{
+  std::size_t size = Table::Size(Entries(), 1.2);
+  util::scoped_fd file;
+  void *mem = util::MapZeroedWrite(path.c_str(), size, file);
+  Table table(mem, size);
+
+  const Entry::Key invalid = Entry::Key();
+  for (Table::ConstIterator i = m_table.RawBegin(); i != m_table.RawEnd(); ++i) {
+    if (i->key != invalid) {
+      table.Insert(*i);
+    }
+  }
+  util::UnmapOrThrow(mem, size);
+}
+
+///////////////////////////////////////////////////////////////////////
+void Node::Add(GrowingTable &table, const SourcePhrase &sourcePhrase, size_t pos)
 {
   if (pos < sourcePhrase.size()) {
     uint64_t vocabId = sourcePhrase[pos];
@@ -43,7 +101,7 @@ void Node::Add(Table &table, const SourcePhrase &sourcePhrase, size_t pos)
   }
 }
 
-void Node::Write(Table &table)
+void Node::Write(GrowingTable &table)
 {
   //cerr << "START write " << done << " " << key << endl;
   BOOST_FOREACH(Children::value_type &valPair, m_children) {
@@ -63,9 +121,115 @@ void Node::Write(Table &table)
 }
 
 ///////////////////////////////////////////////////////////////////////
+namespace
+{
+
+//One line of the phrase table, parsed on a worker thread
+struct ParsedLine {
+  StringPiece source_phrase;
+  //Only set on the first line of each source phrase in a batch
+  std::vector<uint64_t> vocabid_source;
+  parsed_target target;
+  //Second column of the counts, only parsed where vocabid_source is set
+  bool has_count;
+  float count;
+};
+
+//A batch of consecutive phrase table lines. Splitting the lines, hashing
+//the source words and converting the scores and alignments is done in Run(),
+//which may be on any thread. Everything that assigns ids or writes files is
+//left to the reading thread, which consumes the batches in input order.
+class ParseBatchTask : public Task
+{
+public:
+  ParseBatchTask(bool log_prob, bool scfg, bool parse_counts)
+    :m_logProb(log_prob)
+    ,m_scfg(scfg)
+    ,m_parseCounts(parse_counts)
+    ,m_numLines(0)
+    ,m_done(false)
+  {}
+
+  void Add(const StringPiece &line) {
+    m_text.append(line.data(), line.size());
+    m_text += '\n';
+    ++m_numLines;
+  }
+
+  size_t Size() const {
+    return m_numLines;
+  }
+
+  void Run() {
+    m_lines.resize(m_numLines);
+    size_t start = 0;
+    for (size_t i = 0; i < m_numLines; ++i) {
+      size_t end = m_text.find('\n', start);
+      line_text line = splitLine(StringPiece(m_text.data() + start, end - start), m_scfg);
+      start = end + 1;
+
+      ParsedLine &parsed = m_lines[i];
+      parsed.source_phrase = line.source_phrase;
+      parsed.has_count = false;
+      StoreTarget::Parse(line, m_logProb, m_scfg, parsed.target);
+
+      if (i && parsed.source_phrase == m_lines[i - 1].source_phrase) {
+        continue;
+      }
+      parsed.vocabid_source = getVocabIDs(parsed.source_phrase);
+
+      if (m_parseCounts) {
+        std::string countStr = line.counts.as_string();
+        countStr = Trim(countStr);
+        if (!countStr.empty()) {
+          std::vector<float> toks = Tokenize<float>(countStr);
+          if (toks.size() >= 2) {
+            parsed.has_count = true;
+            parsed.count = toks[1];
+          }
+        }
+      }
+    }
+
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    m_done = true;
+#ifdef WITH_THREADS
+    m_finished.notify_all();
+#endif
+  }
+
+  // Wait until Run() is done and return the parsed lines
+  std::vector<ParsedLine> &Lines() {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!m_done) m_finished.wait(lock);
+#endif
+    return m_lines;
+  }
+
+private:
+  bool m_logProb, m_scfg, m_parseCounts;
+  std::string m_text;
+  size_t m_numLines;
+  std::vector<ParsedLine> m_lines;
+
+  bool m_done;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+  boost::condition_variable m_finished;
+#endif
+};
+
+const size_t kLinesPerBatch = 10000;
+
+}
+
 void createProbingPT(const std::string &phrasetable_path,
                      const std::string &basepath, int num_scores, int num_lex_scores,
-                     bool log_prob, int max_cache_size, bool scfg)
+                     bool log_prob, int max_cache_size, bool scfg,
+                     size_t num_threads)
 {
   std::cerr << "Starting..." << std::endl;
 
@@ -74,20 +238,17 @@ void createProbingPT(const std::string &phrasetable_path,
 
   StoreTarget storeTarget(basepath);
 
-  //Get uniq lines:
-  unsigned long uniq_entries = countUniqueSource(phrasetable_path);
-
   //Source phrase vocabids
   StoreVocab<uint64_t> sourceVocab(basepath + "/source_vocabids");
 
-  //Read the file
-  util::FilePiece filein(phrasetable_path.c_str());
+  //Read the file. It may be compressed so its size is only a hint for the
+  //initial table size; there's no separate pass to count the source phrases
+  int fd = util::OpenReadOrThrow(phrasetable_path.c_str());
+  uint64_t file_size = util::SizeFile(fd);
+  util::FilePiece filein(fd, phrasetable_path.c_str());
 
-  //Init the probing hash table
-  size_t size = Table::Size(uniq_entries, 1.2);
-  char * mem = new char[size];
-  memset(mem, 0, size);
-  Table sourceEntries(mem, size);
+  GrowingTable sourceEntries(basepath,
+                             file_size == util::kBadSize ? 0 : file_size / 256);
 
   std::priority_queue<CacheItem*, std::vector<CacheItem*>, CacheItemOrderer> cache;
   float totalSourceCount = 0;
@@ -97,161 +258,147 @@ void createProbingPT(const std::string &phrasetable_path,
 
   //Read everything and processs
   std::string prevSource;
+  std::vector<uint64_t> prevVocabidSource;
+  bool started = false;
 
   Node sourcePhrases;
   sourcePhrases.done = true;
   sourcePhrases.key = 0;
 
-  while (true) {
-    try {
-      //Process line read
-      line_text line;
-      line = splitLine(filein.ReadLine(), scfg);
-      //cerr << "line=" << line.source_phrase << endl;
+#ifdef WITH_THREADS
+  boost::scoped_ptr<ThreadPool> pool;
+  if (num_threads > 1) {
+    pool.reset(new ThreadPool(num_threads));
+  }
+#endif
+  std::deque<boost::shared_ptr<ParseBatchTask> > pending;
+  bool eof = false;
+
+  while (!eof || !pending.empty()) {
+    // keep the pool busy with the batches that follow the one consumed next
+    while (!eof && pending.size() <= 4 * num_threads) {
+      boost::shared_ptr<ParseBatchTask> batch(new ParseBatchTask(log_prob, scfg, max_cache_size != 0));
+      StringPiece text;
+      while (batch->Size() < kLinesPerBatch && filein.ReadLineOrEOF(text)) {
+        batch->Add(text);
+      }
+      eof = batch->Size() < kLinesPerBatch;
+#ifdef WITH_THREADS
+      if (pool) {
+        pool->Submit(batch);
+      } else
+#endif
+      {
+        batch->Run();
+      }
+      pending.push_back(batch);
+    }
+
+    std::vector<ParsedLine> &lines = pending.front()->Lines();
+    for (size_t i = 0; i < lines.size(); ++i) {
+      ParsedLine &line = lines[i];
 
       ++line_num;
       if (line_num % 1000000 == 0) {
         std::cerr << line_num << " " << std::flush;
       }
 
-      //Add source phrases to vocabularyIDs
-      add_to_map(sourceVocab, line.source_phrase);
-
-      if (prevSource.empty()) {
+      if (!started) {
         // 1st line
-        prevSource = line.source_phrase.as_string();
-        storeTarget.Append(line, log_prob, scfg);
-      } else if (prevSource == line.source_phrase) {
-        //If we still have the same line, just append to it:
-        storeTarget.Append(line, log_prob, scfg);
-      } else {
-        assert(prevSource != line.source_phrase);
-
-        //Create a new entry even
-
+        started = true;
+      } else if (prevSource != line.source_phrase) {
         // save
         uint64_t targetInd = storeTarget.Save();
 
-        // next line
-        storeTarget.Append(line, log_prob, scfg);
-
         //Create an entry for the previous source phrase:
         Entry sourceEntry;
         sourceEntry.value = targetInd;
         //The key is the sum of hashes of individual words bitshifted by their position in the phrase.
         //Probably not entirerly correct, but fast and seems to work fine in practise.
-        std::vector<uint64_t> vocabid_source = getVocabIDs(prevSource);
         if (scfg) {
           // storing prefixes?
-          sourcePhrases.Add(sourceEntries, vocabid_source);
+          sourcePhrases.Add(sourceEntries, prevVocabidSource);
         }
-        sourceEntry.key = getKey(vocabid_source);
+        sourceEntry.key = getKey(prevVocabidSource);
 
-        /*
-        cerr << "prevSource=" << prevSource << flush
-            << " vocabids=" << Debug(vocabid_source) << flush
-            << " key=" << sourceEntry.key << endl;
-        */
         //Put into table
         sourceEntries.Insert(sourceEntry);
 
         // update cache - CURRENT source phrase, not prev
-        if (max_cache_size) {
-          std::string countStr = line.counts.as_string();
-          countStr = Trim(countStr);
-          if (!countStr.empty()) {
-            std::vector<float> toks = Tokenize<float>(countStr);
-            //cerr << "CACHE:" << line.source_phrase << " " << countStr << " " << toks[1] << endl;
-
-            if (toks.size() >= 2) {
-              totalSourceCount += toks[1];
-
-              // compute key for CURRENT source
-              std::vector<uint64_t> currVocabidSource = getVocabIDs(line.source_phrase.as_string());
-              uint64_t currKey = getKey(currVocabidSource);
-
-              CacheItem *item = new CacheItem(
-                Trim(line.source_phrase.as_string()),
-                currKey,
-                toks[1]);
-              cache.push(item);
-
-              if (max_cache_size > 0 && cache.size() > max_cache_size) {
-                cache.pop();
-              }
-            }
+        if (max_cache_size && line.has_count) {
+          totalSourceCount += line.count;
+
+          CacheItem *item = new CacheItem(
+            Trim(line.source_phrase.as_string()),
+            getKey(line.vocabid_source),
+            line.count);
+          cache.push(item);
+
+          if (max_cache_size > 0 && cache.size() > max_cache_size) {
+            cache.pop();
           }
         }
-
-        //Set prevLine
-        prevSource = line.source_phrase.as_string();
+      } else {
+        //If we still have the same source phrase, just append to it
+        storeTarget.Append(line.target);
+        continue;
       }
 
-    } catch (util::EndOfFileException e) {
-      std::cerr
-          << "Reading phrase table finished, writing remaining files to disk."
-          << std::endl;
-
-      //After the final entry is constructed we need to add it to the phrase_table
-      //Create an entry for the previous source phrase:
-      uint64_t targetInd = storeTarget.Save();
+      //Add source phrases to vocabularyIDs
+      add_to_map(sourceVocab, line.source_phrase);
 
-      Entry sourceEntry;
-      sourceEntry.value = targetInd;
+      prevSource = line.source_phrase.as_string();
+      prevVocabidSource.swap(line.vocabid_source);
+      storeTarget.Append(line.target);
+    }
+    pending.pop_front();
+  }
+#ifdef WITH_THREADS
+  if (pool) {
+    pool->Stop(true);
+  }
+#endif
 
-      //The key is the sum of hashes of individual words. Probably not entirerly correct, but fast
-      std::vector<uint64_t> vocabid_source = getVocabIDs(prevSource);
-      sourceEntry.key = getKey(vocabid_source);
+  std::cerr
+      << "Reading phrase table finished, writing remaining files to disk."
+      << std::endl;
 
-      //Put into table
-      sourceEntries.Insert(sourceEntry);
+  //After the final entry is constructed we need to add it to the phrase_table
+  if (started) {
+    uint64_t targetInd = storeTarget.Save();
 
-      break;
+    Entry sourceEntry;
+    sourceEntry.value = targetInd;
+    if (scfg) {
+      sourcePhrases.Add(sourceEntries, prevVocabidSource);
     }
+    sourceEntry.key = getKey(prevVocabidSource);
+
+    //Put into table
+    sourceEntries.Insert(sourceEntry);
   }
 
   sourcePhrases.Write(sourceEntries);
 
   storeTarget.SaveAlignment();
 
-  serialize_table(mem, size, (basepath + "/probing_hash.dat"));
+  sourceEntries.Write(basepath + "/probing_hash.dat");
 
   sourceVocab.Save();
 
   serialize_cache(cache, (basepath + "/cache"), totalSourceCount);
 
-  delete[] mem;
-
   //Write configfile
   std::ofstream configfile;
   configfile.open((basepath + "/config").c_str());
   configfile << "API_VERSION\t" << API_VERSION << '\n';
-  configfile << "uniq_entries\t" << uniq_entries << '\n';
+  configfile << "uniq_entries\t" << sourceEntries.Entries() << '\n';
   configfile << "num_scores\t" << num_scores << '\n';
   configfile << "num_lex_scores\t" << num_lex_scores << '\n';
   configfile << "log_prob\t" << log_prob << '\n';
   configfile.close();
 }
 
-size_t countUniqueSource(const std::string &path)
-{
-  size_t ret = 0;
-  InputFileStream strme(path);
-
-  std::string line, prevSource;
-  while (std::getline(strme, line)) {
-    std::vector<std::string> toks = TokenizeMultiCharSeparator(line, "|||");
-    assert(toks.size() != 0);
-
-    if (prevSource != toks[0]) {
-      prevSource = toks[0];
-      ++ret;
-    }
-  }
-
-  return ret;
-}
-
 void serialize_cache(
   std::priority_queue<CacheItem*, std::vector<CacheItem*>, CacheItemOrderer> &cache,
   const std::string &path, float totalSourceCount)
@@ -21,6 +21,34 @@ namespace Moses
 {
 typedef std::vector<uint64_t> SourcePhrase;
 
+//Probing hash table kept in an mmapped, unlinked temporary file rather than
+//on the heap. It doubles in place when it gets too full, so the number of
+//source phrases doesn't have to be known in advance
+class GrowingTable
+{
+public:
+  GrowingTable(const std::string &basepath, uint64_t estimated_entries);
+  ~GrowingTable();
+
+  void Insert(const Entry &entry);
+
+  uint64_t Entries() const {
+    return m_table.SizeNoSerialization();
+  }
+
+  //Rehash into a table of exactly Table::Size(Entries(), 1.2), the size the
+  //loader expects, and write it to path
+  void Write(const std::string &path) const;
+
+protected:
+  util::scoped_fd m_file;
+  void *m_mem;
+  std::size_t m_size;
+  Table m_table;
+
+  void Grow();
+};
+
 
 class Node
 {
@@ -35,14 +63,15 @@ public:
     :done(false)
   {}
 
-  void Add(Table &table, const SourcePhrase &sourcePhrase, size_t pos = 0);
-  void Write(Table &table);
+  void Add(GrowingTable &table, const SourcePhrase &sourcePhrase, size_t pos = 0);
+  void Write(GrowingTable &table);
 };
 
 
 void createProbingPT(const std::string &phrasetable_path,
                      const std::string &basepath, int num_scores, int num_lex_scores,
-                     bool log_prob, int max_cache_size, bool scfg);
+                     bool log_prob, int max_cache_size, bool scfg,
+                     size_t num_threads = 1);
 uint64_t getKey(const std::vector<uint64_t> &source_phrase);
 
 std::vector<uint64_t> CreatePrefix(const std::vector<uint64_t> &vocabid_source, size_t endPos);
@@ -57,8 +86,6 @@ std::string Debug(const std::vector<T> &vec)
   return strm.str();
 }
 
-size_t countUniqueSource(const std::string &path);
-
 class CacheItem
 {
 public:
@@ -0,0 +1,619 @@
+#include "BinaryRuleTable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "moses/Phrase.h"
+#include "moses/TargetPhrase.h"
+#include "moses/TargetPhraseCollection.h"
+#include "moses/TranslationModel/PhraseDictionary.h"
+#include "moses/Util.h"
+#include "util/double-conversion/double-conversion.h"
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/file_piece.hh"
+#include "util/tokenize_piece.hh"
+
+namespace Moses
+{
+
+const char BinaryRuleTable::kMagic[8] = {'m', 'o', 's', 'e', 's', 'R', 'T', 'b'};
+
+namespace
+{
+
+uint32_t GetOrAddToken(const StringPiece &token,
+                       boost::unordered_map<std::string, uint32_t> &ids,
+                       std::vector<std::string> &tokens)
+{
+  std::string str = token.as_string();
+  boost::unordered_map<std::string, uint32_t>::const_iterator p =
+    ids.find(str);
+  if (p != ids.end()) {
+    return p->second;
+  }
+  uint32_t id = tokens.size();
+  ids[str] = id;
+  tokens.push_back(str);
+  return id;
+}
+
+template<typename T>
+void Append(std::vector<char> &record, const T *data, std::size_t n)
+{
+  const char *begin = reinterpret_cast<const char*>(data);
+  record.insert(record.end(), begin, begin + n*sizeof(T));
+}
+
+bool IsBracketed(const StringPiece &token)
+{
+  return token.size() >= 2 && token.data()[0] == '['
+         && token.data()[token.size()-1] == ']';
+}
+
+// The source (Input) or target (Output) label of a non-terminal token of a
+// rule's right-hand side, e.g. X or NP of [X][NP].
+StringPiece NonTermLabel(const StringPiece &token, FactorDirection direction)
+{
+  std::size_t nextPos = token.find('[', 1);
+  UTIL_THROW_IF2(nextPos == StringPiece::npos,
+                 "Incorrect formatting of non-terminal. Should have 2 non-terms, eg. [X][X]. "
+                 << "Current string: " << token);
+  if (direction == Input) {
+    return token.substr(1, nextPos - 2);
+  }
+  return token.substr(nextPos + 1, token.size() - nextPos - 2);
+}
+
+// An edge of the source trie while it's built.
+struct EdgeKey {
+  uint32_t parent;
+  uint32_t label;
+  uint32_t targetLabel;
+
+  bool operator==(const EdgeKey &other) const {
+    return parent == other.parent && label == other.label
+           && targetLabel == other.targetLabel;
+  }
+};
+
+std::size_t hash_value(const EdgeKey &key)
+{
+  std::size_t seed = 0;
+  boost::hash_combine(seed, key.parent);
+  boost::hash_combine(seed, key.label);
+  boost::hash_combine(seed, key.targetLabel);
+  return seed;
+}
+
+typedef boost::unordered_map<EdgeKey, uint32_t> EdgeMap;
+
+// Orders the edges by parent, with each node's terminal edges first.
+struct EdgeOrder {
+  bool operator()(const std::pair<EdgeKey, uint32_t> &a,
+                  const std::pair<EdgeKey, uint32_t> &b) const {
+    const bool aNonTerm = a.first.targetLabel != BinaryRuleTable::kNoLabel;
+    const bool bNonTerm = b.first.targetLabel != BinaryRuleTable::kNoLabel;
+    if (a.first.parent != b.first.parent) {
+      return a.first.parent < b.first.parent;
+    }
+    if (aNonTerm != bNonTerm) {
+      return bNonTerm;
+    }
+    if (a.first.label != b.first.label) {
+      return a.first.label < b.first.label;
+    }
+    return a.first.targetLabel < b.first.targetLabel;
+  }
+};
+
+bool EdgeLabelLess(const BinaryRuleTable::Edge &edge, uint32_t label)
+{
+  return edge.label < label;
+}
+
+template<typename T>
+void Write(std::ofstream &out, const T *data, std::size_t n)
+{
+  out.write(reinterpret_cast<const char*>(data), n*sizeof(T));
+}
+
+void Align(std::ofstream &out)
+{
+  while (out.tellp() % 8) {
+    out.put(0);
+  }
+}
+
+}  // namespace
+
+bool BinaryRuleTable::IsBinary(const std::string &path)
+{
+  std::ifstream in(path.c_str(), std::ios::binary);
+  char magic[sizeof(kMagic)];
+  return in.read(magic, sizeof(magic)) &&
+         std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+void BinaryRuleTable::Create(const std::string &inPath,
+                             const std::string &outPath)
+{
+  util::FilePiece in(inPath.c_str(), &std::cerr);
+  std::ofstream out(outPath.c_str(), std::ios::binary);
+  UTIL_THROW_IF2(!out, "Couldn't open " << outPath << " for writing");
+
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  boost::unordered_map<std::string, uint32_t> ids;
+  std::vector<std::string> tokens;
+
+  // the source trie: the edges, and the node of each rule
+  boost::unordered_map<std::string, uint32_t> labelIds;
+  std::vector<std::string> labels;
+  EdgeMap edges;
+  uint32_t nodeCount = 1;
+  std::vector<std::pair<uint32_t, uint64_t> > ruleNodes;
+  uint64_t ruleOffset = sizeof(header);
+
+  double_conversion::StringToDoubleConverter converter(double_conversion::StringToDoubleConverter::NO_FLAGS, NAN, NAN, "inf", "nan");
+
+  // reused variables
+  std::vector<uint32_t> source, target;
+  std::vector<uint16_t> align;
+  std::vector<float> scores;
+  std::vector<char> record;
+  StringPiece line;
+
+  while (true) {
+    try {
+      line = in.ReadLine();
+    } catch (const util::EndOfFileException &e) {
+      break;
+    }
+
+    util::TokenIter<util::MultiCharacter> pipes(line, "|||");
+    StringPiece sourceString(*pipes);
+    StringPiece targetString(*++pipes);
+    StringPiece scoreString(*++pipes);
+    StringPiece alignString;
+    if (++pipes) {
+      alignString = *pipes;
+    }
+
+    source.clear();
+    for (util::TokenIter<util::AnyCharacter, true> t(sourceString, "\t "); t; ++t) {
+      source.push_back(GetOrAddToken(*t, ids, tokens));
+    }
+    target.clear();
+    for (util::TokenIter<util::AnyCharacter, true> t(targetString, "\t "); t; ++t) {
+      target.push_back(GetOrAddToken(*t, ids, tokens));
+    }
+
+    scores.clear();
+    for (util::TokenIter<util::AnyCharacter, true> s(scoreString, " \t"); s; ++s) {
+      int processed;
+      float score = converter.StringToFloat(s->data(), s->length(), &processed);
+      UTIL_THROW_IF2(std::isnan(score), "Bad score " << *s << " on line " << header.ruleCount);
+      scores.push_back(score);
+    }
+    if (header.ruleCount == 0) {
+      header.numScores = scores.size();
+    }
+    UTIL_THROW_IF2(scores.size() != header.numScores,
+                   "Size of scoreVector != number (" << scores.size() << "!="
+                   << header.numScores << ") of score components on line "
+                   << header.ruleCount);
+
+    align.clear();
+    for (util::TokenIter<util::AnyCharacter, true> t(alignString, " \t"); t; ++t) {
+      util::TokenIter<util::SingleCharacter, false> dash(*t, util::SingleCharacter('-'));
+      char *endptr;
+      unsigned long sourcePos = std::strtoul(dash->data(), &endptr, 10);
+      UTIL_THROW_IF2(endptr != dash->data() + dash->size(), "Error parsing alignment " << *t);
+      ++dash;
+      unsigned long targetPos = std::strtoul(dash->data(), &endptr, 10);
+      UTIL_THROW_IF2(endptr != dash->data() + dash->size(), "Error parsing alignment " << *t);
+      UTIL_THROW_IF2(++dash, "Extra gunk in alignment " << *t);
+      align.push_back(sourcePos);
+      align.push_back(targetPos);
+    }
+
+    ++pipes;  // skip over counts field.
+
+    RuleHeader rule;
+    std::memset(&rule, 0, sizeof(rule));
+    StringPiece sparseString, propertiesString;
+    if (++pipes) {
+      sparseString = *pipes;
+      rule.flags |= kHasSparse;
+      rule.sparseSize = sparseString.size();
+    }
+    if (++pipes) {
+      propertiesString = *pipes;
+      rule.flags |= kHasProperties;
+      rule.propertiesSize = propertiesString.size();
+    }
+
+    UTIL_THROW_IF2(source.size() > 0xffff || target.size() > 0xffff ||
+                   align.size()/2 > 0xffff,
+                   "Rule too long on line " << header.ruleCount);
+    rule.sourceSize = source.size();
+    rule.targetSize = target.size();
+    rule.alignSize = align.size()/2;
+
+    // Find the rule's node as PhraseDictionaryMemory::GetOrCreateNode does:
+    // a terminal is an edge by itself, a non-terminal an edge together with
+    // the target non-terminal aligned to it.
+    std::size_t sourceSize = source.size();
+    if (sourceSize && IsBracketed(tokens[source[sourceSize-1]])) {
+      --sourceSize;
+    }
+    uint32_t node = 0;
+    for (std::size_t pos = 0; pos < sourceSize; ++pos) {
+      const std::string &token = tokens[source[pos]];
+      EdgeKey key;
+      key.parent = node;
+      if (IsBracketed(token)) {
+        std::size_t i = 0;
+        while (i < align.size() && (align[i] != pos || align[i+1] >= target.size()
+                                    || !IsBracketed(tokens[target[align[i+1]]]))) {
+          i += 2;
+        }
+        UTIL_THROW_IF2(i == align.size(), "No alignment for non-term at position "
+                       << pos << " on line " << header.ruleCount);
+#if defined(UNLABELLED_SOURCE)
+        key.label = kNoLabel;
+#else
+        key.label = GetOrAddToken(NonTermLabel(token, Input), labelIds, labels);
+#endif
+        key.targetLabel = GetOrAddToken(
+                            NonTermLabel(tokens[target[align[i+1]]], Output),
+                            labelIds, labels);
+      } else {
+        key.label = source[pos];
+        key.targetLabel = kNoLabel;
+      }
+      std::pair<EdgeMap::iterator, bool> edge =
+        edges.insert(std::make_pair(key, nodeCount));
+      if (edge.second) {
+        UTIL_THROW_IF2(nodeCount == kNoLabel, "Too many source prefixes");
+        ++nodeCount;
+      }
+      node = edge.first->second;
+    }
+    ruleNodes.push_back(std::make_pair(node, ruleOffset));
+
+    record.clear();
+    Append(record, &rule, 1);
+    Append(record, source.data(), source.size());
+    Append(record, target.data(), target.size());
+    Append(record, align.data(), align.size());
+    Append(record, scores.data(), scores.size());
+    Append(record, sparseString.data(), sparseString.size());
+    Append(record, propertiesString.data(), propertiesString.size());
+    record.resize((record.size() + 3) & ~std::size_t(3), 0);
+    out.write(&record[0], record.size());
+    ruleOffset += record.size();
+
+    ++header.ruleCount;
+  }
+
+  // the rules of each node, in the order of the text file
+  std::vector<Node> nodes(nodeCount);
+  for (std::size_t i = 0; i < ruleNodes.size(); ++i) {
+    ++nodes[ruleNodes[i].first].ruleCount;
+  }
+  for (std::size_t i = 1; i < nodes.size(); ++i) {
+    nodes[i].firstRule = nodes[i-1].firstRule + nodes[i-1].ruleCount;
+  }
+  std::vector<uint64_t> ruleOffsets(ruleNodes.size());
+  {
+    std::vector<uint64_t> next(nodes.size());
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+      next[i] = nodes[i].firstRule;
+    }
+    for (std::size_t i = 0; i < ruleNodes.size(); ++i) {
+      ruleOffsets[next[ruleNodes[i].first]++] = ruleNodes[i].second;
+    }
+  }
+  std::vector<std::pair<uint32_t, uint64_t> >().swap(ruleNodes);
+
+  // the edges of each node
+  std::vector<std::pair<EdgeKey, uint32_t> > sortedEdges(edges.begin(), edges.end());
+  EdgeMap().swap(edges);
+  std::sort(sortedEdges.begin(), sortedEdges.end(), EdgeOrder());
+  std::vector<Edge> edgeArray(sortedEdges.size());
+  std::vector<uint32_t> terminals;
+  for (std::size_t i = 0; i < sortedEdges.size(); ++i) {
+    const EdgeKey &key = sortedEdges[i].first;
+    Node &parent = nodes[key.parent];
+    if (parent.terminalCount + parent.nonTerminalCount == 0) {
+      parent.firstEdge = i;
+    }
+    if (key.targetLabel == kNoLabel) {
+      ++parent.terminalCount;
+      terminals.push_back(key.label);
+    } else {
+      ++parent.nonTerminalCount;
+    }
+    edgeArray[i].label = key.label;
+    edgeArray[i].targetLabel = key.targetLabel;
+    edgeArray[i].node = sortedEdges[i].second;
+  }
+  std::vector<std::pair<EdgeKey, uint32_t> >().swap(sortedEdges);
+  std::sort(terminals.begin(), terminals.end());
+  terminals.erase(std::unique(terminals.begin(), terminals.end()), terminals.end());
+
+  // the labels are tokens too
+  std::vector<uint32_t> labelTokens(labels.size());
+  for (std::size_t i = 0; i < labels.size(); ++i) {
+    labelTokens[i] = GetOrAddToken(labels[i], ids, tokens);
+  }
+
+  Align(out);
+  header.ruleOffsetsOffset = out.tellp();
+  Write(out, ruleOffsets.data(), ruleOffsets.size());
+  header.nodeCount = nodes.size();
+  header.nodesOffset = out.tellp();
+  Write(out, nodes.data(), nodes.size());
+  header.edgeCount = edgeArray.size();
+  header.edgesOffset = out.tellp();
+  Write(out, edgeArray.data(), edgeArray.size());
+  header.labelCount = labelTokens.size();
+  header.labelsOffset = out.tellp();
+  Write(out, labelTokens.data(), labelTokens.size());
+  header.terminalCount = terminals.size();
+  header.terminalsOffset = out.tellp();
+  Write(out, terminals.data(), terminals.size());
+
+  // vocabulary
+  Align(out);
+  header.vocabOffset = out.tellp();
+  header.vocabSize = tokens.size();
+  uint64_t offset = 0;
+  for (std::size_t i = 0; i < tokens.size(); ++i) {
+    out.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    offset += tokens[i].size();
+  }
+  out.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+  for (std::size_t i = 0; i < tokens.size(); ++i) {
+    out.write(tokens[i].data(), tokens[i].size());
+  }
+
+  out.seekp(0);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  UTIL_THROW_IF2(!out, "Error writing " << outPath);
+}
+
+BinaryRuleTable::BinaryRuleTable(const std::string &path)
+  : m_ruleIndex(0)
+{
+  util::scoped_fd file(util::OpenReadOrThrow(path.c_str()));
+  const uint64_t size = util::SizeOrThrow(file.get());
+  UTIL_THROW_IF2(size < sizeof(Header), path << " is not a binary rule table");
+  util::MapRead(util::POPULATE_OR_READ, file.get(), 0, size, m_memory);
+
+  m_header = reinterpret_cast<const Header*>(m_memory.begin());
+  UTIL_THROW_IF2(std::memcmp(m_header->magic, kMagic, sizeof(kMagic)) != 0,
+                 path << " is not a binary rule table");
+  UTIL_THROW_IF2(m_header->version != kVersion,
+                 path << ": unsupported binary rule table version "
+                 << m_header->version << ", recreate it with CreateBinaryRuleTable");
+
+  m_vocabOffsets = GetArray<uint64_t>(m_header->vocabOffset);
+  m_vocabStrings = reinterpret_cast<const char*>(m_vocabOffsets
+                   + m_header->vocabSize + 1);
+  m_ruleOffsets = GetArray<uint64_t>(m_header->ruleOffsetsOffset);
+  m_nodes = GetArray<Node>(m_header->nodesOffset);
+  m_edges = GetArray<Edge>(m_header->edgesOffset);
+  m_next = m_memory.begin() + sizeof(Header);
+  std::memset(&m_current, 0, sizeof(m_current));
+}
+
+const char *BinaryRuleTable::ReadRule(const char *p, Rule &rule) const
+{
+  rule.header = reinterpret_cast<const RuleHeader*>(p);
+  p += sizeof(RuleHeader);
+  rule.source = reinterpret_cast<const uint32_t*>(p);
+  p += rule.header->sourceSize * sizeof(uint32_t);
+  rule.target = reinterpret_cast<const uint32_t*>(p);
+  p += rule.header->targetSize * sizeof(uint32_t);
+  rule.align = reinterpret_cast<const uint16_t*>(p);
+  p += rule.header->alignSize * 2 * sizeof(uint16_t);
+  rule.scores = reinterpret_cast<const float*>(p);
+  p += m_header->numScores * sizeof(float);
+  rule.sparse = p;
+  p += rule.header->sparseSize;
+  rule.properties = p;
+  p += rule.header->propertiesSize;
+  return m_memory.begin() + ((p - m_memory.begin() + 3) & ~std::size_t(3));
+}
+
+bool BinaryRuleTable::Next()
+{
+  if (m_ruleIndex == m_header->ruleCount) {
+    return false;
+  }
+  ++m_ruleIndex;
+  m_next = ReadRule(m_next, m_current);
+  return true;
+}
+
+void BinaryRuleTable::InitializeLookup(const std::vector<FactorType> &input,
+                                       const std::vector<FactorType> &output)
+{
+  const uint32_t *terminals = GetArray<uint32_t>(m_header->terminalsOffset);
+  for (uint64_t i = 0; i < m_header->terminalCount; ++i) {
+    m_terminalIds[GetWord(terminals[i], SourceWord, input)] = terminals[i];
+  }
+
+  const uint32_t *labels = GetArray<uint32_t>(m_header->labelsOffset);
+  m_targetNonTerms.resize(m_header->labelCount, Word(true));
+  for (uint64_t i = 0; i < m_header->labelCount; ++i) {
+    m_targetNonTerms[i].CreateFromString(Output, output, GetToken(labels[i]),
+                                         true);
+  }
+}
+
+const BinaryRuleTable::Node *BinaryRuleTable::GetTerminalChild(
+  const Node &node, const Word &sourceWord) const
+{
+  if (node.terminalCount == 0) {
+    return NULL;
+  }
+  TerminalIds::const_iterator p = m_terminalIds.find(sourceWord);
+  if (p == m_terminalIds.end()) {
+    return NULL;
+  }
+  const Edge *begin = m_edges + node.firstEdge;
+  const Edge *end = begin + node.terminalCount;
+  const Edge *edge = std::lower_bound(begin, end, p->second, EdgeLabelLess);
+  if (edge == end || edge->label != p->second) {
+    return NULL;
+  }
+  return &m_nodes[edge->node];
+}
+
+void BinaryRuleTable::CreateTargetPhrases(const Node &node,
+    const PhraseDictionary &ff,
+    const std::vector<FactorType> &input,
+    const std::vector<FactorType> &output,
+    bool wordDeletionEnabled,
+    TargetPhraseCollection &coll)
+{
+  Phrase sourcePhrase;
+  Rule rule;
+  for (uint32_t i = 0; i < node.ruleCount; ++i) {
+    ReadRule(m_memory.begin() + m_ruleOffsets[node.firstRule + i], rule);
+    if (rule.header->sourceSize == 0 && !wordDeletionEnabled) {
+      continue;
+    }
+
+    Word *sourceLHS;
+    CreateSource(rule, input, sourcePhrase, sourceLHS);
+    TargetPhrase *targetPhrase = CreateTargetPhrase(rule, ff, output);
+    targetPhrase->EvaluateInIsolation(sourcePhrase, ff.GetFeaturesToApply());
+    coll.Add(targetPhrase);
+
+    // not implemented correctly in memory pt. just delete it for now
+    delete sourceLHS;
+  }
+}
+
+StringPiece BinaryRuleTable::GetToken(uint32_t id) const
+{
+  return StringPiece(m_vocabStrings + m_vocabOffsets[id],
+                     m_vocabOffsets[id+1] - m_vocabOffsets[id]);
+}
+
+// As in Phrase::CreateFromString, a bracketed last token is the LHS.
+bool BinaryRuleTable::IsLHS(const uint32_t *tokens, std::size_t size) const
+{
+  return size && IsBracketed(GetToken(tokens[size-1]));
+}
+
+BinaryRuleTable::WordCache &BinaryRuleTable::GetWordCache()
+{
+  if (!m_wordCache.get()) {
+    m_wordCache.reset(new WordCache);
+  }
+  return *m_wordCache;
+}
+
+const Word &BinaryRuleTable::GetWord(uint32_t id, Role role,
+                                     const std::vector<FactorType> &factors)
+{
+  boost::unordered_map<uint32_t, Word> &words = GetWordCache().words[role];
+  boost::unordered_map<uint32_t, Word>::iterator p = words.find(id);
+  if (p != words.end()) {
+    return p->second;
+  }
+
+  const FactorDirection direction =
+    (role == SourceWord || role == SourceLHS) ? Input : Output;
+  StringPiece token = GetToken(id);
+  Word word(IsBracketed(token));
+  if (role == SourceLHS || role == TargetLHS) {
+    word.CreateFromString(direction, factors,
+                          token.substr(1, token.size() - 2), true);
+  } else if (IsBracketed(token)) {
+    word.CreateFromString(direction, factors, NonTermLabel(token, direction),
+                          true);
+  } else {
+    word.CreateFromString(direction, factors, token, false);
+  }
+  return words.insert(std::make_pair(id, word)).first->second;
+}
+
+void BinaryRuleTable::CreateSource(const Rule &rule,
+                                   const std::vector<FactorType> &input,
+                                   Phrase &source, Word *&sourceLHS)
+{
+  std::size_t size = rule.header->sourceSize;
+  sourceLHS = NULL;
+  if (IsLHS(rule.source, size)) {
+    --size;
+    sourceLHS = new Word(GetWord(rule.source[size], SourceLHS, input));
+  }
+  source.Clear();
+  for (std::size_t i = 0; i < size; ++i) {
+    source.AddWord(GetWord(rule.source[i], SourceWord, input));
+  }
+}
+
+TargetPhrase *BinaryRuleTable::CreateTargetPhrase(
+  const Rule &rule, const PhraseDictionary &ff,
+  const std::vector<FactorType> &output)
+{
+  TargetPhrase *targetPhrase = new TargetPhrase(&ff);
+
+  std::size_t size = rule.header->targetSize;
+  Word *targetLHS = NULL;
+  if (IsLHS(rule.target, size)) {
+    --size;
+    targetLHS = new Word(GetWord(rule.target[size], TargetLHS, output));
+  }
+  for (std::size_t i = 0; i < size; ++i) {
+    targetPhrase->AddWord(GetWord(rule.target[i], TargetWord, output));
+  }
+  targetPhrase->SetTargetLHS(targetLHS);
+
+  AlignmentInfo::CollType alignTerm, alignNonTerm;
+  for (std::size_t i = 0; i < rule.header->alignSize; ++i) {
+    std::pair<std::size_t, std::size_t> point(rule.align[2*i], rule.align[2*i+1]);
+    if (targetPhrase->GetWord(point.second).IsNonTerminal()) {
+      alignNonTerm.insert(point);
+    } else {
+      alignTerm.insert(point);
+    }
+  }
+  targetPhrase->SetAlignTerm(alignTerm);
+  targetPhrase->SetAlignNonTerm(alignNonTerm);
+
+  if (rule.header->flags & kHasSparse) {
+    targetPhrase->SetSparseScore(&ff, StringPiece(rule.sparse,
+                                 rule.header->sparseSize));
+  }
+  if (rule.header->flags & kHasProperties) {
+    targetPhrase->SetProperties(StringPiece(rule.properties,
+                                            rule.header->propertiesSize));
+  }
+
+  std::vector<float> scoreVector(m_header->numScores);
+  for (std::size_t i = 0; i < m_header->numScores; ++i) {
+    scoreVector[i] = FloorScore(TransformScore(rule.scores[i]));
+  }
+  targetPhrase->GetScoreBreakdown().Assign(&ff, scoreVector);
+
+  return targetPhrase;
+}
+
+}  // namespace Moses
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#else
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "moses/Terminal.h"
+#include "moses/TypeDef.h"
+#include "moses/Word.h"
+#include "util/mmap.hh"
+#include "util/string_piece.hh"
+
+namespace Moses
+{
+
+class Phrase;
+class PhraseDictionary;
+class TargetPhrase;
+class TargetPhraseCollection;
+
+/** A rule table in Moses format (as read by RuleTableLoaderStandard and the
+ *  syntax rule trie loaders) compiled into a binary file by
+ *  CreateBinaryRuleTable.  Each distinct token is stored once, in a
+ *  vocabulary, and each rule is a record of token ids, raw scores and
+ *  alignment points.  The file is memory mapped.
+ *
+ *  The file also holds the source trie of PhraseDictionaryMemory: a node per
+ *  distinct prefix of the rules' source sides (without the LHS), its edges
+ *  and the rules of each node.  PhraseDictionaryMemory searches the mapped
+ *  trie instead of building one, and creates the target phrases of a node
+ *  when a sentence first needs them.  The syntax rule trie loaders, whose
+ *  tries are keyed differently, read the rules one after the other.
+ *
+ *  The layout is the byte order and alignment of the machine that created
+ *  the file:
+ *
+ *    Header
+ *    rules: for each rule a RuleHeader, then
+ *      uint32_t source[sourceSize]   token ids, including the LHS, if any
+ *      uint32_t target[targetSize]   token ids, including the LHS, if any
+ *      uint16_t align[2*alignSize]   source/target position pairs
+ *      float scores[numScores]       as in the text file, not transformed
+ *      char sparse[sparseSize]
+ *      char properties[propertiesSize]
+ *      each record padded to a multiple of 4 bytes
+ *    uint64_t ruleOffsets[ruleCount] the rules of node 0, then of node 1...
+ *    Node nodes[nodeCount]           node 0 is the root
+ *    Edge edges[edgeCount]           the edges of node 0, then of node 1...
+ *    uint32_t labels[labelCount]     token ids of the non-terminal labels
+ *    uint32_t terminals[terminalCount] token ids of the terminal edges
+ *    vocab: uint64_t offsets[vocabSize+1] into the token strings that follow
+ */
+class BinaryRuleTable
+{
+public:
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t numScores;
+    uint64_t ruleCount;
+    uint64_t vocabSize;
+    uint64_t vocabOffset;
+    uint64_t ruleOffsetsOffset;
+    uint64_t nodeCount;
+    uint64_t nodesOffset;
+    uint64_t edgeCount;
+    uint64_t edgesOffset;
+    uint64_t labelCount;
+    uint64_t labelsOffset;
+    uint64_t terminalCount;
+    uint64_t terminalsOffset;
+  };
+
+  struct RuleHeader {
+    uint16_t sourceSize;
+    uint16_t targetSize;
+    uint16_t alignSize;
+    uint16_t flags;
+    uint32_t sparseSize;
+    uint32_t propertiesSize;
+  };
+
+  // A node of the source trie.  Its edges are the terminal ones, by token
+  // id, then the non-terminal ones, by source and target label.
+  struct Node {
+    uint64_t firstRule;
+    uint32_t ruleCount;
+    uint32_t firstEdge;
+    uint32_t terminalCount;
+    uint32_t nonTerminalCount;
+  };
+
+  // A terminal edge is labelled by the token id of the word, with
+  // targetLabel kNoLabel.  A non-terminal edge is labelled by the indexes of
+  // its source and target labels in labels[], as PhraseDictionaryNodeMemory
+  // is keyed by the source non-terminal and the target one aligned to it.
+  struct Edge {
+    uint32_t label;
+    uint32_t targetLabel;
+    uint32_t node;
+  };
+
+  static const char kMagic[8];
+  static const uint32_t kVersion = 2;
+  static const uint32_t kNoLabel = 0xffffffff;
+
+  static const uint16_t kHasSparse = 1;
+  static const uint16_t kHasProperties = 2;
+
+  // Returns true if the file at path is a binary rule table.
+  static bool IsBinary(const std::string &path);
+
+  // Compiles the text rule table at inPath.
+  static void Create(const std::string &inPath, const std::string &outPath);
+
+  BinaryRuleTable(const std::string &path);
+
+  std::size_t GetNumScores() const {
+    return m_header->numScores;
+  }
+
+  // Reading the rules one after the other.
+
+  // Moves to the next rule.  Returns false after the last one.
+  bool Next();
+
+  // True if the current rule has no source symbols (not even a LHS), i.e.
+  // it deletes a word.
+  bool IsSourceEmpty() const {
+    return m_current.header->sourceSize == 0;
+  }
+
+  // Source phrase and LHS (NULL if none) of the current rule, as
+  // Phrase::CreateFromString would create them.
+  void CreateSource(const std::vector<FactorType> &input, Phrase &source,
+                    Word *&sourceLHS) {
+    CreateSource(m_current, input, source, sourceLHS);
+  }
+
+  // Target phrase of the current rule with its LHS, alignments, scores,
+  // sparse scores and properties.  It isn't evaluated.
+  TargetPhrase *CreateTargetPhrase(const PhraseDictionary &ff,
+                                   const std::vector<FactorType> &output) {
+    return CreateTargetPhrase(m_current, ff, output);
+  }
+
+  // Searching the source trie.  The words of the terminal edges and of the
+  // target labels are created by InitializeLookup, the target phrases of a
+  // node by CreateTargetPhrases.  Both can be called from several threads.
+
+  void InitializeLookup(const std::vector<FactorType> &input,
+                        const std::vector<FactorType> &output);
+
+  const Node &GetRoot() const {
+    return m_nodes[0];
+  }
+
+  std::size_t GetIndex(const Node &node) const {
+    return &node - m_nodes;
+  }
+
+  // The child of node along the terminal edge for sourceWord, or NULL.
+  const Node *GetTerminalChild(const Node &node, const Word &sourceWord) const;
+
+  const Edge *BeginNonTerminals(const Node &node) const {
+    return m_edges + node.firstEdge + node.terminalCount;
+  }
+
+  const Edge *EndNonTerminals(const Node &node) const {
+    return BeginNonTerminals(node) + node.nonTerminalCount;
+  }
+
+  const Node &GetChild(const Edge &edge) const {
+    return m_nodes[edge.node];
+  }
+
+  const Word &GetTargetNonTerm(const Edge &edge) const {
+    return m_targetNonTerms[edge.targetLabel];
+  }
+
+  // Adds the target phrases of node's rules to coll, evaluated in isolation.
+  // Rules that delete a word are skipped unless wordDeletionEnabled.
+  void CreateTargetPhrases(const Node &node, const PhraseDictionary &ff,
+                           const std::vector<FactorType> &input,
+                           const std::vector<FactorType> &output,
+                           bool wordDeletionEnabled,
+                           TargetPhraseCollection &coll);
+
+private:
+  // The ways in which a token is turned into a Word.
+  enum Role {
+    SourceWord,
+    SourceLHS,
+    TargetWord,
+    TargetLHS,
+    NumRoles
+  };
+
+  // A rule record.
+  struct Rule {
+    const RuleHeader *header;
+    const uint32_t *source;
+    const uint32_t *target;
+    const uint16_t *align;
+    const float *scores;
+    const char *sparse;
+    const char *properties;
+  };
+
+  typedef boost::unordered_map<Word, uint32_t, TerminalHasher,
+          TerminalEqualityPred> TerminalIds;
+
+  // the words created so far, by role and token id
+  struct WordCache {
+    boost::unordered_map<uint32_t, Word> words[NumRoles];
+  };
+
+  template<typename T>
+  const T *GetArray(uint64_t offset) const {
+    return reinterpret_cast<const T*>(m_memory.begin() + offset);
+  }
+
+  // Reads the record at p into rule and returns the start of the next one.
+  const char *ReadRule(const char *p, Rule &rule) const;
+
+  void CreateSource(const Rule &rule, const std::vector<FactorType> &input,
+                    Phrase &source, Word *&sourceLHS);
+  TargetPhrase *CreateTargetPhrase(const Rule &rule, const PhraseDictionary &,
+                                   const std::vector<FactorType> &output);
+
+  StringPiece GetToken(uint32_t id) const;
+  bool IsLHS(const uint32_t *tokens, std::size_t size) const;
+  const Word &GetWord(uint32_t id, Role role,
+                      const std::vector<FactorType> &factors);
+  WordCache &GetWordCache();
+
+  util::scoped_memory m_memory;
+  const Header *m_header;
+  const uint64_t *m_vocabOffsets;
+  const char *m_vocabStrings;
+  const uint64_t *m_ruleOffsets;
+  const Node *m_nodes;
+  const Edge *m_edges;
+
+  // reading the rules one after the other: the current rule
+  const char *m_next;
+  uint64_t m_ruleIndex;
+  Rule m_current;
+
+  // looking up: the token ids of the terminal edges' words, and the target
+  // label words, by label index
+  TerminalIds m_terminalIds;
+  std::vector<Word> m_targetNonTerms;
+
+  // Words are created on first use, by each thread for itself, so that
+  // threads don't wait for each other
+#ifdef WITH_THREADS
+  boost::thread_specific_ptr<WordCache> m_wordCache;
+#else
+  boost::scoped_ptr<WordCache> m_wordCache;
+#endif
+};
+
+}  // namespace Moses
@@ -0,0 +1,60 @@
+#include "LoaderBinary.h"
+
+#include "moses/Phrase.h"
+#include "moses/TargetPhrase.h"
+#include "moses/Timer.h"
+#include "moses/Util.h"
+#include "moses/Word.h"
+#include "BinaryRuleTable.h"
+#include "Trie.h"
+
+namespace Moses
+{
+
+bool RuleTableLoaderBinary::Load(AllOptions const& opts,
+                                 const std::vector<FactorType> &input,
+                                 const std::vector<FactorType> &output,
+                                 const std::string &inFile,
+                                 size_t /* tableLimit */,
+                                 RuleTableTrie &ruleTable)
+{
+  PrintUserTime("Start loading binary rule table");
+
+  BinaryRuleTable table(inFile);
+  const size_t numScoreComponents = ruleTable.GetNumScoreComponents();
+  UTIL_THROW_IF2(table.GetNumScores() != numScoreComponents,
+                 "Size of scoreVector != number (" << table.GetNumScores()
+                 << "!=" << numScoreComponents << ") of score components in "
+                 << inFile);
+
+  size_t count = 0;
+  Phrase sourcePhrase;
+  while (table.Next()) {
+    if (table.IsSourceEmpty() && !opts.unk.word_deletion_enabled) {
+      TRACE_ERR( ruleTable.GetFilePath() << ":" << count << ": pt entry contains empty target, skipping\n");
+      continue;
+    }
+
+    Word *sourceLHS;
+    table.CreateSource(input, sourcePhrase, sourceLHS);
+    TargetPhrase *targetPhrase = table.CreateTargetPhrase(ruleTable, output);
+    targetPhrase->EvaluateInIsolation(sourcePhrase, ruleTable.GetFeaturesToApply());
+
+    TargetPhraseCollection::shared_ptr phraseColl
+    = GetOrCreateTargetPhraseCollection(ruleTable, sourcePhrase,
+                                        *targetPhrase, sourceLHS);
+    phraseColl->Add(targetPhrase);
+
+    // not implemented correctly in memory pt. just delete it for now
+    delete sourceLHS;
+
+    count++;
+  }
+
+  // sort and prune each target phrase collection
+  SortAndPrune(ruleTable);
+
+  return true;
+}
+
+}  // namespace Moses
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Loader.h"
+
+namespace Moses
+{
+
+//! Loader for SCFG rule tables compiled by CreateBinaryRuleTable, for the
+//! tries that are built in memory.  PhraseDictionaryMemory searches the trie
+//! of the file instead.
+class RuleTableLoaderBinary : public RuleTableLoader
+{
+public:
+  bool Load(AllOptions const& opts,
+            const std::vector<FactorType> &input,
+            const std::vector<FactorType> &output,
+            const std::string &inFile,
+            size_t tableLimit,
+            RuleTableTrie &);
+};
+
+}  // namespace Moses
@@ -21,6 +21,8 @@
 
 #include "moses/Util.h"
 #include "moses/InputFileStream.h"
+#include "BinaryRuleTable.h"
+#include "LoaderBinary.h"
 #include "LoaderCompact.h"
 #include "LoaderHiero.h"
 #include "LoaderStandard.h"
@@ -39,6 +41,10 @@ std::auto_ptr<RuleTableLoader>
 RuleTableLoaderFactory::
 Create(const std::string &path)
 {
+  if (BinaryRuleTable::IsBinary(path)) {
+    return std::auto_ptr<RuleTableLoader>(new RuleTableLoaderBinary());
+  }
+
   InputFileStream input(path);
   std::string line;
 
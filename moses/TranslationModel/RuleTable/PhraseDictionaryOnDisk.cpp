@@ -39,6 +39,8 @@ namespace Moses
 {
 PhraseDictionaryOnDisk::PhraseDictionaryOnDisk(const std::string &line)
   : MyBase(line, true)
+  , m_useMmap(false)
+  , m_prefetchLevels(2)
   , m_maxSpanDefault(NOT_FOUND)
   , m_maxSpanLabelled(NOT_FOUND)
 {
@@ -53,6 +55,11 @@ void PhraseDictionaryOnDisk::Load(AllOptions::ptr const& opts)
 {
   m_options = opts;
   SetFeaturesToApply();
+
+  if (m_useMmap) {
+    m_sharedImplementation.reset(CreateImplementation(true));
+    m_sharedImplementation->PrefetchSourceTrie(m_prefetchLevels);
+  }
 }
 
 ChartRuleLookupManager *PhraseDictionaryOnDisk::CreateRuleLookupManager(
@@ -68,6 +75,10 @@ ChartRuleLookupManager *PhraseDictionaryOnDisk::CreateRuleLookupManager(
 
 OnDiskPt::OnDiskWrapper &PhraseDictionaryOnDisk::GetImplementation()
 {
+  if (m_useMmap) {
+    return *m_sharedImplementation;
+  }
+
   OnDiskPt::OnDiskWrapper* dict;
   dict = m_implementation.get();
   UTIL_THROW_IF2(dict == NULL, "Dictionary object not yet created for this thread");
@@ -76,19 +87,20 @@ OnDiskPt::OnDiskWrapper &PhraseDictionaryOnDisk::GetImplementation()
 
 const OnDiskPt::OnDiskWrapper &PhraseDictionaryOnDisk::GetImplementation() const
 {
+  if (m_useMmap) {
+    return *m_sharedImplementation;
+  }
+
   OnDiskPt::OnDiskWrapper* dict;
   dict = m_implementation.get();
   UTIL_THROW_IF2(dict == NULL, "Dictionary object not yet created for this thread");
   return *dict;
 }
 
-void PhraseDictionaryOnDisk::InitializeForInput(ttasksptr const& ttask)
+OnDiskPt::OnDiskWrapper *PhraseDictionaryOnDisk::CreateImplementation(bool useMmap) const
 {
-  InputType const& source = *ttask->GetSource();
-  ReduceCache();
-
   OnDiskPt::OnDiskWrapper *obj = new OnDiskPt::OnDiskWrapper();
-  obj->BeginLoad(m_filePath);
+  obj->BeginLoad(m_filePath, useMmap);
 
   UTIL_THROW_IF2(obj->GetMisc("Version") != OnDiskPt::OnDiskWrapper::VERSION_NUM,
                  "On-disk phrase table is version " <<  obj->GetMisc("Version")
@@ -106,7 +118,16 @@ void PhraseDictionaryOnDisk::InitializeForInput(ttasksptr const& ttask)
                  "On-disk phrase table has " <<  obj->GetMisc("NumScores") << " scores."
                  << ". The ini file specified " << m_numScoreComponents << " scores");
 
-  m_implementation.reset(obj);
+  return obj;
+}
+
+void PhraseDictionaryOnDisk::InitializeForInput(ttasksptr const& ttask)
+{
+  ReduceCache();
+
+  if (!m_useMmap) {
+    m_implementation.reset(CreateImplementation(false));
+  }
 }
 
 void PhraseDictionaryOnDisk::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
@@ -388,6 +409,10 @@ void PhraseDictionaryOnDisk::SetParameter(const std::string& key, const std::str
     m_maxSpanDefault = Scan<size_t>(value);
   } else if (key == "max-span-labelled") {
     m_maxSpanLabelled = Scan<size_t>(value);
+  } else if (key == "mmap") {
+    m_useMmap = Scan<bool>(value);
+  } else if (key == "prefetch-levels") {
+    m_prefetchLevels = Scan<size_t>(value);
   } else {
     PhraseDictionary::SetParameter(key, value);
   }
@@ -29,10 +29,9 @@
 #include "OnDiskPt/Word.h"
 #include "OnDiskPt/PhraseNode.h"
 
+#include <boost/scoped_ptr.hpp>
 #ifdef WITH_THREADS
 #include <boost/thread/tss.hpp>
-#else
-#include <boost/scoped_ptr.hpp>
 #endif
 
 namespace Moses
@@ -57,8 +56,14 @@ protected:
   boost::scoped_ptr<OnDiskPt::OnDiskWrapper> m_implementation;
 #endif
 
+  // mmap=true: one read-only, memory-mapped table shared by all threads
+  bool m_useMmap;
+  size_t m_prefetchLevels;
+  boost::scoped_ptr<OnDiskPt::OnDiskWrapper> m_sharedImplementation;
+
   size_t m_maxSpanDefault, m_maxSpanLabelled;
 
+  OnDiskPt::OnDiskWrapper *CreateImplementation(bool useMmap) const;
   OnDiskPt::OnDiskWrapper &GetImplementation();
   const OnDiskPt::OnDiskWrapper &GetImplementation() const;
 
@@ -62,6 +62,11 @@ public:
     size_t last,
     ChartParserCallback &outColl);
 
+  // The rule applications of each span are found up front.
+  bool SupportsWidthOrder() const {
+    return true;
+  }
+
 private:
   // Define a callback type for use by StackLatticeSearcher.
   struct MatchCallback {
@@ -35,6 +35,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "DecodeStepGeneration.h"
 #include "DecodeGraph.h"
 #include "InputPath.h"
+#include "Profiler.h"
 #include "moses/FF/UnknownWordPenaltyProducer.h"
 #include "moses/FF/LexicalReordering/LexicalReordering.h"
 #include "moses/FF/InputFeature.h"
@@ -506,9 +507,11 @@ void TranslationOptionCollection::EvaluateTranslationOptionListWithSourceContext
 
   const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
   const StaticData &staticData = StaticData::Instance();
+  Profiler::Data *profile = Profiler::GetData();
   for (size_t i = 0; i < ffs.size(); ++i) {
     const FeatureFunction &ff = *ffs[i];
     if (! staticData.IsFeatureFunctionIgnored(ff)) {
+      ProfileTimer timer(profile, ff, Profiler::WithSourceContext);
       ff.EvaluateTranslationOptionListWithSourceContext(m_source, translationOptionList);
     }
   }
@@ -658,6 +661,7 @@ GetTargetPhraseCollectionBatch()
       const Tstep* tstep = dynamic_cast<const Tstep *>(*i);
       if (tstep) {
         const PhraseDictionary &pdict = *tstep->GetPhraseDictionaryFeature();
+        ProfileTimer timer(Profiler::GetData(), pdict, Profiler::Lookup);
         pdict.GetTargetPhraseCollectionBatch(m_ttask.lock(), m_inputPathQueue);
       }
     }
@@ -6,6 +6,7 @@
 #include "moses/TypeDef.h"
 #include "moses/Util.h"
 #include "moses/Timer.h"
+#include "moses/Profiler.h"
 #include "moses/InputType.h"
 #include "moses/OutputCollector.h"
 #include "moses/Incremental.h"
@@ -172,6 +173,8 @@ void TranslationTask::Run()
 
   interpret_dlt(); // parse document-level translation info stored on the input
 
+  Profiler::StartSentence(translationId);
+
   // report thread number
 #if defined(WITH_THREADS) && defined(BOOST_HAS_PTHREADS)
   VERBOSE(2, "Translating line " << translationId << "  in thread id "
@@ -197,7 +200,10 @@ void TranslationTask::Run()
   // oh, and by the way, all the output should be handled by the
   // output wrapper along the lines of *m_iwWrapper << *manager;
   // Just sayin' ...
-  if (m_ioWrapper == NULL) return;
+  if (m_ioWrapper == NULL) {
+    Profiler::EndSentence();
+    return;
+  }
 
   // we are done with search, let's look what we got
   OutputCollector* ocoll;
@@ -229,7 +235,10 @@ void TranslationTask::Run()
   additionalReportingTime.start();
 
   // output n-best list
-  manager->OutputNBest(io->GetNBestOutputCollector());
+  {
+    ProfileTimer timer(Profiler::GetData(), Profiler::NBest);
+    manager->OutputNBest(io->GetNBestOutputCollector());
+  }
 
   //lattice samples
   manager->OutputLatticeSamples(io->GetLatticeSamplesCollector());
@@ -255,6 +264,7 @@ void TranslationTask::Run()
   IFVERBOSE(2) {
     PrintUserTime("Sentence Decoding Time:");
   }
+  Profiler::EndSentence();
 }
 
 }
@@ -20,7 +20,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include "TrellisPath.h"
-#include "TrellisPathList.h"
 #include "TrellisPathCollection.h"
 #include "StaticData.h"
 #include "Manager.h"
@@ -29,15 +28,10 @@ using namespace std;
 namespace Moses
 {
 TrellisPath::TrellisPath(const Hypothesis *hypo)
-  : m_prevEdgeChanged(NOT_FOUND)
+  : m_hypo(hypo)
+  , m_prevEdgeChanged(NOT_FOUND)
 {
   m_totalScore = hypo->GetFutureScore();
-
-  // enumerate path using prevHypo
-  while (hypo != NULL) {
-    m_path.push_back(hypo);
-    hypo = hypo->GetPrevHypo();
-  }
 }
 
 void TrellisPath::InitTotalScore()
@@ -55,113 +49,127 @@ void TrellisPath::InitTotalScore()
   }
 }
 
-TrellisPath::TrellisPath(const TrellisPath &copy, size_t edgeIndex, const Hypothesis *arc)
-  :m_prevEdgeChanged(edgeIndex)
+TrellisPath::TrellisPath(const Hypothesis *hypo,
+                         const boost::shared_ptr<const Deviation> &prevDeviation,
+                         size_t edgeIndex, size_t arcRank, const Hypothesis *arc,
+                         float prevScore)
+  : m_hypo(hypo)
+  , m_prevEdgeChanged(edgeIndex)
 {
-  m_path.reserve(copy.m_path.size());
-  for (size_t currEdge = 0 ; currEdge < edgeIndex ; currEdge++) {
-    // copy path from parent
-    m_path.push_back(copy.m_path[currEdge]);
-  }
-
-  // 1 deviation
-  m_path.push_back(arc);
-
-  // rest of path comes from following best path backwards
-  const Hypothesis *prevHypo = arc->GetPrevHypo();
-  while (prevHypo != NULL) {
-    m_path.push_back(prevHypo);
-    prevHypo = prevHypo->GetPrevHypo();
-  }
-
-  InitTotalScore();
+  Deviation *deviation = new Deviation;
+  deviation->edgeIndex = edgeIndex;
+  deviation->arc = arc;
+  deviation->arcRank = arcRank;
+  deviation->prevScore = prevScore;
+  deviation->prev = prevDeviation;
+  m_deviation.reset(deviation);
+
+  // the edges that aren't deviations are hypos, so they score the same as
+  // their winning hypo and only the new deviation changes the score.  Same
+  // sum, in the same order, as InitTotalScore()
+  m_totalScore = prevScore;
+  m_totalScore += arc->GetFutureScore() - arc->GetWinningHypo()->GetFutureScore();
 }
 
 TrellisPath::TrellisPath(const vector<const Hypothesis*> edges)
-  :m_prevEdgeChanged(NOT_FOUND)
+  : m_hypo(NULL)
+  , m_prevEdgeChanged(NOT_FOUND)
 {
   m_path.resize(edges.size());
   copy(edges.rbegin(),edges.rend(),m_path.begin());
   InitTotalScore();
 }
 
+const std::vector<const Hypothesis *> &TrellisPath::GetEdges() const
+{
+  if (m_path.empty() && m_hypo) {
+    // deviations, lowest edge index first
+    std::vector<const Deviation*> deviations;
+    for (const Deviation *deviation = m_deviation.get(); deviation; deviation = deviation->prev.get()) {
+      deviations.push_back(deviation);
+    }
+    std::vector<const Deviation*>::const_reverse_iterator iterDeviation = deviations.rbegin();
+
+    const Hypothesis *hypo = m_hypo;
+    for (size_t currEdge = 0 ; hypo != NULL ; currEdge++) {
+      if (iterDeviation != deviations.rend() && (*iterDeviation)->edgeIndex == currEdge) {
+        hypo = (*iterDeviation)->arc;
+        ++iterDeviation;
+      }
+      m_path.push_back(hypo);
+      hypo = hypo->GetPrevHypo();
+    }
+  }
+  return m_path;
+}
 
 void TrellisPath::CreateDeviantPaths(TrellisPathCollection &pathColl) const
 {
-  const size_t sizePath = m_path.size();
-
-  if (m_prevEdgeChanged == NOT_FOUND) {
-    // initial enumration from a pure hypo
-    for (size_t currEdge = 0 ; currEdge < sizePath ; currEdge++) {
-      const Hypothesis	*hypo		= static_cast<const Hypothesis*>(m_path[currEdge]);
-      const ArcList *pAL = hypo->GetArcList();
-      if (!pAL) continue;
-      const ArcList &arcList = *pAL;
-
-      // every possible Arc to replace this edge
-      ArcList::const_iterator iterArc;
-      for (iterArc = arcList.begin() ; iterArc != arcList.end() ; ++iterArc) {
-        const Hypothesis *arc = *iterArc;
-        TrellisPath *deviantPath = new TrellisPath(*this, currEdge, arc);
-        pathColl.Add(deviantPath);
-      }
+  const Hypothesis *hypo = m_hypo;
+  size_t currEdge = 0;
+
+  if (m_deviation) {
+    const Deviation &last = *m_deviation;
+
+    // the next best arc instead of the last deviation
+    const std::vector<const Hypothesis*> &arcs = pathColl.GetSortedArcs(*last.arc->GetWinningHypo());
+    if (last.arcRank + 1 < arcs.size()) {
+      pathColl.Add(new TrellisPath(m_hypo, last.prev, last.edgeIndex, last.arcRank + 1,
+                                   arcs[last.arcRank + 1], last.prevScore));
+    }
+
+    // only wiggle the edges after the last deviation
+    hypo = last.arc->GetPrevHypo();
+    currEdge = last.edgeIndex + 1;
+  }
+
+  // the best arc of each of the remaining edges
+  for (; hypo != NULL ; hypo = hypo->GetPrevHypo(), currEdge++) {
+    const std::vector<const Hypothesis*> &arcs = pathColl.GetSortedArcs(*hypo);
+    if (!arcs.empty()) {
+      pathColl.Add(new TrellisPath(m_hypo, m_deviation, currEdge, 0, arcs[0], m_totalScore));
     }
-  } else {
-    // wiggle 1 of the edges only
-    for (size_t currEdge = m_prevEdgeChanged + 1 ; currEdge < sizePath ; currEdge++) {
-      const ArcList *pAL = m_path[currEdge]->GetArcList();
-      if (!pAL) continue;
-      const ArcList &arcList = *pAL;
-      ArcList::const_iterator iterArc;
-
-      for (iterArc = arcList.begin() ; iterArc != arcList.end() ; ++iterArc) {
-        // copy this Path & change 1 edge
-        const Hypothesis *arcReplace = *iterArc;
-
-        TrellisPath *deviantPath = new TrellisPath(*this, currEdge, arcReplace);
-        pathColl.Add(deviantPath);
-      } // for (iterArc...
-    } // for (currEdge = 0 ...
   }
 }
 
-void TrellisPath::CreateDeviantPaths(TrellisPathList &pathColl) const
+uint64_t TrellisPath::GetSurfaceHash(TrellisPathCollection &pathColl) const
 {
-  const size_t sizePath = m_path.size();
-
-  if (m_prevEdgeChanged == NOT_FOUND) {
-    // initial enumration from a pure hypo
-    for (size_t currEdge = 0 ; currEdge < sizePath ; currEdge++) {
-      const Hypothesis	*hypo		= static_cast<const Hypothesis*>(m_path[currEdge]);
-      const ArcList *pAL = hypo->GetArcList();
-      if (!pAL) continue;
-      const ArcList &arcList = *pAL;
-
-      // every possible Arc to replace this edge
-      ArcList::const_iterator iterArc;
-      for (iterArc = arcList.begin() ; iterArc != arcList.end() ; ++iterArc) {
-        const Hypothesis *arc = *iterArc;
-        TrellisPath *deviantPath = new TrellisPath(*this, currEdge, arc);
-        pathColl.Add(deviantPath);
+  typedef TrellisPathCollection::PrefixHash PrefixHash;
+
+  if (m_hypo == NULL) {
+    // only a list of edges, hash the words one by one
+    uint64_t hash = 0;
+    for (int node = (int) m_path.size() - 2 ; node >= 0 ; --node) {
+      const Phrase &phrase = m_path[node]->GetCurrTargetPhrase();
+      for (size_t pos = 0 ; pos < phrase.GetSize() ; ++pos) {
+        hash = hash * TrellisPathCollection::kHashBase + pathColl.GetWordHash(phrase.GetWord(pos));
       }
     }
-  } else {
-    // wiggle 1 of the edges only
-    for (size_t currEdge = m_prevEdgeChanged + 1 ; currEdge < sizePath ; currEdge++) {
-      const ArcList *pAL = m_path[currEdge]->GetArcList();
-      if (!pAL) continue;
-      const ArcList &arcList = *pAL;
-      ArcList::const_iterator iterArc;
-
-      for (iterArc = arcList.begin() ; iterArc != arcList.end() ; ++iterArc) {
-        // copy this Path & change 1 edge
-        const Hypothesis *arcReplace = *iterArc;
-
-        TrellisPath *deviantPath = new TrellisPath(*this, currEdge, arcReplace);
-        pathColl.Add(deviantPath);
-      } // for (iterArc...
-    } // for (currEdge = 0 ...
+    return hash;
+  }
+
+  if (!m_deviation) {
+    return pathColl.GetPrefixHash(*m_hypo).hash;
+  }
+
+  // The path is the prefix ending at the last deviation's arc, followed by
+  // segments that each run from a deviation's arc (or, for the last segment,
+  // the pure hypo) back to the hypo the next deviation replaced.  The hash of
+  // a segment is the difference of the prefix hashes of its ends.
+  uint64_t hash = pathColl.GetPrefixHash(*m_deviation->arc).hash;
+  const Hypothesis *replaced = m_deviation->arc->GetWinningHypo();
+  for (const Deviation *deviation = m_deviation->prev.get(); ; deviation = deviation->prev.get()) {
+    const Hypothesis *segmentEnd = deviation ? deviation->arc : m_hypo;
+    const PrefixHash to = pathColl.GetPrefixHash(*segmentEnd);
+    const PrefixHash from = pathColl.GetPrefixHash(*replaced);
+    hash = (hash - from.hash) * TrellisPathCollection::HashBasePower(to.size - from.size) + to.hash;
+
+    if (deviation == NULL) {
+      break;
+    }
+    replaced = deviation->arc->GetWinningHypo();
   }
+  return hash;
 }
 
 boost::shared_ptr<ScoreComponentCollection> const
@@ -170,15 +178,16 @@ GetScoreBreakdown() const
 {
   if (!m_scoreBreakdown) {
     m_scoreBreakdown.reset(new ScoreComponentCollection());
-    m_scoreBreakdown->PlusEquals(m_path[0]->GetWinningHypo()->GetScoreBreakdown());
+    const std::vector<const Hypothesis *> &path = GetEdges();
+    m_scoreBreakdown->PlusEquals(path[0]->GetWinningHypo()->GetScoreBreakdown());
 
     // adjust score
     // I assume things are done this way on the assumption that most hypothesis edges
     // are shared with the winning path, so that score adjustments are cheaper than
     // recomputing the score from scratch. UG
-    size_t sizePath = m_path.size();
+    size_t sizePath = path.size();
     for (size_t pos = 0 ; pos < sizePath ; pos++) {
-      const Hypothesis *hypo = m_path[pos];
+      const Hypothesis *hypo = path[pos];
       const Hypothesis *winningHypo = hypo->GetWinningHypo();
       if (hypo != winningHypo) {
         m_scoreBreakdown->MinusEquals(winningHypo->GetScoreBreakdown());
@@ -194,10 +203,11 @@ Phrase TrellisPath::GetTargetPhrase() const
 {
   Phrase targetPhrase(ARRAY_SIZE_INCR);
 
-  int numHypo = (int) m_path.size();
+  const std::vector<const Hypothesis *> &path = GetEdges();
+  int numHypo = (int) path.size();
   for (int node = numHypo - 2 ; node >= 0 ; --node) {
     // don't do the empty hypo - waste of time and decode step id is invalid
-    const Hypothesis &hypo = *m_path[node];
+    const Hypothesis &hypo = *path[node];
     const Phrase &currTargetPhrase = hypo.GetCurrTargetPhrase();
 
     targetPhrase.Append(currTargetPhrase);
@@ -230,8 +240,9 @@ Range TrellisPath::GetTargetWordsRange(const Hypothesis &hypo) const
 {
   size_t startPos = 0;
 
-  for (int indEdge = (int) m_path.size() - 1 ; indEdge >= 0 ; --indEdge) {
-    const Hypothesis *currHypo = m_path[indEdge];
+  const std::vector<const Hypothesis *> &path = GetEdges();
+  for (int indEdge = (int) path.size() - 1 ; indEdge >= 0 ; --indEdge) {
+    const Hypothesis *currHypo = path[indEdge];
     size_t endPos = startPos + currHypo->GetCurrTargetLength() - 1;
 
     if (currHypo == &hypo) {
@@ -20,6 +20,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #pragma once
 
+#include <stdint.h>
 #include <iostream>
 #include <vector>
 #include <limits>
@@ -31,7 +32,6 @@ namespace Moses
 {
 
 class TrellisPathCollection;
-class TrellisPathList;
 
 /** Encapsulate the set of hypotheses/arcs that goes from decoding 1
  *	phrase to all the source phrases to reach a final
@@ -39,6 +39,11 @@ class TrellisPathList;
  *	hypotheses, for the other n-best paths, the node on the path
  *	can consist of hypotheses or arcs.  Used by phrase-based
  *	decoding
+ *
+ *  A path is stored as the pure hypothesis it was derived from and the list
+ *  of arcs it uses instead of hypotheses, which it shares with the path it
+ *  was derived from.  The list of hypotheses/arcs is only created when it is
+ *  asked for, so the contenders for an n-best list are cheap.
  */
 class TrellisPath
 {
@@ -46,7 +51,20 @@ class TrellisPath
   friend class Manager;
 
 protected:
-  std::vector<const Hypothesis *> m_path; //< list of hypotheses/arcs
+  /** An arc used instead of the hypothesis at edgeIndex of the path this
+   *  path was derived from.  The edges after it follow the arc's m_prevHypo.
+   */
+  struct Deviation {
+    size_t edgeIndex;
+    const Hypothesis *arc;
+    size_t arcRank; //< position of the arc in TrellisPathCollection::GetSortedArcs()
+    float prevScore; //< score of the path without this deviation
+    boost::shared_ptr<const Deviation> prev; //< deviation at a lower edgeIndex
+  };
+
+  const Hypothesis *m_hypo; //< the pure hypo, NULL if created from a list of edges
+  boost::shared_ptr<const Deviation> m_deviation; //< the last deviation, if any
+  mutable std::vector<const Hypothesis *> m_path; //< list of hypotheses/arcs
   size_t m_prevEdgeChanged;
   /**< the last node that was wiggled to create this path
      , or NOT_FOUND if this path is the best trans so consist of only hypos
@@ -58,10 +76,18 @@ protected:
   //Used by Manager::LatticeSample()
   explicit TrellisPath(const std::vector<const Hypothesis*> edges);
 
+  /** create path from the pure hypo and deviations of another path, adding
+   *  a deviation at edgeIndex by using arc instead
+   */
+  TrellisPath(const Hypothesis *hypo,
+              const boost::shared_ptr<const Deviation> &prevDeviation,
+              size_t edgeIndex, size_t arcRank, const Hypothesis *arc,
+              float prevScore);
+
   void InitTotalScore();
 
   Manager const& manager() const {
-    UTIL_THROW_IF2(m_path.size() == 0, "zero-length trellis path");
+    UTIL_THROW_IF2(GetEdges().size() == 0, "zero-length trellis path");
     return m_path[0]->GetManager();
   }
 
@@ -71,11 +97,6 @@ public:
   //! create path OF pure hypo
   TrellisPath(const Hypothesis *hypo);
 
-  /** create path from another path, deviate at edgeIndex by using arc instead,
-  	* which may change other hypo back from there
-  	*/
-  TrellisPath(const TrellisPath &copy, size_t edgeIndex, const Hypothesis *arc);
-
   //! get score for this path throught trellis
   inline float GetFutureScore() const {
     return m_totalScore;
@@ -84,19 +105,24 @@ public:
   /** list of each hypo/arcs in path. For anything other than the best hypo, it is not possible just to follow the
   	* m_prevHypo variable in the hypothesis object
   	*/
-  inline const std::vector<const Hypothesis *> &GetEdges() const {
-    return m_path;
-  }
+  const std::vector<const Hypothesis *> &GetEdges() const;
 
   inline size_t GetSize() const {
-    return m_path.size();
+    return GetEdges().size();
   }
 
-  //! create a set of next best paths by wiggling 1 of the node at a time.
+  /** add the next best paths that are derived from this one: the path that
+   *  uses the next best arc instead of the last deviation, and the paths that
+   *  use the best arc at one of the edges after it.  Each path is derived
+   *  from exactly one other path and is no better than it, so popping the
+   *  best contender enumerates all paths in order.
+   */
   void CreateDeviantPaths(TrellisPathCollection &pathColl) const;
 
-  //! create a list of next best paths by wiggling 1 of the node at a time.
-  void CreateDeviantPaths(TrellisPathList &pathColl) const;
+  /** hash of the output factors of the target words, consistent with
+   *  GetSurfacePhrase(): paths with the same surface phrase have the same hash
+   */
+  uint64_t GetSurfaceHash(TrellisPathCollection &pathColl) const;
 
   const boost::shared_ptr<ScoreComponentCollection> GetScoreBreakdown() const;
 
@@ -113,9 +139,9 @@ public:
 // friend
 inline std::ostream& operator<<(std::ostream& out, const TrellisPath& path)
 {
-  const size_t sizePath = path.m_path.size();
-  for (int pos = (int) sizePath - 1 ; pos >= 0 ; pos--) {
-    const Hypothesis *edge = path.m_path[pos];
+  const std::vector<const Hypothesis *> &edges = path.GetEdges();
+  for (int pos = (int) edges.size() - 1 ; pos >= 0 ; pos--) {
+    const Hypothesis *edge = edges[pos];
     const Range &sourceRange = edge->GetCurrSourceWordsRange();
     out << edge->GetId() << " " << sourceRange.GetStartPos() << "-" << sourceRange.GetEndPos() << ", ";
   }
@@ -1,8 +1,18 @@
 #include "TrellisPathCollection.h"
+#include "util/murmur_hash.hh"
 
 namespace Moses
 {
 
+namespace
+{
+struct CompareArcScore {
+  bool operator()(const Hypothesis *a, const Hypothesis *b) const {
+    return a->GetFutureScore() > b->GetFutureScore();
+  }
+};
+}
+
 void TrellisPathCollection::Prune(size_t newSize)
 {
   size_t currSize = m_collection.size();
@@ -28,6 +38,82 @@ void TrellisPathCollection::Prune(size_t newSize)
   m_collection.erase(iter, m_collection.end());
 }
 
+const std::vector<const Hypothesis*> &TrellisPathCollection::GetSortedArcs(const Hypothesis &hypo)
+{
+  boost::unordered_map<const Hypothesis*, std::vector<const Hypothesis*> >::iterator iter
+    = m_sortedArcs.find(&hypo);
+  if (iter != m_sortedArcs.end()) {
+    return iter->second;
+  }
+
+  std::vector<const Hypothesis*> &arcs = m_sortedArcs[&hypo];
+  const ArcList *arcList = hypo.GetArcList();
+  if (arcList) {
+    arcs.assign(arcList->begin(), arcList->end());
+    // ties stay in the order of the arc list
+    std::stable_sort(arcs.begin(), arcs.end(), CompareArcScore());
+  }
+  return arcs;
+}
+
+const TrellisPathCollection::PrefixHash &TrellisPathCollection::GetPrefixHash(const Hypothesis &hypo)
+{
+  boost::unordered_map<const Hypothesis*, PrefixHash>::iterator iter = m_prefixHashes.find(&hypo);
+  if (iter != m_prefixHashes.end()) {
+    return iter->second;
+  }
+
+  // the hypos back to the first one whose hash is known, or the empty hypo
+  std::vector<const Hypothesis*> chain;
+  PrefixHash prefix = {0, 0};
+  for (const Hypothesis *curr = &hypo; ; curr = curr->GetPrevHypo()) {
+    if (curr->GetPrevHypo() == NULL) {
+      // the empty hypo has no target phrase
+      m_prefixHashes[curr] = prefix;
+      break;
+    }
+    iter = m_prefixHashes.find(curr);
+    if (iter != m_prefixHashes.end()) {
+      prefix = iter->second;
+      break;
+    }
+    chain.push_back(curr);
+  }
+
+  for (std::vector<const Hypothesis*>::reverse_iterator curr = chain.rbegin();
+       curr != chain.rend(); ++curr) {
+    const TargetPhrase &phrase = (*curr)->GetCurrTargetPhrase();
+    for (size_t pos = 0; pos < phrase.GetSize(); ++pos) {
+      prefix.hash = prefix.hash * kHashBase + GetWordHash(phrase.GetWord(pos));
+    }
+    prefix.size += phrase.GetSize();
+    m_prefixHashes[*curr] = prefix;
+  }
+
+  return m_prefixHashes[&hypo];
+}
+
+uint64_t TrellisPathCollection::GetWordHash(const Word &word) const
+{
+  const Factor *factors[MAX_NUM_FACTORS];
+  for (size_t i = 0; i < m_outputFactorOrder.size(); ++i) {
+    factors[i] = word[m_outputFactorOrder[i]];
+  }
+  return util::MurmurHashNative(factors, m_outputFactorOrder.size() * sizeof(const Factor*));
 }
 
+uint64_t TrellisPathCollection::HashBasePower(size_t exponent)
+{
+  uint64_t ret = 1;
+  uint64_t base = kHashBase;
+  for (; exponent; exponent >>= 1) {
+    if (exponent & 1) {
+      ret *= base;
+    }
+    base *= base;
+  }
+  return ret;
+}
+
+}
 
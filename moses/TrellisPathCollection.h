@@ -24,6 +24,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <set>
 #include <iostream>
+#include <vector>
+#include <boost/unordered_map.hpp>
 #include "TrellisPath.h"
 
 namespace Moses
@@ -37,17 +39,35 @@ struct CompareTrellisPathCollection {
 
 /** priority queue used in Manager to store list of contenders for N-Best list.
  * Stored in order of total score so that the best path can just be popped from the top
+ * Also caches, for the sentence, the arc lists sorted by score and the
+ * hashes of the hypotheses' target prefixes that the paths are derived with.
  *  Used by phrase-based decoding
  */
 class TrellisPathCollection
 {
   friend std::ostream& operator<<(std::ostream&, const TrellisPathCollection&);
 
+public:
+  //! hash and number of words of the target phrases from the start of the sentence to a hypo
+  struct PrefixHash {
+    uint64_t hash;
+    size_t size;
+  };
+
 protected:
   typedef std::multiset<TrellisPath*, CompareTrellisPathCollection> CollectionType;
   CollectionType m_collection;
 
+  std::vector<FactorType> m_outputFactorOrder;
+  boost::unordered_map<const Hypothesis*, std::vector<const Hypothesis*> > m_sortedArcs;
+  boost::unordered_map<const Hypothesis*, PrefixHash> m_prefixHashes;
+
 public:
+  //! the output factors are those the surface hashes are computed over
+  explicit TrellisPathCollection(const std::vector<FactorType> &outputFactorOrder)
+    : m_outputFactorOrder(outputFactorOrder) {
+  }
+
   //iterator begin() { return m_collection.begin(); }
   TrellisPath *pop() {
     TrellisPath *top = *m_collection.begin();
@@ -72,6 +92,20 @@ public:
   }
 
   void Prune(size_t newSize);
+
+  //! the arcs of hypo, best first
+  const std::vector<const Hypothesis*> &GetSortedArcs(const Hypothesis &hypo);
+
+  const PrefixHash &GetPrefixHash(const Hypothesis &hypo);
+
+  //! hash of the output factors of word
+  uint64_t GetWordHash(const Word &word) const;
+
+  //! multiplier of the polynomial hash of a sequence of words
+  static const uint64_t kHashBase = 0x9e3779b97f4a7c15ULL;
+
+  //! kHashBase to the power of exponent
+  static uint64_t HashBasePower(size_t exponent);
 };
 
 inline std::ostream& operator<<(std::ostream& out, const TrellisPathCollection& pathColl)
@@ -147,6 +147,37 @@ BOOST_AUTO_TEST_CASE(positions)
 
 }
 
+BOOST_AUTO_TEST_CASE(long_input)
+{
+  // positions in the second and third words of the packed bits
+  Bitmap wbm(150);
+  BOOST_CHECK_EQUAL(wbm.GetLastGapPos(), 149);
+  Bitmap wbm2(wbm, Range(0, 69));
+  BOOST_CHECK_EQUAL(wbm2.GetFirstGapPos(), 70);
+  BOOST_CHECK_EQUAL(wbm2.GetLastPos(), 69);
+  BOOST_CHECK_EQUAL(wbm2.GetNumWordsCovered(), 70);
+  BOOST_CHECK(wbm2.Overlap(Range(63, 64)));
+  BOOST_CHECK(!wbm2.Overlap(Range(70, 140)));
+
+  Bitmap wbm3(wbm2, Range(130, 149));
+  BOOST_CHECK_EQUAL(wbm3.GetLastGapPos(), 129);
+  BOOST_CHECK_EQUAL(wbm3.GetLastPos(), 149);
+  BOOST_CHECK_EQUAL(wbm3.GetEdgeToTheLeftOf(100), 70);
+  BOOST_CHECK_EQUAL(wbm3.GetEdgeToTheRightOf(100), 129);
+
+  Bitmap wbm4(wbm3, Range(70, 129));
+  BOOST_CHECK(wbm4.IsComplete());
+  BOOST_CHECK_EQUAL(wbm4.GetFirstGapPos(), NOT_FOUND);
+  BOOST_CHECK_EQUAL(wbm4.GetLastGapPos(), NOT_FOUND);
+
+  // the same ticks, made in another order
+  Bitmap wbm5(wbm, Range(70, 149));
+  Bitmap wbm6(wbm5, Range(0, 69));
+  BOOST_CHECK(wbm4 == wbm6);
+  BOOST_CHECK_EQUAL(wbm4.hash(), wbm6.hash());
+  BOOST_CHECK(wbm3 != wbm5);
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -18,6 +18,7 @@ namespace Moses
     float map_weight; //! Weight given to the map solution. See Kumar et al 09 
     size_t pruning_factor; //! average number of nodes per word wanted in pruned lattice
     std::vector<float> theta; //! theta(s) for lattice mbr calculation
+    size_t threads; //! threads computing the n-gram posteriors of one sentence
     bool init(Parameter const& param);
     LMBR_Options();
   };
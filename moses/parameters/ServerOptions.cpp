@@ -62,6 +62,7 @@ init(Parameter const& P)
   P.SetParameter(this->port, "server-port", 8080);
   P.SetParameter(this->is_serial, "serial", false);
   P.SetParameter(this->logfile, "server-log", std::string("/dev/null"));
+  P.SetParameter(this->readyfile, "server-ready-file", std::string(""));
   P.SetParameter(this->numThreads, "threads", uint32_t(15));
 
   // defaults reflect recommended defaults (according to Hieu)
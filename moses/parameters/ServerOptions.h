@@ -16,6 +16,7 @@ namespace Moses
 
     int port;              // this is for the abyss server
     std::string logfile;   // this is for the abyss server
+    std::string readyfile; // created when the server accepts requests
     int maxConn;           // this is for the abyss server
     int maxConnBacklog;    // this is for the abyss server
     int keepaliveTimeout;  // this is for the abyss server
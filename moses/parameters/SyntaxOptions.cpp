@@ -12,6 +12,8 @@ namespace Moses {
   SyntaxOptions::
   SyntaxOptions()
     : s2t_parsing_algo(RecursiveCYKPlus)
+    , s2t_parsing_threads(1)
+    , chart_cell_threads(1)
     , default_non_term_only_for_empty_range(false)
     , source_label_overlap(SourceLabelOverlapAdd)
     , rule_limit(DEFAULT_MAX_TRANS_OPT_SIZE)
@@ -24,6 +26,8 @@ namespace Moses {
     param.SetParameter(rule_limit, "rule-limit", DEFAULT_MAX_TRANS_OPT_SIZE);
     param.SetParameter(s2t_parsing_algo, "s2t-parsing-algorithm", 
                        RecursiveCYKPlus);
+    param.SetParameter(s2t_parsing_threads, "s2t-parsing-threads", size_t(1));
+    param.SetParameter(chart_cell_threads, "chart-cell-threads", size_t(1));
     param.SetParameter(default_non_term_only_for_empty_range,
                        "default-non-term-for-empty-range-only", false);
     param.SetParameter(source_label_overlap, "source-label-overlap", 
@@ -16,6 +16,8 @@ namespace Moses
   SyntaxOptions : public OptionsBaseClass
   {
     S2TParsingAlgorithm s2t_parsing_algo;
+    size_t s2t_parsing_threads; // spans of the same width parsed concurrently
+    size_t chart_cell_threads; // chart cells of the same width decoded concurrently
     Word input_default_non_terminal;
     Word output_default_non_terminal;
     bool default_non_term_only_for_empty_range; // whatever that means
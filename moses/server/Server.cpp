@@ -22,6 +22,8 @@ namespace MosesServer
   ~Server()
   {
     unlink(m_pidfile.c_str());
+    if (m_server_options.readyfile.size())
+      unlink(m_server_options.readyfile.c_str());
   }
 
   int 
@@ -47,6 +49,12 @@ namespace MosesServer
     pidfile << getpid() << std::endl;
     pidfile.close();
     XVERBOSE(1,"Listening on port " << m_server_options.port << std::endl);
+    if (m_server_options.readyfile.size())
+      {
+        // the models are loaded, and requests are taken from here on
+        std::ofstream readyfile(m_server_options.readyfile.c_str());
+        readyfile << getpid() << std::endl;
+      }
     if (m_server_options.is_serial) 
       {
         VERBOSE(1,"Running server in serial mode." << std::endl);
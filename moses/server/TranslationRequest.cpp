@@ -4,6 +4,7 @@
 #include <boost/foreach.hpp>
 #include "moses/Util.h"
 #include "moses/Hypothesis.h"
+#include "moses/Profiler.h"
 
 namespace MosesServer
 {
@@ -24,6 +25,8 @@ using Moses::FValue;
 using Moses::PhraseDictionaryMultiModel;
 using Moses::FindPhraseDictionary;
 using Moses::Sentence;
+using Moses::Profiler;
+using Moses::ProfileTimer;
 
 boost::shared_ptr<TranslationRequest>
 TranslationRequest::
@@ -55,6 +58,7 @@ Run()
   typedef std::map<std::string,xmlrpc_c::value> param_t;
   param_t const& params = m_paramList.getStruct(0);
   parse_request(params);
+  Profiler::StartSentence(m_source->GetTranslationId());
   // cerr << "SESSION ID" << ret->m_session_id << endl;
 
 
@@ -69,6 +73,8 @@ Run()
   else
     run_phrase_decoder();
 
+  Profiler::EndSentence();
+
   {
     boost::lock_guard<boost::mutex> lock(m_mutex);
     m_done = true;
@@ -410,7 +416,10 @@ run_phrase_decoder()
   
   if (m_withGraphInfo) insertGraphInfo(manager,m_retData);
   if (m_withTopts) insertTranslationOptions(manager,m_retData);
-  if (m_options->nbest.nbest_size) outputNBest(manager, m_retData);
+  if (m_options->nbest.nbest_size) {
+    ProfileTimer timer(Profiler::GetData(), Profiler::NBest);
+    outputNBest(manager, m_retData);
+  }
 
 }
 }
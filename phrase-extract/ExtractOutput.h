@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+
+#include <boost/scoped_ptr.hpp>
+
+#include "OutputFileStream.h"
+#include "SortedLineWriter.h"
+
+namespace MosesTraining
+{
+
+/** One extract file, written as extraction goes or, with --SortedOutput,
+ *  collected and written sorted when closed.
+ */
+class ExtractOutput
+{
+public:
+  ExtractOutput() : m_open(false) {}
+
+  // Returns false if the file couldn't be opened.
+  bool Open(const std::string &fileName, bool sorted, std::size_t sortBufferBytes, bool unique) {
+    if (sorted) {
+      m_sorted.reset(new SortedLineWriter(fileName, sortBufferBytes, unique));
+    } else if (!m_file.Open(fileName)) {
+      return false;
+    }
+    m_open = true;
+    return true;
+  }
+
+  void Write(const std::string &text) {
+    if (!m_open || text.empty()) return;
+    if (m_sorted) {
+      m_sorted->Write(text);
+    } else {
+      m_file << text;
+    }
+  }
+
+  void Close() {
+    if (!m_open) return;
+    if (m_sorted) {
+      m_sorted->Close();
+    } else {
+      m_file.Close();
+    }
+    m_open = false;
+  }
+
+private:
+  bool m_open;
+  Moses::OutputFileStream m_file;
+  boost::scoped_ptr<SortedLineWriter> m_sorted;
+};
+
+}
@@ -68,7 +68,7 @@ public:
   const std::string GetOrientationInfoString(int startF, int startE, int endF, int endE, REO_DIR direction=REO_DIR_BIDIR) const;
   static const std::string GetOrientationString(const REO_CLASS orient, const REO_MODEL_TYPE modelType=REO_MODEL_TYPE_MSLR);
   static void WriteOrientation(std::ostream& out, const REO_CLASS orient, const REO_MODEL_TYPE modelType=REO_MODEL_TYPE_MSLR);
-  void IncrementPriorCount(REO_DIR direction, REO_CLASS orient, float increment);
+  static void IncrementPriorCount(REO_DIR direction, REO_CLASS orient, float increment);
   static void WritePriorCounts(std::ostream& out, const REO_MODEL_TYPE modelType=REO_MODEL_TYPE_MSLR);
   bool SourceSpanIsAligned(int index1, int index2) const;
   bool TargetSpanIsAligned(int index1, int index2) const;
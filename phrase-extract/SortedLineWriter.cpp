@@ -0,0 +1,183 @@
+/***********************************************************************
+  Moses - statistical machine translation system
+  Copyright (C) 2006-2011 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "SortedLineWriter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <queue>
+
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/file_piece.hh"
+#include "util/file_stream.hh"
+#include "OutputFileStream.h"
+
+using namespace std;
+
+namespace MosesTraining
+{
+
+namespace
+{
+
+// Byte order, as LC_ALL=C sort (memcmp compares unsigned chars).
+int Compare(const char *a, size_t aLength, const char *b, size_t bLength)
+{
+  int cmp = memcmp(a, b, min(aLength, bLength));
+  if (cmp) return cmp;
+  return aLength < bLength ? -1 : (aLength > bLength ? 1 : 0);
+}
+
+class LineLess
+{
+public:
+  explicit LineLess(const string &buffer) : m_buffer(buffer.data()) {}
+
+  bool operator()(const pair<size_t, size_t> &a, const pair<size_t, size_t> &b) const {
+    return Compare(m_buffer + a.first, a.second, m_buffer + b.first, b.second) < 0;
+  }
+
+private:
+  const char *m_buffer;
+};
+
+// Current line of one sorted run during the merge
+struct RunHead {
+  StringPiece line;
+  size_t run;
+
+  // priority_queue is a max heap
+  bool operator<(const RunHead &other) const {
+    int cmp = Compare(line.data(), line.size(), other.line.data(), other.line.size());
+    return cmp > 0 || (cmp == 0 && run > other.run);
+  }
+};
+
+} // namespace
+
+SortedLineWriter::SortedLineWriter(const string &filePath, size_t bufferBytes, bool unique)
+  : m_filePath(filePath), m_bufferBytes(bufferBytes), m_unique(unique), m_closed(false)
+{
+  m_buffer.reserve(min<size_t>(bufferBytes, 1 << 26));
+}
+
+SortedLineWriter::~SortedLineWriter()
+{
+  for (size_t i = 0; i < m_runs.size(); ++i) {
+    delete m_runs[i];
+  }
+}
+
+void SortedLineWriter::Write(const string &lines)
+{
+  size_t start = 0;
+  while (start < lines.size()) {
+    size_t end = lines.find('\n', start);
+    UTIL_THROW_IF2(end == string::npos, "Line without newline written to " << m_filePath);
+    m_lines.push_back(Line(m_buffer.size() + start, end - start));
+    start = end + 1;
+  }
+  m_buffer.append(lines);
+  if (m_buffer.size() >= m_bufferBytes) {
+    Spill();
+  }
+}
+
+void SortedLineWriter::SortBuffer()
+{
+  sort(m_lines.begin(), m_lines.end(), LineLess(m_buffer));
+}
+
+void SortedLineWriter::Spill()
+{
+  SortBuffer();
+  int fd = util::MakeTemp(m_filePath);
+  {
+    util::FileStream out(fd, 1 << 20);
+    for (size_t i = 0; i < m_lines.size(); ++i) {
+      out.write(m_buffer.data() + m_lines[i].first, m_lines[i].second);
+      out.write("\n", 1);
+    }
+  }
+  util::SeekOrThrow(fd, 0);
+  m_runs.push_back(new util::FilePiece(fd, m_filePath.c_str()));
+  m_buffer.clear();
+  m_lines.clear();
+}
+
+void SortedLineWriter::Close()
+{
+  if (m_closed) return;
+  m_closed = true;
+
+  // The last buffer takes part in the merge without being spilled.
+  SortBuffer();
+  const size_t memoryRun = m_runs.size();
+  size_t memoryPos = 0;
+
+  priority_queue<RunHead> heap;
+  RunHead head;
+  for (size_t i = 0; i < m_runs.size(); ++i) {
+    if (m_runs[i]->ReadLineOrEOF(head.line, '\n', false)) {
+      head.run = i;
+      heap.push(head);
+    }
+  }
+  if (memoryPos < m_lines.size()) {
+    head.line = StringPiece(m_buffer.data() + m_lines[memoryPos].first, m_lines[memoryPos].second);
+    head.run = memoryRun;
+    heap.push(head);
+  }
+
+  Moses::OutputFileStream out(m_filePath);
+  string previous;
+  bool first = true;
+  while (!heap.empty()) {
+    head = heap.top();
+    heap.pop();
+    if (!m_unique || first || head.line != StringPiece(previous)) {
+      out.write(head.line.data(), head.line.size());
+      out << '\n';
+      if (m_unique) previous.assign(head.line.data(), head.line.size());
+      first = false;
+    }
+
+    // The popped line is consumed; advance its run.
+    if (head.run == memoryRun) {
+      if (++memoryPos < m_lines.size()) {
+        head.line = StringPiece(m_buffer.data() + m_lines[memoryPos].first, m_lines[memoryPos].second);
+        heap.push(head);
+      }
+    } else if (m_runs[head.run]->ReadLineOrEOF(head.line, '\n', false)) {
+      heap.push(head);
+    }
+  }
+  out.Close();
+
+  for (size_t i = 0; i < m_runs.size(); ++i) {
+    delete m_runs[i];
+  }
+  m_runs.clear();
+  m_buffer.clear();
+  m_lines.clear();
+}
+
+}
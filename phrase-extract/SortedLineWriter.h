@@ -0,0 +1,67 @@
+/***********************************************************************
+  Moses - statistical machine translation system
+  Copyright (C) 2006-2011 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace util
+{
+class FilePiece;
+}
+
+namespace MosesTraining
+{
+
+/** Collects lines of text and writes them to a file in the order of
+ *  LC_ALL=C sort, optionally without repeated lines as with uniq.
+ *  Lines are sorted in memory; when the buffer is full, the sorted run is
+ *  spilled to an unlinked temporary file and all runs are merged on Close().
+ *  The output is gzipped if the file name ends in .gz.
+ */
+class SortedLineWriter
+{
+public:
+  SortedLineWriter(const std::string &filePath, std::size_t bufferBytes, bool unique);
+  ~SortedLineWriter();
+
+  /** Add one or more complete, newline terminated lines */
+  void Write(const std::string &lines);
+
+  void Close();
+
+private:
+  typedef std::pair<std::size_t, std::size_t> Line; // offset and length in m_buffer
+
+  void SortBuffer();
+  void Spill();
+
+  std::string m_filePath;
+  std::size_t m_bufferBytes;
+  bool m_unique;
+  bool m_closed;
+
+  std::string m_buffer;
+  std::vector<Line> m_lines;
+  std::vector<util::FilePiece*> m_runs;
+};
+
+}
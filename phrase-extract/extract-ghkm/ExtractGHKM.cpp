@@ -21,6 +21,7 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <iterator>
@@ -29,10 +30,19 @@
 #include <vector>
 
 #include <boost/program_options.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
 
 #include "syntax-common/exception.h"
 #include "syntax-common/xml_tree_parser.h"
 
+#include "moses/ThreadPool.h"
+
+#include "ExtractOutput.h"
 #include "InputFileStream.h"
 #include "OutputFileStream.h"
 #include "SyntaxNode.h"
@@ -60,6 +70,317 @@ namespace Syntax
 namespace GHKM
 {
 
+/** The label sets and word counts of a number of sentences, which the glue
+ *  grammar, unknown word label and source label set files are written from.
+ */
+struct CorpusStatistics {
+  std::set<std::string> targetLabelSet;
+  std::map<std::string, int> targetTopLabelSet;
+  std::set<std::string> sourceLabelSet;
+
+  // Word count statistics for producing unknown word labels.
+  std::map<std::string, int> targetWordCount;
+  std::map<std::string, std::string> targetWordLabel;
+
+  // Word count statistics for producing unknown word labels: source side.
+  std::map<std::string, int> sourceWordCount;
+  std::map<std::string, std::string> sourceWordLabel;
+
+  // Adds the statistics of sentences that follow those already counted.
+  void Add(const CorpusStatistics &other) {
+    targetLabelSet.insert(other.targetLabelSet.begin(),
+                          other.targetLabelSet.end());
+    AddCounts(other.targetTopLabelSet, targetTopLabelSet);
+    sourceLabelSet.insert(other.sourceLabelSet.begin(),
+                          other.sourceLabelSet.end());
+    AddCounts(other.targetWordCount, targetWordCount);
+    AddLabels(other.targetWordLabel, targetWordLabel);
+    AddCounts(other.sourceWordCount, sourceWordCount);
+    AddLabels(other.sourceWordLabel, sourceWordLabel);
+  }
+
+private:
+  static void AddCounts(const std::map<std::string, int> &from,
+                        std::map<std::string, int> &to) {
+    for (std::map<std::string, int>::const_iterator p = from.begin();
+         p != from.end(); ++p) {
+      to[p->first] += p->second;
+    }
+  }
+
+  // A word is labelled with the label of its last occurrence.
+  static void AddLabels(const std::map<std::string, std::string> &from,
+                        std::map<std::string, std::string> &to) {
+    for (std::map<std::string, std::string>::const_iterator p = from.begin();
+         p != from.end(); ++p) {
+      to[p->first] = p->second;
+    }
+  }
+};
+
+/** Extraction from a block of consecutive sentences into memory, so blocks
+ *  can be processed concurrently and written in corpus order.
+ */
+class ExtractBlockTask : public Moses::Task
+{
+public:
+  ExtractBlockTask(const ExtractGHKM &tool, const Options &options)
+    : m_tool(tool)
+    , m_options(options)
+    , m_done(false) {
+    for (int dir = 0; dir < 2; ++dir) {
+      for (int orient = 0; orient <= PhraseOrientation::REO_CLASS_UNKNOWN;
+           ++orient) {
+        m_priorCounts[dir][orient] = 0;
+      }
+    }
+  }
+
+  void Add(size_t lineNum, const std::string &targetLine,
+           const std::string &sourceLine, const std::string &alignmentLine) {
+    m_lineNums.push_back(lineNum);
+    m_targetLines.push_back(targetLine);
+    m_sourceLines.push_back(sourceLine);
+    m_alignmentLines.push_back(alignmentLine);
+  }
+
+  size_t Size() const {
+    return m_lineNums.size();
+  }
+
+  void Run() {
+    for (size_t i = 0; i < m_lineNums.size(); ++i) {
+      ExtractSentence(m_lineNums[i], m_targetLines[i], m_sourceLines[i],
+                      m_alignmentLines[i]);
+    }
+    m_statistics.targetLabelSet = m_targetXmlTreeParser.label_set();
+    m_statistics.targetTopLabelSet = m_targetXmlTreeParser.top_label_set();
+    m_statistics.sourceLabelSet = m_sourceXmlTreeParser.label_set();
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    m_done = true;
+#ifdef WITH_THREADS
+    m_finished.notify_all();
+#endif
+  }
+
+  // Wait until Run() is done, append the rules to the extract files and add
+  // the statistics of the block to those of the corpus.
+  void WriteTo(ExtractOutput &fwdExtract, ExtractOutput &invExtract,
+               CorpusStatistics &statistics) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!m_done) m_finished.wait(lock);
+#endif
+    std::cerr << m_log.str();
+    fwdExtract.Write(m_fwd.str());
+    invExtract.Write(m_inv.str());
+    statistics.Add(m_statistics);
+    for (int orient = 0; orient <= PhraseOrientation::REO_CLASS_UNKNOWN;
+         ++orient) {
+      PhraseOrientation::REO_CLASS reoClass =
+        static_cast<PhraseOrientation::REO_CLASS>(orient);
+      if (m_priorCounts[0][orient] != 0) {
+        PhraseOrientation::IncrementPriorCount(PhraseOrientation::REO_DIR_L2R,
+                                               reoClass, m_priorCounts[0][orient]);
+      }
+      if (m_priorCounts[1][orient] != 0) {
+        PhraseOrientation::IncrementPriorCount(PhraseOrientation::REO_DIR_R2L,
+                                               reoClass, m_priorCounts[1][orient]);
+      }
+    }
+  }
+
+private:
+  void ExtractSentence(size_t lineNum, const std::string &targetLine,
+                       const std::string &sourceLine,
+                       const std::string &alignmentLine);
+
+  const ExtractGHKM &m_tool;
+  const Options &m_options;
+
+  std::vector<size_t> m_lineNums;
+  std::vector<std::string> m_targetLines;
+  std::vector<std::string> m_sourceLines;
+  std::vector<std::string> m_alignmentLines;
+
+  // The parsers collect the label sets of the block's trees.
+  XmlTreeParser m_targetXmlTreeParser;
+  XmlTreeParser m_sourceXmlTreeParser;
+
+  std::ostringstream m_fwd;
+  std::ostringstream m_inv;
+  std::ostringstream m_log;
+  CorpusStatistics m_statistics;
+  float m_priorCounts[2][PhraseOrientation::REO_CLASS_UNKNOWN+1];
+
+  bool m_done;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+  boost::condition_variable m_finished;
+#endif
+};
+
+void ExtractBlockTask::ExtractSentence(size_t lineNum,
+                                       const std::string &targetLine,
+                                       const std::string &sourceLine,
+                                       const std::string &alignmentLine)
+{
+  const Options &options = m_options;
+
+  // Parse target tree.
+  if (targetLine.size() == 0) {
+    m_log << "skipping line " << lineNum << " with empty target tree\n";
+    return;
+  }
+  std::auto_ptr<SyntaxTree> targetParseTree;
+  try {
+    targetParseTree = m_targetXmlTreeParser.Parse(targetLine);
+    assert(targetParseTree.get());
+  } catch (const Exception &e) {
+    std::ostringstream oss;
+    oss << "Failed to parse target XML tree at line " << lineNum;
+    if (!e.msg().empty()) {
+      oss << ": " << e.msg();
+    }
+    m_tool.Error(oss.str());
+  }
+
+  // Read source tokens (and parse tree if using source labels).
+  std::vector<std::string> sourceTokens;
+  std::auto_ptr<SyntaxTree> sourceParseTree;
+  if (!options.sourceLabels) {
+    sourceTokens = m_tool.ReadTokens(sourceLine);
+  } else {
+    try {
+      sourceParseTree = m_sourceXmlTreeParser.Parse(sourceLine);
+      assert(sourceParseTree.get());
+    } catch (const Exception &e) {
+      std::ostringstream oss;
+      oss << "Failed to parse source XML tree at line " << lineNum;
+      if (!e.msg().empty()) {
+        oss << ": " << e.msg();
+      }
+      m_tool.Error(oss.str());
+    }
+    sourceTokens = m_sourceXmlTreeParser.words();
+  }
+
+  // Read word alignments.
+  Alignment alignment;
+  try {
+    ReadAlignment(alignmentLine, alignment);
+  } catch (const Exception &e) {
+    std::ostringstream oss;
+    oss << "Failed to read alignment at line " << lineNum << ": ";
+    oss << e.msg();
+    m_tool.Error(oss.str());
+  }
+  if (alignment.size() == 0) {
+    m_log << "skipping line " << lineNum << " without alignment points\n";
+    return;
+  }
+  if (options.t2s) {
+    FlipAlignment(alignment);
+  }
+
+  // Record word counts.
+  if (!options.targetUnknownWordFile.empty()) {
+    m_tool.CollectWordLabelCounts(*targetParseTree, options,
+                                  m_statistics.targetWordCount,
+                                  m_statistics.targetWordLabel);
+  }
+
+  // Record word counts: source side.
+  if (options.sourceLabels && !options.sourceUnknownWordFile.empty()) {
+    m_tool.CollectWordLabelCounts(*sourceParseTree, options,
+                                  m_statistics.sourceWordCount,
+                                  m_statistics.sourceWordLabel);
+  }
+
+  // Form an alignment graph from the target tree, source words, and
+  // alignment.
+  AlignmentGraph graph(targetParseTree.get(), sourceTokens, alignment);
+
+  // Extract minimal rules, adding each rule to its root node's rule set.
+  graph.ExtractMinimalRules(options);
+
+  // Extract composed rules.
+  if (!options.minimal) {
+    graph.ExtractComposedRules(options);
+  }
+
+  // Initialize phrase orientation scoring object
+  PhraseOrientation phraseOrientation(sourceTokens.size(),
+                                      m_targetXmlTreeParser.words().size(), alignment);
+
+  // Write the rules, subject to scope pruning.
+  ScfgRuleWriter scfgWriter(m_fwd, m_inv, options);
+  StsgRuleWriter stsgWriter(m_fwd, m_inv, options);
+  const std::vector<Node *> &targetNodes = graph.GetTargetNodes();
+  for (std::vector<Node *>::const_iterator p = targetNodes.begin();
+       p != targetNodes.end(); ++p) {
+
+    const std::vector<const Subgraph *> &rules = (*p)->GetRules();
+
+    PhraseOrientation::REO_CLASS l2rOrientation=PhraseOrientation::REO_CLASS_UNKNOWN, r2lOrientation=PhraseOrientation::REO_CLASS_UNKNOWN;
+    if (options.phraseOrientation && !rules.empty()) {
+      int sourceSpanBegin = *((*p)->GetSpan().begin());
+      int sourceSpanEnd   = *((*p)->GetSpan().rbegin());
+      l2rOrientation = phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd,PhraseOrientation::REO_DIR_L2R);
+      r2lOrientation = phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd,PhraseOrientation::REO_DIR_R2L);
+      // std::cerr << "span " << sourceSpanBegin << " " << sourceSpanEnd << std::endl;
+      // std::cerr << "phraseOrientation " << phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd) << std::endl;
+    }
+
+    for (std::vector<const Subgraph *>::const_iterator q = rules.begin();
+         q != rules.end(); ++q) {
+      // STSG output.
+      if (options.stsg) {
+        StsgRule rule(**q);
+        if (rule.Scope() <= options.maxScope) {
+          stsgWriter.Write(rule);
+        }
+        continue;
+      }
+      // SCFG output.
+      ScfgRule *r = 0;
+      if (options.sourceLabels) {
+        r = new ScfgRule(**q, &m_sourceXmlTreeParser.node_collection());
+      } else {
+        r = new ScfgRule(**q);
+      }
+      // TODO Can scope pruning be done earlier?
+      if (r->Scope() <= options.maxScope) {
+        scfgWriter.Write(*r,lineNum,false);
+        if (options.treeFragments) {
+          m_fwd << " {{Tree ";
+          (*q)->PrintTree(m_fwd);
+          m_fwd << "}}";
+        }
+        if (options.partsOfSpeech) {
+          m_fwd << " {{POS";
+          (*q)->PrintPartsOfSpeech(m_fwd);
+          m_fwd << "}}";
+        }
+        if (options.phraseOrientation) {
+          m_fwd << " {{Orientation ";
+          phraseOrientation.WriteOrientation(m_fwd,l2rOrientation);
+          m_fwd << " ";
+          phraseOrientation.WriteOrientation(m_fwd,r2lOrientation);
+          m_fwd << "}}";
+          ++m_priorCounts[PhraseOrientation::REO_DIR_L2R][l2rOrientation];
+          ++m_priorCounts[PhraseOrientation::REO_DIR_R2L][r2lOrientation];
+        }
+        m_fwd << std::endl;
+        m_inv << std::endl;
+      }
+      delete r;
+    }
+  }
+}
+
 int ExtractGHKM::Main(int argc, char *argv[])
 {
   using Moses::InputFileStream;
@@ -85,8 +406,11 @@ int ExtractGHKM::Main(int argc, char *argv[])
   InputFileStream alignmentStream(options.alignmentFile);
 
   // Open output files.
-  OutputFileStream fwdExtractStream;
-  OutputFileStream invExtractStream;
+  //
+  // Sorted output is what the training scripts get from piping the extract
+  // files through LC_ALL=C sort and gzip, ready for score.
+  ExtractOutput fwdExtractStream;
+  ExtractOutput invExtractStream;
   OutputFileStream glueGrammarStream;
   OutputFileStream targetUnknownWordStream;
   OutputFileStream sourceUnknownWordStream;
@@ -95,12 +419,20 @@ int ExtractGHKM::Main(int argc, char *argv[])
 
   std::string fwdFileName = options.extractFile;
   std::string invFileName = options.extractFile + std::string(".inv");
-  if (options.gzOutput) {
+  if (options.sortedOutput) {
+    fwdFileName += ".sorted.gz";
+    invFileName += ".sorted.gz";
+  } else if (options.gzOutput) {
     fwdFileName += ".gz";
     invFileName += ".gz";
   }
-  OpenOutputFileOrDie(fwdFileName, fwdExtractStream);
-  OpenOutputFileOrDie(invFileName, invExtractStream);
+  size_t sortBufferBytes = (static_cast<size_t>(options.sortBufferSize) << 20) / 2;
+  if (!fwdExtractStream.Open(fwdFileName, options.sortedOutput, sortBufferBytes, false)) {
+    Error(std::string("failed to open file for writing: ") + fwdFileName);
+  }
+  if (!invExtractStream.Open(invFileName, options.sortedOutput, sortBufferBytes, false)) {
+    Error(std::string("failed to open file for writing: ") + invFileName);
+  }
 
   if (!options.glueGrammarFile.empty()) {
     OpenOutputFileOrDie(options.glueGrammarFile, glueGrammarStream);
@@ -121,22 +453,25 @@ int ExtractGHKM::Main(int argc, char *argv[])
     OpenOutputFileOrDie(options.unknownWordSoftMatchesFile, unknownWordSoftMatchesStream);
   }
 
-  // Word count statistics for producing unknown word labels.
-  std::map<std::string, int> targetWordCount;
-  std::map<std::string, std::string> targetWordLabel;
-
-  // Word count statistics for producing unknown word labels: source side.
-  std::map<std::string, int> sourceWordCount;
-  std::map<std::string, std::string> sourceWordLabel;
+  // Label sets and word count statistics of the whole corpus.
+  CorpusStatistics statistics;
+
+  // Lines are read here, in order; blocks of them are extracted by the pool
+  // and their rules are appended in corpus order.
+  const size_t sentencesPerBlock = 1000;
+  const size_t numThreads = options.threads;
+  std::deque<boost::shared_ptr<ExtractBlockTask> > pending;
+#ifdef WITH_THREADS
+  boost::scoped_ptr<Moses::ThreadPool> pool;
+  if (numThreads > 1) {
+    pool.reset(new Moses::ThreadPool(numThreads));
+  }
+#endif
+  boost::shared_ptr<ExtractBlockTask> block(new ExtractBlockTask(*this, options));
 
   std::string targetLine;
   std::string sourceLine;
   std::string alignmentLine;
-  Alignment alignment;
-  XmlTreeParser targetXmlTreeParser;
-  XmlTreeParser sourceXmlTreeParser;
-  ScfgRuleWriter scfgWriter(fwdExtractStream, invExtractStream, options);
-  StsgRuleWriter stsgWriter(fwdExtractStream, invExtractStream, options);
   size_t lineNum = options.sentenceOffset;
   while (true) {
     std::getline(targetStream, targetLine);
@@ -152,153 +487,41 @@ int ExtractGHKM::Main(int argc, char *argv[])
     }
 
     ++lineNum;
-
-    // Parse target tree.
-    if (targetLine.size() == 0) {
-      std::cerr << "skipping line " << lineNum << " with empty target tree\n";
-      continue;
-    }
-    std::auto_ptr<SyntaxTree> targetParseTree;
-    try {
-      targetParseTree = targetXmlTreeParser.Parse(targetLine);
-      assert(targetParseTree.get());
-    } catch (const Exception &e) {
-      std::ostringstream oss;
-      oss << "Failed to parse target XML tree at line " << lineNum;
-      if (!e.msg().empty()) {
-        oss << ": " << e.msg();
-      }
-      Error(oss.str());
-    }
-
-    // Read source tokens (and parse tree if using source labels).
-    std::vector<std::string> sourceTokens;
-    std::auto_ptr<SyntaxTree> sourceParseTree;
-    if (!options.sourceLabels) {
-      sourceTokens = ReadTokens(sourceLine);
-    } else {
-      try {
-        sourceParseTree = sourceXmlTreeParser.Parse(sourceLine);
-        assert(sourceParseTree.get());
-      } catch (const Exception &e) {
-        std::ostringstream oss;
-        oss << "Failed to parse source XML tree at line " << lineNum;
-        if (!e.msg().empty()) {
-          oss << ": " << e.msg();
+    block->Add(lineNum, targetLine, sourceLine, alignmentLine);
+
+    if (block->Size() == sentencesPerBlock) {
+#ifdef WITH_THREADS
+      if (pool) {
+        pool->Submit(block);
+        pending.push_back(block);
+        // bound the memory held by blocks waiting to be written
+        while (pending.size() > 4 * numThreads) {
+          pending.front()->WriteTo(fwdExtractStream, invExtractStream, statistics);
+          pending.pop_front();
         }
-        Error(oss.str());
+      } else
+#endif
+      {
+        block->Run();
+        block->WriteTo(fwdExtractStream, invExtractStream, statistics);
       }
-      sourceTokens = sourceXmlTreeParser.words();
-    }
-
-    // Read word alignments.
-    try {
-      ReadAlignment(alignmentLine, alignment);
-    } catch (const Exception &e) {
-      std::ostringstream oss;
-      oss << "Failed to read alignment at line " << lineNum << ": ";
-      oss << e.msg();
-      Error(oss.str());
-    }
-    if (alignment.size() == 0) {
-      std::cerr << "skipping line " << lineNum << " without alignment points\n";
-      continue;
+      block.reset(new ExtractBlockTask(*this, options));
     }
-    if (options.t2s) {
-      FlipAlignment(alignment);
-    }
-
-    // Record word counts.
-    if (!options.targetUnknownWordFile.empty()) {
-      CollectWordLabelCounts(*targetParseTree, options, targetWordCount,
-                             targetWordLabel);
-    }
-
-    // Record word counts: source side.
-    if (options.sourceLabels && !options.sourceUnknownWordFile.empty()) {
-      CollectWordLabelCounts(*sourceParseTree, options, sourceWordCount,
-                             sourceWordLabel);
-    }
-
-    // Form an alignment graph from the target tree, source words, and
-    // alignment.
-    AlignmentGraph graph(targetParseTree.get(), sourceTokens, alignment);
-
-    // Extract minimal rules, adding each rule to its root node's rule set.
-    graph.ExtractMinimalRules(options);
-
-    // Extract composed rules.
-    if (!options.minimal) {
-      graph.ExtractComposedRules(options);
-    }
-
-    // Initialize phrase orientation scoring object
-    PhraseOrientation phraseOrientation(sourceTokens.size(),
-                                        targetXmlTreeParser.words().size(), alignment);
-
-    // Write the rules, subject to scope pruning.
-    const std::vector<Node *> &targetNodes = graph.GetTargetNodes();
-    for (std::vector<Node *>::const_iterator p = targetNodes.begin();
-         p != targetNodes.end(); ++p) {
-
-      const std::vector<const Subgraph *> &rules = (*p)->GetRules();
-
-      PhraseOrientation::REO_CLASS l2rOrientation=PhraseOrientation::REO_CLASS_UNKNOWN, r2lOrientation=PhraseOrientation::REO_CLASS_UNKNOWN;
-      if (options.phraseOrientation && !rules.empty()) {
-        int sourceSpanBegin = *((*p)->GetSpan().begin());
-        int sourceSpanEnd   = *((*p)->GetSpan().rbegin());
-        l2rOrientation = phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd,PhraseOrientation::REO_DIR_L2R);
-        r2lOrientation = phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd,PhraseOrientation::REO_DIR_R2L);
-        // std::cerr << "span " << sourceSpanBegin << " " << sourceSpanEnd << std::endl;
-        // std::cerr << "phraseOrientation " << phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd) << std::endl;
-      }
+  }
 
-      for (std::vector<const Subgraph *>::const_iterator q = rules.begin();
-           q != rules.end(); ++q) {
-        // STSG output.
-        if (options.stsg) {
-          StsgRule rule(**q);
-          if (rule.Scope() <= options.maxScope) {
-            stsgWriter.Write(rule);
-          }
-          continue;
-        }
-        // SCFG output.
-        ScfgRule *r = 0;
-        if (options.sourceLabels) {
-          r = new ScfgRule(**q, &sourceXmlTreeParser.node_collection());
-        } else {
-          r = new ScfgRule(**q);
-        }
-        // TODO Can scope pruning be done earlier?
-        if (r->Scope() <= options.maxScope) {
-          scfgWriter.Write(*r,lineNum,false);
-          if (options.treeFragments) {
-            fwdExtractStream << " {{Tree ";
-            (*q)->PrintTree(fwdExtractStream);
-            fwdExtractStream << "}}";
-          }
-          if (options.partsOfSpeech) {
-            fwdExtractStream << " {{POS";
-            (*q)->PrintPartsOfSpeech(fwdExtractStream);
-            fwdExtractStream << "}}";
-          }
-          if (options.phraseOrientation) {
-            fwdExtractStream << " {{Orientation ";
-            phraseOrientation.WriteOrientation(fwdExtractStream,l2rOrientation);
-            fwdExtractStream << " ";
-            phraseOrientation.WriteOrientation(fwdExtractStream,r2lOrientation);
-            fwdExtractStream << "}}";
-            phraseOrientation.IncrementPriorCount(PhraseOrientation::REO_DIR_L2R,l2rOrientation,1);
-            phraseOrientation.IncrementPriorCount(PhraseOrientation::REO_DIR_R2L,r2lOrientation,1);
-          }
-          fwdExtractStream << std::endl;
-          invExtractStream << std::endl;
-        }
-        delete r;
-      }
-    }
+  block->Run();
+  for (; !pending.empty(); pending.pop_front()) {
+    pending.front()->WriteTo(fwdExtractStream, invExtractStream, statistics);
   }
+  block->WriteTo(fwdExtractStream, invExtractStream, statistics);
+#ifdef WITH_THREADS
+  if (pool) {
+    pool->Stop(true);
+  }
+#endif
+
+  fwdExtractStream.Close();
+  invExtractStream.Close();
 
   if (options.phraseOrientation) {
     std::string phraseOrientationPriorsFileName = options.extractFile + std::string(".phraseOrientationPriors");
@@ -309,7 +532,7 @@ int ExtractGHKM::Main(int argc, char *argv[])
 
   std::map<std::string,size_t> sourceLabels;
   if (options.sourceLabels && !options.sourceLabelSetFile.empty()) {
-    std::set<std::string> extendedLabelSet = sourceXmlTreeParser.label_set();
+    std::set<std::string> extendedLabelSet = statistics.sourceLabelSet;
     extendedLabelSet.insert("XLHS"); // non-matching label (left-hand side)
     extendedLabelSet.insert("XRHS"); // non-matching label (right-hand side)
     extendedLabelSet.insert("TOPLABEL");  // as used in the glue grammar
@@ -326,8 +549,8 @@ int ExtractGHKM::Main(int argc, char *argv[])
   std::map<std::string, int> strippedTargetTopLabelSet;
   if (options.stripBitParLabels &&
       (!options.glueGrammarFile.empty() || !options.unknownWordSoftMatchesFile.empty())) {
-    StripBitParLabels(targetXmlTreeParser.label_set(),
-                      targetXmlTreeParser.top_label_set(),
+    StripBitParLabels(statistics.targetLabelSet,
+                      statistics.targetTopLabelSet,
                       strippedTargetLabelSet, strippedTargetTopLabelSet);
   }
 
@@ -335,25 +558,27 @@ int ExtractGHKM::Main(int argc, char *argv[])
     if (options.stripBitParLabels) {
       WriteGlueGrammar(strippedTargetLabelSet, strippedTargetTopLabelSet, sourceLabels, options, glueGrammarStream);
     } else {
-      WriteGlueGrammar(targetXmlTreeParser.label_set(),
-                       targetXmlTreeParser.top_label_set(),
+      WriteGlueGrammar(statistics.targetLabelSet,
+                       statistics.targetTopLabelSet,
                        sourceLabels, options, glueGrammarStream);
     }
   }
 
   if (!options.targetUnknownWordFile.empty()) {
-    WriteUnknownWordLabel(targetWordCount, targetWordLabel, options, targetUnknownWordStream);
+    WriteUnknownWordLabel(statistics.targetWordCount, statistics.targetWordLabel,
+                          options, targetUnknownWordStream);
   }
 
   if (options.sourceLabels && !options.sourceUnknownWordFile.empty()) {
-    WriteUnknownWordLabel(sourceWordCount, sourceWordLabel, options, sourceUnknownWordStream, true);
+    WriteUnknownWordLabel(statistics.sourceWordCount, statistics.sourceWordLabel,
+                          options, sourceUnknownWordStream, true);
   }
 
   if (!options.unknownWordSoftMatchesFile.empty()) {
     if (options.stripBitParLabels) {
       WriteUnknownWordSoftMatches(strippedTargetLabelSet, unknownWordSoftMatchesStream);
     } else {
-      WriteUnknownWordSoftMatches(targetXmlTreeParser.label_set(),
+      WriteUnknownWordSoftMatches(statistics.targetLabelSet,
                                   unknownWordSoftMatchesStream);
     }
   }
@@ -456,6 +681,9 @@ void ExtractGHKM::ProcessOptions(int argc, char *argv[],
    "output STSG rules (default is SCFG)")
   ("T2S",
    "enable tree-to-string rule extraction (string-to-tree is assumed by default)")
+  ("Threads",
+   po::value(&options.threads)->default_value(options.threads),
+   "set number of threads, rules are written in corpus order")
   ("TreeFragments",
    "output parse tree information")
   ("SourceLabels",
@@ -466,6 +694,11 @@ void ExtractGHKM::ProcessOptions(int argc, char *argv[],
   ("SentenceOffset",
    po::value(&options.sentenceOffset)->default_value(options.sentenceOffset),
    "set sentence number offset if processing split corpus")
+  ("SortBufferSize",
+   po::value(&options.sortBufferSize)->default_value(options.sortBufferSize),
+   "set memory in megabytes for sorting the extract files with --SortedOutput")
+  ("SortedOutput",
+   "write the extract files sorted and gzipped (as EXTRACT.sorted.gz and EXTRACT.inv.sorted.gz)")
   ("UnknownWordLabel",
    po::value(&options.targetUnknownWordFile),
    "write unknown word labels to named file")
@@ -581,6 +814,9 @@ void ExtractGHKM::ProcessOptions(int argc, char *argv[],
   if (vm.count("TreeFragments")) {
     options.treeFragments = true;
   }
+  if (vm.count("SortedOutput")) {
+    options.sortedOutput = true;
+  }
   if (vm.count("SourceLabels")) {
     options.sourceLabels = true;
   }
@@ -591,6 +827,19 @@ void ExtractGHKM::ProcessOptions(int argc, char *argv[],
     options.unpairedExtractFormat = true;
   }
 
+  if (options.threads < 1) {
+    Error("--Threads must be at least 1");
+  }
+  if (options.sortBufferSize < 1) {
+    Error("--SortBufferSize must be at least 1");
+  }
+#ifndef WITH_THREADS
+  if (options.threads > 1) {
+    Warn("compiled without threads, ignoring --Threads");
+    options.threads = 1;
+  }
+#endif
+
   // Workaround for extract-parallel issue.
   if (options.sentenceOffset > 0) {
     options.targetUnknownWordFile.clear();
@@ -768,7 +1017,7 @@ void ExtractGHKM::CollectWordLabelCounts(
   SyntaxTree &root,
   const Options &options,
   std::map<std::string, int> &wordCount,
-  std::map<std::string, std::string> &wordLabel)
+  std::map<std::string, std::string> &wordLabel) const
 {
   for (SyntaxTree::ConstLeafIterator p(root);
        p != SyntaxTree::ConstLeafIterator(); ++p) {
@@ -37,6 +37,7 @@ namespace Syntax
 namespace GHKM
 {
 
+class ExtractBlockTask;
 struct Options;
 
 class ExtractGHKM : public Tool
@@ -47,11 +48,13 @@ public:
   virtual int Main(int argc, char *argv[]);
 
 private:
+  friend class ExtractBlockTask;
+
   void RecordTreeLabels(const SyntaxTree &, std::set<std::string> &);
   void CollectWordLabelCounts(SyntaxTree &,
                               const Options &,
                               std::map<std::string, int> &,
-                              std::map<std::string, std::string> &);
+                              std::map<std::string, std::string> &) const;
   void WriteUnknownWordLabel(const std::map<std::string, int> &,
                              const std::map<std::string, std::string> &,
                              const Options &,
@@ -45,10 +45,13 @@ public:
     , pcfg(false)
     , phraseOrientation(false)
     , sentenceOffset(0)
+    , sortBufferSize(1024)
+    , sortedOutput(false)
     , sourceLabels(false)
     , stripBitParLabels(false)
     , stsg(false)
     , t2s(false)
+    , threads(1)
     , treeFragments(false)
     , unknownWordMinRelFreq(0.03f)
     , unknownWordUniform(false)
@@ -76,6 +79,8 @@ public:
   bool pcfg;
   bool phraseOrientation;
   int sentenceOffset;
+  int sortBufferSize;
+  bool sortedOutput;
   bool sourceLabels;
   std::string sourceLabelSetFile;
   std::string sourceUnknownWordFile;
@@ -83,6 +88,7 @@ public:
   bool stsg;
   bool t2s;
   std::string targetUnknownWordFile;
+  int threads;
   bool treeFragments;
   float unknownWordMinRelFreq;
   std::string unknownWordSoftMatchesFile;
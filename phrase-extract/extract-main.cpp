@@ -12,12 +12,23 @@
 #include <vector>
 #include <limits>
 
+#include <deque>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+
 #include "tables-core.h"
 #include "InputFileStream.h"
 #include "OutputFileStream.h"
+#include "ExtractOutput.h"
 #include "PhraseExtractionOptions.h"
 #include "SentenceAlignmentWithSyntax.h"
 #include "SyntaxNode.h"
+#include "moses/ThreadPool.h"
 #include "moses/Util.h"
 
 using namespace std;
@@ -74,11 +85,11 @@ public:
   ExtractTask(
     size_t id, SentenceAlignmentWithSyntax &sentence,
     PhraseExtractionOptions &initoptions,
-    Moses::OutputFileStream &extractFile,
-    Moses::OutputFileStream &extractFileInv,
-    Moses::OutputFileStream &extractFileOrientation,
-    Moses::OutputFileStream &extractFileContext,
-    Moses::OutputFileStream &extractFileContextInv):
+    std::ostream &extractFile,
+    std::ostream &extractFileInv,
+    std::ostream &extractFileOrientation,
+    std::ostream &extractFileContext,
+    std::ostream &extractFileContextInv):
     m_sentence(sentence),
     m_options(initoptions),
     m_extractFile(extractFile),
@@ -115,11 +126,80 @@ private:
 
   SentenceAlignmentWithSyntax &m_sentence;
   const PhraseExtractionOptions &m_options;
-  Moses::OutputFileStream &m_extractFile;
-  Moses::OutputFileStream &m_extractFileInv;
-  Moses::OutputFileStream &m_extractFileOrientation;
-  Moses::OutputFileStream &m_extractFileContext;
-  Moses::OutputFileStream &m_extractFileContextInv;
+  std::ostream &m_extractFile;
+  std::ostream &m_extractFileInv;
+  std::ostream &m_extractFileOrientation;
+  std::ostream &m_extractFileContext;
+  std::ostream &m_extractFileContextInv;
+};
+
+// The five extract files, in the order used by ExtractBlockTask.
+enum ExtractFileType {
+  EXTRACT = 0, EXTRACT_INV, EXTRACT_ORIENTATION, EXTRACT_CONTEXT, EXTRACT_CONTEXT_INV, NUM_EXTRACT_FILES
+};
+
+/** Extraction from a block of consecutive sentence pairs into memory, so
+ *  blocks can be processed concurrently and written in corpus order.
+ */
+class ExtractBlockTask : public Moses::Task
+{
+public:
+  explicit ExtractBlockTask(PhraseExtractionOptions &options)
+    : m_options(options), m_done(false) {}
+
+  ~ExtractBlockTask() {
+    for (size_t i = 0; i < m_sentences.size(); ++i) {
+      delete m_sentences[i];
+    }
+  }
+
+  // takes ownership of the sentence
+  void Add(size_t id, SentenceAlignmentWithSyntax *sentence) {
+    m_ids.push_back(id);
+    m_sentences.push_back(sentence);
+  }
+
+  size_t Size() const {
+    return m_sentences.size();
+  }
+
+  void Run() {
+    for (size_t i = 0; i < m_sentences.size(); ++i) {
+      ExtractTask task(m_ids[i], *m_sentences[i], m_options,
+                       m_out[EXTRACT], m_out[EXTRACT_INV], m_out[EXTRACT_ORIENTATION],
+                       m_out[EXTRACT_CONTEXT], m_out[EXTRACT_CONTEXT_INV]);
+      task.Run();
+    }
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    m_done = true;
+#ifdef WITH_THREADS
+    m_finished.notify_all();
+#endif
+  }
+
+  // Wait until Run() is done and append the output to the extract files.
+  void WriteTo(ExtractOutput *outputs) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!m_done) m_finished.wait(lock);
+#endif
+    for (size_t i = 0; i < NUM_EXTRACT_FILES; ++i) {
+      outputs[i].Write(m_out[i].str());
+    }
+  }
+
+private:
+  PhraseExtractionOptions &m_options;
+  vector<size_t> m_ids;
+  vector<SentenceAlignmentWithSyntax*> m_sentences;
+  ostringstream m_out[NUM_EXTRACT_FILES];
+  bool m_done;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+  boost::condition_variable m_finished;
+#endif
 };
 }
 
@@ -131,15 +211,15 @@ int main(int argc, char* argv[])
   if (argc < 6) {
     cerr << "syntax: extract en de align extract max-length [orientation [ --model [wbe|phrase|hier]-[msd|mslr|mono] ] ";
     cerr << "| --OnlyOutputSpanInfo | --NoTTable | --GZOutput | --IncludeSentenceId | --SentenceOffset n | --InstanceWeights filename ";
-    cerr << "| --TargetConstituentConstrained | --TargetConstituentBoundaries ]" << std::endl;
+    cerr << "| --TargetConstituentConstrained | --TargetConstituentBoundaries ";
+    cerr << "| --Threads n | --SortedOutput | --SortBufferSize megabytes ]" << std::endl;
     exit(1);
   }
 
-  Moses::OutputFileStream extractFile;
-  Moses::OutputFileStream extractFileInv;
-  Moses::OutputFileStream extractFileOrientation;
-  Moses::OutputFileStream extractFileContext;
-  Moses::OutputFileStream extractFileContextInv;
+  ExtractOutput extractFiles[NUM_EXTRACT_FILES];
+  size_t numThreads = 1;
+  bool sortedOutput = false;
+  size_t sortBufferMegabytes = 1024;
   const char* const &fileNameE = argv[1];
   const char* const &fileNameF = argv[2];
   const char* const &fileNameA = argv[3];
@@ -169,6 +249,20 @@ int main(int argc, char* argv[])
         exit(1);
       }
       sentenceOffset = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--Threads") == 0) {
+      if (i+1 >= argc || argv[i+1][0] < '1' || argv[i+1][0] > '9') {
+        cerr << "extract: syntax error, used switch --Threads without a positive number" << endl;
+        exit(1);
+      }
+      numThreads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--SortedOutput") == 0) {
+      sortedOutput = true;
+    } else if (strcmp(argv[i], "--SortBufferSize") == 0) {
+      if (i+1 >= argc || argv[i+1][0] < '1' || argv[i+1][0] > '9') {
+        cerr << "extract: syntax error, used switch --SortBufferSize without a positive number" << endl;
+        exit(1);
+      }
+      sortBufferMegabytes = atoi(argv[++i]);
     } else if (strcmp(argv[i], "--GZOutput") == 0) {
       options.initGzOutput(true);
     } else if (strcmp(argv[i], "--InstanceWeights") == 0) {
@@ -265,23 +359,48 @@ int main(int argc, char* argv[])
     iwFileP = instanceWeightsFile.get();
   }
 
+  // span info is printed to stdout while extracting, so keep it in order
+  if (options.isOnlyOutputSpanInfo()) {
+    numThreads = 1;
+  }
+#ifndef WITH_THREADS
+  if (numThreads > 1) {
+    cerr << "extract: compiled without threads, ignoring --Threads" << endl;
+    numThreads = 1;
+  }
+#endif
+
   // open output files
+  // Sorted output is what the training scripts get from piping the files
+  // through LC_ALL=C sort (and uniq for the context files) and gzip.
+  const string suffix = sortedOutput ? ".sorted.gz" : (options.isGzOutput() ? ".gz" : "");
+  size_t numOutputs = (options.isTranslationFlag() ? 2 : 0) + (options.isOrientationFlag() ? 1 : 0)
+                      + (options.isFlexScoreFlag() ? 2 : 0);
+  size_t sortBufferBytes = (sortBufferMegabytes << 20) / max<size_t>(numOutputs, 1);
   if (options.isTranslationFlag()) {
-    string fileNameExtractInv = fileNameExtract + ".inv" + (options.isGzOutput()?".gz":"");
-    extractFile.Open( (fileNameExtract + (options.isGzOutput()?".gz":"")).c_str());
-    extractFileInv.Open(fileNameExtractInv.c_str());
+    extractFiles[EXTRACT].Open(fileNameExtract + suffix, sortedOutput, sortBufferBytes, false);
+    extractFiles[EXTRACT_INV].Open(fileNameExtract + ".inv" + suffix, sortedOutput, sortBufferBytes, false);
   }
   if (options.isOrientationFlag()) {
-    string fileNameExtractOrientation = fileNameExtract + ".o" + (options.isGzOutput()?".gz":"");
-    extractFileOrientation.Open(fileNameExtractOrientation.c_str());
+    extractFiles[EXTRACT_ORIENTATION].Open(fileNameExtract + ".o" + suffix, sortedOutput, sortBufferBytes, false);
   }
   if (options.isFlexScoreFlag()) {
-    string fileNameExtractContext = fileNameExtract + ".context"  + (options.isGzOutput()?".gz":"");
-    string fileNameExtractContextInv = fileNameExtract + ".context.inv"  + (options.isGzOutput()?".gz":"");
-    extractFileContext.Open(fileNameExtractContext.c_str());
-    extractFileContextInv.Open(fileNameExtractContextInv.c_str());
+    extractFiles[EXTRACT_CONTEXT].Open(fileNameExtract + ".context" + suffix, sortedOutput, sortBufferBytes, true);
+    extractFiles[EXTRACT_CONTEXT_INV].Open(fileNameExtract + ".context.inv" + suffix, sortedOutput, sortBufferBytes, true);
   }
 
+  // Sentence pairs are read and parsed here, in order; blocks of them are
+  // extracted by the pool and their output is appended in corpus order.
+  const size_t sentencesPerBlock = options.isOnlyOutputSpanInfo() ? 1 : 1000;
+  std::deque<boost::shared_ptr<ExtractBlockTask> > pending;
+#ifdef WITH_THREADS
+  boost::scoped_ptr<Moses::ThreadPool> pool;
+  if (numThreads > 1) {
+    pool.reset(new Moses::ThreadPool(numThreads));
+  }
+#endif
+  boost::shared_ptr<ExtractBlockTask> block(new ExtractBlockTask(options));
+
   // stats on labels for glue grammar and unknown word label probabilities
   set< string > targetLabelCollection, sourceLabelCollection;
   map< string, int > targetTopLabelCollection, sourceTopLabelCollection;
@@ -302,7 +421,7 @@ int main(int argc, char* argv[])
       getline(*iwFileP, weightString);
     }
 
-    SentenceAlignmentWithSyntax sentence
+    SentenceAlignmentWithSyntax *sentence = new SentenceAlignmentWithSyntax
     (targetLabelCollection, sourceLabelCollection,
      targetTopLabelCollection, sourceTopLabelCollection,
      targetSyntax, false);
@@ -314,41 +433,57 @@ int main(int argc, char* argv[])
       cout << "LOG: ALT: " << alignmentString << endl;
       cout << "LOG: PHRASES_BEGIN:" << endl;
     }
-    if (sentence.create( englishString.c_str(),
-                         foreignString.c_str(),
-                         alignmentString.c_str(),
-                         weightString.c_str(),
-                         i, false)) {
+    if (sentence->create( englishString.c_str(),
+                          foreignString.c_str(),
+                          alignmentString.c_str(),
+                          weightString.c_str(),
+                          i, false)) {
       if (options.placeholders.size()) {
-        sentence.invertAlignment();
+        sentence->invertAlignment();
       }
-      ExtractTask *task = new ExtractTask(i-1, sentence, options, extractFile , extractFileInv, extractFileOrientation, extractFileContext, extractFileContextInv);
-      task->Run();
-      delete task;
+      block->Add(i-1, sentence);
+    } else {
+      delete sentence;
+    }
 
+    if (block->Size() == sentencesPerBlock) {
+#ifdef WITH_THREADS
+      if (pool) {
+        pool->Submit(block);
+        pending.push_back(block);
+        // bound the memory held by blocks waiting to be written
+        while (pending.size() > 4 * numThreads) {
+          pending.front()->WriteTo(extractFiles);
+          pending.pop_front();
+        }
+      } else
+#endif
+      {
+        block->Run();
+        block->WriteTo(extractFiles);
+      }
+      block.reset(new ExtractBlockTask(options));
     }
     if (options.isOnlyOutputSpanInfo()) cout << "LOG: PHRASES_END:" << endl; //az: mark end of phrases
   }
 
+  block->Run();
+  for (; !pending.empty(); pending.pop_front()) {
+    pending.front()->WriteTo(extractFiles);
+  }
+  block->WriteTo(extractFiles);
+#ifdef WITH_THREADS
+  if (pool) {
+    pool->Stop(true);
+  }
+#endif
+
   eFile.Close();
   fFile.Close();
   aFile.Close();
 
-  //az: only close if we actually opened it
-  if (!options.isOnlyOutputSpanInfo()) {
-    if (options.isTranslationFlag()) {
-      extractFile.Close();
-      extractFileInv.Close();
-
-    }
-    if (options.isOrientationFlag()) {
-      extractFileOrientation.Close();
-    }
-
-    if (options.isFlexScoreFlag()) {
-      extractFileContext.Close();
-      extractFileContextInv.Close();
-    }
+  for (size_t f = 0; f < NUM_EXTRACT_FILES; ++f) {
+    extractFiles[f].Close();
   }
 
   // We've been printing progress dots to stderr.  End the line.
@@ -1,9 +1,15 @@
 #include "LexicalTable.h"
 
+#include "util/file.hh"
 #include "util/tokenize_piece.hh"
 
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <limits>
+
+#include "syntax-common/exception.h"
 
 namespace MosesTraining
 {
@@ -12,9 +18,52 @@ namespace Syntax
 namespace ScoreStsg
 {
 
+namespace
+{
+
+struct Entry {
+  Vocabulary::IdType src;
+  Vocabulary::IdType tgt;
+  double prob;
+
+  bool operator<(const Entry &other) const {
+    return src < other.src || (src == other.src && tgt < other.tgt);
+  }
+};
+
+void WriteVocabulary(const Vocabulary &vocab, std::ostream &out)
+{
+  for (Vocabulary::const_iterator p = vocab.begin(); p != vocab.end(); ++p) {
+    out.write((*p)->c_str(), (*p)->size() + 1);
+  }
+}
+
+const char *ReadVocabulary(const char *p, const char *end, std::size_t size,
+                           Vocabulary &vocab)
+{
+  for (std::size_t i = 0; i < size; ++i) {
+    const char *word = p;
+    p = static_cast<const char *>(std::memchr(p, '\0', end - p));
+    if (!p) {
+      throw Exception("binary lexical table is truncated");
+    }
+    vocab.Insert(std::string(word, p));
+    ++p;
+  }
+  return p;
+}
+
+}  // namespace
+
+const char LexicalTable::kMagic[8] = {'s', 't', 's', 'g', 'l', 'e', 'x', '\0'};
+
 LexicalTable::LexicalTable(Vocabulary &srcVocab, Vocabulary &tgtVocab)
   : m_srcVocab(srcVocab)
   , m_tgtVocab(tgtVocab)
+  , m_rowOffsets(NULL)
+  , m_probs(NULL)
+  , m_targetIds(NULL)
+  , m_numSourceWords(0)
 {
 }
 
@@ -22,6 +71,7 @@ void LexicalTable::Load(std::istream &input)
 {
   const util::AnyCharacter delimiter(" \t");
 
+  std::vector<Entry> entries;
   std::string line;
   std::string tmp;
   int i = 0;
@@ -32,23 +82,137 @@ void LexicalTable::Load(std::istream &input)
     }
 
     util::TokenIter<util::AnyCharacter> it(line, delimiter);
+    Entry entry;
 
     // Target word
     it->CopyToString(&tmp);
-    Vocabulary::IdType tgtId = m_tgtVocab.Insert(tmp);
+    entry.tgt = m_tgtVocab.Insert(tmp);
     ++it;
 
     // Source word.
     it->CopyToString(&tmp);
-    Vocabulary::IdType srcId = m_srcVocab.Insert(tmp);
+    entry.src = m_srcVocab.Insert(tmp);
     ++it;
 
     // Probability.
     it->CopyToString(&tmp);
-    double prob = atof(tmp.c_str());
-    m_table[srcId][tgtId] = prob;
+    entry.prob = atof(tmp.c_str());
+    entries.push_back(entry);
   }
   std::cerr << std::endl;
+
+  if (m_tgtVocab.Size() > std::numeric_limits<uint32_t>::max()) {
+    throw Exception("lexical table has too many target words");
+  }
+
+  // If a pair occurs more than once then the last probability is used.
+  std::stable_sort(entries.begin(), entries.end());
+  m_rowOffsetsVec.assign(m_srcVocab.Size() + 1, 0);
+  m_probsVec.clear();
+  m_targetIdsVec.clear();
+  for (std::size_t j = 0; j < entries.size(); ++j) {
+    const Entry &entry = entries[j];
+    if (j+1 < entries.size() && entries[j+1].src == entry.src &&
+        entries[j+1].tgt == entry.tgt) {
+      continue;
+    }
+    m_probsVec.push_back(entry.prob);
+    m_targetIdsVec.push_back(entry.tgt);
+    m_rowOffsetsVec[entry.src+1] = m_probsVec.size();
+  }
+  // Fill in the offsets of source words without entries.
+  for (std::size_t s = 1; s < m_rowOffsetsVec.size(); ++s) {
+    m_rowOffsetsVec[s] = std::max(m_rowOffsetsVec[s], m_rowOffsetsVec[s-1]);
+  }
+
+  SetArrays(&m_rowOffsetsVec[0], m_probsVec.empty() ? NULL : &m_probsVec[0],
+            m_targetIdsVec.empty() ? NULL : &m_targetIdsVec[0],
+            m_srcVocab.Size());
+}
+
+bool LexicalTable::IsBinary(const std::string &path)
+{
+  std::ifstream in(path.c_str(), std::ios::binary);
+  char magic[sizeof(kMagic)];
+  return in.read(magic, sizeof(magic)) &&
+         std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+void LexicalTable::WriteBinary(const std::string &path) const
+{
+  std::ofstream out(path.c_str(), std::ios::binary);
+  if (!out) {
+    throw Exception("failed to open " + path + " for writing");
+  }
+  Header header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.numSourceWords = m_numSourceWords;
+  header.numTargetWords = m_tgtVocab.Size();
+  header.numEntries = m_rowOffsets[m_numSourceWords];
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(m_rowOffsets),
+            (m_numSourceWords + 1) * sizeof(uint64_t));
+  out.write(reinterpret_cast<const char *>(m_probs),
+            header.numEntries * sizeof(double));
+  out.write(reinterpret_cast<const char *>(m_targetIds),
+            header.numEntries * sizeof(uint32_t));
+  WriteVocabulary(m_srcVocab, out);
+  WriteVocabulary(m_tgtVocab, out);
+  out.close();
+  if (!out) {
+    throw Exception("failed to write " + path);
+  }
+}
+
+void LexicalTable::LoadBinary(const std::string &path)
+{
+  util::scoped_fd file(util::OpenReadOrThrow(path.c_str()));
+  const uint64_t size = util::SizeOrThrow(file.get());
+  if (size < sizeof(Header)) {
+    throw Exception(path + " is not a binary lexical table");
+  }
+  util::MapRead(util::POPULATE_OR_READ, file.get(), 0, size, m_memory);
+
+  const char *begin = static_cast<const char *>(m_memory.get());
+  const char *end = begin + size;
+  const Header *header = reinterpret_cast<const Header *>(begin);
+  if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) {
+    throw Exception(path + " is not a binary lexical table");
+  }
+  if (header->version != kVersion) {
+    throw Exception(path + " has an unsupported version");
+  }
+
+  const char *p = begin + sizeof(Header);
+  const std::size_t arraysSize = (header->numSourceWords + 1) * sizeof(uint64_t)
+                                 + header->numEntries * (sizeof(double) + sizeof(uint32_t));
+  if (static_cast<std::size_t>(end - p) < arraysSize) {
+    throw Exception("binary lexical table is truncated");
+  }
+  const uint64_t *rowOffsets = reinterpret_cast<const uint64_t *>(p);
+  p += (header->numSourceWords + 1) * sizeof(uint64_t);
+  const double *probs = reinterpret_cast<const double *>(p);
+  p += header->numEntries * sizeof(double);
+  const uint32_t *targetIds = reinterpret_cast<const uint32_t *>(p);
+  p += header->numEntries * sizeof(uint32_t);
+
+  m_srcVocab.Clear();
+  m_tgtVocab.Clear();
+  p = ReadVocabulary(p, end, header->numSourceWords, m_srcVocab);
+  ReadVocabulary(p, end, header->numTargetWords, m_tgtVocab);
+
+  SetArrays(rowOffsets, probs, targetIds, header->numSourceWords);
+}
+
+void LexicalTable::SetArrays(const uint64_t *rowOffsets, const double *probs,
+                             const uint32_t *targetIds,
+                             std::size_t numSourceWords)
+{
+  m_rowOffsets = rowOffsets;
+  m_probs = probs;
+  m_targetIds = targetIds;
+  m_numSourceWords = numSourceWords;
 }
 
 }  // namespace ScoreStsg
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <stdint.h>
+
+#include <algorithm>
 #include <istream>
 #include <string>
 #include <vector>
 
-#include <boost/unordered_map.hpp>
+#include "util/mmap.hh"
 
 #include "Vocabulary.h"
 
@@ -15,30 +18,75 @@ namespace Syntax
 namespace ScoreStsg
 {
 
+// Lexical translation probabilities, p(t|s), indexed by vocabulary IDs.  The
+// table is stored compactly: for each source word, the IDs of its target
+// words in ascending order and, in a parallel array, their probabilities.
+//
+// The table can be written to a binary file, which is memory mapped when
+// loaded.  Only the vocabularies are read into memory, so concurrent
+// score-stsg processes share one copy of the table.  The layout is the byte
+// order of the machine that wrote the file:
+//
+//   Header
+//   uint64_t rowOffsets[numSourceWords+1]  into targetIds and probs
+//   double probs[numEntries]
+//   uint32_t targetIds[numEntries]
+//   the source words, then the target words, in ID order, each terminated
+//   by '\0'
 class LexicalTable
 {
 public:
   LexicalTable(Vocabulary &, Vocabulary &);
 
+  // Loads a table in text format (target word, source word, probability).
   void Load(std::istream &);
 
-  double PermissiveLookup(Vocabulary::IdType s, Vocabulary::IdType t) {
-    OuterMap::const_iterator p = m_table.find(s);
-    if (p == m_table.end()) {
+  // Loads a binary table written by WriteBinary().
+  void LoadBinary(const std::string &path);
+
+  void WriteBinary(const std::string &path) const;
+
+  // Returns true if the file at path is a binary table.
+  static bool IsBinary(const std::string &path);
+
+  double PermissiveLookup(Vocabulary::IdType s, Vocabulary::IdType t) const {
+    if (s >= m_numSourceWords) {
       return 1.0;
     }
-    const InnerMap &inner = p->second;
-    InnerMap::const_iterator q = inner.find(t);
-    return q == inner.end() ? 1.0 : q->second;
+    const uint32_t *begin = m_targetIds + m_rowOffsets[s];
+    const uint32_t *end = m_targetIds + m_rowOffsets[s+1];
+    const uint32_t *p = std::lower_bound(begin, end, t);
+    return (p == end || *p != t) ? 1.0 : m_probs[p - m_targetIds];
   }
 
 private:
-  typedef boost::unordered_map<Vocabulary::IdType, double> InnerMap;
-  typedef boost::unordered_map<Vocabulary::IdType, InnerMap> OuterMap;
+  struct Header {
+    char magic[8];
+    uint64_t version;
+    uint64_t numSourceWords;
+    uint64_t numTargetWords;
+    uint64_t numEntries;
+  };
+
+  static const char kMagic[8];
+  static const uint64_t kVersion = 1;
+
+  void SetArrays(const uint64_t *, const double *, const uint32_t *,
+                 std::size_t);
 
   Vocabulary &m_srcVocab;
   Vocabulary &m_tgtVocab;
-  OuterMap m_table;
+
+  // The table, either in the vectors or in the mapped file.
+  std::vector<uint64_t> m_rowOffsetsVec;
+  std::vector<double> m_probsVec;
+  std::vector<uint32_t> m_targetIdsVec;
+  util::scoped_memory m_memory;
+
+  const uint64_t *m_rowOffsets;
+  const double *m_probs;
+  const uint32_t *m_targetIds;
+  std::size_t m_numSourceWords;
 };
 
 }  // namespace ScoreStsg
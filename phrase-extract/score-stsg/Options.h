@@ -20,6 +20,7 @@ public:
     , negLogProb(false)
     , noLex(false)
     , noWordAlignment(false)
+    , threads(1)
     , treeScore(false) {}
 
   // Positional options
@@ -28,6 +29,7 @@ public:
   std::string tableFile;
 
   // All other options
+  std::string binaryLexFile;
   bool goodTuring;
   bool inverse;
   bool kneserNey;
@@ -36,6 +38,7 @@ public:
   bool negLogProb;
   bool noLex;
   bool noWordAlignment;
+  int threads;
   bool treeScore;
 };
 
@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <iterator>
@@ -9,12 +10,21 @@
 #include <sstream>
 #include <vector>
 
+#include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
 
 #include "util/string_piece.hh"
 #include "util/string_piece_hash.hh"
 #include "util/tokenize_piece.hh"
 
+#include "moses/ThreadPool.h"
+
 #include "InputFileStream.h"
 #include "OutputFileStream.h"
 
@@ -34,11 +44,181 @@ namespace ScoreStsg
 
 const int ScoreStsg::kCountOfCountsMax = 10;
 
+/** Scoring of a block of consecutive rule groups into memory, so blocks can
+ *  be processed concurrently and written in input order.
+ */
+class ScoreBlockTask : public Moses::Task
+{
+public:
+  ScoreBlockTask(const ScoreStsg &tool, const Options &options)
+    : m_tool(tool)
+    , m_options(options)
+    , m_writer(options, m_out)
+    , m_numLines(0)
+    , m_countOfCounts(ScoreStsg::kCountOfCountsMax+1, 0)
+    , m_totalDistinct(0)
+    , m_done(false) {}
+
+  // Starts a new rule group, which begins at the given line.
+  RuleGroup &AddGroup(std::size_t startLine, const StringPiece &source) {
+    m_groups.resize(m_groups.size()+1);
+    m_groups.back().SetNewSource(source);
+    m_lineRanges.push_back(std::make_pair(startLine, startLine));
+    return m_groups.back();
+  }
+
+  // Records the last line of the current rule group.
+  void EndGroup(std::size_t endLine) {
+    m_lineRanges.back().second = endLine;
+    m_numLines += endLine - m_lineRanges.back().first + 1;
+  }
+
+  std::size_t GetNumLines() const {
+    return m_numLines;
+  }
+
+  void Run() {
+    for (std::size_t i = 0; i < m_groups.size(); ++i) {
+      ProcessRuleGroupOrDie(m_groups[i], m_lineRanges[i].first,
+                            m_lineRanges[i].second);
+    }
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    m_done = true;
+#ifdef WITH_THREADS
+    m_finished.notify_all();
+#endif
+  }
+
+  // Wait until Run() is done, append the rule table lines to out and add the
+  // count of counts to those of the previous blocks.
+  void WriteTo(std::ostream &out, std::vector<int> &countOfCounts,
+               int &totalDistinct) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!m_done) m_finished.wait(lock);
+#endif
+    out << m_out.str();
+    for (std::size_t i = 0; i < countOfCounts.size(); ++i) {
+      countOfCounts[i] += m_countOfCounts[i];
+    }
+    totalDistinct += m_totalDistinct;
+  }
+
+private:
+  void ProcessRuleGroup(const RuleGroup &);
+  void ProcessRuleGroupOrDie(const RuleGroup &, std::size_t, std::size_t);
+
+  const ScoreStsg &m_tool;
+  const Options &m_options;
+
+  std::vector<RuleGroup> m_groups;
+  std::vector<std::pair<std::size_t, std::size_t> > m_lineRanges;
+
+  std::ostringstream m_out;
+  RuleTableWriter m_writer;
+  std::size_t m_numLines;
+  std::vector<int> m_countOfCounts;
+  int m_totalDistinct;
+
+  TokenizedRuleHalf m_sourceHalf;
+  TokenizedRuleHalf m_targetHalf;
+  std::vector<Vocabulary::IdType> m_sourceIds;
+  ALIGNMENT m_tgtToSrc;
+
+  bool m_done;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+  boost::condition_variable m_finished;
+#endif
+};
+
+void ScoreBlockTask::ProcessRuleGroupOrDie(const RuleGroup &group,
+                                           std::size_t start,
+                                           std::size_t end)
+{
+  try {
+    ProcessRuleGroup(group);
+  } catch (const Exception &e) {
+    std::ostringstream msg;
+    msg << "failed to process rule group at lines " << start << "-" << end
+        << ": " << e.msg();
+    m_tool.Error(msg.str());
+  } catch (const std::exception &e) {
+    std::ostringstream msg;
+    msg << "failed to process rule group at lines " << start << "-" << end
+        << ": " << e.what();
+    m_tool.Error(msg.str());
+  }
+}
+
+void ScoreBlockTask::ProcessRuleGroup(const RuleGroup &group)
+{
+  const std::size_t totalCount = group.GetTotalCount();
+  const std::size_t distinctCount = group.GetSize();
+
+  m_tool.TokenizeRuleHalf(group.GetSource(), m_sourceHalf);
+
+  const bool fullyLexical = m_sourceHalf.IsFullyLexical();
+
+  // The source symbols are looked up in the vocabulary once for the group.
+  if (!m_options.noLex) {
+    m_tool.LookupSourceIds(m_sourceHalf.frontierSymbols, m_sourceIds);
+  }
+
+  // Process each distinct rule in turn.
+  for (RuleGroup::ConstIterator p = group.Begin(); p != group.End(); ++p) {
+    const RuleGroup::DistinctRule &rule = *p;
+
+    // Update count of count statistics.
+    if (m_options.goodTuring || m_options.kneserNey) {
+      ++m_totalDistinct;
+      int countInt = rule.count + 0.99999;
+      if (countInt <= ScoreStsg::kCountOfCountsMax) {
+        ++m_countOfCounts[countInt];
+      }
+    }
+
+    // If the rule is not fully lexical then discard it if the count is below
+    // the threshold value.
+    if (!fullyLexical && rule.count < m_options.minCountHierarchical) {
+      continue;
+    }
+
+    m_tool.TokenizeRuleHalf(rule.target, m_targetHalf);
+
+    // Find the most frequent alignment (if there's a tie, take the first one).
+    std::vector<std::pair<std::string, int> >::const_iterator q =
+      rule.alignments.begin();
+    const std::pair<std::string, int> *bestAlignmentAndCount = &(*q++);
+    for (; q != rule.alignments.end(); ++q) {
+      if (q->second > bestAlignmentAndCount->second) {
+        bestAlignmentAndCount = &(*q);
+      }
+    }
+    const std::string &bestAlignment = bestAlignmentAndCount->first;
+    m_tool.ParseAlignmentString(bestAlignment,
+                                m_targetHalf.frontierSymbols.size(),
+                                m_tgtToSrc);
+
+    // Compute the lexical translation probability.
+    double lexProb = 1.0;
+    if (!m_options.noLex) {
+      lexProb = m_tool.ComputeLexProb(m_sourceIds,
+                                      m_targetHalf.frontierSymbols,
+                                      m_tgtToSrc);
+    }
+
+    // Write a line to the rule table.
+    m_writer.WriteLine(m_sourceHalf, m_targetHalf, bestAlignment, lexProb,
+                       rule.treeScore, p->count, totalCount, distinctCount);
+  }
+}
+
 ScoreStsg::ScoreStsg()
   : Tool("score-stsg")
   , m_lexTable(m_srcVocab, m_tgtVocab)
-  , m_countOfCounts(kCountOfCountsMax, 0)
-  , m_totalDistinct(0)
 {
 }
 
@@ -49,7 +229,6 @@ int ScoreStsg::Main(int argc, char *argv[])
 
   // Open input files.
   Moses::InputFileStream extractStream(m_options.extractFile);
-  Moses::InputFileStream lexStream(m_options.lexFile);
 
   // Open output files.
   Moses::OutputFileStream outStream;
@@ -61,16 +240,29 @@ int ScoreStsg::Main(int argc, char *argv[])
 
   // Load lexical table.
   if (!m_options.noLex) {
-    m_lexTable.Load(lexStream);
+    LoadLexicalTable();
+  }
+
+  // Lines are read and grouped here, in order; blocks of rule groups are
+  // scored by the pool and their lines are written in input order.
+  const std::size_t linesPerBlock = 10000;
+  const std::size_t numThreads = m_options.threads;
+  std::deque<boost::shared_ptr<ScoreBlockTask> > pending;
+#ifdef WITH_THREADS
+  boost::scoped_ptr<Moses::ThreadPool> pool;
+  if (numThreads > 1) {
+    pool.reset(new Moses::ThreadPool(numThreads));
   }
+#endif
+  boost::shared_ptr<ScoreBlockTask> block(new ScoreBlockTask(*this, m_options));
+  std::vector<int> countOfCounts(kCountOfCountsMax+1, 0);
+  int totalDistinct = 0;
 
   const util::MultiCharacter delimiter("|||");
   std::size_t lineNum = 0;
-  std::size_t startLine= 0;
   std::string line;
   std::string tmp;
-  RuleGroup ruleGroup;
-  RuleTableWriter ruleTableWriter(m_options, outStream);
+  RuleGroup *ruleGroup = NULL;
 
   while (std::getline(extractStream, line)) {
     ++lineNum;
@@ -91,36 +283,101 @@ int ScoreStsg::Main(int argc, char *argv[])
     }
 
     // If this is the first line or if source has changed since the last
-    // line then process the current rule group and start a new one.
-    if (source != ruleGroup.GetSource()) {
-      if (lineNum > 1) {
-        ProcessRuleGroupOrDie(ruleGroup, ruleTableWriter, startLine, lineNum-1);
+    // line then end the current rule group and start a new one.  Full blocks
+    // are scored.
+    if (!ruleGroup || source != ruleGroup->GetSource()) {
+      if (ruleGroup) {
+        block->EndGroup(lineNum-1);
+      }
+      if (block->GetNumLines() >= linesPerBlock) {
+#ifdef WITH_THREADS
+        if (pool) {
+          pool->Submit(block);
+          pending.push_back(block);
+          // bound the memory held by blocks waiting to be written
+          while (pending.size() > 4 * numThreads) {
+            pending.front()->WriteTo(outStream, countOfCounts, totalDistinct);
+            pending.pop_front();
+          }
+        } else
+#endif
+        {
+          block->Run();
+          block->WriteTo(outStream, countOfCounts, totalDistinct);
+        }
+        block.reset(new ScoreBlockTask(*this, m_options));
       }
-      startLine = lineNum;
-      ruleGroup.SetNewSource(source);
+      ruleGroup = &block->AddGroup(lineNum, source);
     }
 
     // Add the rule to the current rule group.
-    ruleGroup.AddRule(target, ntAlign, fullAlign, count, treeScore);
+    ruleGroup->AddRule(target, ntAlign, fullAlign, count, treeScore);
   }
 
   // Process the final rule group.
-  ProcessRuleGroupOrDie(ruleGroup, ruleTableWriter, startLine, lineNum);
+  if (ruleGroup) {
+    block->EndGroup(lineNum);
+  }
+  block->Run();
+  for (; !pending.empty(); pending.pop_front()) {
+    pending.front()->WriteTo(outStream, countOfCounts, totalDistinct);
+  }
+  block->WriteTo(outStream, countOfCounts, totalDistinct);
+#ifdef WITH_THREADS
+  if (pool) {
+    pool->Stop(true);
+  }
+#endif
 
   // Write count of counts file.
   if (m_options.goodTuring || m_options.kneserNey) {
     // Kneser-Ney needs the total number of distinct rules.
-    countOfCountsStream << m_totalDistinct << std::endl;
+    countOfCountsStream << totalDistinct << std::endl;
     // Write out counts of counts.
     for (int i = 1; i <= kCountOfCountsMax; ++i) {
-      countOfCountsStream << m_countOfCounts[i] << std::endl;
+      countOfCountsStream << countOfCounts[i] << std::endl;
     }
   }
 
   return 0;
 }
 
-void ScoreStsg::TokenizeRuleHalf(const std::string &s, TokenizedRuleHalf &half)
+void ScoreStsg::LoadLexicalTable()
+{
+  namespace fs = boost::filesystem;
+
+  const std::string &binaryFile = m_options.binaryLexFile;
+  try {
+    if (LexicalTable::IsBinary(m_options.lexFile)) {
+      m_lexTable.LoadBinary(m_options.lexFile);
+      return;
+    }
+    if (!binaryFile.empty() && LexicalTable::IsBinary(binaryFile) &&
+        fs::last_write_time(binaryFile) >=
+        fs::last_write_time(m_options.lexFile)) {
+      m_lexTable.LoadBinary(binaryFile);
+      return;
+    }
+
+    Moses::InputFileStream lexStream(m_options.lexFile);
+    m_lexTable.Load(lexStream);
+
+    // Write to a temporary file first, so that concurrent processes never
+    // see a partial table.
+    if (!binaryFile.empty()) {
+      fs::path tmpFile = fs::unique_path(binaryFile + ".%%%%%%%%");
+      m_lexTable.WriteBinary(tmpFile.string());
+      fs::rename(tmpFile, binaryFile);
+    }
+  } catch (const Exception &e) {
+    Error("failed to load lexical table: " + e.msg());
+  } catch (const std::exception &e) {
+    Error(std::string("failed to load lexical table: ") + e.what());
+  }
+}
+
+void ScoreStsg::TokenizeRuleHalf(const std::string &s,
+                                 TokenizedRuleHalf &half) const
 {
   // Copy s to half.string, but strip any leading or trailing whitespace.
   std::size_t start = s.find_first_not_of(" \t");
@@ -161,82 +418,8 @@ void ScoreStsg::TokenizeRuleHalf(const std::string &s, TokenizedRuleHalf &half)
   }
 }
 
-void ScoreStsg::ProcessRuleGroupOrDie(const RuleGroup &group,
-                                      RuleTableWriter &writer,
-                                      std::size_t start,
-                                      std::size_t end)
-{
-  try {
-    ProcessRuleGroup(group, writer);
-  } catch (const Exception &e) {
-    std::ostringstream msg;
-    msg << "failed to process rule group at lines " << start << "-" << end
-        << ": " << e.msg();
-    Error(msg.str());
-  } catch (const std::exception &e) {
-    std::ostringstream msg;
-    msg << "failed to process rule group at lines " << start << "-" << end
-        << ": " << e.what();
-    Error(msg.str());
-  }
-}
-
-void ScoreStsg::ProcessRuleGroup(const RuleGroup &group,
-                                 RuleTableWriter &writer)
-{
-  const std::size_t totalCount = group.GetTotalCount();
-  const std::size_t distinctCount = group.GetSize();
-
-  TokenizeRuleHalf(group.GetSource(), m_sourceHalf);
-
-  const bool fullyLexical = m_sourceHalf.IsFullyLexical();
-
-  // Process each distinct rule in turn.
-  for (RuleGroup::ConstIterator p = group.Begin(); p != group.End(); ++p) {
-    const RuleGroup::DistinctRule &rule = *p;
-
-    // Update count of count statistics.
-    if (m_options.goodTuring || m_options.kneserNey) {
-      ++m_totalDistinct;
-      int countInt = rule.count + 0.99999;
-      if (countInt <= kCountOfCountsMax) {
-        ++m_countOfCounts[countInt];
-      }
-    }
-
-    // If the rule is not fully lexical then discard it if the count is below
-    // the threshold value.
-    if (!fullyLexical && rule.count < m_options.minCountHierarchical) {
-      continue;
-    }
-
-    TokenizeRuleHalf(rule.target, m_targetHalf);
-
-    // Find the most frequent alignment (if there's a tie, take the first one).
-    std::vector<std::pair<std::string, int> >::const_iterator q =
-      rule.alignments.begin();
-    const std::pair<std::string, int> *bestAlignmentAndCount = &(*q++);
-    for (; q != rule.alignments.end(); ++q) {
-      if (q->second > bestAlignmentAndCount->second) {
-        bestAlignmentAndCount = &(*q);
-      }
-    }
-    const std::string &bestAlignment = bestAlignmentAndCount->first;
-    ParseAlignmentString(bestAlignment, m_targetHalf.frontierSymbols.size(),
-                         m_tgtToSrc);
-
-    // Compute the lexical translation probability.
-    double lexProb = ComputeLexProb(m_sourceHalf.frontierSymbols,
-                                    m_targetHalf.frontierSymbols, m_tgtToSrc);
-
-    // Write a line to the rule table.
-    writer.WriteLine(m_sourceHalf, m_targetHalf, bestAlignment, lexProb,
-                     rule.treeScore, p->count, totalCount, distinctCount);
-  }
-}
-
 void ScoreStsg::ParseAlignmentString(const std::string &s, int numTgtWords,
-                                     ALIGNMENT &tgtToSrc)
+                                     ALIGNMENT &tgtToSrc) const
 {
   tgtToSrc.clear();
   tgtToSrc.resize(numTgtWords);
@@ -268,9 +451,20 @@ void ScoreStsg::ParseAlignmentString(const std::string &s, int numTgtWords,
   }
 }
 
-double ScoreStsg::ComputeLexProb(const std::vector<RuleSymbol> &sourceFrontier,
+void ScoreStsg::LookupSourceIds(const std::vector<RuleSymbol> &sourceFrontier,
+                                std::vector<Vocabulary::IdType> &ids) const
+{
+  ids.clear();
+  for (std::size_t i = 0; i < sourceFrontier.size(); ++i) {
+    ids.push_back(m_srcVocab.Lookup(sourceFrontier[i].value,
+                                    StringPieceCompatibleHash(),
+                                    StringPieceCompatibleEquals()));
+  }
+}
+
+double ScoreStsg::ComputeLexProb(const std::vector<Vocabulary::IdType> &sourceIds,
                                  const std::vector<RuleSymbol> &targetFrontier,
-                                 const ALIGNMENT &tgtToSrc)
+                                 const ALIGNMENT &tgtToSrc) const
 {
   double lexScore = 1.0;
   for (std::size_t i = 0; i < targetFrontier.size(); ++i) {
@@ -288,11 +482,7 @@ double ScoreStsg::ComputeLexProb(const std::vector<RuleSymbol> &sourceFrontier,
       double thisWordScore = 0.0;
       for (std::set<std::size_t>::const_iterator p = srcIndices.begin();
            p != srcIndices.end(); ++p) {
-        Vocabulary::IdType srcId =
-          m_srcVocab.Lookup(sourceFrontier[*p].value,
-                            StringPieceCompatibleHash(),
-                            StringPieceCompatibleEquals());
-        thisWordScore += m_lexTable.PermissiveLookup(srcId, tgtId);
+        thisWordScore += m_lexTable.PermissiveLookup(sourceIds[*p], tgtId);
       }
       lexScore *= thisWordScore / static_cast<double>(srcIndices.size());
     }
@@ -320,6 +510,9 @@ void ScoreStsg::ProcessOptions(int argc, char *argv[], Options &options) const
   // Declare the command line options that are visible to the user.
   po::options_description visible(usageTop.str());
   visible.add_options()
+  ("BinaryLex",
+   po::value(&options.binaryLexFile),
+   "read the lexical table from the named binary file, writing it from LEX first if it is missing or older than LEX (LEX itself may be a binary file)")
   ("GoodTuring",
    "apply Good-Turing smoothing to relative frequency probability estimates")
   ("Hierarchical",
@@ -342,6 +535,9 @@ void ScoreStsg::ProcessOptions(int argc, char *argv[], Options &options) const
    "do not output word alignments")
   ("PCFG",
    "synonym for TreeScore (included for compatibility with score)")
+  ("Threads",
+   po::value(&options.threads)->default_value(options.threads),
+   "set number of threads, lines are written in input order")
   ("TreeScore",
    "include pre-computed tree score from extract")
   ("UnpairedExtractFormat",
@@ -424,6 +620,16 @@ void ScoreStsg::ProcessOptions(int argc, char *argv[], Options &options) const
   if (vm.count("TreeScore") || vm.count("PCFG")) {
     options.treeScore = true;
   }
+
+  if (options.threads < 1) {
+    Error("--Threads must be at least 1");
+  }
+#ifndef WITH_THREADS
+  if (options.threads > 1) {
+    Warn("compiled without threads, ignoring --Threads");
+    options.threads = 1;
+  }
+#endif
 }
 
 }  // namespace ScoreStsg
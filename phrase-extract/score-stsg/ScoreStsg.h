@@ -25,7 +25,7 @@ namespace ScoreStsg
 {
 
 class RuleGroup;
-class RuleTableWriter;
+class ScoreBlockTask;
 
 class ScoreStsg : public Tool
 {
@@ -35,33 +35,30 @@ public:
   virtual int Main(int argc, char *argv[]);
 
 private:
+  friend class ScoreBlockTask;
+
   static const int kCountOfCountsMax;
 
-  double ComputeLexProb(const std::vector<RuleSymbol> &,
+  double ComputeLexProb(const std::vector<Vocabulary::IdType> &,
                         const std::vector<RuleSymbol> &,
-                        const ALIGNMENT &);
+                        const ALIGNMENT &) const;
 
-  void ParseAlignmentString(const std::string &, int,
-                            ALIGNMENT &);
+  void LoadLexicalTable();
 
-  void ProcessOptions(int, char *[], Options &) const;
+  void LookupSourceIds(const std::vector<RuleSymbol> &,
+                       std::vector<Vocabulary::IdType> &) const;
 
-  void ProcessRuleGroup(const RuleGroup &, RuleTableWriter &);
+  void ParseAlignmentString(const std::string &, int,
+                            ALIGNMENT &) const;
 
-  void ProcessRuleGroupOrDie(const RuleGroup &, RuleTableWriter &,
-                             std::size_t, std::size_t);
+  void ProcessOptions(int, char *[], Options &) const;
 
-  void TokenizeRuleHalf(const std::string &, TokenizedRuleHalf &);
+  void TokenizeRuleHalf(const std::string &, TokenizedRuleHalf &) const;
 
   Options m_options;
   Vocabulary m_srcVocab;
   Vocabulary m_tgtVocab;
   LexicalTable m_lexTable;
-  std::vector<int> m_countOfCounts;
-  int m_totalDistinct;
-  TokenizedRuleHalf m_sourceHalf;
-  TokenizedRuleHalf m_targetHalf;
-  ALIGNMENT m_tgtToSrc;
 };
 
 }  // namespace ScoreStsg
@@ -0,0 +1,2 @@
+#!/bin/sh
+./bjam -j1 -q cxxflags=-std=gnu++11 -w moses-cmd//moses moses//moses_test misc//CreateBinaryRuleTable